@@ -1,234 +1,541 @@
 #ifndef BENCHED_U_ARE
 #define BENCHED_U_ARE
 
+/*
+  Statistical benchmark harness for de_bitmask.
+  Every case runs at each mask size of a geometric sweep. For one case and
+  size the harness
+    1. calibrates an iteration count so one trial takes trial_ns,
+    2. runs it for warmup_ns to settle caches, page faults and clocks,
+    3. times `trials` trials and reports min / median / p99 per op.
+  Bulk cases also report GB/s and cycles/byte over the mask size in bytes,
+  one operand worth of data, so they line up with the memcpy / memset
+  baselines of the same size. Cycles are TSC reference cycles, on non x86
+  targets they are left out.
+  Output is a table for reading or CSV / JSON for tracking results across
+  versions; CSV and JSON carry the active SIMD level so runs with different
+  kernels are not mixed up.
+*/
+
 #include "common.h"
 #include "de_bitmask.h"
 
-#include <stdarg.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
-#include <vadefs.h>
 
-static inline double timespec_diff_sec(struct timespec start,
-                                       struct timespec end) {
-  return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC
+#endif
+
+#define BENCH_VERSION "2"
+/* random indices / ranges cycled through by the single-bit cases */
+#define BENCH_IDX_AMOUNT ((usize)4096)
+#define BENCH_MAX_TRIALS ((usize)1024)
+
+/* keeps the compiler from dropping or hoisting work on _ptr */
+#if defined(__GNUC__)
+#define BENCH_CLOBBER(_ptr) __asm__ __volatile__("" : : "g"(_ptr) : "memory")
+#else
+#define BENCH_CLOBBER(_ptr) ((u0)(_ptr))
+#endif
+
+typedef enum {
+  BENCH_FMT_TABLE = 0,
+  BENCH_FMT_CSV,
+  BENCH_FMT_JSON,
+} bench_format;
+
+typedef struct {
+  usize min_bits;
+  usize max_bits;
+  usize step;      /* size multiplier between sweep points, >= 2 */
+  usize trials;    /* timed trials per case and size */
+  u64 warmup_ns;   /* untimed run before the trials */
+  u64 trial_ns;    /* calibration target for one trial */
+  const char *filter; /* only run cases whose name contains this, or NULL */
+  bench_format format;
+  FILE *out;
+} bench_config;
+
+static inline bench_config bench_config_default(u0) {
+  return (bench_config){.min_bits = (usize)1 << 6,
+                        .max_bits = (usize)1 << 30,
+                        .step = 4,
+                        .trials = 21,
+                        .warmup_ns = 20000000,
+                        .trial_ns = 2000000,
+                        .filter = NULL,
+                        .format = BENCH_FMT_TABLE,
+                        .out = stdout};
 }
 
-#define bench_for_start(iterations, ops_per_sec_output, for_body)              \
-  do {                                                                         \
-    struct timespec start, end;                                                \
-    clock_gettime(CLOCK_MONOTONIC, &start);                                    \
-    for (usize i = 0; i < iterations; i++) {                                   \
-      for_body                                                                 \
-    }                                                                          \
-    clock_gettime(CLOCK_MONOTONIC, &end);                                      \
-    ops_per_sec_output =                                                       \
-        (usize)((double)iterations / timespec_diff_sec(start, end));           \
-  } while (0)
+/* state shared by every case at one size */
+typedef struct {
+  usize bits;
+  usize bytes;
+  de_bvec a;
+  de_bvec b;
+  de_bvec tmp;
+  mblk_t *raw_src;
+  mblk_t *raw_dst;
+  usize idx[BENCH_IDX_AMOUNT];
+  usize lo[BENCH_IDX_AMOUNT];
+  usize hi[BENCH_IDX_AMOUNT];
+  volatile usize sink;
+} bench_ctx;
 
-usize bench_msk_get(de_bvec *const msk, const usize msk_size,
-                    const usize iterations) {
-  usize ops_per_second;
-  volatile bool k;
-  bench_for_start(iterations, ops_per_second,
-                  { k = de_bvec_get(msk, i % msk_size); });
+typedef struct {
+  const char *name;
+  bool bulk; /* touches the whole mask, GB/s and cycles/byte apply */
+  u0 (*prepare)(bench_ctx *const _ctx); /* untimed, may be NULL */
+  u0 (*run)(bench_ctx *const _ctx, const usize _iters);
+} bench_case;
 
-  return ops_per_second;
+typedef struct {
+  const char *name;
+  usize bits;
+  usize iters;
+  usize trials;
+  double min_ns;
+  double median_ns;
+  double p99_ns;
+  double gbps;            /* < 0 when not a bulk case */
+  double cycles_per_byte; /* < 0 when not a bulk case or no TSC */
+} bench_result;
+
+/* ---- Clocks ---- */
+static inline u64 bench_now_ns(u0) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000u + (u64)ts.tv_nsec;
 }
 
-usize bench_msk_set(de_bvec *const msk, const usize msk_size,
-                    const usize iterations) {
-  usize ops_per_second;
-  bench_for_start(iterations, ops_per_second,
-                  { de_bvec_set(msk, i % msk_size, i % 2); });
-
-  return ops_per_second;
+static inline u64 bench_cycles(u0) {
+#ifdef BENCH_HAS_TSC
+  return (u64)__rdtsc();
+#else
+  return 0;
+#endif
 }
 
-usize bench_msk_set_range(de_bvec *const msk, const usize msk_size,
-                          const usize iterations) {
-  usize ops_per_second;
-  const usize vals[5] = {msk_size, (usize)msk_size / 2, (usize)msk_size / 3,
-                         (usize)msk_size / 4, (usize)msk_size / 5};
-  const usize vals2[5] = {(usize)msk_size / 2, (usize)msk_size / 3,
-                          (usize)msk_size / 4, (usize)msk_size / 5, 0};
-
-  bench_for_start(iterations, ops_per_second, {
-    de_bvec_set_range(msk, vals2[i % 5], vals[i % 5], i % 2);
-  });
-
-  return ops_per_second;
+/* ---- Context ---- */
+static inline u64 bench_rand(u64 *const _state) {
+  u64 x = *_state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  return *_state = x;
 }
 
-usize bench_msk_create(const usize msk_size, const usize iterations) {
-  usize ops_per_second;
-  // i know this leaks memory if not soo :)
-  bench_for_start(iterations, ops_per_second,
-                  { volatile de_bvec msk = de_bvec_create(msk_size); });
-
-  return ops_per_second;
+static inline u0 bench_fill_random(de_bvec *const _msk, u64 *const _state) {
+  mblk_t *const blocks = DE_BVEC_data(_msk);
+  for (usize i = 0; i < _msk->block_count; ++i)
+    blocks[i] = bench_rand(_state);
+  /* bits past the end must stay 0 */
+  if (_msk->block_count && _msk->last_block_bits_count < DE_BVEC_MBLK_BITS)
+    blocks[_msk->block_count - 1] &=
+        ((mblk_t)1 << _msk->last_block_bits_count) - 1;
+  de_bvec_count_invalidate(_msk);
 }
 
-usize bench_msk_delete(const usize msk_size, const usize iterations) {
-  usize ops_per_second;
-  volatile de_bvec msk = de_bvec_create(msk_size);
-  // i know this leaks memory if not soo :)
-  bench_for_start(iterations, ops_per_second, { de_bvec_delete(&msk); });
-
-  return ops_per_second;
+static inline bool bench_ctx_init(bench_ctx *const _ctx, const usize _bits) {
+  u64 state = 0x9E3779B97F4A7C15ull ^ _bits;
+  _ctx->bits = _bits;
+  _ctx->bytes = (_bits + DE_BVEC_MBLK_BITS - 1) / DE_BVEC_MBLK_BITS *
+                sizeof(mblk_t);
+  _ctx->a = de_bvec_create(_bits);
+  _ctx->b = de_bvec_create(_bits);
+  _ctx->tmp = de_bvec_create(0);
+  _ctx->raw_src = (mblk_t *)malloc(_ctx->bytes);
+  _ctx->raw_dst = (mblk_t *)malloc(_ctx->bytes);
+  if (!de_bvec_info_valid(&_ctx->a) || !de_bvec_info_valid(&_ctx->b) ||
+      !_ctx->raw_src || !_ctx->raw_dst)
+    return false;
+  bench_fill_random(&_ctx->a, &state);
+  bench_fill_random(&_ctx->b, &state);
+  memset(_ctx->raw_src, 0x5A, _ctx->bytes);
+  memset(_ctx->raw_dst, 0, _ctx->bytes);
+  for (usize i = 0; i < BENCH_IDX_AMOUNT; ++i) {
+    const usize x = (usize)(bench_rand(&state) % _bits);
+    const usize y = (usize)(bench_rand(&state) % _bits);
+    _ctx->idx[i] = x;
+    _ctx->lo[i] = x < y ? x : y;
+    _ctx->hi[i] = x < y ? y : x;
+  }
+  _ctx->sink = 0;
+  return true;
 }
 
-usize bench_msk_copy(const usize msk_size, const usize iterations) {
-
-  usize ops_per_second;
-  volatile de_bvec msk1 = de_bvec_create(msk_size);
-  volatile de_bvec msk2 = de_bvec_create(msk_size);
-  de_bvec_flip_range(&msk2, msk_size / 4, msk_size / 2);
-  // i know this leaks memory if not soo :)
-  bench_for_start(iterations, ops_per_second, { de_bvec_copy(&msk1, &msk2); });
-
-  return ops_per_second;
+static inline u0 bench_ctx_free(bench_ctx *const _ctx) {
+  de_bvec_delete(&_ctx->a);
+  de_bvec_delete(&_ctx->b);
+  de_bvec_delete(&_ctx->tmp);
+  free(_ctx->raw_src);
+  free(_ctx->raw_dst);
 }
 
-usize bench_msk_move(const usize msk_size, const usize iterations) {
+/* ---- Cases ---- */
+#define BENCH_IDX(_i) ((_i) & (BENCH_IDX_AMOUNT - 1))
 
-  usize ops_per_second;
-  volatile de_bvec msk1 = de_bvec_create(msk_size);
-  volatile de_bvec msk2 = de_bvec_create(msk_size);
-  de_bvec_flip_range(&msk2, msk_size / 4, msk_size / 2);
-  const usize its = iterations / 2;
-  bench_for_start(its, ops_per_second, {
-    de_bvec_move(&msk1, &msk2);
-    de_bvec_move(&msk2, &msk1);
-  });
-
-  // *2 since we do the operation twice
-  return ops_per_second * 2;
+static u0 bench_get(bench_ctx *const _ctx, const usize _iters) {
+  usize acc = 0;
+  for (usize i = 0; i < _iters; ++i)
+    acc += de_bvec_get(&_ctx->a, _ctx->idx[BENCH_IDX(i)]);
+  _ctx->sink += acc;
 }
 
-usize bench_msk_fill(de_bvec *const msk, const usize msk_size,
-                     const usize iterations) {
-  usize ops_per_second;
-  bench_for_start(iterations, ops_per_second, { de_bvec_fill(msk); });
+static u0 bench_set(bench_ctx *const _ctx, const usize _iters) {
+  for (usize i = 0; i < _iters; ++i)
+    de_bvec_set(&_ctx->a, _ctx->idx[BENCH_IDX(i)], i & 1);
+  BENCH_CLOBBER(&_ctx->a);
+}
 
-  return ops_per_second;
+static u0 bench_flip(bench_ctx *const _ctx, const usize _iters) {
+  for (usize i = 0; i < _iters; ++i)
+    de_bvec_flip(&_ctx->a, _ctx->idx[BENCH_IDX(i)]);
+  BENCH_CLOBBER(&_ctx->a);
 }
 
-usize bench_msk_clear(de_bvec *const msk, const usize msk_size,
-                      const usize iterations) {
-  usize ops_per_second;
-  bench_for_start(iterations, ops_per_second, { de_bvec_clear(msk); });
+static u0 bench_set_range(bench_ctx *const _ctx, const usize _iters) {
+  for (usize i = 0; i < _iters; ++i)
+    de_bvec_set_range(&_ctx->a, _ctx->lo[BENCH_IDX(i)],
+                      _ctx->hi[BENCH_IDX(i)], i & 1);
+  BENCH_CLOBBER(&_ctx->a);
+}
 
-  return ops_per_second;
+static u0 bench_find_next(bench_ctx *const _ctx, const usize _iters) {
+  usize acc = 0;
+  for (usize i = 0; i < _iters; ++i)
+    acc += de_bvec_find_next(&_ctx->a, _ctx->idx[BENCH_IDX(i)]);
+  _ctx->sink += acc;
 }
 
-usize bench_msk_any(de_bvec *const msk, const usize msk_size,
-                    const usize iterations) {
-  usize ops_per_second;
-  volatile bool res;
-  de_bvec_clear(msk);
-  bench_for_start(iterations, ops_per_second, { res = de_bvec_any(msk); });
+static u0 bench_create_delete(bench_ctx *const _ctx, const usize _iters) {
+  for (usize i = 0; i < _iters; ++i) {
+    de_bvec msk = de_bvec_create(_ctx->bits);
+    BENCH_CLOBBER(&msk);
+    de_bvec_delete(&msk);
+  }
+}
 
-  return ops_per_second;
+static u0 bench_copy(bench_ctx *const _ctx, const usize _iters) {
+  for (usize i = 0; i < _iters; ++i) {
+    de_bvec_copy(&_ctx->a, &_ctx->b);
+    BENCH_CLOBBER(&_ctx->a);
+  }
 }
-usize bench_msk_none(de_bvec *const msk, const usize msk_size,
-                     const usize iterations) {
-  usize ops_per_second;
-  volatile bool res;
-  de_bvec_clear(msk);
-  bench_for_start(iterations, ops_per_second, { res = de_bvec_none(msk); });
 
-  return ops_per_second;
+static u0 bench_move(bench_ctx *const _ctx, const usize _iters) {
+  for (usize i = 0; i < _iters; ++i) {
+    if (i & 1)
+      de_bvec_move(&_ctx->a, &_ctx->tmp);
+    else
+      de_bvec_move(&_ctx->tmp, &_ctx->a);
+    BENCH_CLOBBER(&_ctx->a);
+  }
+  if (_iters & 1)
+    de_bvec_move(&_ctx->a, &_ctx->tmp);
 }
 
-usize bench_msk_all(de_bvec *const msk, const usize msk_size,
-                    const usize iterations) {
-  usize ops_per_second;
-  volatile bool res;
-  de_bvec_fill(msk);
-  bench_for_start(iterations, ops_per_second, { res = de_bvec_all(msk); });
+static u0 bench_fill(bench_ctx *const _ctx, const usize _iters) {
+  for (usize i = 0; i < _iters; ++i) {
+    de_bvec_fill(&_ctx->a);
+    BENCH_CLOBBER(&_ctx->a);
+  }
+}
 
-  return ops_per_second;
+static u0 bench_clear(bench_ctx *const _ctx, const usize _iters) {
+  for (usize i = 0; i < _iters; ++i) {
+    de_bvec_clear(&_ctx->a);
+    BENCH_CLOBBER(&_ctx->a);
+  }
 }
-usize bench_msk_count(de_bvec *const msk, const usize msk_size,
-                      const usize iterations) {
-  usize ops_per_second;
-  volatile usize res;
-  de_bvec_fill(msk);
-  bench_for_start(iterations, ops_per_second, { res = de_bvec_count(msk); });
 
-  return ops_per_second;
+static u0 bench_not(bench_ctx *const _ctx, const usize _iters) {
+  for (usize i = 0; i < _iters; ++i) {
+    de_bvec_not(&_ctx->a);
+    BENCH_CLOBBER(&_ctx->a);
+  }
 }
-usize bench_msk_print(de_bvec *const msk, const usize msk_size,
-                      const usize iterations) {
-  usize ops_per_second;
 
-  FILE *old_stdout = stdout; // just for clarity
-  fflush(stdout);            // flush anything pending
+#define BENCH_DEFINE_BINOP(_name)                                              \
+  static u0 bench_##_name(bench_ctx *const _ctx, const usize _iters) {         \
+    for (usize i = 0; i < _iters; ++i) {                                       \
+      de_bvec_##_name(&_ctx->a, &_ctx->b);                                     \
+      BENCH_CLOBBER(&_ctx->a);                                                 \
+    }                                                                          \
+  }
 
-  freopen("/dev/null", "w", stdout); // redirect stdout to /dev/null
+BENCH_DEFINE_BINOP(and_msk)
+BENCH_DEFINE_BINOP(or_msk)
+BENCH_DEFINE_BINOP(xor_msk)
 
-  // run your benchmark
-  bench_for_start(iterations, ops_per_second, { de_bvec_print(msk); });
+#define BENCH_DEFINE_QUERY(_name, _call)                                       \
+  static u0 bench_##_name(bench_ctx *const _ctx, const usize _iters) {         \
+    usize acc = 0;                                                             \
+    for (usize i = 0; i < _iters; ++i) {                                       \
+      BENCH_CLOBBER(&_ctx->a);                                                 \
+      acc += (usize)(_call);                                                   \
+    }                                                                          \
+    _ctx->sink += acc;                                                         \
+  }
 
-  // restore stdout
-  fflush(stdout);
-  freopen("/dev/tty", "w", stdout); //
+BENCH_DEFINE_QUERY(count, de_bvec_count(&_ctx->a))
+BENCH_DEFINE_QUERY(any, de_bvec_any(&_ctx->a))
+BENCH_DEFINE_QUERY(all, de_bvec_all(&_ctx->a))
+BENCH_DEFINE_QUERY(and_count, de_bvec_and_count(&_ctx->a, &_ctx->b))
+BENCH_DEFINE_QUERY(xor_count, de_bvec_xor_count(&_ctx->a, &_ctx->b))
 
-  return ops_per_second;
+static u0 bench_memcpy(bench_ctx *const _ctx, const usize _iters) {
+  for (usize i = 0; i < _iters; ++i) {
+    memcpy(_ctx->raw_dst, _ctx->raw_src, _ctx->bytes);
+    BENCH_CLOBBER(_ctx->raw_dst);
+  }
 }
 
-typedef struct {
-  const float ops;
-  const char *name;
-} result;
+static u0 bench_memset(bench_ctx *const _ctx, const usize _iters) {
+  for (usize i = 0; i < _iters; ++i) {
+    memset(_ctx->raw_dst, (int)(i & 0xFF), _ctx->bytes);
+    BENCH_CLOBBER(_ctx->raw_dst);
+  }
+}
+
+/* any / all return at the first deciding block, make them scan it all */
+static u0 bench_prepare_clear(bench_ctx *const _ctx) {
+  de_bvec_clear(&_ctx->a);
+}
 
-void print_table(usize *count, ...) {
-  va_list args;
-  va_start(args, *count);
+static u0 bench_prepare_fill(bench_ctx *const _ctx) { de_bvec_fill(&_ctx->a); }
+
+static const bench_case bench_cases[] = {
+    {"get", false, NULL, bench_get},
+    {"set", false, NULL, bench_set},
+    {"flip", false, NULL, bench_flip},
+    {"set_range", false, NULL, bench_set_range},
+    {"find_next", false, NULL, bench_find_next},
+    {"create_delete", false, NULL, bench_create_delete},
+    {"move", false, NULL, bench_move},
+    {"copy", true, NULL, bench_copy},
+    {"fill", true, NULL, bench_fill},
+    {"clear", true, NULL, bench_clear},
+    {"not", true, NULL, bench_not},
+    {"and_msk", true, NULL, bench_and_msk},
+    {"or_msk", true, NULL, bench_or_msk},
+    {"xor_msk", true, NULL, bench_xor_msk},
+    {"count", true, NULL, bench_count},
+    {"any", true, bench_prepare_clear, bench_any},
+    {"all", true, bench_prepare_fill, bench_all},
+    {"and_count", true, NULL, bench_and_count},
+    {"xor_count", true, NULL, bench_xor_count},
+    {"memcpy", true, NULL, bench_memcpy},
+    {"memset", true, NULL, bench_memset},
+};
+
+/* ---- Measurement ---- */
+static int bench_cmp_double(const void *_a, const void *_b) {
+  const double a = *(const double *)_a;
+  const double b = *(const double *)_b;
+  return (a > b) - (a < b);
+}
 
-  printf("+---------------------+-----------+\n");
-  printf("| %-19s | %-9s |\n", "Name", "MOps/sec");
-  printf("+---------------------+-----------+\n");
+/* nearest rank percentile of a sorted sample */
+static inline double bench_percentile(const double *const _sorted,
+                                      const usize _n, const double _p) {
+  usize rank = (usize)(_p * (double)_n + 0.999999);
+  rank = rank ? rank - 1 : 0;
+  return _sorted[rank < _n ? rank : _n - 1];
+}
 
-  for (int i = 0; i < *count; i++) {
-    result r = va_arg(args, result);
-    printf("| %-19s | %9.4f |\n", r.name, r.ops);
+static bench_result bench_measure(const bench_config *const _cfg,
+                                  const bench_case *const _case,
+                                  bench_ctx *const _ctx) {
+  double ns[BENCH_MAX_TRIALS];
+  double cyc[BENCH_MAX_TRIALS];
+  const usize trials =
+      _cfg->trials < BENCH_MAX_TRIALS ? _cfg->trials : BENCH_MAX_TRIALS;
+
+  if (_case->prepare)
+    _case->prepare(_ctx);
+
+  /* smallest power of two iteration count that fills a trial */
+  usize iters = 1;
+  for (;;) {
+    const u64 t0 = bench_now_ns();
+    _case->run(_ctx, iters);
+    const u64 dt = bench_now_ns() - t0;
+    if (dt >= _cfg->trial_ns || iters >= ((usize)1 << 40))
+      break;
+    iters <<= 1;
   }
 
-  printf("+---------------------+-----------+\n");
+  const u64 warm_end = bench_now_ns() + _cfg->warmup_ns;
+  do
+    _case->run(_ctx, iters);
+  while (bench_now_ns() < warm_end);
+
+  for (usize t = 0; t < trials; ++t) {
+    const u64 c0 = bench_cycles();
+    const u64 t0 = bench_now_ns();
+    _case->run(_ctx, iters);
+    const u64 t1 = bench_now_ns();
+    const u64 c1 = bench_cycles();
+    ns[t] = (double)(t1 - t0) / (double)iters;
+    cyc[t] = (double)(c1 - c0) / (double)iters;
+  }
+  qsort(ns, trials, sizeof(double), bench_cmp_double);
+  qsort(cyc, trials, sizeof(double), bench_cmp_double);
+
+  bench_result r = {.name = _case->name,
+                    .bits = _ctx->bits,
+                    .iters = iters,
+                    .trials = trials,
+                    .min_ns = ns[0],
+                    .median_ns = bench_percentile(ns, trials, 0.5),
+                    .p99_ns = bench_percentile(ns, trials, 0.99),
+                    .gbps = -1.0,
+                    .cycles_per_byte = -1.0};
+  if (_case->bulk) {
+    r.gbps = (double)_ctx->bytes / r.median_ns;
+#ifdef BENCH_HAS_TSC
+    r.cycles_per_byte =
+        bench_percentile(cyc, trials, 0.5) / (double)_ctx->bytes;
+#endif
+  }
+  return r;
+}
 
-  va_end(args);
+/* ---- Output ---- */
+static inline const char *bench_simd_name(const de_bvec_simd _level) {
+  switch (_level) {
+  case DE_BVEC_SIMD_SSE2:
+    return "sse2";
+  case DE_BVEC_SIMD_AVX2:
+    return "avx2";
+  case DE_BVEC_SIMD_AVX512:
+    return "avx512";
+  default:
+    return "scalar";
+  }
 }
 
-#define r(_name, _ops)                                                         \
-  ((result){.ops = (++arg_count, (_ops / (float)1000000)), .name = #_name})
+static u0 bench_emit_begin(const bench_config *const _cfg) {
+  FILE *const f = _cfg->out;
+  const char *const simd = bench_simd_name(de_bvec_simd_active());
+  switch (_cfg->format) {
+  case BENCH_FMT_CSV:
+    fprintf(f, "version,simd,name,bits,iters,trials,min_ns,median_ns,"
+               "p99_ns,mops,gbps,cycles_per_byte\n");
+    break;
+  case BENCH_FMT_JSON:
+    fprintf(f,
+            "{\n  \"suite\": \"de_bitmask\",\n  \"version\": \"%s\",\n"
+            "  \"simd\": \"%s\",\n  \"trials\": %zu,\n  \"results\": [",
+            BENCH_VERSION, simd, (size_t)_cfg->trials);
+    break;
+  default:
+    fprintf(f, "simd: %s, trials: %zu\n", simd, (size_t)_cfg->trials);
+    fprintf(f, "%-14s %12s %12s %12s %10s %9s %8s\n", "name", "bits",
+            "median ns", "p99 ns", "MOps/s", "GB/s", "cyc/B");
+    break;
+  }
+}
+
+static u0 bench_emit(const bench_config *const _cfg,
+                     const bench_result *const _r, const bool _first) {
+  FILE *const f = _cfg->out;
+  const double mops = 1e3 / _r->median_ns;
+  switch (_cfg->format) {
+  case BENCH_FMT_CSV:
+    fprintf(f, "%s,%s,%s,%zu,%zu,%zu,%.3f,%.3f,%.3f,%.4f,", BENCH_VERSION,
+            bench_simd_name(de_bvec_simd_active()), _r->name,
+            (size_t)_r->bits, (size_t)_r->iters, (size_t)_r->trials,
+            _r->min_ns, _r->median_ns, _r->p99_ns, mops);
+    if (_r->gbps >= 0)
+      fprintf(f, "%.4f", _r->gbps);
+    fputc(',', f);
+    if (_r->cycles_per_byte >= 0)
+      fprintf(f, "%.5f", _r->cycles_per_byte);
+    fputc('\n', f);
+    break;
+  case BENCH_FMT_JSON:
+    fprintf(f,
+            "%s\n    {\"name\": \"%s\", \"bits\": %zu, \"iters\": %zu, "
+            "\"min_ns\": %.3f, \"median_ns\": %.3f, \"p99_ns\": %.3f, "
+            "\"mops\": %.4f, ",
+            _first ? "" : ",", _r->name, (size_t)_r->bits,
+            (size_t)_r->iters, _r->min_ns, _r->median_ns, _r->p99_ns, mops);
+    if (_r->gbps >= 0)
+      fprintf(f, "\"gbps\": %.4f, ", _r->gbps);
+    else
+      fprintf(f, "\"gbps\": null, ");
+    if (_r->cycles_per_byte >= 0)
+      fprintf(f, "\"cycles_per_byte\": %.5f}", _r->cycles_per_byte);
+    else
+      fprintf(f, "\"cycles_per_byte\": null}");
+    break;
+  default:
+    fprintf(f, "%-14s %12zu %12.2f %12.2f %10.2f ", _r->name,
+            (size_t)_r->bits, _r->median_ns, _r->p99_ns, mops);
+    if (_r->gbps >= 0)
+      fprintf(f, "%9.2f ", _r->gbps);
+    else
+      fprintf(f, "%9s ", "-");
+    if (_r->cycles_per_byte >= 0)
+      fprintf(f, "%8.3f\n", _r->cycles_per_byte);
+    else
+      fprintf(f, "%8s\n", "-");
+    break;
+  }
+  fflush(f);
+}
 
-u0 run_all_benchmarks(const usize msk_size) {
-  const usize iterations = 10000000;
-  de_bvec msk = de_bvec_create(msk_size);
+static u0 bench_emit_end(const bench_config *const _cfg) {
+  if (_cfg->format == BENCH_FMT_JSON)
+    fprintf(_cfg->out, "\n  ]\n}\n");
+}
 
-  printf("+---------------------+-----------+\n");
-  printf("| iters: %-12llu | %-4llu bits |\n", iterations, msk_size);
-  // clang-format off
-  usize arg_count = 0;
-  print_table(&arg_count, 
-    r(get, bench_msk_get(&msk, msk_size, iterations)),
-    r(set, bench_msk_set(&msk, msk_size, iterations)),
-    r(set_range, bench_msk_set_range(&msk, msk_size-1, iterations)),
-    r(create, bench_msk_create(msk_size, iterations)),
-    r(delete, bench_msk_delete(msk_size, iterations)),
-    r(copy, bench_msk_copy(msk_size, iterations)),
-    r(move, bench_msk_move(msk_size, iterations)),
-    r(fill, bench_msk_fill(&msk, msk_size, iterations)),
-    r(clear, bench_msk_clear(&msk, msk_size, iterations)),
-    r(any, bench_msk_any(&msk, msk_size, iterations)),
-    r(all, bench_msk_all(&msk, msk_size, iterations)),
-    r(none, bench_msk_none(&msk, msk_size, iterations)),
-    r(count, bench_msk_count(&msk, msk_size, iterations))
-    // r(print, bench_msk_print(&msk, msk_size, 100))
-  );
-  // clang-format on
+/* ---- Driver ---- */
+
+/*
+runs every case matching _cfg->filter at every size of the sweep,
+returns false if a size could not be allocated
+*/
+static bool bench_run(const bench_config *const _cfg) {
+  const usize step = _cfg->step < 2 ? 2 : _cfg->step;
+  const usize cases = sizeof(bench_cases) / sizeof(bench_cases[0]);
+  bool first = true;
+  bool ok = true;
+
+  bench_emit_begin(_cfg);
+  for (usize bits = _cfg->min_bits ? _cfg->min_bits : 1;
+       bits <= _cfg->max_bits; bits *= step) {
+    bench_ctx *const ctx = (bench_ctx *)calloc(1, sizeof(bench_ctx));
+    if (!ctx || !bench_ctx_init(ctx, bits)) {
+      fprintf(stderr, "bench: could not allocate %zu bits\n", (size_t)bits);
+      if (ctx)
+        bench_ctx_free(ctx);
+      free(ctx);
+      ok = false;
+      break;
+    }
+    for (usize c = 0; c < cases; ++c) {
+      if (_cfg->filter && !strstr(bench_cases[c].name, _cfg->filter))
+        continue;
+      const bench_result r = bench_measure(_cfg, bench_cases + c, ctx);
+      bench_emit(_cfg, &r, first);
+      first = false;
+    }
+    bench_ctx_free(ctx);
+    free(ctx);
+    if (bits > _cfg->max_bits / step)
+      break;
+  }
+  bench_emit_end(_cfg);
+  return ok;
 }
 
-#endif
\ No newline at end of file
+#endif
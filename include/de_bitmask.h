@@ -30,26 +30,97 @@
 /* ---- Constants ---- */
 typedef u64 mblk_t;
 #define DE_BVEC_MBLK_BITS 64
+/* returned by the find functions when no matching bit exists */
+#define DE_BVEC_NPOS ((usize)-1)
+/*
+default heap storage of at least this many bytes is mmap'ed, lazily zeroed
+and backed by transparent huge pages where the OS offers them
+*/
+#ifndef DE_BVEC_HUGE_THRESHOLD
+#define DE_BVEC_HUGE_THRESHOLD ((usize)4 << 20)
+#endif
+/* batched access prefetches the block this many indices ahead */
+#ifndef DE_BVEC_BATCH_PREFETCH
+#define DE_BVEC_BATCH_PREFETCH 16
+#endif
 
 // clang-format off
 
+/* ---- Allocator ---- */
+/*
+  Heap block storage can come from a user allocator instead of the default
+  64 byte aligned / mmap'ed storage.
+  alloc must return _blocks zeroed blocks, dealloc gets the same count back.
+  realloc is optional (NULL => alloc + copy + dealloc), it keeps the first
+  _old_blocks, the grown tail may hold anything. on failure it returns NULL
+  and leaves _data untouched.
+  See de_bitmask_alloc.h for the built-in arena and size-class pool.
+*/
+typedef struct de_bvec_allocator de_bvec_allocator;
+struct de_bvec_allocator {
+  mblk_t* (*alloc)(de_bvec_allocator* const _self, const usize _blocks);
+  u0      (*dealloc)(de_bvec_allocator* const _self, mblk_t* const _data,
+                     const usize _blocks);
+  mblk_t* (*realloc)(de_bvec_allocator* const _self, mblk_t* const _data,
+                     const usize _old_blocks, const usize _new_blocks);
+};
+
 /* ---- Struct ---- */
+/* inline blocks, they share their space with the heap pointer */
+#ifndef DE_BVEC_INLINE_BLOCKS
+#define DE_BVEC_INLINE_BLOCKS 2
+#endif
+#define DE_BVEC_INLINE_BITS (DE_BVEC_INLINE_BLOCKS * DE_BVEC_MBLK_BITS)
+
+/*
+56 bytes on 64-bit targets (64 with DE_CONTAINER_BITMASK_CACHED_COUNT),
+the original layout was 40. every field is a full word so there is no
+padding to fold anything into:
+  - the second inline block took the word is_small used with its padding
+  - block_capacity (+8) lets push_back / set_size grow geometrically
+  - alloc (+8) lets masks from different arenas / pools coexist
+masks are usually long lived and few, the heap blocks dominate memory
+*/
 typedef struct {
   union {
-    mblk_t  small;   /* inline storage for up to SMALL_CAPACITY_BITS */
-    mblk_t* blocks;  /* pointer to heap blocks (length = block_count) */
+    mblk_t  small[DE_BVEC_INLINE_BLOCKS]; /* inline storage, <= INLINE_BITS */
+    mblk_t* blocks;  /* pointer to heap blocks (length = block_capacity) */
   } data;
   usize bits_amount;       /* logical number of bits */
-  usize block_count;     /* number of blocks allocated or used */
+  usize block_count;     /* number of blocks used, inline or heap */
+  usize block_capacity;  /* number of heap blocks allocated, 0 => inline */
   usize last_block_bits_count;     /* number of used bits in last block */
-  bool   is_small;        /* true => use .data.small */
+  de_bvec_allocator* alloc; /* heap storage source, NULL => aligned heap */
+#ifdef DE_CONTAINER_BITMASK_CACHED_COUNT
+  usize cached_ones;     /* amount of 1 bits + 1, 0 => unknown */
+#endif
 } de_bvec;
 
+/*
+block storage regardless of where it lives. every accessor indexes through
+this, the pointer is picked with a mask so there is no branch to mispredict
+(compilers turn a plain ?: back into a jump here)
+*/
+#define DE_BVEC_IS_INLINE(_msk) ((_msk)->block_capacity == 0)
+#define DE_BVEC_DATA(_msk) DE_BVEC_data(_msk)
+#define DE_BVEC_BLOCKS_USED(_msk) ((_msk)->block_count)
+
+static inline mblk_t*
+DE_BVEC_data(
+  const de_bvec* const _msk
+) {
+  const uptr heap   = (uptr)_msk->data.blocks;
+  const uptr local  = (uptr)_msk->data.small;
+  const uptr select = (uptr)0 - (uptr)(_msk->block_capacity != 0);
+  return (mblk_t*)((heap & select) | (local & ~select));
+}
+
 /* ---- Lifecycle ---- */
 
 /* 
 create a bitvector struct and return it to the user. 
-If _amount_bits <= 64, then soo, (short object optimization) will be used
+If _amount_bits <= DE_BVEC_INLINE_BITS (128), then soo,
+(short object optimization) will be used
 */
 DE_CONTAINER_BITMASK_API de_bvec
 de_bvec_create(
@@ -57,7 +128,8 @@ de_bvec_create(
 );
 /*
 create a bitvector struct inline. 
-If _amount_bits <= 64, then soo, (short object optimization) will be used
+If _amount_bits <= DE_BVEC_INLINE_BITS (128), then soo,
+(short object optimization) will be used
 does not clean up previous data if present.
 */
 DE_CONTAINER_BITMASK_API u0 
@@ -66,6 +138,25 @@ de_bvec_create_i(
   const usize _amount_bits
 );
 
+/*
+same as de_bvec_create, but heap blocks come from _alloc (NULL => default).
+the allocator stays attached to the struct for every later (re)allocation.
+*/
+DE_CONTAINER_BITMASK_API de_bvec
+de_bvec_create_with(
+  const usize _amount_bits,
+  de_bvec_allocator* const _alloc
+);
+
+/*
+sets the allocator de_bvec_create uses on the calling thread, NULL => default.
+returns the previous one. handy to route per-request temporaries into an arena.
+*/
+DE_CONTAINER_BITMASK_API de_bvec_allocator*
+de_bvec_allocator_set_default(
+  de_bvec_allocator* const _alloc
+);
+
 /*
 resets all values and clears the struct
 */
@@ -75,7 +166,7 @@ de_bvec_delete(
 );
 /*
 increase the structs size till its >= _amount_bits.
-Does not decrease size
+Does not decrease size. storage grows geometrically, see de_bvec_resize
 */
 DE_CONTAINER_BITMASK_API u0
 de_bvec_reserve(
@@ -85,8 +176,10 @@ de_bvec_reserve(
 
 /*
 increase or decrease the size.
-will loose data if _amount_bits is smaller that previous
-may contain a behaviourbug on same data_size as before, todo: fix
+will loose data if _amount_bits is smaller that previous.
+heap storage grows to at least twice its capacity and is extended in place
+where possible, only the newly used blocks are zeroed. shrinking keeps the
+capacity unless the mask fits inline again
 */
 DE_CONTAINER_BITMASK_API u0
 de_bvec_resize(
@@ -94,9 +187,17 @@ de_bvec_resize(
   const usize         _amount_bits
 );
 
+/*
+releases unused heap capacity
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_shrink_to_fit(
+  de_bvec* const _msk
+);
+
 
 /* 
-deep copies _src into _dst
+deep copies _src into _dst, _dst keeps its own allocator
 */
 DE_CONTAINER_BITMASK_API u0
 de_bvec_copy(
@@ -105,7 +206,7 @@ de_bvec_copy(
 );
 
 /*
-sets _dst as _src, deletes _src
+sets _dst as _src (including its allocator), deletes _src
 */
 DE_CONTAINER_BITMASK_API u0
 de_bvec_move(
@@ -164,6 +265,82 @@ de_bvec_flip_range(
   const usize   _end_idx
 );
 
+/* ---- Batched access ---- */
+/*
+  The single-bit ops over an index array. Blocks are prefetched
+  DE_BVEC_BATCH_PREFETCH indices ahead, so random indices overlap their
+  cache misses instead of waiting on each one. Indices are handled in
+  order, repeated indices behave like repeated single calls.
+*/
+
+/*
+_out[i] = state of the bit at _idx[i]
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_get_many(
+  const de_bvec* const _msk,
+  const usize* const   _idx,
+  const usize          _amount,
+  bool* const          _out
+);
+
+/*
+sets the bits at _idx[0.._amount) to _value
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_set_many(
+  de_bvec* const     _msk,
+  const usize* const _idx,
+  const usize        _amount,
+  const bool         _value
+);
+
+/*
+flips the bits at _idx[0.._amount)
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_flip_many(
+  de_bvec* const     _msk,
+  const usize* const _idx,
+  const usize        _amount
+);
+
+/*
+sets the bits at _idx[0.._amount) to 1, _out[i] (optional) receives the
+state before. returns the amount of bits that were 0
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_test_and_set_many(
+  de_bvec* const     _msk,
+  const usize* const _idx,
+  const usize        _amount,
+  bool* const        _out
+);
+
+/* ---- Append ---- */
+
+/*
+appends one bit at index de_bvec_info_size(), amortized O(1).
+an invalid mask, or one that becomes invalid because growing failed, is
+left as it is
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_push_back(
+  de_bvec* const _msk,
+  const bool    _value
+);
+
+/*
+appends the low _amount_bits (<= 64) of _bits, bit 0 goes first.
+invalid masks are handled as in de_bvec_push_back
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_append_bits(
+  de_bvec* const _msk,
+  const mblk_t  _bits,
+  const usize   _amount_bits
+);
+
 /* ---- Bulk operations ---- */
 
 /*
@@ -247,6 +424,14 @@ de_bvec_info_size(
   const de_bvec* const _msk
 );
 
+/*
+retuns the amount of bits that fit without reallocating
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_info_capacity(
+  const de_bvec* const _msk
+);
+
 /*
 retuns if the struct is valid
 if malloc worked etc
@@ -288,6 +473,206 @@ de_bvec_count(
   const de_bvec* const _msk
 );
 
+/*
+  With `#define DE_CONTAINER_BITMASK_CACHED_COUNT` (in every TU, before
+  including this file) a mask carries its amount of 1 bits. set / flip /
+  push_back and friends adjust it by the change of the touched bit,
+  set_range / flip_range by the popcount of the range before the write,
+  clear / fill / not / copy know the result. Ops that cannot tell cheaply
+  (and / or / xor, shrinking) drop it; de_bvec_count_refresh recomputes it
+  once, after that count, any, all and none are O(1) while a mask only
+  changes by a few bits between calls. the const queries only read the
+  cache, so they stay safe on shared masks.
+*/
+
+/*
+de_bvec_count that also stores the result in the cache of _msk, a known
+cache is returned as is. same as de_bvec_count without
+DE_CONTAINER_BITMASK_CACHED_COUNT
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_count_refresh(
+  de_bvec* const _msk
+);
+
+/*
+drops the cached amount of 1 bits. call it after writing the blocks
+without the de_bvec functions (views over the mask, DE_BVEC_DATA).
+does nothing without DE_CONTAINER_BITMASK_CACHED_COUNT
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_count_invalidate(
+  de_bvec* const _msk
+);
+
+/*
+returns amount of positive bits (1) in the range [_start_idx, _end_idx]
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_count_range(
+  const de_bvec* const _msk,
+  const usize   _start_idx,
+  const usize   _end_idx
+);
+
+/* ---- Fused counts ---- */
+/*
+  Count the result of a binary op without materializing it. Both inputs
+  are streamed once, popcounts accumulate in vector registers.
+  Masks of different size are treated as zero padded.
+*/
+
+/*
+returns |_a & _b|
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_and_count(
+  const de_bvec* const _a,
+  const de_bvec* const _b
+);
+
+/*
+returns |_a | _b|
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_or_count(
+  const de_bvec* const _a,
+  const de_bvec* const _b
+);
+
+/*
+returns |_a ^ _b|, the hamming distance
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_xor_count(
+  const de_bvec* const _a,
+  const de_bvec* const _b
+);
+
+/*
+returns |_a & ~_b|
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_andnot_count(
+  const de_bvec* const _a,
+  const de_bvec* const _b
+);
+
+/*
+returns true if _a and _b share a 1 bit, stops at the first one
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_intersects(
+  const de_bvec* const _a,
+  const de_bvec* const _b
+);
+
+/*
+returns true if every 1 bit of _a is also set in _b
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_is_subset(
+  const de_bvec* const _a,
+  const de_bvec* const _b
+);
+
+/* ---- Search / Iteration ---- */
+
+/*
+returns the index of the first 1 bit, or DE_BVEC_NPOS
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_find_first(
+  const de_bvec* const _msk
+);
+
+/*
+returns the index of the first 1 bit at or after _idx, or DE_BVEC_NPOS
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_find_next(
+  const de_bvec* const _msk,
+  const usize   _idx
+);
+
+/*
+returns the index of the first 0 bit, or DE_BVEC_NPOS
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_find_first_zero(
+  const de_bvec* const _msk
+);
+
+/*
+returns the index of the first 0 bit at or after _idx, or DE_BVEC_NPOS
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_find_next_zero(
+  const de_bvec* const _msk,
+  const usize   _idx
+);
+
+/*
+iterator over the 1 bits of a mask, see DE_BVEC_FOREACH_SET.
+the mask must not be resized while iterating.
+*/
+typedef struct {
+  const mblk_t* blocks;
+  usize  block_count;
+  usize  bits_amount;
+  usize  block;         /* block `word` was loaded from */
+  mblk_t word;          /* not yet visited 1 bits of that block */
+} de_bvec_iter;
+
+static inline de_bvec_iter
+de_bvec_iter_begin(
+  const de_bvec* const _msk
+) {
+  de_bvec_iter it = {
+    .blocks = DE_BVEC_DATA(_msk),
+    .block_count = _msk->block_count,
+    .bits_amount = _msk->bits_amount,
+    .block = 0,
+    .word = 0,
+  };
+  it.word = it.block_count ? it.blocks[0] : 0;
+  return it;
+}
+
+/*
+returns the next 1 bit, or DE_BVEC_NPOS once exhausted.
+zero blocks are skipped, each step is a tzcnt + blsr.
+*/
+static inline usize
+de_bvec_iter_next(
+  de_bvec_iter* const _it
+) {
+  while (!_it->word) {
+    if (++_it->block >= _it->block_count)
+      return DE_BVEC_NPOS;
+    _it->word = _it->blocks[_it->block];
+  }
+  const usize idx =
+    _it->block * DE_BVEC_MBLK_BITS + (usize)__builtin_ctzll(_it->word);
+  _it->word &= _it->word - 1;
+  if (idx >= _it->bits_amount) {
+    _it->word = 0;
+    _it->block = _it->block_count;
+    return DE_BVEC_NPOS;
+  }
+  return idx;
+}
+
+/*
+loops over every 1 bit of _msk in ascending order.
+_idx must be a usize variable declared by the caller, `break` works.
+  usize i;
+  DE_BVEC_FOREACH_SET(&msk, i) { ... }
+*/
+#define DE_BVEC_FOREACH_SET(_msk, _idx)                                        \
+  for (de_bvec_iter DE_BVEC_it_##_idx = de_bvec_iter_begin(_msk);              \
+       ((_idx) = de_bvec_iter_next(&DE_BVEC_it_##_idx)) != DE_BVEC_NPOS;)
+
 /*
 prints all bits to the screen. idx 0 is bottom left
 */
@@ -305,6 +690,136 @@ DE_CONTAINER_BITMASK_API u0 de_bvec_print(
   const de_bvec *const _msk
 );
 
+/* ---- SIMD dispatch ---- */
+
+/*
+instruction sets the bulk kernels can run on.
+the best one supported by the cpu is picked once at startup,
+so a portable build (no -march=native) still uses wide vectors.
+*/
+typedef enum {
+  DE_BVEC_SIMD_SCALAR = 0,
+  DE_BVEC_SIMD_SSE2,
+  DE_BVEC_SIMD_AVX2,
+  DE_BVEC_SIMD_AVX512,
+} de_bvec_simd;
+
+/*
+returns the best instruction set supported by the running cpu
+*/
+DE_CONTAINER_BITMASK_API de_bvec_simd
+de_bvec_simd_detect(u0);
+
+/*
+returns the instruction set the bulk kernels currently use
+*/
+DE_CONTAINER_BITMASK_API de_bvec_simd
+de_bvec_simd_active(u0);
+
+/*
+forces the bulk kernels to _level (clamped to what the cpu supports).
+returns the level that was actually installed.
+mainly useful for benchmarking and testing the fallbacks.
+*/
+DE_CONTAINER_BITMASK_API de_bvec_simd
+de_bvec_simd_select(
+  const de_bvec_simd _level
+);
+
+/* ---- Instrumentation ---- */
+/*
+  Opt-in usage counters, compiled in only with
+  `#define DE_CONTAINER_BITMASK_STATS`
+  (in every TU, before including this file). Without it none of this exists
+  and the API functions carry no extra code.
+  Every de_bvec function below counts its calls, bulk functions also the
+  bytes a full pass reads plus writes (early exits still count the full
+  pass). Calls one API function makes to another count for both.
+  Allocation counters cover the default heap and attached allocators,
+  create_bits is a histogram of create sizes by bit length (bucket k holds
+  sizes in [2^(k-1), 2^k), the last one everything above) to size
+  DE_BVEC_INLINE_BLOCKS from.
+  With DE_CONTAINER_BITMASK_STATS_TIMING as well (GCC/clang on x86) every
+  call also lands in a per function log2 histogram of its TSC cycles.
+  Counters are per thread and never contended, a snapshot sums all threads,
+  including ones that already exited.
+*/
+#ifdef DE_CONTAINER_BITMASK_STATS
+
+#include <stdio.h>
+
+#define DE_BVEC_STATS_OPS(X)                                                   \
+  X(create_with) X(create) X(create_i) X(delete) X(reserve) X(resize)          \
+  X(shrink_to_fit) X(copy) X(move) X(get) X(set) X(set_range) X(flip)          \
+  X(flip_range) X(get_many) X(set_many) X(flip_many) X(test_and_set_many)      \
+  X(push_back) X(append_bits) X(clear) X(clear_range) X(fill) X(fill_range)    \
+  X(and_msk) X(or_msk) X(xor_msk) X(not) X(any) X(all) X(none) X(count)        \
+  X(count_range) X(and_count) X(or_count) X(xor_count) X(andnot_count)         \
+  X(intersects) X(is_subset) X(find_first) X(find_next) X(find_first_zero)     \
+  X(find_next_zero)
+
+#define DE_BVEC_STATS_OP_ENUM(_op) DE_BVEC_STATS_OP_##_op,
+typedef enum {
+  DE_BVEC_STATS_OPS(DE_BVEC_STATS_OP_ENUM)
+  DE_BVEC_STATS_OP_COUNT
+} de_bvec_stats_op;
+#undef DE_BVEC_STATS_OP_ENUM
+
+/* log2 buckets of the size and cycle histograms */
+#define DE_BVEC_STATS_BUCKETS 64
+
+typedef struct {
+  u64 calls[DE_BVEC_STATS_OP_COUNT];
+  u64 bytes[DE_BVEC_STATS_OP_COUNT];
+  u64 allocs;          /* block arrays allocated */
+  u64 alloc_bytes;
+  u64 frees;
+  u64 free_bytes;
+  u64 reallocs;        /* heap capacity changes of a live mask */
+  u64 realloc_bytes;   /* new capacity, summed */
+  u64 inline_creates;  /* creates that fit the inline blocks */
+  u64 heap_creates;
+  u64 spills;          /* inline masks that grew onto the heap */
+  u64 unspills;        /* heap masks that shrank back inline */
+  u64 create_bits[DE_BVEC_STATS_BUCKETS];
+#if defined(DE_CONTAINER_BITMASK_STATS_TIMING)
+  u64 cycles[DE_BVEC_STATS_OP_COUNT][DE_BVEC_STATS_BUCKETS];
+#endif
+} de_bvec_stats;
+
+/*
+sums the counters of all threads since the last reset into _out
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_stats_snapshot(
+  de_bvec_stats* const _out
+);
+
+/*
+starts counting from 0 again, for every thread
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_stats_reset(u0);
+
+/*
+returns the function name _op counts, without the de_bvec_ prefix
+*/
+DE_CONTAINER_BITMASK_API const char*
+de_bvec_stats_op_name(
+  const de_bvec_stats_op _op
+);
+
+/*
+writes the non zero counters of _stats to _file, one line each
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_stats_dump(
+  const de_bvec_stats* const _stats,
+  FILE* const                _file
+);
+
+#endif
+
 // clang-format on
 #pragma GCC diagnostic pop
 #endif /* DE_CONTAINER_BITMASK_HEADER */
@@ -337,448 +852,1358 @@ DE_CONTAINER_BITMASK_INTERNAL usize DE_BVEC_BITS_MOD_MBLK(usize bits) {
 
 #define DE_BVEC_ONE ((mblk_t)1)
 
-DE_CONTAINER_BITMASK_INTERNAL mblk_t *DE_BVEC_calloc(const usize _amount) {
-  return (mblk_t *)calloc(_amount, sizeof(mblk_t));
-}
+/* bits of a block below _bits_count (1..64) */
+#define DE_BVEC_LOW_MASK(_bits_count)                                          \
+  (DE_BVEC_MBLK_FILLED >> (DE_BVEC_MBLK_BITS - (_bits_count)))
+
+/* ---- Cached count ---- */
+/* the cache holds ones + 1 so that a zeroed de_bvec reads as unknown */
+#ifdef DE_CONTAINER_BITMASK_CACHED_COUNT
+#define DE_BVEC_COUNT_KNOWN(_msk) ((_msk)->cached_ones != 0)
+#define DE_BVEC_COUNT_GET(_msk) ((_msk)->cached_ones - 1)
+#define DE_BVEC_COUNT_SET(_msk, _ones)                                         \
+  ((_msk)->cached_ones = (usize)(_ones) + 1)
+#define DE_BVEC_COUNT_COPY(_dst, _src)                                         \
+  ((_dst)->cached_ones = (_src)->cached_ones)
+#define DE_BVEC_COUNT_INVALIDATE(_msk) ((_msk)->cached_ones = 0)
+/* _delta may be negative, it wraps like the cache itself */
+#define DE_BVEC_COUNT_ADD(_msk, _delta)                                        \
+  do {                                                                         \
+    if (DE_BVEC_COUNT_KNOWN(_msk))                                             \
+      (_msk)->cached_ones += (usize)(_delta);                                  \
+  } while (0)
+#else
+#define DE_BVEC_COUNT_KNOWN(_msk) false
+#define DE_BVEC_COUNT_GET(_msk) ((usize)0)
+#define DE_BVEC_COUNT_SET(_msk, _ones) ((u0)0)
+#define DE_BVEC_COUNT_COPY(_dst, _src) ((u0)0)
+#define DE_BVEC_COUNT_INVALIDATE(_msk) ((u0)0)
+#define DE_BVEC_COUNT_ADD(_msk, _delta) ((u0)(_delta))
+#endif
 
-DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_dealloc(mblk_t *const _data) {
-  free(_data);
+/* ---- Instrumentation ---- */
+/*
+  Each thread owns a slot of counters, found through a thread local pointer.
+  Only the owner writes it, so a bump is a relaxed load and store, no locked
+  instruction. Snapshots read every slot relaxed. Slots are never freed: a
+  thread that exits hands its slot (counts included) to the next new
+  thread. Reset does not touch the slots, it stores the current sums as a
+  baseline that snapshots subtract, so it never races with a bump.
+*/
+#ifdef DE_CONTAINER_BITMASK_STATS
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define DE_BVEC_STATS_WORDS (sizeof(de_bvec_stats) / sizeof(u64))
+#define DE_BVEC_STATS_AT(_field) (offsetof(de_bvec_stats, _field) / sizeof(u64))
+
+_Static_assert(sizeof(de_bvec_stats) % sizeof(u64) == 0,
+               "de_bvec_stats must be an array of u64 counters");
+
+typedef struct DE_BVEC_stats_slot {
+  _Atomic u64 words[DE_BVEC_STATS_WORDS];
+  struct DE_BVEC_stats_slot *next;
+  atomic_bool owned;
+} DE_BVEC_stats_slot;
+
+static _Atomic(DE_BVEC_stats_slot *) DE_BVEC_stats_slots = NULL;
+static _Thread_local DE_BVEC_stats_slot *DE_BVEC_stats_tls = NULL;
+static u64 DE_BVEC_stats_base[DE_BVEC_STATS_WORDS];
+static pthread_mutex_t DE_BVEC_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t DE_BVEC_stats_key;
+static pthread_once_t DE_BVEC_stats_once = PTHREAD_ONCE_INIT;
+
+static u0 DE_BVEC_stats_release(u0 *const _slot) {
+  atomic_store_explicit(&((DE_BVEC_stats_slot *)_slot)->owned, false,
+                        memory_order_release);
 }
 
-DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_memcpy(mblk_t *const _dst,
-                                                const mblk_t *const _src,
-                                                const usize _size) {
-  memcpy(_dst, _src, _size * sizeof(mblk_t));
+static u0 DE_BVEC_stats_key_init(u0) {
+  pthread_key_create(&DE_BVEC_stats_key, DE_BVEC_stats_release);
 }
-DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_memmov(mblk_t *const _dst,
-                                                const mblk_t *const _src,
-                                                const usize _size) {
-  memmove(_dst, _src, _size * sizeof(mblk_t));
+
+/* first counter of a thread: reuse a released slot or add a new one */
+static DE_BVEC_stats_slot *DE_BVEC_stats_claim(u0) {
+  pthread_once(&DE_BVEC_stats_once, DE_BVEC_stats_key_init);
+  DE_BVEC_stats_slot *slot =
+      atomic_load_explicit(&DE_BVEC_stats_slots, memory_order_acquire);
+  for (; slot; slot = slot->next) {
+    bool expected = false;
+    if (atomic_compare_exchange_strong(&slot->owned, &expected, true))
+      break;
+  }
+  if (!slot) {
+    slot = (DE_BVEC_stats_slot *)calloc(1, sizeof(DE_BVEC_stats_slot));
+    if (!slot)
+      return NULL;
+    atomic_store_explicit(&slot->owned, true, memory_order_relaxed);
+    slot->next =
+        atomic_load_explicit(&DE_BVEC_stats_slots, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak(&DE_BVEC_stats_slots, &slot->next,
+                                         slot))
+      ;
+  }
+  pthread_setspecific(DE_BVEC_stats_key, slot);
+  DE_BVEC_stats_tls = slot;
+  return slot;
 }
 
-DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_memset(mblk_t *const _data,
-                                                const mblk_t _value,
-                                                const usize _size) {
-  for (usize i = 0; i < _size; ++i)
-    _data[i] = _value;
+static inline u0 DE_BVEC_stats_add(const usize _word, const u64 _amount) {
+  DE_BVEC_stats_slot *const slot =
+      DE_BVEC_stats_tls ? DE_BVEC_stats_tls : DE_BVEC_stats_claim();
+  if (!slot)
+    return;
+  _Atomic u64 *const word = slot->words + _word;
+  atomic_store_explicit(
+      word, atomic_load_explicit(word, memory_order_relaxed) + _amount,
+      memory_order_relaxed);
 }
 
-// #define _memmov memcpy
+/* log2 bucket, 0 and 1 share bucket 0 */
+#define DE_BVEC_STATS_BUCKET(_value)                                           \
+  ((usize)(63 - __builtin_clzll((u64)(_value) | 1)))
+
+#define DE_BVEC_STAT_COUNT(_field, _amount)                                    \
+  DE_BVEC_stats_add(DE_BVEC_STATS_AT(_field), (u64)(_amount))
+#define DE_BVEC_STAT_BYTES(_op, _bytes)                                        \
+  DE_BVEC_stats_add(DE_BVEC_STATS_AT(bytes) + DE_BVEC_STATS_OP_##_op,          \
+                    (u64)(_bytes))
+/* create_bits bucket is the bit length of the size, sizes of 2^63 bits and
+   up share the last one */
+#define DE_BVEC_STATS_SIZE_BUCKET(_bits)                                       \
+  (!(_bits) ? 0                                                                \
+   : DE_BVEC_STATS_BUCKET(_bits) + 1 < DE_BVEC_STATS_BUCKETS                   \
+       ? DE_BVEC_STATS_BUCKET(_bits) + 1                                       \
+       : DE_BVEC_STATS_BUCKETS - 1)
+#define DE_BVEC_STAT_CREATE(_bits)                                             \
+  do {                                                                         \
+    DE_BVEC_stats_add(DE_BVEC_STATS_AT(create_bits) +                          \
+                          DE_BVEC_STATS_SIZE_BUCKET(_bits),                    \
+                      1);                                                      \
+    if ((_bits) > DE_BVEC_INLINE_BITS)                                         \
+      DE_BVEC_STAT_COUNT(heap_creates, 1);                                     \
+    else                                                                       \
+      DE_BVEC_STAT_COUNT(inline_creates, 1);                                   \
+  } while (0)
+
+#if defined(DE_CONTAINER_BITMASK_STATS_TIMING) && defined(__GNUC__) &&         \
+    (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
 
-/* ---- Lifecycle ---- */
-DE_CONTAINER_BITMASK_INTERNAL de_bvec de_bvec_create(const usize _amount_bits) {
-  if (_amount_bits <= DE_BVEC_MBLK_BITS) {
-    return (de_bvec){.data.small = 0,
-                     .is_small = true,
-                     .bits_amount = _amount_bits,
-                     .block_count = 0,
-                     .last_block_bits_count =
-                         DE_BVEC_BITS_MOD_MBLK(_amount_bits)};
-  } else {
-    const usize blocks = DE_BVEC_GET_BLOCKS_AMOUNT(_amount_bits);
-    return (de_bvec){.data.blocks = (mblk_t *)DE_BVEC_calloc(blocks),
-                     .is_small = false,
-                     .bits_amount = _amount_bits,
-                     .block_count = blocks,
-                     .last_block_bits_count =
-                         DE_BVEC_BITS_MOD_MBLK(_amount_bits)};
-  }
-}
-DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_create_i(de_bvec *const _msk,
-                                                  const usize _amount_bits) {
-  *_msk = de_bvec_create(_amount_bits);
+typedef struct {
+  u64 start;
+  usize op;
+} DE_BVEC_stats_timer;
+
+/* runs when the instrumented function returns, whichever return it takes */
+static inline u0 DE_BVEC_stats_timer_end(DE_BVEC_stats_timer *const _timer) {
+  const u64 cycles = (u64)__rdtsc() - _timer->start;
+  DE_BVEC_stats_add(DE_BVEC_STATS_AT(cycles) +
+                        _timer->op * DE_BVEC_STATS_BUCKETS +
+                        DE_BVEC_STATS_BUCKET(cycles),
+                    1);
 }
 
-DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_free(de_bvec *const _msk) {
-  if (!_msk->is_small) {
-    free(_msk->data.blocks);
-  }
-}
+#define DE_BVEC_STAT(_op)                                                      \
+  DE_BVEC_stats_add(DE_BVEC_STATS_AT(calls) + DE_BVEC_STATS_OP_##_op, 1);      \
+  DE_BVEC_stats_timer DE_BVEC_stat_timer                                       \
+      __attribute__((cleanup(DE_BVEC_stats_timer_end))) = {                    \
+          (u64)__rdtsc(), DE_BVEC_STATS_OP_##_op}
+#else
+#define DE_BVEC_STAT(_op)                                                      \
+  DE_BVEC_stats_add(DE_BVEC_STATS_AT(calls) + DE_BVEC_STATS_OP_##_op, 1)
+#endif
 
-// DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_delete(de_bvec *const _msk) {
+#else
+#define DE_BVEC_STAT(_op) ((u0)0)
+#define DE_BVEC_STAT_BYTES(_op, _bytes) ((u0)0)
+#define DE_BVEC_STAT_COUNT(_field, _amount) ((u0)0)
+#define DE_BVEC_STAT_CREATE(_bits) ((u0)0)
+#endif
+
+/* ---- Heap storage ---- */
+/*
+  Default storage when no allocator is attached. Blocks start on a cache
+  line, so SIMD loads never straddle two lines. Requests of at least
+  DE_BVEC_HUGE_THRESHOLD bytes are mapped straight from the OS: the pages
+  come zeroed on first touch (creating a huge empty mask costs nothing up
+  front) and are 2MB aligned and advised for transparent huge pages.
+  On Linux this needs MAP_ANONYMOUS, i.e. _DEFAULT_SOURCE/_GNU_SOURCE in
+  strict ISO builds, otherwise the aligned heap path is used for all sizes.
+*/
+#if defined(__linux__)
+#include <sys/mman.h>
+#if defined(MAP_ANONYMOUS)
+#define DE_BVEC_HEAP_MMAP
+#endif
+#elif defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#define DE_BVEC_HEAP_VIRTUAL
+#endif
+
+#define DE_BVEC_CACHE_LINE ((usize)64)
+#define DE_BVEC_HUGE_PAGE ((usize)2 << 20)
+#define DE_BVEC_ROUND_UP(_n, _align) (((_n) + (_align) - 1) & ~((_align) - 1))
+
+/* bytes backing _blocks, whole cache lines */
+DE_CONTAINER_BITMASK_INTERNAL usize DE_BVEC_heap_bytes(const usize _blocks) {
+  return DE_BVEC_ROUND_UP((_blocks ? _blocks : 1) * sizeof(mblk_t),
+                          DE_BVEC_CACHE_LINE);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool DE_BVEC_heap_mapped(const usize _bytes) {
+#if defined(DE_BVEC_HEAP_MMAP) || defined(DE_BVEC_HEAP_VIRTUAL)
+  return _bytes >= DE_BVEC_HUGE_THRESHOLD;
+#else
+  (u0)_bytes;
+  return false;
+#endif
+}
+
+/* 64 byte aligned blocks, _zero only matters for the aligned heap path */
+DE_CONTAINER_BITMASK_INTERNAL mblk_t *DE_BVEC_heap_alloc(const usize _blocks,
+                                                         const bool _zero) {
+  const usize bytes = DE_BVEC_heap_bytes(_blocks);
+  if (DE_BVEC_heap_mapped(bytes)) {
+#if defined(DE_BVEC_HEAP_MMAP)
+    const usize len = DE_BVEC_ROUND_UP(bytes, DE_BVEC_HUGE_PAGE);
+    /* over-map by one huge page, then cut the unaligned ends off */
+    u8 *const raw = (u8 *)mmap(NULL, len + DE_BVEC_HUGE_PAGE,
+                               PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == (u8 *)MAP_FAILED)
+      return NULL;
+    u8 *const out = (u8 *)DE_BVEC_ROUND_UP((uptr)raw, DE_BVEC_HUGE_PAGE);
+    const usize head = (usize)(out - raw);
+    if (head)
+      munmap(raw, head);
+    munmap(out + len, DE_BVEC_HUGE_PAGE - head);
+#ifdef MADV_HUGEPAGE
+    madvise(out, len, MADV_HUGEPAGE);
+#endif
+    return (mblk_t *)out;
+#elif defined(DE_BVEC_HEAP_VIRTUAL)
+    return (mblk_t *)VirtualAlloc(NULL, bytes, MEM_RESERVE | MEM_COMMIT,
+                                  PAGE_READWRITE);
+#endif
+  }
+#if defined(_WIN32)
+  mblk_t *const out = (mblk_t *)_aligned_malloc(bytes, DE_BVEC_CACHE_LINE);
+#else
+  mblk_t *const out = (mblk_t *)aligned_alloc(DE_BVEC_CACHE_LINE, bytes);
+#endif
+  if (out && _zero)
+    memset(out, 0, bytes);
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_heap_free(mblk_t *const _data,
+                                                   const usize _blocks) {
+  if (!_data)
+    return;
+  const usize bytes = DE_BVEC_heap_bytes(_blocks);
+  if (DE_BVEC_heap_mapped(bytes)) {
+#if defined(DE_BVEC_HEAP_MMAP)
+    munmap(_data, DE_BVEC_ROUND_UP(bytes, DE_BVEC_HUGE_PAGE));
+#elif defined(DE_BVEC_HEAP_VIRTUAL)
+    VirtualFree(_data, 0, MEM_RELEASE);
+#endif
+    return;
+  }
+#if defined(_WIN32)
+  _aligned_free(_data);
+#else
+  free(_data);
+#endif
+}
+
+/* keeps the first min(_old_blocks, _new_blocks), the tail is unspecified */
+DE_CONTAINER_BITMASK_INTERNAL mblk_t *
+DE_BVEC_heap_realloc(mblk_t *const _data, const usize _old_blocks,
+                     const usize _new_blocks) {
+  const usize old_bytes = DE_BVEC_heap_bytes(_old_blocks);
+  const usize new_bytes = DE_BVEC_heap_bytes(_new_blocks);
+  if (old_bytes == new_bytes)
+    return _data;
+#if defined(DE_BVEC_HEAP_MMAP) && defined(MREMAP_MAYMOVE)
+  if (DE_BVEC_heap_mapped(old_bytes) && DE_BVEC_heap_mapped(new_bytes)) {
+    /* page tables move, the data is never copied */
+    const usize old_len = DE_BVEC_ROUND_UP(old_bytes, DE_BVEC_HUGE_PAGE);
+    const usize new_len = DE_BVEC_ROUND_UP(new_bytes, DE_BVEC_HUGE_PAGE);
+    if (old_len == new_len)
+      return _data;
+    u0 *const out = mremap(_data, old_len, new_len, MREMAP_MAYMOVE);
+    if (out == MAP_FAILED)
+      return NULL;
+#ifdef MADV_HUGEPAGE
+    madvise(out, new_len, MADV_HUGEPAGE);
+#endif
+    return (mblk_t *)out;
+  }
+#endif
+  mblk_t *const out = DE_BVEC_heap_alloc(_new_blocks, false);
+  if (!out)
+    return NULL;
+  memcpy(out, _data,
+         (_old_blocks < _new_blocks ? _old_blocks : _new_blocks) *
+             sizeof(mblk_t));
+  DE_BVEC_heap_free(_data, _old_blocks);
+  return out;
+}
+
+static _Thread_local de_bvec_allocator *DE_BVEC_default_alloc = NULL;
+
+DE_CONTAINER_BITMASK_INTERNAL mblk_t *
+DE_BVEC_calloc(de_bvec_allocator *const _alloc, const usize _amount) {
+  DE_BVEC_STAT_COUNT(allocs, 1);
+  DE_BVEC_STAT_COUNT(alloc_bytes, _amount * sizeof(mblk_t));
+  if (_alloc)
+    return _alloc->alloc(_alloc, _amount);
+  return DE_BVEC_heap_alloc(_amount, true);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_dealloc(de_bvec_allocator *const _alloc, mblk_t *const _data,
+                const usize _amount) {
+  if (!_data)
+    return;
+  DE_BVEC_STAT_COUNT(frees, 1);
+  DE_BVEC_STAT_COUNT(free_bytes, _amount * sizeof(mblk_t));
+  if (_alloc)
+    _alloc->dealloc(_alloc, _data, _amount);
+  else
+    DE_BVEC_heap_free(_data, _amount);
+
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_memcpy(mblk_t *const _dst,
+                                                const mblk_t *const _src,
+                                                const usize _size) {
+  memcpy(_dst, _src, _size * sizeof(mblk_t));
+}
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_memmov(mblk_t *const _dst,
+                                                const mblk_t *const _src,
+                                                const usize _size) {
+  memmove(_dst, _src, _size * sizeof(mblk_t));
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_memset(mblk_t *const _data,
+                                                const mblk_t _value,
+                                                const usize _size) {
+  for (usize i = 0; i < _size; ++i)
+    _data[i] = _value;
+}
+
+// #define _memmov memcpy
+
+/* ---- SIMD kernels ---- */
+/*
+  Every kernel works on a plain block array and is picked at startup through
+  DE_BVEC_kernels. The vector variants are compiled with per-function target
+  attributes, so they exist even when the TU is built without -mavx2 etc.
+*/
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define DE_BVEC_X86_DISPATCH
+#define DE_BVEC_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+typedef u0 (*DE_BVEC_binop_fn)(mblk_t *const, const mblk_t *const,
+                               const usize);
+typedef u0 (*DE_BVEC_unop_fn)(mblk_t *const, const usize);
+typedef usize (*DE_BVEC_count_fn)(const mblk_t *const, const usize);
+typedef usize (*DE_BVEC_count2_fn)(const mblk_t *const, const mblk_t *const,
+                                   const usize);
+
+typedef struct {
+  DE_BVEC_binop_fn and_blocks;
+  DE_BVEC_binop_fn or_blocks;
+  DE_BVEC_binop_fn xor_blocks;
+  DE_BVEC_unop_fn not_blocks;
+  DE_BVEC_count_fn count_blocks;
+  DE_BVEC_count2_fn and_count_blocks;
+  DE_BVEC_count2_fn or_count_blocks;
+  DE_BVEC_count2_fn xor_count_blocks;
+  DE_BVEC_count2_fn andnot_count_blocks;
+  de_bvec_simd level;
+} DE_BVEC_kernel_table;
+
+#define DE_BVEC_DEFINE_SCALAR_BINOP(_name, _op)                                \
+  DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_##_name##_scalar(                   \
+      mblk_t *const _dst, const mblk_t *const _src, const usize _size) {       \
+    for (usize i = 0; i < _size; ++i)                                          \
+      _dst[i] = _dst[i] _op _src[i];                                           \
+  }
+
+DE_BVEC_DEFINE_SCALAR_BINOP(and, &)
+DE_BVEC_DEFINE_SCALAR_BINOP(or, |)
+DE_BVEC_DEFINE_SCALAR_BINOP(xor, ^)
+
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_not_scalar(mblk_t *const _dst,
+                                                    const usize _size) {
+  for (usize i = 0; i < _size; ++i)
+    _dst[i] = ~_dst[i];
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_count_scalar(const mblk_t *const _src, const usize _size) {
+  usize out = 0;
+  for (usize i = 0; i < _size; ++i)
+    out += __builtin_popcountll(_src[i]);
+  return out;
+}
+
+/* popcount of (_a[i] _op _b[i]), _tag also names the target attribute */
+#define DE_BVEC_DEFINE_SCALAR_COUNT2(_name, _tag, _attr, _op)                 \
+  _attr DE_CONTAINER_BITMASK_INTERNAL usize DE_BVEC_##_name##_count_##_tag(    \
+      const mblk_t *const _a, const mblk_t *const _b, const usize _size) {     \
+    usize out = 0;                                                             \
+    for (usize i = 0; i < _size; ++i)                                          \
+      out += __builtin_popcountll(_a[i] _op _b[i]);                            \
+    return out;                                                                \
+  }
+
+DE_BVEC_DEFINE_SCALAR_COUNT2(and, scalar, , &)
+DE_BVEC_DEFINE_SCALAR_COUNT2(or, scalar, , |)
+DE_BVEC_DEFINE_SCALAR_COUNT2(xor, scalar, , ^)
+DE_BVEC_DEFINE_SCALAR_COUNT2(andnot, scalar, , &~)
+
+#ifdef DE_BVEC_X86_DISPATCH
+/* two vectors per iteration, scalar tail */
+#define DE_BVEC_DEFINE_VEC_BINOP(_name, _tag, _isa, _vec, _load, _store,      \
+                                 _vop, _op)                                    \
+  DE_BVEC_TARGET(_isa)                                                         \
+  DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_##_name##_##_tag(                   \
+      mblk_t *const _dst, const mblk_t *const _src, const usize _size) {       \
+    const usize lanes = sizeof(_vec) / sizeof(mblk_t);                         \
+    usize i = 0;                                                               \
+    for (; i + 2 * lanes <= _size; i += 2 * lanes) {                           \
+      const _vec a0 = _load((const _vec *)(_dst + i));                         \
+      const _vec a1 = _load((const _vec *)(_dst + i + lanes));                 \
+      const _vec b0 = _load((const _vec *)(_src + i));                         \
+      const _vec b1 = _load((const _vec *)(_src + i + lanes));                 \
+      _store((_vec *)(_dst + i), _vop(a0, b0));                                \
+      _store((_vec *)(_dst + i + lanes), _vop(a1, b1));                        \
+    }                                                                          \
+    for (; i < _size; ++i)                                                     \
+      _dst[i] = _dst[i] _op _src[i];                                           \
+  }
+
+#define DE_BVEC_DEFINE_VEC_NOT(_tag, _isa, _vec, _load, _store, _xor, _ones)  \
+  DE_BVEC_TARGET(_isa)                                                         \
+  DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_not_##_tag(mblk_t *const _dst,      \
+                                                      const usize _size) {     \
+    const usize lanes = sizeof(_vec) / sizeof(mblk_t);                         \
+    const _vec ones = _ones;                                                   \
+    usize i = 0;                                                               \
+    for (; i + lanes <= _size; i += lanes)                                     \
+      _store((_vec *)(_dst + i), _xor(_load((const _vec *)(_dst + i)), ones)); \
+    for (; i < _size; ++i)                                                     \
+      _dst[i] = ~_dst[i];                                                      \
+  }
+
+// clang-format off
+DE_BVEC_DEFINE_VEC_BINOP(and, sse2,   "sse2",    __m128i, _mm_loadu_si128,    _mm_storeu_si128,    _mm_and_si128,    &)
+DE_BVEC_DEFINE_VEC_BINOP(or,  sse2,   "sse2",    __m128i, _mm_loadu_si128,    _mm_storeu_si128,    _mm_or_si128,     |)
+DE_BVEC_DEFINE_VEC_BINOP(xor, sse2,   "sse2",    __m128i, _mm_loadu_si128,    _mm_storeu_si128,    _mm_xor_si128,    ^)
+DE_BVEC_DEFINE_VEC_BINOP(and, avx2,   "avx2",    __m256i, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_and_si256, &)
+DE_BVEC_DEFINE_VEC_BINOP(or,  avx2,   "avx2",    __m256i, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_or_si256,  |)
+DE_BVEC_DEFINE_VEC_BINOP(xor, avx2,   "avx2",    __m256i, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_xor_si256, ^)
+DE_BVEC_DEFINE_VEC_BINOP(and, avx512, "avx512f", __m512i, _mm512_loadu_si512, _mm512_storeu_si512, _mm512_and_si512, &)
+DE_BVEC_DEFINE_VEC_BINOP(or,  avx512, "avx512f", __m512i, _mm512_loadu_si512, _mm512_storeu_si512, _mm512_or_si512,  |)
+DE_BVEC_DEFINE_VEC_BINOP(xor, avx512, "avx512f", __m512i, _mm512_loadu_si512, _mm512_storeu_si512, _mm512_xor_si512, ^)
+
+DE_BVEC_DEFINE_VEC_NOT(sse2,   "sse2",    __m128i, _mm_loadu_si128,    _mm_storeu_si128,    _mm_xor_si128,    _mm_set1_epi32(-1))
+DE_BVEC_DEFINE_VEC_NOT(avx2,   "avx2",    __m256i, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_xor_si256, _mm256_set1_epi32(-1))
+DE_BVEC_DEFINE_VEC_NOT(avx512, "avx512f", __m512i, _mm512_loadu_si512, _mm512_storeu_si512, _mm512_xor_si512, _mm512_set1_epi32(-1))
+// clang-format on
+
+/* same loop as the scalar one, but with the popcnt instruction enabled */
+DE_BVEC_TARGET("popcnt")
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_count_popcnt(const mblk_t *const _src, const usize _size) {
+  usize out = 0;
+  for (usize i = 0; i < _size; ++i)
+    out += __builtin_popcountll(_src[i]);
+  return out;
+}
+
+/* per-64-bit-lane popcount via nibble lookup (Mula) */
+DE_BVEC_TARGET("avx2") static inline __m256i DE_BVEC_popcnt256(__m256i _v) {
+  const __m256i lookup =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1,
+                       2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  const __m256i lo = _mm256_and_si256(_v, low_mask);
+  const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(_v, 4), low_mask);
+  const __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                      _mm256_shuffle_epi8(lookup, hi));
+  return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+/* carry-save adder: (*_h, *_l) = _a + _b + _c, bitwise */
+DE_BVEC_TARGET("avx2")
+static inline u0 DE_BVEC_csa256(__m256i *const _h, __m256i *const _l,
+                                const __m256i _a, const __m256i _b,
+                                const __m256i _c) {
+  const __m256i u = _mm256_xor_si256(_a, _b);
+  *_h = _mm256_or_si256(_mm256_and_si256(_a, _b), _mm256_and_si256(u, _c));
+  *_l = _mm256_xor_si256(u, _c);
+}
+
+/* Harley-Seal: 16 vectors are folded through a CSA tree per popcount */
+DE_BVEC_TARGET("avx2")
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_count_avx2(const mblk_t *const _src, const usize _size) {
+  const __m256i *const d = (const __m256i *)_src;
+  const usize vecs = _size / 4;
+  __m256i total = _mm256_setzero_si256();
+  __m256i ones = _mm256_setzero_si256();
+  __m256i twos = _mm256_setzero_si256();
+  __m256i fours = _mm256_setzero_si256();
+  __m256i eights = _mm256_setzero_si256();
+  __m256i sixteens, twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+  usize i = 0;
+
+#define DE_BVEC_LD(_k) _mm256_loadu_si256(d + i + (_k))
+  for (; i + 16 <= vecs; i += 16) {
+    DE_BVEC_csa256(&twos_a, &ones, ones, DE_BVEC_LD(0), DE_BVEC_LD(1));
+    DE_BVEC_csa256(&twos_b, &ones, ones, DE_BVEC_LD(2), DE_BVEC_LD(3));
+    DE_BVEC_csa256(&fours_a, &twos, twos, twos_a, twos_b);
+    DE_BVEC_csa256(&twos_a, &ones, ones, DE_BVEC_LD(4), DE_BVEC_LD(5));
+    DE_BVEC_csa256(&twos_b, &ones, ones, DE_BVEC_LD(6), DE_BVEC_LD(7));
+    DE_BVEC_csa256(&fours_b, &twos, twos, twos_a, twos_b);
+    DE_BVEC_csa256(&eights_a, &fours, fours, fours_a, fours_b);
+    DE_BVEC_csa256(&twos_a, &ones, ones, DE_BVEC_LD(8), DE_BVEC_LD(9));
+    DE_BVEC_csa256(&twos_b, &ones, ones, DE_BVEC_LD(10), DE_BVEC_LD(11));
+    DE_BVEC_csa256(&fours_a, &twos, twos, twos_a, twos_b);
+    DE_BVEC_csa256(&twos_a, &ones, ones, DE_BVEC_LD(12), DE_BVEC_LD(13));
+    DE_BVEC_csa256(&twos_b, &ones, ones, DE_BVEC_LD(14), DE_BVEC_LD(15));
+    DE_BVEC_csa256(&fours_b, &twos, twos, twos_a, twos_b);
+    DE_BVEC_csa256(&eights_b, &fours, fours, fours_a, fours_b);
+    DE_BVEC_csa256(&sixteens, &eights, eights, eights_a, eights_b);
+    total = _mm256_add_epi64(total, DE_BVEC_popcnt256(sixteens));
+  }
+#undef DE_BVEC_LD
+
+  total = _mm256_slli_epi64(total, 4);
+  total = _mm256_add_epi64(
+      total, _mm256_slli_epi64(DE_BVEC_popcnt256(eights), 3));
+  total =
+      _mm256_add_epi64(total, _mm256_slli_epi64(DE_BVEC_popcnt256(fours), 2));
+  total =
+      _mm256_add_epi64(total, _mm256_slli_epi64(DE_BVEC_popcnt256(twos), 1));
+  total = _mm256_add_epi64(total, DE_BVEC_popcnt256(ones));
+  for (; i < vecs; ++i)
+    total = _mm256_add_epi64(total,
+                             DE_BVEC_popcnt256(_mm256_loadu_si256(d + i)));
+
+  usize out = (usize)_mm256_extract_epi64(total, 0) +
+              (usize)_mm256_extract_epi64(total, 1) +
+              (usize)_mm256_extract_epi64(total, 2) +
+              (usize)_mm256_extract_epi64(total, 3);
+  for (usize j = vecs * 4; j < _size; ++j)
+    out += __builtin_popcountll(_src[j]);
+  return out;
+}
+
+/* native 64-bit lane popcount, tail handled by a masked load */
+DE_BVEC_TARGET("avx512f,avx512vpopcntdq")
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_count_avx512(const mblk_t *const _src, const usize _size) {
+  __m512i acc0 = _mm512_setzero_si512();
+  __m512i acc1 = _mm512_setzero_si512();
+  usize i = 0;
+  for (; i + 16 <= _size; i += 16) {
+    acc0 = _mm512_add_epi64(
+        acc0, _mm512_popcnt_epi64(_mm512_loadu_si512(_src + i)));
+    acc1 = _mm512_add_epi64(
+        acc1, _mm512_popcnt_epi64(_mm512_loadu_si512(_src + i + 8)));
+  }
+  for (; i < _size; i += 8) {
+    const usize left = _size - i;
+    const __mmask8 m =
+        left >= 8 ? (__mmask8)0xff : (__mmask8)((1u << left) - 1);
+    acc0 = _mm512_add_epi64(
+        acc0, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(m, _src + i)));
+  }
+  return (usize)_mm512_reduce_add_epi64(_mm512_add_epi64(acc0, acc1));
+}
+
+DE_BVEC_DEFINE_SCALAR_COUNT2(and, popcnt, DE_BVEC_TARGET("popcnt"), &)
+DE_BVEC_DEFINE_SCALAR_COUNT2(or, popcnt, DE_BVEC_TARGET("popcnt"), |)
+DE_BVEC_DEFINE_SCALAR_COUNT2(xor, popcnt, DE_BVEC_TARGET("popcnt"), ^)
+DE_BVEC_DEFINE_SCALAR_COUNT2(andnot, popcnt, DE_BVEC_TARGET("popcnt"), &~)
+
+/* _a & ~_b, the intrinsics negate their first operand */
+DE_BVEC_TARGET("avx2")
+static inline __m256i DE_BVEC_andnot256(const __m256i _a, const __m256i _b) {
+  return _mm256_andnot_si256(_b, _a);
+}
+DE_BVEC_TARGET("avx512f")
+static inline __m512i DE_BVEC_andnot512(const __m512i _a, const __m512i _b) {
+  return _mm512_andnot_si512(_b, _a);
+}
+
+/* DE_BVEC_count_avx2 where each input vector is _vop(_a, _b) */
+#define DE_BVEC_DEFINE_AVX2_COUNT2(_name, _vop, _op)                          \
+  DE_BVEC_TARGET("avx2")                                                       \
+  DE_CONTAINER_BITMASK_INTERNAL usize DE_BVEC_##_name##_count_avx2(            \
+      const mblk_t *const _a, const mblk_t *const _b, const usize _size) {     \
+    const __m256i *const da = (const __m256i *)_a;                             \
+    const __m256i *const db = (const __m256i *)_b;                             \
+    const usize vecs = _size / 4;                                              \
+    __m256i total = _mm256_setzero_si256();                                    \
+    __m256i ones = _mm256_setzero_si256();                                     \
+    __m256i twos = _mm256_setzero_si256();                                     \
+    __m256i fours = _mm256_setzero_si256();                                    \
+    __m256i eights = _mm256_setzero_si256();                                   \
+    __m256i sixteens, twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;    \
+    usize i = 0;                                                               \
+    for (; i + 16 <= vecs; i += 16) {                                          \
+      DE_BVEC_csa256(&twos_a, &ones, ones, DE_BVEC_LD2(_vop, 0),               \
+                     DE_BVEC_LD2(_vop, 1));                                    \
+      DE_BVEC_csa256(&twos_b, &ones, ones, DE_BVEC_LD2(_vop, 2),               \
+                     DE_BVEC_LD2(_vop, 3));                                    \
+      DE_BVEC_csa256(&fours_a, &twos, twos, twos_a, twos_b);                   \
+      DE_BVEC_csa256(&twos_a, &ones, ones, DE_BVEC_LD2(_vop, 4),               \
+                     DE_BVEC_LD2(_vop, 5));                                    \
+      DE_BVEC_csa256(&twos_b, &ones, ones, DE_BVEC_LD2(_vop, 6),               \
+                     DE_BVEC_LD2(_vop, 7));                                    \
+      DE_BVEC_csa256(&fours_b, &twos, twos, twos_a, twos_b);                   \
+      DE_BVEC_csa256(&eights_a, &fours, fours, fours_a, fours_b);              \
+      DE_BVEC_csa256(&twos_a, &ones, ones, DE_BVEC_LD2(_vop, 8),               \
+                     DE_BVEC_LD2(_vop, 9));                                    \
+      DE_BVEC_csa256(&twos_b, &ones, ones, DE_BVEC_LD2(_vop, 10),              \
+                     DE_BVEC_LD2(_vop, 11));                                   \
+      DE_BVEC_csa256(&fours_a, &twos, twos, twos_a, twos_b);                   \
+      DE_BVEC_csa256(&twos_a, &ones, ones, DE_BVEC_LD2(_vop, 12),              \
+                     DE_BVEC_LD2(_vop, 13));                                   \
+      DE_BVEC_csa256(&twos_b, &ones, ones, DE_BVEC_LD2(_vop, 14),              \
+                     DE_BVEC_LD2(_vop, 15));                                   \
+      DE_BVEC_csa256(&fours_b, &twos, twos, twos_a, twos_b);                   \
+      DE_BVEC_csa256(&eights_b, &fours, fours, fours_a, fours_b);              \
+      DE_BVEC_csa256(&sixteens, &eights, eights, eights_a, eights_b);          \
+      total = _mm256_add_epi64(total, DE_BVEC_popcnt256(sixteens));            \
+    }                                                                          \
+    total = _mm256_slli_epi64(total, 4);                                       \
+    total = _mm256_add_epi64(                                                  \
+        total, _mm256_slli_epi64(DE_BVEC_popcnt256(eights), 3));               \
+    total = _mm256_add_epi64(                                                  \
+        total, _mm256_slli_epi64(DE_BVEC_popcnt256(fours), 2));                \
+    total = _mm256_add_epi64(                                                  \
+        total, _mm256_slli_epi64(DE_BVEC_popcnt256(twos), 1));                 \
+    total = _mm256_add_epi64(total, DE_BVEC_popcnt256(ones));                  \
+    for (; i < vecs; ++i)                                                      \
+      total = _mm256_add_epi64(total, DE_BVEC_popcnt256(DE_BVEC_LD2(_vop, 0)));\
+    usize out = (usize)_mm256_extract_epi64(total, 0) +                        \
+                (usize)_mm256_extract_epi64(total, 1) +                        \
+                (usize)_mm256_extract_epi64(total, 2) +                        \
+                (usize)_mm256_extract_epi64(total, 3);                         \
+    for (usize j = vecs * 4; j < _size; ++j)                                   \
+      out += __builtin_popcountll(_a[j] _op _b[j]);                            \
+    return out;                                                                \
+  }
+
+/* native lane popcount of _vop(_a, _b), masked loads zero the tail */
+#define DE_BVEC_DEFINE_AVX512_COUNT2(_name, _vop)                              \
+  DE_BVEC_TARGET("avx512f,avx512vpopcntdq")                                    \
+  DE_CONTAINER_BITMASK_INTERNAL usize DE_BVEC_##_name##_count_avx512(          \
+      const mblk_t *const _a, const mblk_t *const _b, const usize _size) {     \
+    __m512i acc0 = _mm512_setzero_si512();                                     \
+    __m512i acc1 = _mm512_setzero_si512();                                     \
+    usize i = 0;                                                               \
+    for (; i + 16 <= _size; i += 16) {                                         \
+      acc0 = _mm512_add_epi64(                                                 \
+          acc0, _mm512_popcnt_epi64(_vop(_mm512_loadu_si512(_a + i),           \
+                                         _mm512_loadu_si512(_b + i))));        \
+      acc1 = _mm512_add_epi64(                                                 \
+          acc1, _mm512_popcnt_epi64(_vop(_mm512_loadu_si512(_a + i + 8),       \
+                                         _mm512_loadu_si512(_b + i + 8))));    \
+    }                                                                          \
+    for (; i < _size; i += 8) {                                                \
+      const usize left = _size - i;                                            \
+      const __mmask8 m =                                                       \
+          left >= 8 ? (__mmask8)0xff : (__mmask8)((1u << left) - 1);           \
+      const __m512i va = _mm512_maskz_loadu_epi64(m, _a + i);                  \
+      const __m512i vb = _mm512_maskz_loadu_epi64(m, _b + i);                  \
+      acc0 = _mm512_add_epi64(acc0, _mm512_popcnt_epi64(_vop(va, vb)));        \
+    }                                                                          \
+    return (usize)_mm512_reduce_add_epi64(_mm512_add_epi64(acc0, acc1));       \
+  }
+
+#define DE_BVEC_LD2(_vop, _k)                                                  \
+  _vop(_mm256_loadu_si256(da + i + (_k)), _mm256_loadu_si256(db + i + (_k)))
+// clang-format off
+DE_BVEC_DEFINE_AVX2_COUNT2(and,    _mm256_and_si256,  &)
+DE_BVEC_DEFINE_AVX2_COUNT2(or,     _mm256_or_si256,   |)
+DE_BVEC_DEFINE_AVX2_COUNT2(xor,    _mm256_xor_si256,  ^)
+DE_BVEC_DEFINE_AVX2_COUNT2(andnot, DE_BVEC_andnot256, &~)
+
+DE_BVEC_DEFINE_AVX512_COUNT2(and,    _mm512_and_si512)
+DE_BVEC_DEFINE_AVX512_COUNT2(or,     _mm512_or_si512)
+DE_BVEC_DEFINE_AVX512_COUNT2(xor,    _mm512_xor_si512)
+DE_BVEC_DEFINE_AVX512_COUNT2(andnot, DE_BVEC_andnot512)
+// clang-format on
+#undef DE_BVEC_LD2
+#endif
+
+static DE_BVEC_kernel_table DE_BVEC_kernels = {
+    .and_blocks = DE_BVEC_and_scalar,
+    .or_blocks = DE_BVEC_or_scalar,
+    .xor_blocks = DE_BVEC_xor_scalar,
+    .not_blocks = DE_BVEC_not_scalar,
+    .count_blocks = DE_BVEC_count_scalar,
+    .and_count_blocks = DE_BVEC_and_count_scalar,
+    .or_count_blocks = DE_BVEC_or_count_scalar,
+    .xor_count_blocks = DE_BVEC_xor_count_scalar,
+    .andnot_count_blocks = DE_BVEC_andnot_count_scalar,
+    .level = DE_BVEC_SIMD_SCALAR,
+};
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_simd de_bvec_simd_detect(u0) {
+#ifdef DE_BVEC_X86_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return DE_BVEC_SIMD_AVX512;
+  if (__builtin_cpu_supports("avx2"))
+    return DE_BVEC_SIMD_AVX2;
+  if (__builtin_cpu_supports("sse2"))
+    return DE_BVEC_SIMD_SSE2;
+#endif
+  return DE_BVEC_SIMD_SCALAR;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_simd de_bvec_simd_active(u0) {
+  return DE_BVEC_kernels.level;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_simd
+de_bvec_simd_select(const de_bvec_simd _level) {
+  const de_bvec_simd supported = de_bvec_simd_detect();
+  const de_bvec_simd level = _level < supported ? _level : supported;
+  DE_BVEC_kernel_table k = {
+      .and_blocks = DE_BVEC_and_scalar,
+      .or_blocks = DE_BVEC_or_scalar,
+      .xor_blocks = DE_BVEC_xor_scalar,
+      .not_blocks = DE_BVEC_not_scalar,
+      .count_blocks = DE_BVEC_count_scalar,
+      .and_count_blocks = DE_BVEC_and_count_scalar,
+      .or_count_blocks = DE_BVEC_or_count_scalar,
+      .xor_count_blocks = DE_BVEC_xor_count_scalar,
+      .andnot_count_blocks = DE_BVEC_andnot_count_scalar,
+      .level = level,
+  };
+#ifdef DE_BVEC_X86_DISPATCH
+  switch (level) {
+  case DE_BVEC_SIMD_AVX512:
+    k.and_blocks = DE_BVEC_and_avx512;
+    k.or_blocks = DE_BVEC_or_avx512;
+    k.xor_blocks = DE_BVEC_xor_avx512;
+    k.not_blocks = DE_BVEC_not_avx512;
+    if (__builtin_cpu_supports("avx512vpopcntdq")) {
+      k.count_blocks = DE_BVEC_count_avx512;
+      k.and_count_blocks = DE_BVEC_and_count_avx512;
+      k.or_count_blocks = DE_BVEC_or_count_avx512;
+      k.xor_count_blocks = DE_BVEC_xor_count_avx512;
+      k.andnot_count_blocks = DE_BVEC_andnot_count_avx512;
+    } else {
+      k.count_blocks = DE_BVEC_count_avx2;
+      k.and_count_blocks = DE_BVEC_and_count_avx2;
+      k.or_count_blocks = DE_BVEC_or_count_avx2;
+      k.xor_count_blocks = DE_BVEC_xor_count_avx2;
+      k.andnot_count_blocks = DE_BVEC_andnot_count_avx2;
+    }
+    break;
+  case DE_BVEC_SIMD_AVX2:
+    k.and_blocks = DE_BVEC_and_avx2;
+    k.or_blocks = DE_BVEC_or_avx2;
+    k.xor_blocks = DE_BVEC_xor_avx2;
+    k.not_blocks = DE_BVEC_not_avx2;
+    k.count_blocks = DE_BVEC_count_avx2;
+    k.and_count_blocks = DE_BVEC_and_count_avx2;
+    k.or_count_blocks = DE_BVEC_or_count_avx2;
+    k.xor_count_blocks = DE_BVEC_xor_count_avx2;
+    k.andnot_count_blocks = DE_BVEC_andnot_count_avx2;
+    break;
+  case DE_BVEC_SIMD_SSE2:
+    k.and_blocks = DE_BVEC_and_sse2;
+    k.or_blocks = DE_BVEC_or_sse2;
+    k.xor_blocks = DE_BVEC_xor_sse2;
+    k.not_blocks = DE_BVEC_not_sse2;
+    if (__builtin_cpu_supports("popcnt")) {
+      k.count_blocks = DE_BVEC_count_popcnt;
+      k.and_count_blocks = DE_BVEC_and_count_popcnt;
+      k.or_count_blocks = DE_BVEC_or_count_popcnt;
+      k.xor_count_blocks = DE_BVEC_xor_count_popcnt;
+      k.andnot_count_blocks = DE_BVEC_andnot_count_popcnt;
+    }
+    break;
+  default:
+    break;
+  }
+#endif
+  DE_BVEC_kernels = k;
+  return level;
+}
+
+#ifdef __GNUC__
+/* pick the kernels once, before main */
+__attribute__((constructor)) static u0 DE_BVEC_kernels_init(u0) {
+  de_bvec_simd_select(DE_BVEC_SIMD_AVX512);
+}
+#endif
+
+/* ---- Lifecycle ---- */
+DE_CONTAINER_BITMASK_INTERNAL de_bvec
+de_bvec_create_with(const usize _amount_bits, de_bvec_allocator *const _alloc) {
+  DE_BVEC_STAT(create_with);
+  const usize blocks = DE_BVEC_GET_BLOCKS_AMOUNT(_amount_bits);
+  de_bvec out = {.data.small = {0},
+                 .bits_amount = _amount_bits,
+                 .block_count = blocks,
+                 .block_capacity = 0,
+                 .last_block_bits_count = DE_BVEC_BITS_MOD_MBLK(_amount_bits),
+                 .alloc = _alloc};
+  DE_BVEC_STAT_CREATE(_amount_bits);
+  DE_BVEC_COUNT_SET(&out, 0);
+  if (_amount_bits > DE_BVEC_INLINE_BITS) {
+    /* a failed allocation keeps the capacity, de_bvec_info_valid reports it */
+    out.data.blocks = DE_BVEC_calloc(_alloc, blocks);
+    out.block_capacity = blocks;
+  }
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec de_bvec_create(const usize _amount_bits) {
+  DE_BVEC_STAT(create);
+  return de_bvec_create_with(_amount_bits, DE_BVEC_default_alloc);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_allocator *
+de_bvec_allocator_set_default(de_bvec_allocator *const _alloc) {
+  de_bvec_allocator *const prev = DE_BVEC_default_alloc;
+  DE_BVEC_default_alloc = _alloc;
+  return prev;
+}
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_create_i(de_bvec *const _msk,
+                                                  const usize _amount_bits) {
+  DE_BVEC_STAT(create_i);
+  *_msk = de_bvec_create(_amount_bits);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_free(de_bvec *const _msk) {
+  if (!DE_BVEC_IS_INLINE(_msk)) {
+    DE_BVEC_dealloc(_msk->alloc, _msk->data.blocks, _msk->block_capacity);
+  }
+}
+
+// DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_delete(de_bvec *const _msk) {
 //   de_bvec_free(_msk);
 //   _msk->data.small = 0;
 // }
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_delete(de_bvec *const _msk) {
+  DE_BVEC_STAT(delete);
   if (!_msk)
     return;
   de_bvec_free(_msk);
-  _msk->data.small = 0;
+  DE_BVEC_memset(_msk->data.small, 0, DE_BVEC_INLINE_BLOCKS);
   _msk->bits_amount = 0;
   _msk->block_count = 0;
+  _msk->block_capacity = 0;
   _msk->last_block_bits_count = 0;
-  _msk->is_small = true;
+  DE_BVEC_COUNT_SET(_msk, 0);
 }
 
-DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_reserve(de_bvec *const _msk,
-                                                 const usize _amount_bits) {
-  usize new_blocks = DE_BVEC_GET_BLOCKS_AMOUNT(_amount_bits);
-  if (new_blocks > _msk->block_count) {
-    mblk_t *new_data = DE_BVEC_calloc(new_blocks);
-    if (_msk->is_small) {
-      /* move small inline to heap */
-      new_data[0] = _msk->data.small;
-    } else {
-      DE_BVEC_memmov(new_data, _msk->data.blocks, _msk->block_count);
-      DE_BVEC_dealloc(_msk->data.blocks);
-    }
-    _msk->data.blocks = new_data;
-    _msk->block_count = new_blocks;
-    _msk->last_block_bits_count = DE_BVEC_BITS_MOD_MBLK(_amount_bits);
-    _msk->is_small = false;
-    _msk->bits_amount = _amount_bits;
-  } else if (_amount_bits <= DE_BVEC_MBLK_BITS && !_msk->is_small) {
-    /* shrink to small inline if possible */
-    mblk_t temp = _msk->data.blocks[0];
-    de_bvec_free(_msk);
-    de_bvec_create_i(_msk, _amount_bits);
-    _msk->data.small = temp;
+/* moves heap storage to _capacity blocks, the first block_count are kept */
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_regrow(de_bvec *const _msk,
+                                                const usize _capacity) {
+  de_bvec_allocator *const alloc = _msk->alloc;
+  mblk_t *new_data;
+  DE_BVEC_STAT_COUNT(reallocs, 1);
+  DE_BVEC_STAT_COUNT(realloc_bytes, _capacity * sizeof(mblk_t));
+  if (!alloc) {
+    new_data = DE_BVEC_heap_realloc(_msk->data.blocks, _msk->block_capacity,
+                                    _capacity);
+  } else if (alloc->realloc) {
+    new_data = alloc->realloc(alloc, _msk->data.blocks, _msk->block_capacity,
+                              _capacity);
   } else {
-    /* update metadata only */
-    _msk->bits_amount = _amount_bits;
-    _msk->last_block_bits_count = DE_BVEC_BITS_MOD_MBLK(_amount_bits);
+    new_data = alloc->alloc(alloc, _capacity);
+    if (new_data) {
+      DE_BVEC_memcpy(new_data, _msk->data.blocks, _msk->block_count);
+      alloc->dealloc(alloc, _msk->data.blocks, _msk->block_capacity);
+    }
+  }
+  if (!new_data) {
+    /* leaves an invalid mask behind, see de_bvec_info_valid */
+    DE_BVEC_dealloc(alloc, _msk->data.blocks, _msk->block_capacity);
+    DE_BVEC_COUNT_INVALIDATE(_msk);
   }
+  _msk->data.blocks = new_data;
+  _msk->block_capacity = _capacity;
 }
 
-DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_resize(de_bvec *const _msk,
-                                                const usize _amount_bits) {
-  if (_amount_bits > DE_BVEC_MBLK_BITS) {
-    if (_msk->is_small) {
-      mblk_t temp = _msk->data.small;
-      de_bvec_free(_msk);
-      // de_bvec_create_i(_msk, _amount_bits);
-      _msk->block_count = DE_BVEC_GET_BLOCKS_AMOUNT(_amount_bits);
-      _msk->data.blocks = DE_BVEC_calloc(_msk->block_count);
-      _msk->data.blocks[0] = temp;
-      _msk->is_small = false;
-      _msk->bits_amount = _amount_bits;
-      _msk->last_block_bits_count = DE_BVEC_BITS_MOD_MBLK(_amount_bits);
-    } else {
-      usize blocks = DE_BVEC_GET_BLOCKS_AMOUNT(_amount_bits);
-      mblk_t *new_data = DE_BVEC_calloc(blocks);
-      DE_BVEC_memmov(new_data, _msk->data.blocks,
-                     blocks < _msk->block_count ? blocks : _msk->block_count);
+/* clears the bits past bits_amount in the last used block */
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_trim(de_bvec *const _msk) {
+  if (_msk->block_count)
+    DE_BVEC_DATA(_msk)[_msk->block_count - 1] &=
+        DE_BVEC_LOW_MASK(_msk->last_block_bits_count);
+}
+
+/*
+sets the size to _amount_bits, new bits are 0.
+inline blocks past block_count are kept at 0, heap blocks past it are
+zeroed once they come into use
+*/
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_set_size(de_bvec *const _msk,
+                                                  const usize _amount_bits) {
+  const usize blocks = DE_BVEC_GET_BLOCKS_AMOUNT(_amount_bits);
+  /* growing only adds 0 bits, shrinking may drop 1 bits */
+  if (_amount_bits < _msk->bits_amount)
+    DE_BVEC_COUNT_INVALIDATE(_msk);
+  if (_amount_bits <= DE_BVEC_INLINE_BITS) {
+    if (!DE_BVEC_IS_INLINE(_msk)) {
+      DE_BVEC_STAT_COUNT(unspills, 1);
+      mblk_t temp[DE_BVEC_INLINE_BLOCKS];
+      DE_BVEC_memcpy(temp, _msk->data.blocks, blocks);
       de_bvec_free(_msk);
-      _msk->block_count = blocks;
-      _msk->last_block_bits_count = DE_BVEC_BITS_MOD_MBLK(_amount_bits);
-      _msk->bits_amount = _amount_bits;
-      _msk->is_small = false;
-      _msk->data.blocks = new_data;
+      DE_BVEC_memcpy(_msk->data.small, temp, blocks);
+      _msk->block_capacity = 0;
     }
-  } else {
-    mblk_t temp;
-    if (_msk->is_small) {
-      temp = _msk->data.small;
-    } else {
-      temp = _msk->data.blocks[0];
+    DE_BVEC_memset(_msk->data.small + blocks, 0,
+                   DE_BVEC_INLINE_BLOCKS - blocks);
+  } else if (DE_BVEC_IS_INLINE(_msk)) {
+    /* inline storage counts as DE_BVEC_INLINE_BLOCKS of capacity */
+    const usize capacity = blocks > DE_BVEC_INLINE_BLOCKS * 2
+                               ? blocks
+                               : DE_BVEC_INLINE_BLOCKS * 2;
+    DE_BVEC_STAT_COUNT(spills, 1);
+    mblk_t *const heap = DE_BVEC_calloc(_msk->alloc, capacity);
+    if (heap)
+      DE_BVEC_memcpy(heap, _msk->data.small, DE_BVEC_INLINE_BLOCKS);
+    else
+      DE_BVEC_COUNT_INVALIDATE(_msk);
+    _msk->data.blocks = heap;
+    _msk->block_capacity = capacity;
+  } else if (blocks > _msk->block_count) {
+    if (blocks > _msk->block_capacity) {
+      const usize doubled = _msk->block_capacity * 2;
+      DE_BVEC_regrow(_msk, blocks > doubled ? blocks : doubled);
     }
-    de_bvec_free(_msk);
-    de_bvec_create_i(_msk, _amount_bits);
-    _msk->data.small = temp;
+    if (_msk->data.blocks)
+      DE_BVEC_memset(_msk->data.blocks + _msk->block_count, 0,
+                     blocks - _msk->block_count);
   }
+  _msk->bits_amount = _amount_bits;
+  _msk->block_count =
+      DE_BVEC_IS_INLINE(_msk) || _msk->data.blocks ? blocks : 0;
+  _msk->last_block_bits_count = DE_BVEC_BITS_MOD_MBLK(_amount_bits);
+  /* shrinking may leave bits set past the new end */
+  DE_BVEC_trim(_msk);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_reserve(de_bvec *const _msk,
+                                                 const usize _amount_bits) {
+  DE_BVEC_STAT(reserve);
+  if (_amount_bits > _msk->bits_amount)
+    DE_BVEC_set_size(_msk, _amount_bits);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_resize(de_bvec *const _msk,
+                                                const usize _amount_bits) {
+  DE_BVEC_STAT(resize);
+  DE_BVEC_set_size(_msk, _amount_bits);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_shrink_to_fit(de_bvec *const _msk) {
+  DE_BVEC_STAT(shrink_to_fit);
+  if (!DE_BVEC_IS_INLINE(_msk) && _msk->block_capacity > _msk->block_count)
+    DE_BVEC_regrow(_msk, _msk->block_count);
 }
 
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_copy(de_bvec *const _dst,
                                               const de_bvec *const _src) {
-  de_bvec_free(_dst);
-  _dst->bits_amount = _src->bits_amount;
-  _dst->block_count = _src->block_count;
-  _dst->is_small = _src->is_small;
-  _dst->last_block_bits_count = _src->last_block_bits_count;
-  if (_src->is_small) {
-    _dst->data.small = _src->data.small;
+  DE_BVEC_STAT(copy);
+  DE_BVEC_STAT_BYTES(copy, _src->block_count * sizeof(mblk_t) * 2);
+  if (DE_BVEC_IS_INLINE(_src)) {
+    de_bvec_free(_dst);
+    _dst->data = _src->data;
+    _dst->block_capacity = 0;
   } else {
-    _dst->data.blocks = DE_BVEC_calloc(_src->block_count);
+    if (DE_BVEC_IS_INLINE(_dst) || _dst->block_capacity < _src->block_count) {
+      de_bvec_free(_dst);
+      _dst->data.blocks = DE_BVEC_calloc(_dst->alloc, _src->block_count);
+      _dst->block_capacity = _src->block_count;
+    }
+    /* otherwise the existing heap capacity is reused */
     DE_BVEC_memcpy(_dst->data.blocks, _src->data.blocks, _src->block_count);
   }
+  _dst->bits_amount = _src->bits_amount;
+  _dst->block_count = _src->block_count;
+  _dst->last_block_bits_count = _src->last_block_bits_count;
+  DE_BVEC_COUNT_COPY(_dst, _src);
 }
 
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_move(de_bvec *const _dst,
                                               de_bvec *const _src) {
+  DE_BVEC_STAT(move);
   de_bvec_free(_dst);
-  _dst->bits_amount = _src->bits_amount;
-  _dst->block_count = _src->block_count;
-  _dst->bits_amount = _src->bits_amount;
-  _dst->is_small = _src->is_small;
-  _dst->last_block_bits_count = _src->last_block_bits_count;
-  if (_src->is_small) {
-    _dst->data.small = _src->data.small;
-  } else {
-    _dst->data.blocks = _src->data.blocks;
-    _src->data.blocks = NULL;
-  }
+  *_dst = *_src;
+  /* the storage belongs to _dst now */
+  _src->block_capacity = 0;
   de_bvec_delete(_src);
 }
 /* ---- Single-bit access ---- */
 DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_get(const de_bvec *const _msk,
                                                const usize _idx) {
+  DE_BVEC_STAT(get);
 #ifndef DE_CONTAINER_NO_SAFETY_CHECKS
   assert(_idx < _msk->bits_amount);
 #endif
-  if (_msk->is_small) {
-    return DE_BVEC_ONE & (_msk->data.small >> _idx);
-  } else {
-    return DE_BVEC_ONE & (_msk->data.blocks[DE_BVEC_GET_BLOCKS_INDEX(_idx)] >>
-                          (_idx % DE_BVEC_MBLK_BITS));
-  }
+  return DE_BVEC_ONE & (DE_BVEC_DATA(_msk)[DE_BVEC_GET_BLOCKS_INDEX(_idx)] >>
+                        (_idx % DE_BVEC_MBLK_BITS));
 }
 
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_set(de_bvec *const _msk,
                                              const usize _idx,
                                              const bool _value) {
+  DE_BVEC_STAT(set);
 #ifndef DE_CONTAINER_NO_SAFETY_CHECKS
   assert(_idx < _msk->bits_amount);
 #endif
-  if (_msk->is_small) {
-    if (_value) {
-      _msk->data.small |= DE_BVEC_ONE << _idx;
-    } else {
-      _msk->data.small &= ~(DE_BVEC_ONE << _idx);
-    }
-  } else {
-    if (_value) {
-      _msk->data.blocks[DE_BVEC_GET_BLOCKS_INDEX(_idx)] |=
-          DE_BVEC_ONE << (_idx % DE_BVEC_MBLK_BITS);
-    } else {
-      _msk->data.blocks[DE_BVEC_GET_BLOCKS_INDEX(_idx)] &=
-          ~(DE_BVEC_ONE << (_idx % DE_BVEC_MBLK_BITS));
-    }
-  }
+  mblk_t *const block = DE_BVEC_DATA(_msk) + DE_BVEC_GET_BLOCKS_INDEX(_idx);
+  const mblk_t bit = DE_BVEC_ONE << (_idx % DE_BVEC_MBLK_BITS);
+  const mblk_t old = *block;
+  *block = (old & ~bit) | (bit & -(mblk_t)_value);
+  DE_BVEC_COUNT_ADD(_msk, (usize)_value - (usize)((old & bit) != 0));
+}
+
+/* amount of 1 bits in a range given by its edge blocks and their masks */
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_range_ones(const mblk_t *const _blocks, const usize _block_start,
+                   const usize _block_amount, const mblk_t _head,
+                   const mblk_t _tail) {
+  if (!_block_amount)
+    return __builtin_popcountll(_blocks[_block_start] & _head & _tail);
+  return __builtin_popcountll(_blocks[_block_start] & _head) +
+         DE_BVEC_kernels.count_blocks(_blocks + _block_start + 1,
+                                      _block_amount - 1) +
+         __builtin_popcountll(_blocks[_block_start + _block_amount] & _tail);
 }
 
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_set_range(de_bvec *const _msk,
                                                    const usize _start_idx,
                                                    const usize _end_idx,
                                                    const bool _value) {
-#ifndef DE_CONTAINER_NO_SAFETY_CHECKS1
+  DE_BVEC_STAT(set_range);
+  DE_BVEC_STAT_BYTES(set_range, (DE_BVEC_GET_BLOCKS_INDEX(_end_idx) -
+                          DE_BVEC_GET_BLOCKS_INDEX(_start_idx) + 1) *
+                             sizeof(mblk_t) * 2);
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
   assert(_start_idx < _msk->bits_amount);
   assert(_end_idx < _msk->bits_amount);
   assert(_start_idx <= _end_idx);
 #endif
-  if (_msk->is_small) {
-    if (_value) {
-      _msk->data.small |=
-          ((DE_BVEC_ONE << (_end_idx - _start_idx + 1)) - DE_BVEC_ONE)
-          << _start_idx;
+  mblk_t *const blocks = DE_BVEC_DATA(_msk);
+  // from this index till end of block
+  const mblk_t head = DE_BVEC_MBLK_FILLED << (_start_idx % DE_BVEC_MBLK_BITS);
+  // from start of block till this index
+  const mblk_t tail = DE_BVEC_MBLK_FILLED >>
+                      (DE_BVEC_MBLK_BITS - 1 - _end_idx % DE_BVEC_MBLK_BITS);
+  const usize block_start = DE_BVEC_GET_BLOCKS_INDEX(_start_idx);
+  const usize block_amount = DE_BVEC_GET_BLOCKS_INDEX(_end_idx) - block_start;
+  if (DE_BVEC_COUNT_KNOWN(_msk)) {
+    const usize before =
+        DE_BVEC_range_ones(blocks, block_start, block_amount, head, tail);
+    const usize after = _value ? _end_idx - _start_idx + 1 : 0;
+    DE_BVEC_COUNT_ADD(_msk, after - before);
+  }
+
+  if (_value) {
+    if (block_amount) {
+      blocks[block_start] |= head;
+      DE_BVEC_memset(blocks + block_start + 1, DE_BVEC_MBLK_FILLED,
+                     block_amount - 1);
+      blocks[block_start + block_amount] |= tail;
     } else {
-      _msk->data.small &=
-          ~(((DE_BVEC_ONE << (_end_idx - _start_idx + 1)) - DE_BVEC_ONE)
-            << _start_idx);
+      blocks[block_start] |= head & tail;
     }
   } else {
-    // from this index till end of block
-    const usize first_block_start_idx = DE_BVEC_BITS_MOD_MBLK(_start_idx);
-    // from start of block till this index
-    const usize last_block_end_idx = _end_idx % DE_BVEC_MBLK_BITS;
-    const usize block_start = DE_BVEC_GET_BLOCKS_INDEX(_start_idx);
-    const usize block_amount = DE_BVEC_GET_BLOCKS_INDEX(_end_idx) - block_start;
-
-    if (_value) {
-      if (block_amount) {
-        _msk->data.blocks[block_start] |= DE_BVEC_MBLK_FILLED
-                                          << first_block_start_idx;
-        DE_BVEC_memset(_msk->data.blocks + block_start + 1, DE_BVEC_MBLK_FILLED,
-                       block_amount - 1);
-        _msk->data.blocks[block_start + block_amount] |=
-            DE_BVEC_MBLK_FILLED >> (DE_BVEC_MBLK_BITS - last_block_end_idx);
-
-      } else {
-        _msk->data.blocks[block_start] |=
-            ((DE_BVEC_ONE << (_end_idx - _start_idx + DE_BVEC_ONE)) -
-             DE_BVEC_ONE)
-            << _start_idx;
-      }
+    if (block_amount) {
+      blocks[block_start] &= ~head;
+      DE_BVEC_memset(blocks + block_start + 1, 0, block_amount - 1);
+      blocks[block_start + block_amount] &= ~tail;
     } else {
-      if (block_amount) {
-        _msk->data.blocks[block_start] &=
-            ~(DE_BVEC_MBLK_FILLED << first_block_start_idx);
-        DE_BVEC_memset(_msk->data.blocks + block_start + 1, 0,
-                       block_amount - 1);
-        _msk->data.blocks[block_start + block_amount] &=
-            ~(DE_BVEC_MBLK_FILLED >> (DE_BVEC_MBLK_BITS - last_block_end_idx));
-      } else {
-        _msk->data.blocks[block_start] &=
-            ~(((DE_BVEC_ONE << (_end_idx - _start_idx + DE_BVEC_ONE)) -
-               DE_BVEC_ONE)
-              << _start_idx);
-      }
+      blocks[block_start] &= ~(head & tail);
     }
   }
 }
 
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_flip(de_bvec *const _msk,
                                               const usize _idx) {
+  DE_BVEC_STAT(flip);
 
 #ifndef DE_CONTAINER_NO_SAFETY_CHECKS
   assert(_idx < _msk->bits_amount);
 #endif
-  if (_msk->is_small) {
-    _msk->data.small ^= DE_BVEC_ONE << _idx;
-  } else {
-    _msk->data.blocks[DE_BVEC_GET_BLOCKS_INDEX(_idx)] ^=
-        DE_BVEC_ONE << (_idx % DE_BVEC_MBLK_BITS);
-  }
+  mblk_t *const block = DE_BVEC_DATA(_msk) + DE_BVEC_GET_BLOCKS_INDEX(_idx);
+  const mblk_t bit = DE_BVEC_ONE << (_idx % DE_BVEC_MBLK_BITS);
+  *block ^= bit;
+  DE_BVEC_COUNT_ADD(_msk, (*block & bit) ? (usize)1 : (usize)-1);
 }
 
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_flip_range(de_bvec *const _msk,
                                                     const usize _start_idx,
                                                     const usize _end_idx) {
+  DE_BVEC_STAT(flip_range);
+  DE_BVEC_STAT_BYTES(flip_range, (DE_BVEC_GET_BLOCKS_INDEX(_end_idx) -
+                          DE_BVEC_GET_BLOCKS_INDEX(_start_idx) + 1) *
+                             sizeof(mblk_t) * 2);
 #ifndef DE_CONTAINER_NO_SAFETY_CHECKS
   assert(_start_idx < _msk->bits_amount);
   assert(_end_idx < _msk->bits_amount);
   assert(_start_idx <= _end_idx);
 #endif
-  if (_msk->is_small) {
-    _msk->data.small ^=
-        ((DE_BVEC_ONE << (_end_idx - _start_idx + 1)) - DE_BVEC_ONE)
-        << _start_idx;
+  mblk_t *const blocks = DE_BVEC_DATA(_msk);
+  // from this index till end of block
+  const mblk_t head = DE_BVEC_MBLK_FILLED << (_start_idx % DE_BVEC_MBLK_BITS);
+  // from start of block till this index
+  const mblk_t tail = DE_BVEC_MBLK_FILLED >>
+                      (DE_BVEC_MBLK_BITS - 1 - _end_idx % DE_BVEC_MBLK_BITS);
+  const usize block_start = DE_BVEC_GET_BLOCKS_INDEX(_start_idx);
+  const usize block_amount = DE_BVEC_GET_BLOCKS_INDEX(_end_idx) - block_start;
+  if (DE_BVEC_COUNT_KNOWN(_msk)) {
+    /* every 1 in the range becomes a 0 and the other way around */
+    const usize before =
+        DE_BVEC_range_ones(blocks, block_start, block_amount, head, tail);
+    DE_BVEC_COUNT_ADD(_msk, _end_idx - _start_idx + 1 - 2 * before);
+  }
+
+  if (block_amount) {
+    blocks[block_start] ^= head;
+    DE_BVEC_kernels.not_blocks(blocks + block_start + 1, block_amount - 1);
+    blocks[block_start + block_amount] ^= tail;
   } else {
-    // from this index till end of block
-    const usize first_block_start_idx = DE_BVEC_BITS_MOD_MBLK(_start_idx);
-    // from start of block till this index
-    const usize last_block_end_idx = _end_idx % DE_BVEC_MBLK_BITS;
-    const usize block_start = DE_BVEC_GET_BLOCKS_INDEX(_start_idx);
-    const usize block_amount = DE_BVEC_GET_BLOCKS_INDEX(_end_idx) - block_start;
+    blocks[block_start] ^= head & tail;
+  }
+}
 
-    if (block_amount) {
-      _msk->data.blocks[block_start] ^= DE_BVEC_MBLK_FILLED
-                                        << first_block_start_idx;
+/* ---- Batched access ---- */
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+#define DE_BVEC_BATCH_CHECK(_msk, _i) assert((_i) < (_msk)->bits_amount)
+#else
+#define DE_BVEC_BATCH_CHECK(_msk, _i) ((u0)0)
+#endif
+
+/* _rw: 0 read, 1 write. prefetching never faults, only _idx is bounded */
+#define DE_BVEC_BATCH_PREFETCH_AT(_blocks, _idx, _i, _amount, _rw)             \
+  do {                                                                         \
+    if ((_i) + DE_BVEC_BATCH_PREFETCH < (_amount)) {                           \
+      const usize ahead = (_idx)[(_i) + DE_BVEC_BATCH_PREFETCH];               \
+      __builtin_prefetch((_blocks) + DE_BVEC_GET_BLOCKS_INDEX(ahead), (_rw),   \
+                         3);                                                   \
+    }                                                                          \
+  } while (0)
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_get_many(const de_bvec *const _msk,
+                                                  const usize *const _idx,
+                                                  const usize _amount,
+                                                  bool *const _out) {
+  DE_BVEC_STAT(get_many);
+  const mblk_t *const blocks = DE_BVEC_DATA(_msk);
+  for (usize i = 0; i < _amount; ++i) {
+    DE_BVEC_BATCH_PREFETCH_AT(blocks, _idx, i, _amount, 0);
+    const usize idx = _idx[i];
+    DE_BVEC_BATCH_CHECK(_msk, idx);
+    _out[i] = DE_BVEC_ONE & (blocks[DE_BVEC_GET_BLOCKS_INDEX(idx)] >>
+                             (idx % DE_BVEC_MBLK_BITS));
+  }
+}
 
-      for (usize i = block_start + 1; i < (block_amount + block_start); ++i) {
-        _msk->data.blocks[i] ^= DE_BVEC_MBLK_FILLED;
-      }
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_set_many(de_bvec *const _msk,
+                                                  const usize *const _idx,
+                                                  const usize _amount,
+                                                  const bool _value) {
+  DE_BVEC_STAT(set_many);
+  mblk_t *const blocks = DE_BVEC_DATA(_msk);
+  const mblk_t fill = -(mblk_t)_value;
+  usize changed = 0;
+  for (usize i = 0; i < _amount; ++i) {
+    DE_BVEC_BATCH_PREFETCH_AT(blocks, _idx, i, _amount, 1);
+    const usize idx = _idx[i];
+    DE_BVEC_BATCH_CHECK(_msk, idx);
+    mblk_t *const block = blocks + DE_BVEC_GET_BLOCKS_INDEX(idx);
+    const mblk_t bit = DE_BVEC_ONE << (idx % DE_BVEC_MBLK_BITS);
+    changed += ((*block & bit) != 0) != _value;
+    *block = (*block & ~bit) | (bit & fill);
+  }
+  DE_BVEC_COUNT_ADD(_msk, _value ? changed : (usize)0 - changed);
+}
 
-      _msk->data.blocks[block_start + block_amount] ^=
-          DE_BVEC_MBLK_FILLED >> (DE_BVEC_MBLK_BITS - last_block_end_idx);
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_flip_many(de_bvec *const _msk,
+                                                   const usize *const _idx,
+                                                   const usize _amount) {
+  DE_BVEC_STAT(flip_many);
+  mblk_t *const blocks = DE_BVEC_DATA(_msk);
+  for (usize i = 0; i < _amount; ++i) {
+    DE_BVEC_BATCH_PREFETCH_AT(blocks, _idx, i, _amount, 1);
+    const usize idx = _idx[i];
+    DE_BVEC_BATCH_CHECK(_msk, idx);
+    blocks[DE_BVEC_GET_BLOCKS_INDEX(idx)] ^= DE_BVEC_ONE
+                                             << (idx % DE_BVEC_MBLK_BITS);
+  }
+  /* an index may repeat, the net change needs a recount */
+  if (_amount)
+    DE_BVEC_COUNT_INVALIDATE(_msk);
+}
 
-    } else {
-      _msk->data.blocks[block_start] ^=
-          ((DE_BVEC_ONE << (_end_idx - _start_idx + DE_BVEC_ONE)) - DE_BVEC_ONE)
-          << _start_idx;
+DE_CONTAINER_BITMASK_INTERNAL usize de_bvec_test_and_set_many(
+    de_bvec *const _msk, const usize *const _idx, const usize _amount,
+    bool *const _out) {
+  DE_BVEC_STAT(test_and_set_many);
+  mblk_t *const blocks = DE_BVEC_DATA(_msk);
+  usize fresh = 0;
+  for (usize i = 0; i < _amount; ++i) {
+    DE_BVEC_BATCH_PREFETCH_AT(blocks, _idx, i, _amount, 1);
+    const usize idx = _idx[i];
+    DE_BVEC_BATCH_CHECK(_msk, idx);
+    mblk_t *const block = blocks + DE_BVEC_GET_BLOCKS_INDEX(idx);
+    const usize shift = idx % DE_BVEC_MBLK_BITS;
+    const bool was = DE_BVEC_ONE & (*block >> shift);
+    *block |= DE_BVEC_ONE << shift;
+    fresh += !was;
+    if (_out)
+      _out[i] = was;
+  }
+  DE_BVEC_COUNT_ADD(_msk, fresh);
+  return fresh;
+}
+
+/* ---- Append ---- */
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_push_back(de_bvec *const _msk,
+                                                   const bool _value) {
+  DE_BVEC_STAT(push_back);
+  /* an invalid mask still reports its capacity, it has no blocks though */
+  if (!de_bvec_info_valid(_msk))
+    return;
+  const usize idx = _msk->bits_amount;
+  if (idx < de_bvec_info_capacity(_msk)) {
+    /* fast path, the block is either in use or gets zeroed here */
+    if (idx % DE_BVEC_MBLK_BITS == 0) {
+      DE_BVEC_DATA(_msk)[_msk->block_count++] = 0;
     }
+    _msk->bits_amount = idx + 1;
+    _msk->last_block_bits_count = idx % DE_BVEC_MBLK_BITS + 1;
+  } else {
+    DE_BVEC_set_size(_msk, idx + 1);
+    if (!de_bvec_info_valid(_msk))
+      return;
   }
+  mblk_t *const data = DE_BVEC_DATA(_msk);
+  data[DE_BVEC_GET_BLOCKS_INDEX(idx)] |= (mblk_t)_value
+                                         << (idx % DE_BVEC_MBLK_BITS);
+  DE_BVEC_COUNT_ADD(_msk, _value);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_append_bits(de_bvec *const _msk,
+                                                     const mblk_t _bits,
+                                                     const usize _amount_bits) {
+  DE_BVEC_STAT(append_bits);
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_amount_bits <= DE_BVEC_MBLK_BITS);
+#endif
+  if (_amount_bits == 0 || !de_bvec_info_valid(_msk))
+    return;
+  const usize idx = _msk->bits_amount;
+  const usize offset = idx % DE_BVEC_MBLK_BITS;
+  const mblk_t bits = _bits & DE_BVEC_LOW_MASK(_amount_bits);
+  DE_BVEC_set_size(_msk, idx + _amount_bits);
+  if (!de_bvec_info_valid(_msk))
+    return;
+  mblk_t *const data = DE_BVEC_DATA(_msk) + DE_BVEC_GET_BLOCKS_INDEX(idx);
+  data[0] |= bits << offset;
+  if (offset + _amount_bits > DE_BVEC_MBLK_BITS)
+    data[1] |= bits >> (DE_BVEC_MBLK_BITS - offset);
+  DE_BVEC_COUNT_ADD(_msk, __builtin_popcountll(bits));
 }
 
 /* ---- Bulk operations ---- */
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_clear(de_bvec *const _msk) {
-  if (_msk->is_small) {
-    _msk->data.small = 0;
-  } else {
-    DE_BVEC_memset(_msk->data.blocks, 0, _msk->block_count);
-  }
+  DE_BVEC_STAT(clear);
+  DE_BVEC_STAT_BYTES(clear, _msk->block_count * sizeof(mblk_t));
+  DE_BVEC_memset(DE_BVEC_DATA(_msk), 0, _msk->block_count);
+  DE_BVEC_COUNT_SET(_msk, 0);
 }
 
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_clear_range(de_bvec *const _msk,
                                                      const usize _start_idx,
                                                      const usize _end_idx) {
+  DE_BVEC_STAT(clear_range);
   de_bvec_set_range(_msk, _start_idx, _end_idx, false);
 }
 
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_fill(de_bvec *const _msk) {
-  if (_msk->bits_amount == 0) {
-    return;
-  }
-  if (_msk->is_small) {
-    _msk->data.small =
-        DE_BVEC_MBLK_FILLED >> (DE_BVEC_MBLK_BITS - _msk->bits_amount);
-  } else {
-    DE_BVEC_memset(_msk->data.blocks, DE_BVEC_MBLK_FILLED,
-                   _msk->block_count - 1);
-    _msk->data.blocks[_msk->block_count - 1] =
-        DE_BVEC_MBLK_FILLED >>
-        (DE_BVEC_MBLK_BITS - _msk->last_block_bits_count);
-  }
+  DE_BVEC_STAT(fill);
+  DE_BVEC_STAT_BYTES(fill, _msk->block_count * sizeof(mblk_t));
+  DE_BVEC_memset(DE_BVEC_DATA(_msk), DE_BVEC_MBLK_FILLED, _msk->block_count);
+  DE_BVEC_trim(_msk);
+  DE_BVEC_COUNT_SET(_msk, _msk->bits_amount);
 }
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_fill_range(de_bvec *const _msk,
                                                     const usize _start_idx,
                                                     const usize _end_idx) {
+  DE_BVEC_STAT(fill_range);
   de_bvec_set_range(_msk, _start_idx, _end_idx, true);
 }
 
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_and_msk(de_bvec *const _dst,
                                                  const de_bvec *const _src) {
-  if (_dst->is_small) {
-    if (_src->is_small) {
-      _dst->data.small &= _src->data.small;
-    } else {
-      _dst->data.small &= _src->data.blocks[0];
-    }
-  } else {
-
-    if (_src->is_small) {
-      _dst->data.blocks[0] &= _src->data.small;
-      DE_BVEC_memset(_dst->data.blocks + 1, 0, _dst->block_count - 1);
-    } else {
-      usize bl_amount =
-          (_dst->block_count < _src->block_count ? _dst->block_count
-                                                 : _src->block_count);
-      for (usize i = 0; i < bl_amount; ++i) {
-        _dst->data.blocks[i] &= _src->data.blocks[i];
-      }
-      for (usize i = bl_amount; i < _dst->block_count; ++i)
-        _dst->data.blocks[i] &= (mblk_t)0;
-    }
-  }
+  DE_BVEC_STAT(and_msk);
+  DE_BVEC_STAT_BYTES(and_msk, _dst->block_count * sizeof(mblk_t) * 3);
+  mblk_t *const dst = DE_BVEC_DATA(_dst);
+  const usize bl_amount = (_dst->block_count < _src->block_count
+                               ? _dst->block_count
+                               : _src->block_count);
+  DE_BVEC_kernels.and_blocks(dst, DE_BVEC_DATA(_src), bl_amount);
+  DE_BVEC_memset(dst + bl_amount, 0, _dst->block_count - bl_amount);
+  DE_BVEC_COUNT_INVALIDATE(_dst);
 }
 
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_or_msk(de_bvec *const _dst,
                                                 const de_bvec *const _src) {
-
-  if (_dst->is_small) {
-    if (_src->is_small) {
-      _dst->data.small |= _src->data.small;
-    } else {
-      _dst->data.small |= _src->data.blocks[0];
-    }
-  } else {
-
-    if (_src->is_small) {
-      _dst->data.blocks[0] |= _src->data.small;
-    } else {
-      usize bl_amount =
-          (_dst->block_count < _src->block_count ? _dst->block_count
-                                                 : _src->block_count);
-      for (usize i = 0; i < bl_amount; ++i) {
-        _dst->data.blocks[i] |= _src->data.blocks[i];
-      }
-    }
-  }
+  DE_BVEC_STAT(or_msk);
+  DE_BVEC_STAT_BYTES(or_msk, _dst->block_count * sizeof(mblk_t) * 3);
+  const usize bl_amount = (_dst->block_count < _src->block_count
+                               ? _dst->block_count
+                               : _src->block_count);
+  DE_BVEC_kernels.or_blocks(DE_BVEC_DATA(_dst), DE_BVEC_DATA(_src), bl_amount);
+  DE_BVEC_trim(_dst);
+  DE_BVEC_COUNT_INVALIDATE(_dst);
 }
 
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_xor_msk(de_bvec *const _dst,
                                                  const de_bvec *const _src) {
-  if (_dst->is_small) {
-    if (_src->is_small) {
-      _dst->data.small ^= _src->data.small;
-    } else {
-      _dst->data.small ^= _src->data.blocks[0];
-    }
-  } else {
-    if (_src->is_small) {
-      _dst->data.blocks[0] ^= _src->data.small;
-    } else {
-      usize bl_amount =
-          (_dst->block_count < _src->block_count ? _dst->block_count
-                                                 : _src->block_count);
-      for (usize i = 0; i < bl_amount; ++i) {
-        _dst->data.blocks[i] ^= _src->data.blocks[i];
-      }
-    }
-  }
+  DE_BVEC_STAT(xor_msk);
+  DE_BVEC_STAT_BYTES(xor_msk, _dst->block_count * sizeof(mblk_t) * 3);
+  const usize bl_amount = (_dst->block_count < _src->block_count
+                               ? _dst->block_count
+                               : _src->block_count);
+  DE_BVEC_kernels.xor_blocks(DE_BVEC_DATA(_dst), DE_BVEC_DATA(_src),
+                             bl_amount);
+  DE_BVEC_trim(_dst);
+  DE_BVEC_COUNT_INVALIDATE(_dst);
 }
 
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_not(de_bvec *const _dst) {
-  if (_dst->is_small) {
-    _dst->data.small ^= DE_BVEC_MBLK_FILLED;
-  } else {
-    usize bl_amount = _dst->block_count - 1;
-    for (usize i = 0; i < bl_amount; ++i) {
-      _dst->data.blocks[i] ^= DE_BVEC_MBLK_FILLED;
-    }
-    _dst->data.blocks[bl_amount] ^=
-        DE_BVEC_MBLK_FILLED >>
-        (DE_BVEC_MBLK_BITS - _dst->last_block_bits_count);
-  }
+  DE_BVEC_STAT(not);
+  DE_BVEC_STAT_BYTES(not, _dst->block_count * sizeof(mblk_t) * 2);
+  DE_BVEC_kernels.not_blocks(DE_BVEC_DATA(_dst), _dst->block_count);
+  DE_BVEC_trim(_dst);
+  if (DE_BVEC_COUNT_KNOWN(_dst))
+    DE_BVEC_COUNT_SET(_dst, _dst->bits_amount - DE_BVEC_COUNT_GET(_dst));
 }
 
 /* ---- Info / Introspection ---- */
@@ -787,63 +2212,250 @@ de_bvec_info_size(const de_bvec *const _msk) {
   return _msk->bits_amount;
 }
 
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_info_capacity(const de_bvec *const _msk) {
+  return DE_BVEC_IS_INLINE(_msk) ? DE_BVEC_INLINE_BITS
+                                 : _msk->block_capacity * DE_BVEC_MBLK_BITS;
+}
+
 DE_CONTAINER_BITMASK_INTERNAL bool
 de_bvec_info_valid(const de_bvec *const _msk) {
-  return _msk && (_msk->is_small ? true : (_msk->data.blocks != NULL));
+  return _msk && (DE_BVEC_IS_INLINE(_msk) || _msk->data.blocks != NULL);
 }
 
-DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_any(const de_bvec *const _msk) {
-  if (_msk->is_small) {
-    return _msk->data.small != 0;
-  } else {
-    for (usize i = 0; i < _msk->block_count; ++i) {
-      if (_msk->data.blocks[i])
-        return true;
-    }
-    return false;
+/* the scan behind any and none, each counts its own call */
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_any_blocks(const mblk_t *const _blocks, const usize _amount) {
+  for (usize i = 0; i < _amount; ++i) {
+    if (_blocks[i])
+      return true;
   }
+  return false;
 }
 
-DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_all(const de_bvec *const _msk) {
-  if (_msk->is_small) {
-    return (~_msk->data.small << (DE_BVEC_MBLK_BITS - _msk->bits_amount)) == 0;
-  } else {
-    const usize bcount = _msk->block_count - 1;
-    for (usize i = 0; i < bcount; ++i) {
-      if (~_msk->data.blocks[i] != 0)
-        return false;
-    }
-    // return _msk->data.blocks[bcount]
+DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_any(const de_bvec *const _msk) {
+  DE_BVEC_STAT(any);
+  if (DE_BVEC_COUNT_KNOWN(_msk))
+    return DE_BVEC_COUNT_GET(_msk) != 0;
+  DE_BVEC_STAT_BYTES(any, _msk->block_count * sizeof(mblk_t));
+  return DE_BVEC_any_blocks(DE_BVEC_DATA(_msk), _msk->block_count);
+}
 
-    return (~_msk->data.blocks[bcount]
-            << (DE_BVEC_MBLK_BITS - _msk->last_block_bits_count)) == 0;
+DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_all(const de_bvec *const _msk) {
+  DE_BVEC_STAT(all);
+  if (DE_BVEC_COUNT_KNOWN(_msk))
+    return DE_BVEC_COUNT_GET(_msk) == _msk->bits_amount;
+  DE_BVEC_STAT_BYTES(all, _msk->block_count * sizeof(mblk_t));
+  if (_msk->block_count == 0)
+    return true;
+  const mblk_t *const blocks = DE_BVEC_DATA(_msk);
+  const usize bcount = _msk->block_count - 1;
+  for (usize i = 0; i < bcount; ++i) {
+    if (~blocks[i] != 0)
+      return false;
   }
+  return (~blocks[bcount]
+          << (DE_BVEC_MBLK_BITS - _msk->last_block_bits_count)) == 0;
 }
 
 DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_none(const de_bvec *const _msk) {
-  if (_msk->is_small) {
-    return _msk->data.small == 0;
-  } else {
-    const usize bcount = _msk->block_count;
-    for (usize i = 0; i < bcount; ++i) {
-      if (_msk->data.blocks[i] != 0)
-        return false;
-    }
-    return true;
-  }
+  DE_BVEC_STAT(none);
+  if (DE_BVEC_COUNT_KNOWN(_msk))
+    return DE_BVEC_COUNT_GET(_msk) == 0;
+  DE_BVEC_STAT_BYTES(none, _msk->block_count * sizeof(mblk_t));
+  return !DE_BVEC_any_blocks(DE_BVEC_DATA(_msk), _msk->block_count);
 }
 
 DE_CONTAINER_BITMASK_INTERNAL usize de_bvec_count(const de_bvec *const _msk) {
-  if (_msk->is_small) {
-    return __builtin_popcountll(_msk->data.small);
-  } else {
-    usize out = 0;
-    for (usize i = 0; i < _msk->block_count; ++i) {
-      out += __builtin_popcountll(_msk->data.blocks[i]);
-    }
-    return out;
+  DE_BVEC_STAT(count);
+  if (DE_BVEC_COUNT_KNOWN(_msk))
+    return DE_BVEC_COUNT_GET(_msk);
+  DE_BVEC_STAT_BYTES(count, _msk->block_count * sizeof(mblk_t));
+  return DE_BVEC_kernels.count_blocks(DE_BVEC_DATA(_msk), _msk->block_count);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize de_bvec_count_refresh(de_bvec *const _msk) {
+  const usize out = de_bvec_count(_msk);
+  DE_BVEC_COUNT_SET(_msk, out);
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_count_invalidate(de_bvec *const _msk) {
+  DE_BVEC_COUNT_INVALIDATE(_msk);
+  (u0)_msk;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize de_bvec_count_range(
+    const de_bvec *const _msk, const usize _start_idx, const usize _end_idx) {
+  DE_BVEC_STAT(count_range);
+  DE_BVEC_STAT_BYTES(count_range, (DE_BVEC_GET_BLOCKS_INDEX(_end_idx) -
+                          DE_BVEC_GET_BLOCKS_INDEX(_start_idx) + 1) *
+                             sizeof(mblk_t));
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_start_idx < _msk->bits_amount);
+  assert(_end_idx < _msk->bits_amount);
+  assert(_start_idx <= _end_idx);
+#endif
+  const usize first = DE_BVEC_GET_BLOCKS_INDEX(_start_idx);
+  const usize last = DE_BVEC_GET_BLOCKS_INDEX(_end_idx);
+  const mblk_t head = DE_BVEC_MBLK_FILLED << (_start_idx % DE_BVEC_MBLK_BITS);
+  const mblk_t tail = DE_BVEC_MBLK_FILLED >>
+                      (DE_BVEC_MBLK_BITS - 1 - _end_idx % DE_BVEC_MBLK_BITS);
+  return DE_BVEC_range_ones(DE_BVEC_DATA(_msk), first, last - first, head,
+                            tail);
+}
+
+/* ---- Fused counts ---- */
+/* blocks only _longer has, they count as if combined with zeros */
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_count_rest(const de_bvec *const _longer, const usize _from) {
+  if (_longer->block_count <= _from)
+    return 0;
+  return DE_BVEC_kernels.count_blocks(DE_BVEC_DATA(_longer) + _from,
+                                      _longer->block_count - _from);
+}
+
+#define DE_BVEC_MIN_BLOCKS(_a, _b)                                             \
+  ((_a)->block_count < (_b)->block_count ? (_a)->block_count                   \
+                                         : (_b)->block_count)
+
+DE_CONTAINER_BITMASK_INTERNAL usize de_bvec_and_count(const de_bvec *const _a,
+                                                      const de_bvec *const _b) {
+  DE_BVEC_STAT(and_count);
+  DE_BVEC_STAT_BYTES(and_count,
+                     DE_BVEC_MIN_BLOCKS(_a, _b) * sizeof(mblk_t) * 2);
+  return DE_BVEC_kernels.and_count_blocks(DE_BVEC_DATA(_a), DE_BVEC_DATA(_b),
+                                          DE_BVEC_MIN_BLOCKS(_a, _b));
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize de_bvec_or_count(const de_bvec *const _a,
+                                                     const de_bvec *const _b) {
+  DE_BVEC_STAT(or_count);
+  DE_BVEC_STAT_BYTES(or_count,
+                     (_a->block_count + _b->block_count) * sizeof(mblk_t));
+  const usize n = DE_BVEC_MIN_BLOCKS(_a, _b);
+  return DE_BVEC_kernels.or_count_blocks(DE_BVEC_DATA(_a), DE_BVEC_DATA(_b),
+                                         n) +
+         DE_BVEC_count_rest(_a, n) + DE_BVEC_count_rest(_b, n);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize de_bvec_xor_count(const de_bvec *const _a,
+                                                      const de_bvec *const _b) {
+  DE_BVEC_STAT(xor_count);
+  DE_BVEC_STAT_BYTES(xor_count,
+                     (_a->block_count + _b->block_count) * sizeof(mblk_t));
+  const usize n = DE_BVEC_MIN_BLOCKS(_a, _b);
+  return DE_BVEC_kernels.xor_count_blocks(DE_BVEC_DATA(_a), DE_BVEC_DATA(_b),
+                                          n) +
+         DE_BVEC_count_rest(_a, n) + DE_BVEC_count_rest(_b, n);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_andnot_count(const de_bvec *const _a, const de_bvec *const _b) {
+  DE_BVEC_STAT(andnot_count);
+  const usize n = DE_BVEC_MIN_BLOCKS(_a, _b);
+  DE_BVEC_STAT_BYTES(andnot_count, (_a->block_count + n) * sizeof(mblk_t));
+  return DE_BVEC_kernels.andnot_count_blocks(DE_BVEC_DATA(_a),
+                                             DE_BVEC_DATA(_b), n) +
+         DE_BVEC_count_rest(_a, n);
+}
+
+/* early exit checks run per 8 blocks, the inner loop vectorizes */
+DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_intersects(const de_bvec *const _a,
+                                                      const de_bvec *const _b) {
+  DE_BVEC_STAT(intersects);
+  const mblk_t *const a = DE_BVEC_DATA(_a);
+  const mblk_t *const b = DE_BVEC_DATA(_b);
+  const usize n = DE_BVEC_MIN_BLOCKS(_a, _b);
+  DE_BVEC_STAT_BYTES(intersects, n * sizeof(mblk_t) * 2);
+  usize i = 0;
+  for (; i + 8 <= n; i += 8) {
+    mblk_t acc = 0;
+    for (usize k = 0; k < 8; ++k)
+      acc |= a[i + k] & b[i + k];
+    if (acc)
+      return true;
+  }
+  for (; i < n; ++i) {
+    if (a[i] & b[i])
+      return true;
+  }
+  return false;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_is_subset(const de_bvec *const _a,
+                                                     const de_bvec *const _b) {
+  DE_BVEC_STAT(is_subset);
+  const mblk_t *const a = DE_BVEC_DATA(_a);
+  const mblk_t *const b = DE_BVEC_DATA(_b);
+  const usize n = DE_BVEC_MIN_BLOCKS(_a, _b);
+  DE_BVEC_STAT_BYTES(is_subset, n * sizeof(mblk_t) * 2);
+  usize i = 0;
+  for (; i + 8 <= n; i += 8) {
+    mblk_t acc = 0;
+    for (usize k = 0; k < 8; ++k)
+      acc |= a[i + k] & ~b[i + k];
+    if (acc)
+      return false;
+  }
+  for (; i < _a->block_count; ++i) {
+    if (a[i] & (i < n ? ~b[i] : DE_BVEC_MBLK_FILLED))
+      return false;
   }
+  return true;
 }
+
+/* ---- Search / Iteration ---- */
+DE_CONTAINER_BITMASK_INTERNAL usize de_bvec_find_next(const de_bvec *const _msk,
+                                                      const usize _idx) {
+  DE_BVEC_STAT(find_next);
+  if (_idx >= _msk->bits_amount)
+    return DE_BVEC_NPOS;
+  const mblk_t *const blocks = DE_BVEC_DATA(_msk);
+  const usize bcount = DE_BVEC_BLOCKS_USED(_msk);
+  usize b = DE_BVEC_GET_BLOCKS_INDEX(_idx);
+  mblk_t word =
+      blocks[b] & (DE_BVEC_MBLK_FILLED << (_idx % DE_BVEC_MBLK_BITS));
+  while (!word) {
+    if (++b >= bcount)
+      return DE_BVEC_NPOS;
+    word = blocks[b];
+  }
+  const usize out = b * DE_BVEC_MBLK_BITS + (usize)__builtin_ctzll(word);
+  return out < _msk->bits_amount ? out : DE_BVEC_NPOS;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_find_next_zero(const de_bvec *const _msk, const usize _idx) {
+  DE_BVEC_STAT(find_next_zero);
+  if (_idx >= _msk->bits_amount)
+    return DE_BVEC_NPOS;
+  const mblk_t *const blocks = DE_BVEC_DATA(_msk);
+  const usize bcount = DE_BVEC_BLOCKS_USED(_msk);
+  usize b = DE_BVEC_GET_BLOCKS_INDEX(_idx);
+  mblk_t word =
+      ~blocks[b] & (DE_BVEC_MBLK_FILLED << (_idx % DE_BVEC_MBLK_BITS));
+  while (!word) {
+    if (++b >= bcount)
+      return DE_BVEC_NPOS;
+    word = ~blocks[b];
+  }
+  const usize out = b * DE_BVEC_MBLK_BITS + (usize)__builtin_ctzll(word);
+  return out < _msk->bits_amount ? out : DE_BVEC_NPOS;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_find_first(const de_bvec *const _msk) {
+  DE_BVEC_STAT(find_first);
+  return de_bvec_find_next(_msk, 0);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_find_first_zero(const de_bvec *const _msk) {
+  DE_BVEC_STAT(find_first_zero);
+  return de_bvec_find_next_zero(_msk, 0);
+}
+
 #include <stdio.h>
 
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_print_chunk(
@@ -863,18 +2475,101 @@ DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_prints(const de_bvec *const _msk,
                                                 const char byte_delimiter,
                                                 const char chuck_delimiter) {
 
-  if (_msk->is_small) {
-    de_bvec_print_chunk(_msk->data.small, byte_delimiter, chuck_delimiter);
-  } else {
-    for (usize i = _msk->block_count; i-- > 0;) {
-      de_bvec_print_chunk(_msk->data.blocks[i], byte_delimiter,
-                          chuck_delimiter);
-    }
+  const mblk_t *const blocks = DE_BVEC_DATA(_msk);
+  for (usize i = _msk->block_count; i-- > 0;) {
+    de_bvec_print_chunk(blocks[i], byte_delimiter, chuck_delimiter);
   }
 }
 DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_print(const de_bvec *const _msk) {
   de_bvec_prints(_msk, ' ', '\n');
 }
 
+/* ---- Instrumentation ---- */
+#ifdef DE_CONTAINER_BITMASK_STATS
+/* raw sums of every slot, not relative to the last reset */
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_stats_sum(u64 *const _out) {
+  memset(_out, 0, sizeof(de_bvec_stats));
+  for (DE_BVEC_stats_slot *slot =
+           atomic_load_explicit(&DE_BVEC_stats_slots, memory_order_acquire);
+       slot; slot = slot->next) {
+    for (usize i = 0; i < DE_BVEC_STATS_WORDS; ++i)
+      _out[i] += atomic_load_explicit(slot->words + i, memory_order_relaxed);
+  }
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_stats_snapshot(de_bvec_stats *const _out) {
+  u64 *const out = (u64 *)_out;
+  DE_BVEC_stats_sum(out);
+  pthread_mutex_lock(&DE_BVEC_stats_lock);
+  for (usize i = 0; i < DE_BVEC_STATS_WORDS; ++i)
+    out[i] -= DE_BVEC_stats_base[i];
+  pthread_mutex_unlock(&DE_BVEC_stats_lock);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_stats_reset(u0) {
+  de_bvec_stats now;
+  DE_BVEC_stats_sum((u64 *)&now);
+  pthread_mutex_lock(&DE_BVEC_stats_lock);
+  memcpy(DE_BVEC_stats_base, &now, sizeof(now));
+  pthread_mutex_unlock(&DE_BVEC_stats_lock);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL const char *
+de_bvec_stats_op_name(const de_bvec_stats_op _op) {
+#define DE_BVEC_STATS_OP_NAME(_name) #_name,
+  static const char *const names[] = {DE_BVEC_STATS_OPS(DE_BVEC_STATS_OP_NAME)};
+#undef DE_BVEC_STATS_OP_NAME
+  return (usize)_op < DE_BVEC_STATS_OP_COUNT ? names[_op] : "?";
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_stats_dump(
+    const de_bvec_stats *const _stats, FILE *const _file) {
+  fprintf(_file, "%-18s %14s %16s\n", "function", "calls", "bytes");
+  for (usize op = 0; op < DE_BVEC_STATS_OP_COUNT; ++op) {
+    if (!_stats->calls[op])
+      continue;
+    fprintf(_file, "%-18s %14llu %16llu\n",
+            de_bvec_stats_op_name((de_bvec_stats_op)op),
+            (unsigned long long)_stats->calls[op],
+            (unsigned long long)_stats->bytes[op]);
+#if defined(DE_CONTAINER_BITMASK_STATS_TIMING)
+    /* cycles <2^(k+1) : calls */
+    fprintf(_file, "  cycles");
+    for (usize k = 0; k < DE_BVEC_STATS_BUCKETS; ++k) {
+      if (_stats->cycles[op][k])
+        fprintf(_file, " <2^%zu:%llu", (size_t)k + 1,
+                (unsigned long long)_stats->cycles[op][k]);
+    }
+    fputc('\n', _file);
+#endif
+  }
+  fprintf(_file,
+          "allocs %llu (%llu bytes), frees %llu (%llu bytes), "
+          "reallocs %llu (%llu bytes)\n",
+          (unsigned long long)_stats->allocs,
+          (unsigned long long)_stats->alloc_bytes,
+          (unsigned long long)_stats->frees,
+          (unsigned long long)_stats->free_bytes,
+          (unsigned long long)_stats->reallocs,
+          (unsigned long long)_stats->realloc_bytes);
+  fprintf(_file, "creates inline %llu, heap %llu, spills %llu, unspills %llu\n",
+          (unsigned long long)_stats->inline_creates,
+          (unsigned long long)_stats->heap_creates,
+          (unsigned long long)_stats->spills,
+          (unsigned long long)_stats->unspills);
+  fprintf(_file, "create sizes (bits <2^k : creates)");
+  for (usize k = 0; k < DE_BVEC_STATS_BUCKETS; ++k) {
+    /* the last bucket has no upper end */
+    const bool last = k + 1 == DE_BVEC_STATS_BUCKETS;
+    if (_stats->create_bits[k])
+      fprintf(_file, " %s2^%zu:%llu", last ? ">=" : "<",
+              (size_t)(last ? k - 1 : k),
+              (unsigned long long)_stats->create_bits[k]);
+  }
+  fputc('\n', _file);
+}
+#endif
+
 #endif
 #endif
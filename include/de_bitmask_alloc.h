@@ -0,0 +1,335 @@
+#ifndef DE_CONTAINER_BITMASK_ALLOC_HEADER
+#define DE_CONTAINER_BITMASK_ALLOC_HEADER
+
+/*
+  Built-in de_bvec_allocator implementations.
+  - arena: bump pointer allocation, dealloc only reclaims the most recent
+    vector, everything is released at once with de_bvec_arena_reset /
+    de_bvec_arena_delete. the most recent vector also grows in place.
+    vectors from before a reset are dropped, not deleted.
+  - pool: power-of-two size classes with free lists, freed blocks are
+    reused by the next vector of the same class. growth inside a class
+    keeps the pointer.
+  Both embed de_bvec_allocator as their first member, pass `&x.base`
+  to de_bvec_create_with / de_bvec_allocator_set_default.
+  To get function definitions include
+  `#define DE_CONTAINER_BITMASK_IMPLEMENTATION`
+  before including this file.
+*/
+
+#include <common.h>
+#include <de_bitmask.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+/* default arena chunk size in bytes */
+#ifndef DE_BVEC_ARENA_CHUNK_BYTES
+#define DE_BVEC_ARENA_CHUNK_BYTES ((usize)1 << 20)
+#endif
+
+/* pool classes hold 1, 2, 4, ... 2^(n-1) blocks, larger goes to the heap */
+#ifndef DE_BVEC_POOL_CLASSES
+#define DE_BVEC_POOL_CLASSES 20
+#endif
+
+// clang-format off
+
+/* ---- Struct ---- */
+typedef struct {
+  de_bvec_allocator base;
+  u8*   chunk;         /* current chunk, chunks are linked through their head */
+  usize used;          /* bytes used in the current chunk */
+  usize chunk_bytes;   /* payload size of a regular chunk */
+} de_bvec_arena;
+
+typedef struct {
+  de_bvec_allocator base;
+  u0*   free_lists[DE_BVEC_POOL_CLASSES];  /* singly linked through word 0 */
+} de_bvec_pool;
+
+/* ---- Arena ---- */
+
+/*
+create an arena whose chunks hold _chunk_bytes (0 => DE_BVEC_ARENA_CHUNK_BYTES).
+no memory is allocated until the first vector.
+*/
+DE_CONTAINER_BITMASK_API de_bvec_arena
+de_bvec_arena_create(
+  const usize _chunk_bytes
+);
+
+/*
+releases every vector allocated from the arena at once.
+the first chunk is kept for reuse, so vectors from before the reset must be
+dropped without de_bvec_delete: their memory may already belong to a new
+vector, and handing it back would roll the arena over that vector
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_arena_reset(
+  de_bvec_arena* const _arena
+);
+
+/*
+frees all chunks
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_arena_delete(
+  de_bvec_arena* const _arena
+);
+
+/* ---- Pool ---- */
+
+/*
+create an empty size-class pool
+*/
+DE_CONTAINER_BITMASK_API de_bvec_pool
+de_bvec_pool_create(u0);
+
+/*
+frees all cached blocks. delete the vectors of the pool first: one deleted
+later puts its blocks back on a free list, which only another
+de_bvec_pool_delete releases
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_pool_delete(
+  de_bvec_pool* const _pool
+);
+
+// clang-format on
+#pragma GCC diagnostic pop
+#endif /* DE_CONTAINER_BITMASK_ALLOC_HEADER */
+
+/* ---- Implementation Guard ---- */
+#if defined(DE_CONTAINER_BITMASK_IMPLEMENTATION)
+#ifndef DE_CONTAINER_BITMASK_ALLOC_IMPLEMENTATION_INTERNAL
+#define DE_CONTAINER_BITMASK_ALLOC_IMPLEMENTATION_INTERNAL
+
+#include <stdlib.h>
+#include <string.h>
+
+/* chunk head, the payload follows aligned to DE_BVEC_ARENA_ALIGN */
+typedef struct {
+  u8 *prev;
+  usize bytes;
+} DE_BVEC_arena_head;
+
+#define DE_BVEC_ARENA_ALIGN ((usize)64)
+#define DE_BVEC_ARENA_HEAD_BYTES                                               \
+  ((sizeof(DE_BVEC_arena_head) + DE_BVEC_ARENA_ALIGN - 1) &                    \
+   ~(DE_BVEC_ARENA_ALIGN - 1))
+#define DE_BVEC_ARENA_HEAD(_chunk) ((DE_BVEC_arena_head *)(_chunk))
+
+/* ---- Arena ---- */
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_arena_free_chunk(u8 *const _chunk) {
+  DE_BVEC_heap_free((mblk_t *)_chunk, (DE_BVEC_ARENA_HEAD_BYTES +
+                                       DE_BVEC_ARENA_HEAD(_chunk)->bytes) /
+                                          sizeof(mblk_t));
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u8 *DE_BVEC_arena_new_chunk(u8 *const _prev,
+                                                          const usize _bytes) {
+  u8 *chunk = (u8 *)DE_BVEC_heap_alloc(
+      (DE_BVEC_ARENA_HEAD_BYTES + _bytes) / sizeof(mblk_t), false);
+  if (!chunk)
+    return NULL;
+  DE_BVEC_ARENA_HEAD(chunk)->prev = _prev;
+  DE_BVEC_ARENA_HEAD(chunk)->bytes = _bytes;
+  return chunk;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL mblk_t *
+DE_BVEC_arena_alloc(de_bvec_allocator *const _self, const usize _blocks) {
+  de_bvec_arena *const arena = (de_bvec_arena *)_self;
+  const usize bytes = (_blocks * sizeof(mblk_t) + DE_BVEC_ARENA_ALIGN - 1) &
+                      ~(DE_BVEC_ARENA_ALIGN - 1);
+  if (!arena->chunk ||
+      arena->used + bytes > DE_BVEC_ARENA_HEAD(arena->chunk)->bytes) {
+    if (bytes > arena->chunk_bytes && arena->chunk) {
+      /* oversized: own chunk, slotted behind the current one */
+      DE_BVEC_arena_head *const head = DE_BVEC_ARENA_HEAD(arena->chunk);
+      u8 *const big = DE_BVEC_arena_new_chunk(head->prev, bytes);
+      if (!big)
+        return NULL;
+      head->prev = big;
+      u8 *const out = big + DE_BVEC_ARENA_HEAD_BYTES;
+      memset(out, 0, bytes);
+      return (mblk_t *)out;
+    }
+    u8 *const chunk = DE_BVEC_arena_new_chunk(
+        arena->chunk, bytes > arena->chunk_bytes ? bytes : arena->chunk_bytes);
+    if (!chunk)
+      return NULL;
+    arena->chunk = chunk;
+    arena->used = 0;
+  }
+  u8 *const out = arena->chunk + DE_BVEC_ARENA_HEAD_BYTES + arena->used;
+  arena->used += bytes;
+  memset(out, 0, bytes);
+  return (mblk_t *)out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_arena_dealloc(
+    de_bvec_allocator *const _self, mblk_t *const _data, const usize _blocks) {
+  de_bvec_arena *const arena = (de_bvec_arena *)_self;
+  const usize bytes = (_blocks * sizeof(mblk_t) + DE_BVEC_ARENA_ALIGN - 1) &
+                      ~(DE_BVEC_ARENA_ALIGN - 1);
+  /* the most recent allocation can be handed back, the rest waits for reset */
+  if (arena->chunk && arena->used >= bytes &&
+      (u8 *)_data + bytes ==
+          arena->chunk + DE_BVEC_ARENA_HEAD_BYTES + arena->used)
+    arena->used -= bytes;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL mblk_t *
+DE_BVEC_arena_realloc(de_bvec_allocator *const _self, mblk_t *const _data,
+                      const usize _old_blocks, const usize _new_blocks) {
+  de_bvec_arena *const arena = (de_bvec_arena *)_self;
+  const usize old_bytes =
+      (_old_blocks * sizeof(mblk_t) + DE_BVEC_ARENA_ALIGN - 1) &
+      ~(DE_BVEC_ARENA_ALIGN - 1);
+  const usize new_bytes =
+      (_new_blocks * sizeof(mblk_t) + DE_BVEC_ARENA_ALIGN - 1) &
+      ~(DE_BVEC_ARENA_ALIGN - 1);
+  if (arena->chunk && arena->used >= old_bytes &&
+      (u8 *)_data + old_bytes ==
+          arena->chunk + DE_BVEC_ARENA_HEAD_BYTES + arena->used &&
+      arena->used - old_bytes + new_bytes <=
+          DE_BVEC_ARENA_HEAD(arena->chunk)->bytes) {
+    /* top of the current chunk, just move the bump pointer */
+    arena->used = arena->used - old_bytes + new_bytes;
+    return _data;
+  }
+  if (new_bytes <= old_bytes)
+    return _data;
+  mblk_t *const out = DE_BVEC_arena_alloc(_self, _new_blocks);
+  if (out)
+    memcpy(out, _data, _old_blocks * sizeof(mblk_t));
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_arena
+de_bvec_arena_create(const usize _chunk_bytes) {
+  return (de_bvec_arena){
+      .base = {.alloc = DE_BVEC_arena_alloc,
+               .dealloc = DE_BVEC_arena_dealloc,
+               .realloc = DE_BVEC_arena_realloc},
+      .chunk = NULL,
+      .used = 0,
+      .chunk_bytes =
+          ((_chunk_bytes ? _chunk_bytes : DE_BVEC_ARENA_CHUNK_BYTES) +
+           DE_BVEC_ARENA_ALIGN - 1) &
+          ~(DE_BVEC_ARENA_ALIGN - 1)};
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_arena_reset(de_bvec_arena *const _arena) {
+  /* keep one regular sized chunk, free the rest */
+  u8 *keep = NULL;
+  for (u8 *chunk = _arena->chunk; chunk;) {
+    u8 *const prev = DE_BVEC_ARENA_HEAD(chunk)->prev;
+    if (!keep && DE_BVEC_ARENA_HEAD(chunk)->bytes == _arena->chunk_bytes)
+      keep = chunk;
+    else
+      DE_BVEC_arena_free_chunk(chunk);
+    chunk = prev;
+  }
+  if (keep)
+    DE_BVEC_ARENA_HEAD(keep)->prev = NULL;
+  _arena->chunk = keep;
+  _arena->used = 0;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_arena_delete(de_bvec_arena *const _arena) {
+  if (!_arena)
+    return;
+  for (u8 *chunk = _arena->chunk; chunk;) {
+    u8 *const prev = DE_BVEC_ARENA_HEAD(chunk)->prev;
+    DE_BVEC_arena_free_chunk(chunk);
+    chunk = prev;
+  }
+  _arena->chunk = NULL;
+  _arena->used = 0;
+}
+
+/* ---- Pool ---- */
+/* class c holds 2^c blocks */
+DE_CONTAINER_BITMASK_INTERNAL usize DE_BVEC_pool_class(const usize _blocks) {
+  return _blocks <= 1 ? 0
+                      : (usize)(DE_BVEC_MBLK_BITS -
+                                __builtin_clzll((u64)(_blocks - 1)));
+}
+
+DE_CONTAINER_BITMASK_INTERNAL mblk_t *
+DE_BVEC_pool_alloc(de_bvec_allocator *const _self, const usize _blocks) {
+  de_bvec_pool *const pool = (de_bvec_pool *)_self;
+  const usize c = DE_BVEC_pool_class(_blocks);
+  if (c >= DE_BVEC_POOL_CLASSES)
+    return DE_BVEC_heap_alloc(_blocks, true);
+  mblk_t *out = (mblk_t *)pool->free_lists[c];
+  if (out) {
+    pool->free_lists[c] = *(u0 **)out;
+    memset(out, 0, _blocks * sizeof(mblk_t));
+    return out;
+  }
+  return DE_BVEC_heap_alloc((usize)1 << c, true);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_pool_dealloc(
+    de_bvec_allocator *const _self, mblk_t *const _data, const usize _blocks) {
+  de_bvec_pool *const pool = (de_bvec_pool *)_self;
+  const usize c = DE_BVEC_pool_class(_blocks);
+  if (c >= DE_BVEC_POOL_CLASSES) {
+    DE_BVEC_heap_free(_data, _blocks);
+    return;
+  }
+  *(u0 **)_data = pool->free_lists[c];
+  pool->free_lists[c] = _data;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL mblk_t *
+DE_BVEC_pool_realloc(de_bvec_allocator *const _self, mblk_t *const _data,
+                     const usize _old_blocks, const usize _new_blocks) {
+  const usize c = DE_BVEC_pool_class(_old_blocks);
+  const usize new_c = DE_BVEC_pool_class(_new_blocks);
+  if (c < DE_BVEC_POOL_CLASSES && c == new_c)
+    return _data;
+  if (c >= DE_BVEC_POOL_CLASSES && new_c >= DE_BVEC_POOL_CLASSES)
+    return DE_BVEC_heap_realloc(_data, _old_blocks, _new_blocks);
+  mblk_t *const out = DE_BVEC_pool_alloc(_self, _new_blocks);
+  if (!out)
+    return NULL;
+  memcpy(out, _data,
+         (_old_blocks < _new_blocks ? _old_blocks : _new_blocks) *
+             sizeof(mblk_t));
+  DE_BVEC_pool_dealloc(_self, _data, _old_blocks);
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_pool de_bvec_pool_create(u0) {
+  de_bvec_pool out = {.base = {.alloc = DE_BVEC_pool_alloc,
+                               .dealloc = DE_BVEC_pool_dealloc,
+                               .realloc = DE_BVEC_pool_realloc}};
+  for (usize c = 0; c < DE_BVEC_POOL_CLASSES; ++c)
+    out.free_lists[c] = NULL;
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_pool_delete(de_bvec_pool *const _pool) {
+  if (!_pool)
+    return;
+  for (usize c = 0; c < DE_BVEC_POOL_CLASSES; ++c) {
+    for (u0 *block = _pool->free_lists[c]; block;) {
+      u0 *const next = *(u0 **)block;
+      DE_BVEC_heap_free((mblk_t *)block, (usize)1 << c);
+      block = next;
+    }
+    _pool->free_lists[c] = NULL;
+  }
+}
+
+#endif
+#endif
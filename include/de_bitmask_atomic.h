@@ -0,0 +1,275 @@
+#ifndef DE_CONTAINER_BITMASK_ATOMIC_HEADER
+#define DE_CONTAINER_BITMASK_ATOMIC_HEADER
+
+/*
+  Fixed size bitvector shared between threads without a lock.
+  Single bit writes are C11 atomic fetch_or / fetch_and / fetch_xor on the
+  containing block, so writers to different bits of one block never lose
+  updates. Bit writes are acq_rel and get is acquire, a thread that sees a
+  bit set also sees everything the setter wrote before setting it.
+  count / any read every block relaxed, they never tear a block but are
+  not a snapshot of one instant while writers are running.
+  The size is fixed at creation, nothing here reallocates.
+  To get function definitions include
+  `#define DE_CONTAINER_BITMASK_IMPLEMENTATION`
+  before including this file.
+*/
+
+#include <common.h>
+#include <de_bitmask.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+// clang-format off
+
+/* ---- Struct ---- */
+typedef struct {
+  _Atomic mblk_t* blocks;
+  usize           bits_amount;
+  usize           block_count;
+} de_bvec_atomic;
+
+/* ---- Lifecycle ---- */
+
+/*
+create a concurrent bitvector of _amount_bits zeroed bits
+*/
+DE_CONTAINER_BITMASK_API de_bvec_atomic
+de_bvec_atomic_create(
+  const usize _amount_bits
+);
+
+/*
+frees the blocks, no other thread may still use _msk
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_atomic_delete(
+  de_bvec_atomic* const _msk
+);
+
+/*
+copies the current blocks into _dst, resized to the same size. every
+block is read atomically, concurrent writes may or may not be included
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_atomic_snapshot(
+  const de_bvec_atomic* const _msk,
+  de_bvec* const              _dst
+);
+
+/* ---- Single-bit access ---- */
+
+/*
+return the state of the bit at the given index
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_atomic_get(
+  const de_bvec_atomic* const _msk,
+  const usize                 _idx
+);
+
+/*
+sets the state of the bit at the given index
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_atomic_set(
+  de_bvec_atomic* const _msk,
+  const usize           _idx,
+  const bool            _value
+);
+
+/*
+sets the bit at the given index to 0
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_atomic_clear(
+  de_bvec_atomic* const _msk,
+  const usize           _idx
+);
+
+/*
+flips the bit at the given index, returns its previous state
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_atomic_flip(
+  de_bvec_atomic* const _msk,
+  const usize           _idx
+);
+
+/*
+sets the bit at the given index to 1, returns its previous state.
+exactly one of several racing callers gets false, use it to claim _idx
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_atomic_test_and_set(
+  de_bvec_atomic* const _msk,
+  const usize           _idx
+);
+
+/*
+sets the bit at the given index to 0, returns its previous state.
+exactly one of several racing callers gets true
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_atomic_test_and_clear(
+  de_bvec_atomic* const _msk,
+  const usize           _idx
+);
+
+/* ---- Queries ---- */
+
+/*
+returns the amount of 1 bits, relaxed
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_atomic_count(
+  const de_bvec_atomic* const _msk
+);
+
+/*
+returns true if any bit is 1, relaxed
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_atomic_any(
+  const de_bvec_atomic* const _msk
+);
+
+// clang-format on
+#pragma GCC diagnostic pop
+#endif /* DE_CONTAINER_BITMASK_ATOMIC_HEADER */
+
+/* ---- Implementation Guard ---- */
+#if defined(DE_CONTAINER_BITMASK_IMPLEMENTATION)
+#ifndef DE_CONTAINER_BITMASK_ATOMIC_IMPLEMENTATION_INTERNAL
+#define DE_CONTAINER_BITMASK_ATOMIC_IMPLEMENTATION_INTERNAL
+
+#include <assert.h>
+
+/* the blocks are allocated and zeroed as plain mblk_t */
+_Static_assert(sizeof(_Atomic mblk_t) == sizeof(mblk_t),
+               "atomic blocks must have the layout of mblk_t");
+
+#define DE_BVEC_ATOMIC_BLOCK(_msk, _idx)                                       \
+  ((_msk)->blocks + DE_BVEC_GET_BLOCKS_INDEX(_idx))
+#define DE_BVEC_ATOMIC_BIT(_idx) (DE_BVEC_ONE << ((_idx) % DE_BVEC_MBLK_BITS))
+
+/* ---- Lifecycle ---- */
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_atomic
+de_bvec_atomic_create(const usize _amount_bits) {
+  const usize blocks = DE_BVEC_GET_BLOCKS_AMOUNT(_amount_bits);
+  _Atomic mblk_t *const data =
+      blocks ? (_Atomic mblk_t *)DE_BVEC_heap_alloc(blocks, true) : NULL;
+  return (de_bvec_atomic){.blocks = data,
+                          .bits_amount = data ? _amount_bits : 0,
+                          .block_count = data ? blocks : 0};
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_atomic_delete(de_bvec_atomic *const _msk) {
+  if (!_msk)
+    return;
+  DE_BVEC_heap_free((mblk_t *)_msk->blocks, _msk->block_count);
+  *_msk = (de_bvec_atomic){.blocks = NULL, .bits_amount = 0, .block_count = 0};
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_atomic_snapshot(
+    const de_bvec_atomic *const _msk, de_bvec *const _dst) {
+  de_bvec_resize(_dst, _msk->bits_amount);
+  mblk_t *const dst = DE_BVEC_DATA(_dst);
+  for (usize i = 0; i < _msk->block_count; ++i)
+    dst[i] = atomic_load_explicit(_msk->blocks + i, memory_order_relaxed);
+  atomic_thread_fence(memory_order_acquire);
+  DE_BVEC_COUNT_INVALIDATE(_dst);
+}
+
+/* ---- Single-bit access ---- */
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_atomic_get(const de_bvec_atomic *const _msk, const usize _idx) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_idx < _msk->bits_amount);
+#endif
+  return (atomic_load_explicit(DE_BVEC_ATOMIC_BLOCK(_msk, _idx),
+                               memory_order_acquire) &
+          DE_BVEC_ATOMIC_BIT(_idx)) != 0;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_atomic_set(de_bvec_atomic *const _msk,
+                                                    const usize _idx,
+                                                    const bool _value) {
+  if (_value)
+    de_bvec_atomic_test_and_set(_msk, _idx);
+  else
+    de_bvec_atomic_test_and_clear(_msk, _idx);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_atomic_clear(de_bvec_atomic *const _msk, const usize _idx) {
+  de_bvec_atomic_test_and_clear(_msk, _idx);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_atomic_flip(de_bvec_atomic *const _msk, const usize _idx) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_idx < _msk->bits_amount);
+#endif
+  const mblk_t bit = DE_BVEC_ATOMIC_BIT(_idx);
+  return (atomic_fetch_xor_explicit(DE_BVEC_ATOMIC_BLOCK(_msk, _idx), bit,
+                                    memory_order_acq_rel) &
+          bit) != 0;
+}
+
+/*
+  test_and_set / test_and_clear look before they write: when the bit is
+  already in the wanted state the read only shares the cache line, so
+  repeated claims of a visited bit do not bounce it between cores.
+*/
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_atomic_test_and_set(de_bvec_atomic *const _msk, const usize _idx) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_idx < _msk->bits_amount);
+#endif
+  _Atomic mblk_t *const block = DE_BVEC_ATOMIC_BLOCK(_msk, _idx);
+  const mblk_t bit = DE_BVEC_ATOMIC_BIT(_idx);
+  if (atomic_load_explicit(block, memory_order_acquire) & bit)
+    return true;
+  return (atomic_fetch_or_explicit(block, bit, memory_order_acq_rel) & bit) !=
+         0;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_atomic_test_and_clear(de_bvec_atomic *const _msk, const usize _idx) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_idx < _msk->bits_amount);
+#endif
+  _Atomic mblk_t *const block = DE_BVEC_ATOMIC_BLOCK(_msk, _idx);
+  const mblk_t bit = DE_BVEC_ATOMIC_BIT(_idx);
+  if (!(atomic_load_explicit(block, memory_order_acquire) & bit))
+    return false;
+  return (atomic_fetch_and_explicit(block, ~bit, memory_order_acq_rel) &
+          bit) != 0;
+}
+
+/* ---- Queries ---- */
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_atomic_count(const de_bvec_atomic *const _msk) {
+  usize out = 0;
+  for (usize i = 0; i < _msk->block_count; ++i)
+    out += (usize)__builtin_popcountll(
+        atomic_load_explicit(_msk->blocks + i, memory_order_relaxed));
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_atomic_any(const de_bvec_atomic *const _msk) {
+  for (usize i = 0; i < _msk->block_count; ++i) {
+    if (atomic_load_explicit(_msk->blocks + i, memory_order_relaxed))
+      return true;
+  }
+  return false;
+}
+
+#endif
+#endif
@@ -0,0 +1,383 @@
+#ifndef DE_CONTAINER_BITMASK_BLOOM_HEADER
+#define DE_CONTAINER_BITMASK_BLOOM_HEADER
+
+/*
+  Split block Bloom filter stored in a de_bvec.
+  A key picks one 512 bit block (a cache line of the cache line aligned
+  heap storage) and sets one bit in each of its 8 blocks of 64 bits, the
+  bit chosen by a multiply with a per-word salt. A lookup is a single
+  cache miss. With AVX2 the 8 masks come from one multiply, shift and
+  two variable shifts and are tested with two vptest. Other levels of
+  de_bvec_simd_select use the same scalar loop. The batched calls
+  prefetch DE_BVEC_BATCH_PREFETCH keys ahead.
+  Keys are 64 bit values (ids or hashes of the items), they are mixed
+  before use, so sequential ids are fine.
+  The blocks stay a plain de_bvec in msk, it can be serialized, mapped
+  or merged like any other mask.
+  To get function definitions include
+  `#define DE_CONTAINER_BITMASK_IMPLEMENTATION`
+  before including this file.
+*/
+
+#include <common.h>
+#include <de_bitmask.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+#define DE_BVEC_BLOOM_BLOCK_BITS ((usize)512)
+#define DE_BVEC_BLOOM_WORDS (DE_BVEC_BLOOM_BLOCK_BITS / DE_BVEC_MBLK_BITS)
+
+// clang-format off
+
+/* ---- Struct ---- */
+typedef struct {
+  de_bvec msk;           /* DE_BVEC_BLOOM_BLOCK_BITS bits per block */
+  usize   block_count;   /* 512 bit blocks, at most 2^32 */
+} de_bvec_bloom;
+
+/* ---- Lifecycle ---- */
+
+/*
+create an empty filter sized for _expected_keys keys at _bits_per_key
+bits each (at least one block). 10 bits per key give about 1% false
+positives, 16 about 0.1%
+*/
+DE_CONTAINER_BITMASK_API de_bvec_bloom
+de_bvec_bloom_create(
+  const usize _expected_keys,
+  const usize _bits_per_key
+);
+
+/*
+resets all values and clears the struct
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_bloom_delete(
+  de_bvec_bloom* const _flt
+);
+
+/*
+removes all keys
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_bloom_clear(
+  de_bvec_bloom* const _flt
+);
+
+/*
+adds the keys of _src to _dst, both must have the same amount of blocks
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_bloom_merge(
+  de_bvec_bloom* const       _dst,
+  const de_bvec_bloom* const _src
+);
+
+/* ---- Keys ---- */
+
+/*
+adds _key
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_bloom_insert(
+  de_bvec_bloom* const _flt,
+  const u64            _key
+);
+
+/*
+returns false if _key was never inserted, true if it probably was
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_bloom_contains(
+  const de_bvec_bloom* const _flt,
+  const u64                  _key
+);
+
+/*
+adds _keys[0.._amount)
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_bloom_insert_many(
+  de_bvec_bloom* const _flt,
+  const u64* const     _keys,
+  const usize          _amount
+);
+
+/*
+_out[i] (optional) = de_bvec_bloom_contains(_flt, _keys[i]).
+returns the amount of keys that probably are in the filter
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_bloom_contains_many(
+  const de_bvec_bloom* const _flt,
+  const u64* const           _keys,
+  const usize                _amount,
+  bool* const                _out
+);
+
+/* ---- Info / Introspection ---- */
+
+/*
+returns if the filter is valid (allocation worked)
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_bloom_info_valid(
+  const de_bvec_bloom* const _flt
+);
+
+/*
+returns the bytes of the blocks
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_bloom_info_bytes(
+  const de_bvec_bloom* const _flt
+);
+
+// clang-format on
+#pragma GCC diagnostic pop
+#endif /* DE_CONTAINER_BITMASK_BLOOM_HEADER */
+
+/* ---- Implementation Guard ---- */
+#if defined(DE_CONTAINER_BITMASK_IMPLEMENTATION)
+#ifndef DE_CONTAINER_BITMASK_BLOOM_IMPLEMENTATION_INTERNAL
+#define DE_CONTAINER_BITMASK_BLOOM_IMPLEMENTATION_INTERNAL
+
+/* odd constants, one per 64 bit word of a block */
+static const u32 DE_BVEC_bloom_salt[DE_BVEC_BLOOM_WORDS] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+    0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u};
+
+/* murmur3 finalizer, every key bit reaches every hash bit */
+DE_CONTAINER_BITMASK_INTERNAL u64 DE_BVEC_bloom_mix(u64 _key) {
+  _key ^= _key >> 33;
+  _key *= 0xff51afd7ed558ccdull;
+  _key ^= _key >> 33;
+  _key *= 0xc4ceb9fe1a85ec53ull;
+  _key ^= _key >> 33;
+  return _key;
+}
+
+/* the high half picks the block (multiply-shift instead of a modulo) */
+DE_CONTAINER_BITMASK_INTERNAL mblk_t *
+DE_BVEC_bloom_block(const de_bvec_bloom *const _flt, const u64 _hash) {
+  const usize b = (usize)(((_hash >> 32) * (u64)_flt->block_count) >> 32);
+  return DE_BVEC_DATA(&_flt->msk) + b * DE_BVEC_BLOOM_WORDS;
+}
+
+/* the low half picks one bit per word, the top 6 bits of hash * salt */
+#define DE_BVEC_BLOOM_BIT(_hash, _w)                                           \
+  (DE_BVEC_ONE << (((u32)(_hash) * DE_BVEC_bloom_salt[_w]) >> 26))
+
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_bloom_insert_scalar(mblk_t *_block,
+                                                             const u64 _hash) {
+  for (usize w = 0; w < DE_BVEC_BLOOM_WORDS; ++w)
+    _block[w] |= DE_BVEC_BLOOM_BIT(_hash, w);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_bloom_contains_scalar(const mblk_t *_block, const u64 _hash) {
+  mblk_t miss = 0;
+  for (usize w = 0; w < DE_BVEC_BLOOM_WORDS; ++w)
+    miss |= DE_BVEC_BLOOM_BIT(_hash, w) & ~_block[w];
+  return !miss;
+}
+
+#ifdef DE_BVEC_X86_DISPATCH
+/* the 8 word masks of _hash, words 0-3 in *_lo and 4-7 in *_hi */
+DE_BVEC_TARGET("avx2")
+static inline u0 DE_BVEC_bloom_masks256(const u64 _hash, __m256i *const _lo,
+                                        __m256i *const _hi) {
+  const __m256i salt =
+      _mm256_loadu_si256((const __m256i *)(const u0 *)DE_BVEC_bloom_salt);
+  const __m256i bit = _mm256_srli_epi32(
+      _mm256_mullo_epi32(_mm256_set1_epi32((int)(u32)_hash), salt), 26);
+  const __m256i one = _mm256_set1_epi64x(1);
+  *_lo = _mm256_sllv_epi64(one,
+                           _mm256_cvtepu32_epi64(_mm256_castsi256_si128(bit)));
+  *_hi = _mm256_sllv_epi64(
+      one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(bit, 1)));
+}
+
+DE_BVEC_TARGET("avx2")
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_bloom_insert_avx2(mblk_t *_block,
+                                                           const u64 _hash) {
+  __m256i lo, hi;
+  DE_BVEC_bloom_masks256(_hash, &lo, &hi);
+  __m256i *const v = (__m256i *)(u0 *)_block;
+  _mm256_storeu_si256(v, _mm256_or_si256(_mm256_loadu_si256(v), lo));
+  _mm256_storeu_si256(v + 1, _mm256_or_si256(_mm256_loadu_si256(v + 1), hi));
+}
+
+DE_BVEC_TARGET("avx2")
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_bloom_contains_avx2(const mblk_t *_block, const u64 _hash) {
+  __m256i lo, hi;
+  DE_BVEC_bloom_masks256(_hash, &lo, &hi);
+  const __m256i *const v = (const __m256i *)(const u0 *)_block;
+  /* testc: every bit of the mask is set in the block */
+  return _mm256_testc_si256(_mm256_loadu_si256(v), lo) &
+         _mm256_testc_si256(_mm256_loadu_si256(v + 1), hi);
+}
+
+DE_BVEC_TARGET("avx2")
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_bloom_insert_many_avx2(de_bvec_bloom *const _flt,
+                               const u64 *const _keys, const usize _amount) {
+  for (usize i = 0; i < _amount; ++i) {
+    if (i + DE_BVEC_BATCH_PREFETCH < _amount)
+      __builtin_prefetch(
+          DE_BVEC_bloom_block(
+              _flt, DE_BVEC_bloom_mix(_keys[i + DE_BVEC_BATCH_PREFETCH])),
+          1, 3);
+    const u64 hash = DE_BVEC_bloom_mix(_keys[i]);
+    DE_BVEC_bloom_insert_avx2(DE_BVEC_bloom_block(_flt, hash), hash);
+  }
+}
+
+DE_BVEC_TARGET("avx2")
+DE_CONTAINER_BITMASK_INTERNAL usize DE_BVEC_bloom_contains_many_avx2(
+    const de_bvec_bloom *const _flt, const u64 *const _keys,
+    const usize _amount, bool *const _out) {
+  usize found = 0;
+  for (usize i = 0; i < _amount; ++i) {
+    if (i + DE_BVEC_BATCH_PREFETCH < _amount)
+      __builtin_prefetch(
+          DE_BVEC_bloom_block(
+              _flt, DE_BVEC_bloom_mix(_keys[i + DE_BVEC_BATCH_PREFETCH])),
+          0, 3);
+    const u64 hash = DE_BVEC_bloom_mix(_keys[i]);
+    const bool hit =
+        DE_BVEC_bloom_contains_avx2(DE_BVEC_bloom_block(_flt, hash), hash);
+    found += hit;
+    if (_out)
+      _out[i] = hit;
+  }
+  return found;
+}
+
+#define DE_BVEC_BLOOM_AVX2() (DE_BVEC_kernels.level >= DE_BVEC_SIMD_AVX2)
+#else
+#define DE_BVEC_BLOOM_AVX2() false
+#define DE_BVEC_bloom_insert_avx2 DE_BVEC_bloom_insert_scalar
+#define DE_BVEC_bloom_contains_avx2 DE_BVEC_bloom_contains_scalar
+#define DE_BVEC_bloom_insert_many_avx2(_flt, _keys, _amount) ((u0)0)
+#define DE_BVEC_bloom_contains_many_avx2(_flt, _keys, _amount, _out) ((usize)0)
+#endif
+
+/* ---- Lifecycle ---- */
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_bloom
+de_bvec_bloom_create(const usize _expected_keys, const usize _bits_per_key) {
+  const usize bits = _expected_keys * _bits_per_key;
+  usize blocks =
+      (bits + DE_BVEC_BLOOM_BLOCK_BITS - 1) / DE_BVEC_BLOOM_BLOCK_BITS;
+  if (!blocks)
+    blocks = 1;
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert((u64)blocks <= (u64)1 << 32);
+#endif
+  de_bvec_bloom out = {.msk = de_bvec_create(blocks * DE_BVEC_BLOOM_BLOCK_BITS),
+                       .block_count = blocks};
+  if (!de_bvec_info_valid(&out.msk))
+    out.block_count = 0;
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_bloom_delete(de_bvec_bloom *const _flt) {
+  if (!_flt)
+    return;
+  de_bvec_delete(&_flt->msk);
+  _flt->block_count = 0;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_bloom_clear(de_bvec_bloom *const _flt) {
+  de_bvec_clear(&_flt->msk);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_bloom_merge(de_bvec_bloom *const _dst,
+                    const de_bvec_bloom *const _src) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_dst->block_count == _src->block_count);
+#endif
+  de_bvec_or_msk(&_dst->msk, &_src->msk);
+}
+
+/* ---- Keys ---- */
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_bloom_insert(de_bvec_bloom *const _flt, const u64 _key) {
+  const u64 hash = DE_BVEC_bloom_mix(_key);
+  mblk_t *const block = DE_BVEC_bloom_block(_flt, hash);
+  if (DE_BVEC_BLOOM_AVX2())
+    DE_BVEC_bloom_insert_avx2(block, hash);
+  else
+    DE_BVEC_bloom_insert_scalar(block, hash);
+  DE_BVEC_COUNT_INVALIDATE(&_flt->msk);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_bloom_contains(const de_bvec_bloom *const _flt, const u64 _key) {
+  const u64 hash = DE_BVEC_bloom_mix(_key);
+  const mblk_t *const block = DE_BVEC_bloom_block(_flt, hash);
+  if (DE_BVEC_BLOOM_AVX2())
+    return DE_BVEC_bloom_contains_avx2(block, hash);
+  return DE_BVEC_bloom_contains_scalar(block, hash);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_bloom_insert_many(de_bvec_bloom *const _flt, const u64 *const _keys,
+                          const usize _amount) {
+  DE_BVEC_COUNT_INVALIDATE(&_flt->msk);
+  if (DE_BVEC_BLOOM_AVX2()) {
+    DE_BVEC_bloom_insert_many_avx2(_flt, _keys, _amount);
+    return;
+  }
+  for (usize i = 0; i < _amount; ++i) {
+    if (i + DE_BVEC_BATCH_PREFETCH < _amount)
+      __builtin_prefetch(
+          DE_BVEC_bloom_block(
+              _flt, DE_BVEC_bloom_mix(_keys[i + DE_BVEC_BATCH_PREFETCH])),
+          1, 3);
+    const u64 hash = DE_BVEC_bloom_mix(_keys[i]);
+    DE_BVEC_bloom_insert_scalar(DE_BVEC_bloom_block(_flt, hash), hash);
+  }
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize de_bvec_bloom_contains_many(
+    const de_bvec_bloom *const _flt, const u64 *const _keys,
+    const usize _amount, bool *const _out) {
+  if (DE_BVEC_BLOOM_AVX2())
+    return DE_BVEC_bloom_contains_many_avx2(_flt, _keys, _amount, _out);
+  usize found = 0;
+  for (usize i = 0; i < _amount; ++i) {
+    if (i + DE_BVEC_BATCH_PREFETCH < _amount)
+      __builtin_prefetch(
+          DE_BVEC_bloom_block(
+              _flt, DE_BVEC_bloom_mix(_keys[i + DE_BVEC_BATCH_PREFETCH])),
+          0, 3);
+    const u64 hash = DE_BVEC_bloom_mix(_keys[i]);
+    const bool hit =
+        DE_BVEC_bloom_contains_scalar(DE_BVEC_bloom_block(_flt, hash), hash);
+    found += hit;
+    if (_out)
+      _out[i] = hit;
+  }
+  return found;
+}
+
+/* ---- Info / Introspection ---- */
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_bloom_info_valid(const de_bvec_bloom *const _flt) {
+  return _flt && _flt->block_count && de_bvec_info_valid(&_flt->msk);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_bloom_info_bytes(const de_bvec_bloom *const _flt) {
+  return _flt->block_count * DE_BVEC_BLOOM_WORDS * sizeof(mblk_t);
+}
+
+#endif
+#endif
@@ -0,0 +1,629 @@
+#ifndef DE_CONTAINER_BITMASK_EWAH_HEADER
+#define DE_CONTAINER_BITMASK_EWAH_HEADER
+
+/*
+  Word-aligned run-length encoded bitvector (EWAH).
+  The stream is a sequence of marker words, each followed by its literal
+  mblk_t words. A marker packs:
+    bit  0      value of the clean run
+    bits 1..32  amount of clean (all 0 / all 1) words
+    bits 33..63 amount of literal words following the marker
+  Logical ops walk both streams and never expand clean runs.
+  To get function definitions include
+  `#define DE_CONTAINER_BITMASK_IMPLEMENTATION`
+  before including this file.
+*/
+
+#include <common.h>
+#include <de_bitmask.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+// clang-format off
+
+/* ---- Struct ---- */
+typedef struct {
+  mblk_t* buffer;        /* markers and literal words */
+  usize   size;          /* words in use */
+  usize   capacity;
+  usize   last_marker;   /* index of the marker new words are added to */
+  usize   bits_amount;   /* logical number of bits */
+} de_bvec_ewah;
+
+/* ---- Lifecycle ---- */
+
+/*
+create a compressed bitvector with _amount_bits 0 bits (a single run)
+*/
+DE_CONTAINER_BITMASK_API de_bvec_ewah
+de_bvec_ewah_create(
+  const usize _amount_bits
+);
+
+/*
+resets all values and clears the struct
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_ewah_delete(
+  de_bvec_ewah* const _msk
+);
+
+/*
+deep copies _src into _dst
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_ewah_copy(
+  de_bvec_ewah* const       _dst,
+  const de_bvec_ewah* const _src
+);
+
+/*
+encodes a dense bitvector
+*/
+DE_CONTAINER_BITMASK_API de_bvec_ewah
+de_bvec_ewah_from_bvec(
+  const de_bvec* const _msk
+);
+
+/*
+decodes into a dense bitvector of the same size
+*/
+DE_CONTAINER_BITMASK_API de_bvec
+de_bvec_ewah_to_bvec(
+  const de_bvec_ewah* const _msk
+);
+
+/* ---- Single-bit access ---- */
+
+/*
+return the state of the bit at the given index.
+walks the markers, so this is O(markers) and not meant for hot loops
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_ewah_get(
+  const de_bvec_ewah* const _msk,
+  const usize         _idx
+);
+
+/* ---- Bulk operations ---- */
+/*
+  The binary ops work on the compressed streams directly. _dst is replaced
+  by a freshly encoded result of its own size, like de_bvec the result is
+  clipped to _dst and a shorter _src reads as 0 past its end.
+*/
+
+/*
+all bits from _dst are &= with the bits from _src
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_ewah_and_msk(
+  de_bvec_ewah* const       _dst,
+  const de_bvec_ewah* const _src
+);
+
+/*
+all bits from _dst are |= with the bits from _src
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_ewah_or_msk(
+  de_bvec_ewah* const       _dst,
+  const de_bvec_ewah* const _src
+);
+
+/*
+all bits from _dst are ^= with the bits from _src
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_ewah_xor_msk(
+  de_bvec_ewah* const       _dst,
+  const de_bvec_ewah* const _src
+);
+
+/*
+inverts all bits from _dst
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_ewah_not(
+  de_bvec_ewah* const _dst
+);
+
+/* ---- Info / Introspection ---- */
+
+/*
+retuns the amount of available bits
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_ewah_info_size(
+  const de_bvec_ewah* const _msk
+);
+
+/*
+retuns if the struct is valid.
+a failed allocation frees the stream and leaves an invalid mask that
+reads as all 0 until de_bvec_ewah_delete
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_ewah_info_valid(
+  const de_bvec_ewah* const _msk
+);
+
+/*
+returns the heap bytes used by the stream
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_ewah_info_bytes(
+  const de_bvec_ewah* const _msk
+);
+
+/*
+returns true if any bit is 1
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_ewah_any(
+  const de_bvec_ewah* const _msk
+);
+
+/*
+returns amount of positive bits (1) in _msk
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_ewah_count(
+  const de_bvec_ewah* const _msk
+);
+
+// clang-format on
+#pragma GCC diagnostic pop
+#endif /* DE_CONTAINER_BITMASK_EWAH_HEADER */
+
+/* ---- Implementation Guard ---- */
+#if defined(DE_CONTAINER_BITMASK_IMPLEMENTATION)
+#ifndef DE_CONTAINER_BITMASK_EWAH_IMPLEMENTATION_INTERNAL
+#define DE_CONTAINER_BITMASK_EWAH_IMPLEMENTATION_INTERNAL
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DE_BVEC_EWAH_RUN_MAX ((u64)0xffffffff)
+#define DE_BVEC_EWAH_LIT_MAX ((u64)0x7fffffff)
+#define DE_BVEC_EWAH_LIT_SHIFT 33
+
+#define DE_BVEC_EWAH_MARKER(_bit, _run, _lit)                                  \
+  ((mblk_t)(_bit) | ((mblk_t)(_run) << 1) |                                    \
+   ((mblk_t)(_lit) << DE_BVEC_EWAH_LIT_SHIFT))
+#define DE_BVEC_EWAH_M_BIT(_m) ((bool)((_m) & 1))
+#define DE_BVEC_EWAH_M_RUN(_m) (((_m) >> 1) & DE_BVEC_EWAH_RUN_MAX)
+#define DE_BVEC_EWAH_M_LIT(_m) ((_m) >> DE_BVEC_EWAH_LIT_SHIFT)
+
+typedef enum {
+  DE_BVEC_EWAH_COPY,
+  DE_BVEC_EWAH_NEGATE,
+  DE_BVEC_EWAH_DISCARD,
+} DE_BVEC_ewah_mode;
+
+/*
+frees the stream and leaves the invalid state de_bvec_ewah_info_valid
+reports: no buffer but a non zero capacity
+*/
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_ewah_fail(de_bvec_ewah *const _e) {
+  free(_e->buffer);
+  _e->buffer = NULL;
+  _e->size = 0;
+  _e->last_marker = 0;
+  _e->capacity = _e->capacity ? _e->capacity : 1;
+}
+
+/* ---- Encoder ---- */
+/* the encoder returns false once _e is invalid, every later call fails */
+DE_CONTAINER_BITMASK_INTERNAL bool DE_BVEC_ewah_push(de_bvec_ewah *const _e,
+                                                     const mblk_t _word) {
+  if (!de_bvec_ewah_info_valid(_e))
+    return false;
+  if (_e->size == _e->capacity) {
+    const usize cap = _e->capacity ? _e->capacity * 2 : 8;
+    mblk_t *const buffer =
+        (mblk_t *)realloc(_e->buffer, cap * sizeof(mblk_t));
+    if (!buffer) {
+      DE_BVEC_ewah_fail(_e);
+      return false;
+    }
+    _e->buffer = buffer;
+    _e->capacity = cap;
+  }
+  _e->buffer[_e->size++] = _word;
+  return true;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_ewah_add_clean(de_bvec_ewah *const _e, const bool _bit, u64 _amount) {
+  if (!de_bvec_ewah_info_valid(_e))
+    return false;
+  while (_amount) {
+    const mblk_t m = _e->buffer[_e->last_marker];
+    const u64 run = DE_BVEC_EWAH_M_RUN(m);
+    if (!DE_BVEC_EWAH_M_LIT(m) && (!run || DE_BVEC_EWAH_M_BIT(m) == _bit) &&
+        run < DE_BVEC_EWAH_RUN_MAX) {
+      const u64 k = _amount < DE_BVEC_EWAH_RUN_MAX - run
+                        ? _amount
+                        : DE_BVEC_EWAH_RUN_MAX - run;
+      _e->buffer[_e->last_marker] = DE_BVEC_EWAH_MARKER(_bit, run + k, 0);
+      _amount -= k;
+    } else {
+      if (!DE_BVEC_ewah_push(_e, DE_BVEC_EWAH_MARKER(0, 0, 0)))
+        return false;
+      _e->last_marker = _e->size - 1;
+    }
+  }
+  return true;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool DE_BVEC_ewah_add_word(de_bvec_ewah *const _e,
+                                                         const mblk_t _word) {
+  if (_word == 0 || _word == DE_BVEC_MBLK_FILLED)
+    return DE_BVEC_ewah_add_clean(_e, _word != 0, 1);
+  if (!de_bvec_ewah_info_valid(_e))
+    return false;
+  if (DE_BVEC_EWAH_M_LIT(_e->buffer[_e->last_marker]) >= DE_BVEC_EWAH_LIT_MAX) {
+    if (!DE_BVEC_ewah_push(_e, DE_BVEC_EWAH_MARKER(0, 0, 0)))
+      return false;
+    _e->last_marker = _e->size - 1;
+  }
+  /* reserve the slot first so a failed push leaves the marker intact */
+  if (!DE_BVEC_ewah_push(_e, _word))
+    return false;
+  _e->buffer[_e->last_marker] += (mblk_t)1 << DE_BVEC_EWAH_LIT_SHIFT;
+  return true;
+}
+
+/* empty stream with a single marker, no words encoded yet */
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_ewah
+DE_BVEC_ewah_empty(const usize _amount_bits) {
+  de_bvec_ewah out = {.buffer = NULL,
+                      .size = 0,
+                      .capacity = 0,
+                      .last_marker = 0,
+                      .bits_amount = _amount_bits};
+  DE_BVEC_ewah_push(&out, DE_BVEC_EWAH_MARKER(0, 0, 0));
+  return out;
+}
+
+/* ---- Decoder ---- */
+typedef struct {
+  const mblk_t *buf;
+  usize size;
+  usize pos;    /* next unread word */
+  u64 run;      /* clean words left in the current marker */
+  u64 lit;      /* literal words left in the current marker */
+  bool bit;
+} DE_BVEC_ewah_reader;
+
+/* moves to the next marker with words left; past the end reads as 0 run */
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_ewah_load(DE_BVEC_ewah_reader *_r) {
+  while (!_r->run && !_r->lit) {
+    if (_r->pos >= _r->size) {
+      _r->bit = false;
+      _r->run = (u64)-1;
+      return;
+    }
+    const mblk_t m = _r->buf[_r->pos++];
+    _r->bit = DE_BVEC_EWAH_M_BIT(m);
+    _r->run = DE_BVEC_EWAH_M_RUN(m);
+    _r->lit = DE_BVEC_EWAH_M_LIT(m);
+  }
+}
+
+DE_CONTAINER_BITMASK_INTERNAL DE_BVEC_ewah_reader
+DE_BVEC_ewah_reader_init(const de_bvec_ewah *const _e) {
+  DE_BVEC_ewah_reader r = {
+      .buf = _e->buffer, .size = _e->size, .pos = 0, .run = 0, .lit = 0};
+  DE_BVEC_ewah_load(&r);
+  return r;
+}
+
+/*
+consumes _amount words of _r, copying/negating them into _out.
+returns false if _out became invalid
+*/
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_ewah_take(DE_BVEC_ewah_reader *_r, u64 _amount,
+                  de_bvec_ewah *const _out, const DE_BVEC_ewah_mode _mode) {
+  bool ok = true;
+  while (_amount && ok) {
+    DE_BVEC_ewah_load(_r);
+    if (_r->run) {
+      const u64 k = _amount < _r->run ? _amount : _r->run;
+      if (_mode != DE_BVEC_EWAH_DISCARD)
+        ok = DE_BVEC_ewah_add_clean(
+            _out, _r->bit ^ (_mode == DE_BVEC_EWAH_NEGATE), k);
+      _r->run -= k;
+      _amount -= k;
+    } else {
+      const u64 k = _amount < _r->lit ? _amount : _r->lit;
+      if (_mode == DE_BVEC_EWAH_COPY) {
+        for (u64 i = 0; i < k && ok; ++i)
+          ok = DE_BVEC_ewah_add_word(_out, _r->buf[_r->pos + i]);
+      } else if (_mode == DE_BVEC_EWAH_NEGATE) {
+        for (u64 i = 0; i < k && ok; ++i)
+          ok = DE_BVEC_ewah_add_word(_out, ~_r->buf[_r->pos + i]);
+      }
+      _r->pos += k;
+      _r->lit -= k;
+      _amount -= k;
+    }
+  }
+  return ok;
+}
+
+/* consumes a single word */
+DE_CONTAINER_BITMASK_INTERNAL mblk_t
+DE_BVEC_ewah_next(DE_BVEC_ewah_reader *_r) {
+  DE_BVEC_ewah_load(_r);
+  if (_r->run) {
+    --_r->run;
+    return _r->bit ? DE_BVEC_MBLK_FILLED : 0;
+  }
+  --_r->lit;
+  return _r->buf[_r->pos++];
+}
+
+/* ---- Lifecycle ---- */
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_ewah
+de_bvec_ewah_create(const usize _amount_bits) {
+  de_bvec_ewah out = DE_BVEC_ewah_empty(_amount_bits);
+  DE_BVEC_ewah_add_clean(&out, false, DE_BVEC_GET_BLOCKS_AMOUNT(_amount_bits));
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_ewah_delete(de_bvec_ewah *const _msk) {
+  if (!_msk)
+    return;
+  free(_msk->buffer);
+  *_msk = (de_bvec_ewah){0};
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_ewah_copy(de_bvec_ewah *const _dst, const de_bvec_ewah *const _src) {
+  if (_dst == _src)
+    return;
+  free(_dst->buffer);
+  *_dst = *_src;
+  _dst->buffer = NULL;
+  /* an empty _src has no buffer, its capacity carries the valid state */
+  if (!_src->size)
+    return;
+  _dst->capacity = _src->size;
+  _dst->buffer = (mblk_t *)malloc(_src->size * sizeof(mblk_t));
+  if (!_dst->buffer) {
+    DE_BVEC_ewah_fail(_dst);
+    return;
+  }
+  memcpy(_dst->buffer, _src->buffer, _src->size * sizeof(mblk_t));
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_ewah
+de_bvec_ewah_from_bvec(const de_bvec *const _msk) {
+  de_bvec_ewah out = DE_BVEC_ewah_empty(_msk->bits_amount);
+  if (!_msk->bits_amount)
+    return out;
+  const mblk_t *const blocks = DE_BVEC_DATA(_msk);
+  const usize bcount = DE_BVEC_BLOCKS_USED(_msk);
+  for (usize i = 0; i + 1 < bcount; ++i) {
+    if (!DE_BVEC_ewah_add_word(&out, blocks[i]))
+      return out;
+  }
+  /* bits past the logical end stay 0 in the stream */
+  DE_BVEC_ewah_add_word(&out, blocks[bcount - 1] &
+                                  (DE_BVEC_MBLK_FILLED >>
+                                   (DE_BVEC_MBLK_BITS -
+                                    _msk->last_block_bits_count)));
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec
+de_bvec_ewah_to_bvec(const de_bvec_ewah *const _msk) {
+  de_bvec out = de_bvec_create(_msk->bits_amount);
+  if (!_msk->bits_amount)
+    return out;
+  mblk_t *const blocks = DE_BVEC_DATA(&out);
+  const usize bcount = DE_BVEC_BLOCKS_USED(&out);
+  usize w = 0;
+  for (usize pos = 0; pos < _msk->size && w < bcount;) {
+    const mblk_t m = _msk->buffer[pos++];
+    const usize run = DE_BVEC_EWAH_M_RUN(m), lit = DE_BVEC_EWAH_M_LIT(m);
+    if (DE_BVEC_EWAH_M_BIT(m))
+      DE_BVEC_memset(blocks + w, DE_BVEC_MBLK_FILLED, run);
+    w += run;
+    DE_BVEC_memcpy(blocks + w, _msk->buffer + pos, lit);
+    w += lit;
+    pos += lit;
+  }
+  DE_BVEC_COUNT_INVALIDATE(&out);
+  return out;
+}
+
+/* ---- Single-bit access ---- */
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_ewah_get(const de_bvec_ewah *const _msk, const usize _idx) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_idx < _msk->bits_amount);
+#endif
+  const usize target = DE_BVEC_GET_BLOCKS_INDEX(_idx);
+  usize w = 0;
+  for (usize pos = 0; pos < _msk->size;) {
+    const mblk_t m = _msk->buffer[pos++];
+    const usize run = DE_BVEC_EWAH_M_RUN(m), lit = DE_BVEC_EWAH_M_LIT(m);
+    if (target < w + run)
+      return DE_BVEC_EWAH_M_BIT(m);
+    w += run;
+    if (target < w + lit)
+      return DE_BVEC_ONE & (_msk->buffer[pos + target - w] >>
+                            (_idx % DE_BVEC_MBLK_BITS));
+    w += lit;
+    pos += lit;
+  }
+  return false;
+}
+
+/* ---- Bulk operations ---- */
+typedef enum {
+  DE_BVEC_EWAH_AND,
+  DE_BVEC_EWAH_OR,
+  DE_BVEC_EWAH_XOR,
+} DE_BVEC_ewah_op;
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_ewah_msk_op(de_bvec_ewah *const _dst, const de_bvec_ewah *const _src,
+                    const DE_BVEC_ewah_op _op) {
+  if (!de_bvec_ewah_info_valid(_dst))
+    return;
+  if (!de_bvec_ewah_info_valid(_src)) {
+    DE_BVEC_ewah_fail(_dst);
+    return;
+  }
+  const u64 total = DE_BVEC_GET_BLOCKS_AMOUNT(_dst->bits_amount);
+  /* the last word is done on its own, _src may have bits past our end */
+  const u64 body = total ? total - 1 : 0;
+  de_bvec_ewah out = DE_BVEC_ewah_empty(_dst->bits_amount);
+  DE_BVEC_ewah_reader a = DE_BVEC_ewah_reader_init(_dst);
+  DE_BVEC_ewah_reader b = DE_BVEC_ewah_reader_init(_src);
+
+  for (u64 done = 0; done < body && de_bvec_ewah_info_valid(&out);) {
+    DE_BVEC_ewah_load(&a);
+    DE_BVEC_ewah_load(&b);
+    if (a.run || b.run) {
+      /* the longer clean run decides what happens to the other stream */
+      const bool a_leads = a.run >= b.run;
+      DE_BVEC_ewah_reader *const run = a_leads ? &a : &b;
+      DE_BVEC_ewah_reader *const other = a_leads ? &b : &a;
+      const u64 n = run->run < body - done ? run->run : body - done;
+      DE_BVEC_ewah_mode mode;
+      switch (_op) {
+      case DE_BVEC_EWAH_AND:
+        mode = run->bit ? DE_BVEC_EWAH_COPY : DE_BVEC_EWAH_DISCARD;
+        break;
+      case DE_BVEC_EWAH_OR:
+        mode = run->bit ? DE_BVEC_EWAH_DISCARD : DE_BVEC_EWAH_COPY;
+        break;
+      default:
+        mode = run->bit ? DE_BVEC_EWAH_NEGATE : DE_BVEC_EWAH_COPY;
+        break;
+      }
+      if (mode == DE_BVEC_EWAH_DISCARD)
+        DE_BVEC_ewah_add_clean(&out, run->bit, n);
+      DE_BVEC_ewah_take(other, n, &out, mode);
+      run->run -= n;
+      done += n;
+    } else {
+      u64 k = a.lit < b.lit ? a.lit : b.lit;
+      k = k < body - done ? k : body - done;
+      const mblk_t *const wa = a.buf + a.pos, *const wb = b.buf + b.pos;
+      for (u64 i = 0; i < k && de_bvec_ewah_info_valid(&out); ++i) {
+        switch (_op) {
+        case DE_BVEC_EWAH_AND:
+          DE_BVEC_ewah_add_word(&out, wa[i] & wb[i]);
+          break;
+        case DE_BVEC_EWAH_OR:
+          DE_BVEC_ewah_add_word(&out, wa[i] | wb[i]);
+          break;
+        default:
+          DE_BVEC_ewah_add_word(&out, wa[i] ^ wb[i]);
+          break;
+        }
+      }
+      a.pos += k, a.lit -= k;
+      b.pos += k, b.lit -= k;
+      done += k;
+    }
+  }
+  if (total && de_bvec_ewah_info_valid(&out)) {
+    const mblk_t wa = DE_BVEC_ewah_next(&a), wb = DE_BVEC_ewah_next(&b);
+    const mblk_t word = _op == DE_BVEC_EWAH_AND  ? wa & wb
+                        : _op == DE_BVEC_EWAH_OR ? wa | wb
+                                                 : wa ^ wb;
+    DE_BVEC_ewah_add_word(&out, word & (DE_BVEC_MBLK_FILLED >>
+                                        (DE_BVEC_MBLK_BITS -
+                                         DE_BVEC_BITS_MOD_MBLK(
+                                             _dst->bits_amount))));
+  }
+  free(_dst->buffer);
+  *_dst = out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_ewah_and_msk(de_bvec_ewah *const _dst, const de_bvec_ewah *const _src) {
+  DE_BVEC_ewah_msk_op(_dst, _src, DE_BVEC_EWAH_AND);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_ewah_or_msk(de_bvec_ewah *const _dst, const de_bvec_ewah *const _src) {
+  DE_BVEC_ewah_msk_op(_dst, _src, DE_BVEC_EWAH_OR);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_ewah_xor_msk(de_bvec_ewah *const _dst, const de_bvec_ewah *const _src) {
+  DE_BVEC_ewah_msk_op(_dst, _src, DE_BVEC_EWAH_XOR);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_ewah_not(de_bvec_ewah *const _dst) {
+  const u64 total = DE_BVEC_GET_BLOCKS_AMOUNT(_dst->bits_amount);
+  if (!total || !de_bvec_ewah_info_valid(_dst))
+    return;
+  de_bvec_ewah out = DE_BVEC_ewah_empty(_dst->bits_amount);
+  DE_BVEC_ewah_reader r = DE_BVEC_ewah_reader_init(_dst);
+  /* the last word must keep the bits past the end at 0 */
+  if (DE_BVEC_ewah_take(&r, total - 1, &out, DE_BVEC_EWAH_NEGATE))
+    DE_BVEC_ewah_add_word(&out, ~DE_BVEC_ewah_next(&r) &
+                                    (DE_BVEC_MBLK_FILLED >>
+                                     (DE_BVEC_MBLK_BITS -
+                                      DE_BVEC_BITS_MOD_MBLK(
+                                          _dst->bits_amount))));
+  free(_dst->buffer);
+  *_dst = out;
+}
+
+/* ---- Info / Introspection ---- */
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_ewah_info_size(const de_bvec_ewah *const _msk) {
+  return _msk->bits_amount;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_ewah_info_valid(const de_bvec_ewah *const _msk) {
+  return _msk && (_msk->buffer != NULL || !_msk->capacity);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_ewah_info_bytes(const de_bvec_ewah *const _msk) {
+  return _msk->capacity * sizeof(mblk_t);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_ewah_any(const de_bvec_ewah *const _msk) {
+  for (usize pos = 0; pos < _msk->size;) {
+    const mblk_t m = _msk->buffer[pos];
+    /* literal words are never all 0 */
+    if ((DE_BVEC_EWAH_M_BIT(m) && DE_BVEC_EWAH_M_RUN(m)) ||
+        DE_BVEC_EWAH_M_LIT(m))
+      return true;
+    pos += 1 + DE_BVEC_EWAH_M_LIT(m);
+  }
+  return false;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_ewah_count(const de_bvec_ewah *const _msk) {
+  usize out = 0;
+  for (usize pos = 0; pos < _msk->size;) {
+    const mblk_t m = _msk->buffer[pos++];
+    const usize lit = DE_BVEC_EWAH_M_LIT(m);
+    if (DE_BVEC_EWAH_M_BIT(m))
+      out += DE_BVEC_EWAH_M_RUN(m) * DE_BVEC_MBLK_BITS;
+    out += DE_BVEC_kernels.count_blocks(_msk->buffer + pos, lit);
+    pos += lit;
+  }
+  return out;
+}
+
+#endif
+#endif
@@ -0,0 +1,563 @@
+#ifndef DE_CONTAINER_BITMASK_EXPR_HEADER
+#define DE_CONTAINER_BITMASK_EXPR_HEADER
+
+/*
+  Lazy bitwise expressions over de_bvec operands.
+  Operations only record nodes, de_bvec_expr_eval / de_bvec_expr_count
+  walk the operands once in cache sized tiles: every node of the DAG is
+  computed for one tile before moving on, so intermediates never leave
+  L1/L2 and the result is written exactly once.
+  Operands are zero padded to the longest operand reachable from the root.
+  To get function definitions include
+  `#define DE_CONTAINER_BITMASK_IMPLEMENTATION`
+  before including this file.
+*/
+
+#include <common.h>
+#include <de_bitmask.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+/* blocks per tile, every live intermediate holds one tile */
+#ifndef DE_BVEC_EXPR_TILE_BLOCKS
+#define DE_BVEC_EXPR_TILE_BLOCKS 256
+#endif
+
+// clang-format off
+
+/* ---- Struct ---- */
+typedef enum {
+  DE_BVEC_EXPR_LEAF = 0,
+  DE_BVEC_EXPR_AND,
+  DE_BVEC_EXPR_OR,
+  DE_BVEC_EXPR_XOR,
+  DE_BVEC_EXPR_ANDNOT,   /* lhs & ~rhs */
+  DE_BVEC_EXPR_NOT,      /* ~lhs */
+} de_bvec_expr_op;
+
+/* handle of a node, only valid for the expression that returned it */
+typedef u32 de_bvec_expr_id;
+
+/*
+returned by the building calls when the node array could not grow.
+passing it on yields it again, de_bvec_expr_eval / _count reject it
+*/
+#define DE_BVEC_EXPR_INVALID ((de_bvec_expr_id)-1)
+
+typedef struct {
+  const de_bvec*  leaf;  /* operand of DE_BVEC_EXPR_LEAF nodes */
+  de_bvec_expr_id lhs;
+  de_bvec_expr_id rhs;
+  u8              op;    /* de_bvec_expr_op */
+} de_bvec_expr_node;
+
+typedef struct {
+  de_bvec_expr_node* nodes;   /* children always precede their parents */
+  usize   size;
+  usize   capacity;
+  /* evaluation state, kept to be reused by the next eval */
+  u32*    slots;              /* tile buffer of every node */
+  u32*    last_use;
+  mblk_t* scratch;
+  usize   scratch_tiles;
+} de_bvec_expr;
+
+/* ---- Lifecycle ---- */
+
+/*
+create an empty expression
+*/
+DE_CONTAINER_BITMASK_API de_bvec_expr
+de_bvec_expr_create(u0);
+
+/*
+frees the nodes and scratch buffers, the operands are not touched
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_expr_delete(
+  de_bvec_expr* const _expr
+);
+
+/*
+drops all nodes but keeps the memory, for building the next query
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_expr_clear(
+  de_bvec_expr* const _expr
+);
+
+/* ---- Building ---- */
+
+/*
+adds _msk as an operand. only the pointer is stored, _msk must stay alive
+and in place until the last eval
+*/
+DE_CONTAINER_BITMASK_API de_bvec_expr_id
+de_bvec_expr_leaf(
+  de_bvec_expr* const  _expr,
+  const de_bvec* const _msk
+);
+
+/*
+_lhs & _rhs
+*/
+DE_CONTAINER_BITMASK_API de_bvec_expr_id
+de_bvec_expr_and(
+  de_bvec_expr* const   _expr,
+  const de_bvec_expr_id _lhs,
+  const de_bvec_expr_id _rhs
+);
+
+/*
+_lhs | _rhs
+*/
+DE_CONTAINER_BITMASK_API de_bvec_expr_id
+de_bvec_expr_or(
+  de_bvec_expr* const   _expr,
+  const de_bvec_expr_id _lhs,
+  const de_bvec_expr_id _rhs
+);
+
+/*
+_lhs ^ _rhs
+*/
+DE_CONTAINER_BITMASK_API de_bvec_expr_id
+de_bvec_expr_xor(
+  de_bvec_expr* const   _expr,
+  const de_bvec_expr_id _lhs,
+  const de_bvec_expr_id _rhs
+);
+
+/*
+_lhs & ~_rhs
+*/
+DE_CONTAINER_BITMASK_API de_bvec_expr_id
+de_bvec_expr_andnot(
+  de_bvec_expr* const   _expr,
+  const de_bvec_expr_id _lhs,
+  const de_bvec_expr_id _rhs
+);
+
+/*
+~_node
+*/
+DE_CONTAINER_BITMASK_API de_bvec_expr_id
+de_bvec_expr_not(
+  de_bvec_expr* const   _expr,
+  const de_bvec_expr_id _node
+);
+
+/* ---- Evaluation ---- */
+
+/*
+evaluates _root into _dst, which is resized to the expression size.
+_dst may be one of the operands.
+returns false and leaves _dst as it was if _root is DE_BVEC_EXPR_INVALID,
+an operand is not de_bvec_info_valid or the scratch buffers could not be
+allocated. returns false with an invalid _dst if resizing it failed
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_expr_eval(
+  de_bvec_expr* const   _expr,
+  const de_bvec_expr_id _root,
+  de_bvec* const        _dst
+);
+
+/*
+returns the amount of 1 bits of _root without writing the result anywhere.
+returns DE_BVEC_NPOS in the cases de_bvec_expr_eval returns false
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_expr_count(
+  de_bvec_expr* const   _expr,
+  const de_bvec_expr_id _root
+);
+
+// clang-format on
+#pragma GCC diagnostic pop
+#endif /* DE_CONTAINER_BITMASK_EXPR_HEADER */
+
+/* ---- Implementation Guard ---- */
+#if defined(DE_CONTAINER_BITMASK_IMPLEMENTATION)
+#ifndef DE_CONTAINER_BITMASK_EXPR_IMPLEMENTATION_INTERNAL
+#define DE_CONTAINER_BITMASK_EXPR_IMPLEMENTATION_INTERNAL
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* node that is not reachable from the root being evaluated */
+#define DE_BVEC_EXPR_UNUSED ((u32)-1)
+
+/* ---- Lifecycle ---- */
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_expr de_bvec_expr_create(u0) {
+  return (de_bvec_expr){.nodes = NULL,
+                        .size = 0,
+                        .capacity = 0,
+                        .slots = NULL,
+                        .last_use = NULL,
+                        .scratch = NULL,
+                        .scratch_tiles = 0};
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_expr_delete(de_bvec_expr *const _expr) {
+  if (!_expr)
+    return;
+  free(_expr->nodes);
+  free(_expr->slots);
+  free(_expr->last_use);
+  DE_BVEC_heap_free(_expr->scratch,
+                    _expr->scratch_tiles * DE_BVEC_EXPR_TILE_BLOCKS);
+  *_expr = de_bvec_expr_create();
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_expr_clear(de_bvec_expr *const _expr) {
+  _expr->size = 0;
+}
+
+/* ---- Building ---- */
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_expr_id
+DE_BVEC_expr_push(de_bvec_expr *const _expr, const de_bvec_expr_node _node) {
+  if (_expr->size == _expr->capacity) {
+    if (_expr->capacity >= DE_BVEC_EXPR_INVALID / 2)
+      return DE_BVEC_EXPR_INVALID;
+    const usize capacity = _expr->capacity ? _expr->capacity * 2 : 16;
+    de_bvec_expr_node *const nodes = (de_bvec_expr_node *)realloc(
+        _expr->nodes, capacity * sizeof(de_bvec_expr_node));
+    /* second half is the free buffer stack of the planner */
+    u32 *const slots =
+        (u32 *)realloc(_expr->slots, 2 * capacity * sizeof(u32));
+    u32 *const last_use =
+        (u32 *)realloc(_expr->last_use, capacity * sizeof(u32));
+    /* the grown buffers are kept, they only count once all three grew */
+    _expr->nodes = nodes ? nodes : _expr->nodes;
+    _expr->slots = slots ? slots : _expr->slots;
+    _expr->last_use = last_use ? last_use : _expr->last_use;
+    if (!nodes || !slots || !last_use)
+      return DE_BVEC_EXPR_INVALID;
+    _expr->capacity = capacity;
+  }
+  _expr->nodes[_expr->size] = _node;
+  return (de_bvec_expr_id)_expr->size++;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_expr_id
+DE_BVEC_expr_binary(de_bvec_expr *const _expr, const de_bvec_expr_op _op,
+                    const de_bvec_expr_id _lhs, const de_bvec_expr_id _rhs) {
+  if (_lhs == DE_BVEC_EXPR_INVALID || _rhs == DE_BVEC_EXPR_INVALID)
+    return DE_BVEC_EXPR_INVALID;
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_lhs < _expr->size);
+  assert(_rhs < _expr->size);
+#endif
+  return DE_BVEC_expr_push(
+      _expr, (de_bvec_expr_node){
+                 .leaf = NULL, .lhs = _lhs, .rhs = _rhs, .op = (u8)_op});
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_expr_id
+de_bvec_expr_leaf(de_bvec_expr *const _expr, const de_bvec *const _msk) {
+  return DE_BVEC_expr_push(
+      _expr, (de_bvec_expr_node){
+                 .leaf = _msk, .lhs = 0, .rhs = 0, .op = DE_BVEC_EXPR_LEAF});
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_expr_id
+de_bvec_expr_and(de_bvec_expr *const _expr, const de_bvec_expr_id _lhs,
+                 const de_bvec_expr_id _rhs) {
+  return DE_BVEC_expr_binary(_expr, DE_BVEC_EXPR_AND, _lhs, _rhs);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_expr_id
+de_bvec_expr_or(de_bvec_expr *const _expr, const de_bvec_expr_id _lhs,
+                const de_bvec_expr_id _rhs) {
+  return DE_BVEC_expr_binary(_expr, DE_BVEC_EXPR_OR, _lhs, _rhs);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_expr_id
+de_bvec_expr_xor(de_bvec_expr *const _expr, const de_bvec_expr_id _lhs,
+                 const de_bvec_expr_id _rhs) {
+  return DE_BVEC_expr_binary(_expr, DE_BVEC_EXPR_XOR, _lhs, _rhs);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_expr_id
+de_bvec_expr_andnot(de_bvec_expr *const _expr, const de_bvec_expr_id _lhs,
+                    const de_bvec_expr_id _rhs) {
+  return DE_BVEC_expr_binary(_expr, DE_BVEC_EXPR_ANDNOT, _lhs, _rhs);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_expr_id
+de_bvec_expr_not(de_bvec_expr *const _expr, const de_bvec_expr_id _node) {
+  return DE_BVEC_expr_binary(_expr, DE_BVEC_EXPR_NOT, _node, _node);
+}
+
+/* ---- Evaluation ---- */
+/*
+  Planning: mark the nodes reachable from _root, note the last node that
+  reads each of them and hand out tile buffers in node order. A buffer is
+  released once its last reader ran, so the buffer count is the width of
+  the DAG, not its size. Stores the expression size in bits in _bits,
+  returns false if a reachable operand is invalid or the scratch buffers
+  could not be allocated.
+*/
+DE_CONTAINER_BITMASK_INTERNAL bool DE_BVEC_expr_plan(de_bvec_expr *const _expr,
+                                                     const u32 _root,
+                                                     usize *const _bits) {
+  de_bvec_expr_node *const nodes = _expr->nodes;
+  u32 *const last_use = _expr->last_use;
+  u32 *const slots = _expr->slots;
+  usize bits = 0;
+
+  for (u32 i = 0; i <= _root; ++i)
+    last_use[i] = DE_BVEC_EXPR_UNUSED;
+  last_use[_root] = _root;
+  for (u32 i = _root + 1; i-- > 0;) {
+    if (last_use[i] == DE_BVEC_EXPR_UNUSED)
+      continue;
+    if (nodes[i].op == DE_BVEC_EXPR_LEAF) {
+      if (!de_bvec_info_valid(nodes[i].leaf))
+        return false;
+      if (nodes[i].leaf->bits_amount > bits)
+        bits = nodes[i].leaf->bits_amount;
+      continue;
+    }
+    /* parents are visited first, the first one seen is the last reader */
+    if (last_use[nodes[i].lhs] == DE_BVEC_EXPR_UNUSED)
+      last_use[nodes[i].lhs] = i;
+    if (last_use[nodes[i].rhs] == DE_BVEC_EXPR_UNUSED)
+      last_use[nodes[i].rhs] = i;
+  }
+
+  u32 *const free_stack = slots + _expr->capacity;
+  u32 used = 0;
+  u32 free_top = 0;
+  for (u32 i = 0; i <= _root; ++i) {
+    if (last_use[i] == DE_BVEC_EXPR_UNUSED)
+      continue;
+    if (nodes[i].op != DE_BVEC_EXPR_LEAF) {
+      /* inputs read for the last time can be overwritten in place */
+      if (last_use[nodes[i].lhs] == i)
+        free_stack[free_top++] = slots[nodes[i].lhs];
+      if (last_use[nodes[i].rhs] == i && nodes[i].rhs != nodes[i].lhs)
+        free_stack[free_top++] = slots[nodes[i].rhs];
+    }
+    slots[i] = free_top ? free_stack[--free_top] : used++;
+  }
+
+  if (used > _expr->scratch_tiles) {
+    DE_BVEC_heap_free(_expr->scratch,
+                      _expr->scratch_tiles * DE_BVEC_EXPR_TILE_BLOCKS);
+    _expr->scratch = DE_BVEC_heap_alloc(used * DE_BVEC_EXPR_TILE_BLOCKS, false);
+    _expr->scratch_tiles = _expr->scratch ? used : 0;
+  }
+  *_bits = bits;
+  return _expr->scratch != NULL;
+}
+
+/* pointer to the tile of leaf _msk, zero padded through _buf if short */
+DE_CONTAINER_BITMASK_INTERNAL const mblk_t *
+DE_BVEC_expr_leaf_tile(const de_bvec *const _msk, const usize _first,
+                       const usize _n, mblk_t *const _buf) {
+  const usize have = _msk->block_count > _first ? _msk->block_count - _first
+                                                : 0;
+  if (have >= _n)
+    return DE_BVEC_DATA(_msk) + _first;
+  if (have)
+    memcpy(_buf, DE_BVEC_DATA(_msk) + _first, have * sizeof(mblk_t));
+  memset(_buf + have, 0, (_n - have) * sizeof(mblk_t));
+  return _buf;
+}
+
+/*
+  _out = _l op _r through the in place DE_BVEC_kernels: _out takes a copy
+  of one operand first unless it already is that operand. Operands either
+  are _out or do not overlap it, leaves sit at the same block offset.
+*/
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_expr_apply(const u8 _op, mblk_t *const _out, const mblk_t *const _l,
+                   const mblk_t *const _r, const usize _n) {
+  DE_BVEC_binop_fn binop;
+  switch (_op) {
+  case DE_BVEC_EXPR_AND:
+    binop = DE_BVEC_kernels.and_blocks;
+    break;
+  case DE_BVEC_EXPR_OR:
+    binop = DE_BVEC_kernels.or_blocks;
+    break;
+  case DE_BVEC_EXPR_XOR:
+    binop = DE_BVEC_kernels.xor_blocks;
+    break;
+  case DE_BVEC_EXPR_ANDNOT:
+    if (_out == _l) {
+      /* no kernel for it, ~_r has nowhere to go */
+      for (usize i = 0; i < _n; ++i)
+        _out[i] &= ~_r[i];
+    } else {
+      if (_out != _r)
+        memcpy(_out, _r, _n * sizeof(mblk_t));
+      DE_BVEC_kernels.not_blocks(_out, _n);
+      DE_BVEC_kernels.and_blocks(_out, _l, _n);
+    }
+    return;
+  case DE_BVEC_EXPR_NOT:
+    if (_out != _l)
+      memcpy(_out, _l, _n * sizeof(mblk_t));
+    DE_BVEC_kernels.not_blocks(_out, _n);
+    return;
+  default:
+    return;
+  }
+  /* and / or / xor commute */
+  if (_out == _r) {
+    binop(_out, _l, _n);
+    return;
+  }
+  if (_out != _l)
+    memcpy(_out, _l, _n * sizeof(mblk_t));
+  binop(_out, _r, _n);
+}
+
+/*
+  Computes every planned node below _root for the tile starting at block
+  _first into the scratch buffers, _tile receives the node pointers.
+  Bits past _bits in the last block are cleared after each NOT, so all
+  intermediates stay as clean as the operands.
+*/
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_expr_tile(de_bvec_expr *const _expr, const u32 _root,
+                  const usize _first, const usize _n, const usize _bits,
+                  const mblk_t **const _tile) {
+  const de_bvec_expr_node *const nodes = _expr->nodes;
+  const usize last_block = DE_BVEC_GET_BLOCKS_AMOUNT(_bits) - 1;
+  const bool tail_here = _first + _n - 1 == last_block;
+  for (u32 i = 0; i < _root; ++i) {
+    if (_expr->last_use[i] == DE_BVEC_EXPR_UNUSED)
+      continue;
+    mblk_t *const buf =
+        _expr->scratch + (usize)_expr->slots[i] * DE_BVEC_EXPR_TILE_BLOCKS;
+    if (nodes[i].op == DE_BVEC_EXPR_LEAF) {
+      _tile[i] = DE_BVEC_expr_leaf_tile(nodes[i].leaf, _first, _n, buf);
+      continue;
+    }
+    DE_BVEC_expr_apply(nodes[i].op, buf, _tile[nodes[i].lhs],
+                       _tile[nodes[i].rhs], _n);
+    if (nodes[i].op == DE_BVEC_EXPR_NOT && tail_here)
+      buf[_n - 1] &= DE_BVEC_LOW_MASK(DE_BVEC_BITS_MOD_MBLK(_bits));
+    _tile[i] = buf;
+  }
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_expr_eval(de_bvec_expr *const _expr, const de_bvec_expr_id _root,
+                  de_bvec *const _dst) {
+  if (_root == DE_BVEC_EXPR_INVALID)
+    return false;
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_root < _expr->size);
+#endif
+  usize bits;
+  if (!DE_BVEC_expr_plan(_expr, _root, &bits))
+    return false;
+  const mblk_t **const tile =
+      (const mblk_t **)malloc((_root + 1) * sizeof(const mblk_t *));
+  if (!tile)
+    return false;
+  de_bvec_resize(_dst, bits);
+  if (!bits || !de_bvec_info_valid(_dst)) {
+    free(tile);
+    return de_bvec_info_valid(_dst);
+  }
+  const de_bvec_expr_node root = _expr->nodes[_root];
+  const usize blocks = _dst->block_count;
+  for (usize first = 0; first < blocks; first += DE_BVEC_EXPR_TILE_BLOCKS) {
+    const usize n = blocks - first < DE_BVEC_EXPR_TILE_BLOCKS
+                        ? blocks - first
+                        : DE_BVEC_EXPR_TILE_BLOCKS;
+    /* operand storage can move when _dst is one of them, refetch per tile */
+    mblk_t *const out = DE_BVEC_DATA(_dst) + first;
+    DE_BVEC_expr_tile(_expr, _root, first, n, bits, tile);
+    if (root.op == DE_BVEC_EXPR_LEAF) {
+      const mblk_t *const src = DE_BVEC_expr_leaf_tile(
+          root.leaf, first, n,
+          _expr->scratch +
+              (usize)_expr->slots[_root] * DE_BVEC_EXPR_TILE_BLOCKS);
+      if (src != out)
+        memmove(out, src, n * sizeof(mblk_t));
+    } else {
+      /* the only write of the result */
+      DE_BVEC_expr_apply(root.op, out, tile[root.lhs], tile[root.rhs], n);
+    }
+  }
+  free(tile);
+  DE_BVEC_trim(_dst);
+  DE_BVEC_COUNT_INVALIDATE(_dst);
+  return true;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_expr_count(de_bvec_expr *const _expr, const de_bvec_expr_id _root) {
+  if (_root == DE_BVEC_EXPR_INVALID)
+    return DE_BVEC_NPOS;
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_root < _expr->size);
+#endif
+  usize bits;
+  if (!DE_BVEC_expr_plan(_expr, _root, &bits))
+    return DE_BVEC_NPOS;
+  if (!bits)
+    return 0;
+  const de_bvec_expr_node root = _expr->nodes[_root];
+  const usize blocks = DE_BVEC_GET_BLOCKS_AMOUNT(bits);
+  const mblk_t **const tile =
+      (const mblk_t **)malloc((_root + 1) * sizeof(const mblk_t *));
+  if (!tile)
+    return DE_BVEC_NPOS;
+  mblk_t *const root_buf =
+      _expr->scratch + (usize)_expr->slots[_root] * DE_BVEC_EXPR_TILE_BLOCKS;
+  usize out = 0;
+  for (usize first = 0; first < blocks; first += DE_BVEC_EXPR_TILE_BLOCKS) {
+    const usize n = blocks - first < DE_BVEC_EXPR_TILE_BLOCKS
+                        ? blocks - first
+                        : DE_BVEC_EXPR_TILE_BLOCKS;
+    DE_BVEC_expr_tile(_expr, _root, first, n, bits, tile);
+    const mblk_t *const l = tile[root.lhs];
+    const mblk_t *const r = tile[root.rhs];
+    /* the root itself is never stored, the fused kernels count it */
+    switch (root.op) {
+    case DE_BVEC_EXPR_LEAF:
+      out += DE_BVEC_kernels.count_blocks(
+          DE_BVEC_expr_leaf_tile(root.leaf, first, n, root_buf), n);
+      break;
+    case DE_BVEC_EXPR_AND:
+      out += DE_BVEC_kernels.and_count_blocks(l, r, n);
+      break;
+    case DE_BVEC_EXPR_OR:
+      out += DE_BVEC_kernels.or_count_blocks(l, r, n);
+      break;
+    case DE_BVEC_EXPR_XOR:
+      out += DE_BVEC_kernels.xor_count_blocks(l, r, n);
+      break;
+    case DE_BVEC_EXPR_ANDNOT:
+      out += DE_BVEC_kernels.andnot_count_blocks(l, r, n);
+      break;
+    case DE_BVEC_EXPR_NOT: {
+      const usize tile_bits =
+          first + n == blocks ? bits - first * DE_BVEC_MBLK_BITS
+                              : n * DE_BVEC_MBLK_BITS;
+      out += tile_bits - DE_BVEC_kernels.count_blocks(l, n);
+      break;
+    }
+    default:
+      break;
+    }
+  }
+  free(tile);
+  return out;
+}
+
+#endif
+#endif
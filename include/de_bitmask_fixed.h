@@ -0,0 +1,250 @@
+#ifndef DE_CONTAINER_BITMASK_FIXED_HEADER
+#define DE_CONTAINER_BITMASK_FIXED_HEADER
+
+/*
+  Compile-time sized bitsets for small masks that are created, copied and
+  thrown away in hot loops. DE_BVEC_DEFINE_FIXED(name, bits) emits a plain
+  struct `name` holding ceil(bits / 64) blocks and `static inline` name_*
+  functions mirroring de_bitmask.h. There is no heap, no allocator, no
+  bits_amount and no inline/heap switch: the struct lives on the stack or
+  inside another struct, copies are plain assignment, and every loop runs a
+  constant number of times so the compiler unrolls it into registers, or
+  into vector ops for the wider sets.
+  Bits past `bits` in the last block are always 0, every whole-set
+  operation keeps it that way.
+  Index arguments are only checked with assert, which
+  DE_CONTAINER_NO_SAFETY_CHECKS turns off like everywhere else.
+  Only to_bvec / from_bvec call into de_bitmask.h, they need its function
+  definitions (`#define DE_CONTAINER_BITMASK_IMPLEMENTATION` in one
+  translation unit) like any other user of de_bvec.
+
+  usage:
+    DE_BVEC_DEFINE_FIXED(de_mask128, 128)
+
+    de_mask128 a = de_mask128_create();
+    de_mask128_set(&a, 3, true);
+    de_mask128 b = a;
+*/
+
+#include <assert.h>
+#include <common.h>
+#include <de_bitmask.h>
+#include <stdbool.h>
+
+#define DE_BVEC_FIXED_BLOCKS(_bits)                                            \
+  (((usize)(_bits) + DE_BVEC_MBLK_BITS - 1) / DE_BVEC_MBLK_BITS)
+/* used bits of the last block */
+#define DE_BVEC_FIXED_TAIL(_bits)                                              \
+  ((usize)(_bits) % DE_BVEC_MBLK_BITS                                          \
+       ? ((mblk_t)1 << ((usize)(_bits) % DE_BVEC_MBLK_BITS)) - 1               \
+       : ~(mblk_t)0)
+
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+#define DE_BVEC_FIXED_CHECK(_cond) assert(_cond)
+#else
+#define DE_BVEC_FIXED_CHECK(_cond) ((u0)0)
+#endif
+
+/* the block counts are constants, make sure they are unrolled at -O2 too */
+#if defined(__GNUC__) && !defined(__clang__)
+#define DE_BVEC_FIXED_UNROLL _Pragma("GCC unroll 8")
+#elif defined(__clang__)
+#define DE_BVEC_FIXED_UNROLL _Pragma("unroll 8")
+#else
+#define DE_BVEC_FIXED_UNROLL
+#endif
+
+#define DE_BVEC_DEFINE_FIXED(_name, _bits)                                     \
+  _Static_assert((_bits) > 0, #_name " needs at least one bit");               \
+  typedef struct {                                                             \
+    mblk_t blocks[DE_BVEC_FIXED_BLOCKS(_bits)];                                \
+  } _name;                                                                     \
+                                                                               \
+  static inline _name _name##_create(u0) {                                     \
+    return (_name){{0}};                                                       \
+  }                                                                            \
+                                                                               \
+  static inline bool _name##_get(const _name *const _msk, const usize _idx) {  \
+    DE_BVEC_FIXED_CHECK(_idx < (_bits));                                       \
+    return (_msk->blocks[_idx / DE_BVEC_MBLK_BITS] >>                          \
+            (_idx % DE_BVEC_MBLK_BITS)) & 1;                                   \
+  }                                                                            \
+                                                                               \
+  static inline u0 _name##_set(_name *const _msk, const usize _idx,            \
+                               const bool _value) {                            \
+    DE_BVEC_FIXED_CHECK(_idx < (_bits));                                       \
+    mblk_t *const block = _msk->blocks + _idx / DE_BVEC_MBLK_BITS;             \
+    const mblk_t bit = (mblk_t)1 << (_idx % DE_BVEC_MBLK_BITS);                \
+    *block = (*block & ~bit) | (bit & -(mblk_t)_value);                        \
+  }                                                                            \
+                                                                               \
+  static inline u0 _name##_flip(_name *const _msk, const usize _idx) {         \
+    DE_BVEC_FIXED_CHECK(_idx < (_bits));                                       \
+    _msk->blocks[_idx / DE_BVEC_MBLK_BITS] ^= (mblk_t)1                        \
+                                              << (_idx % DE_BVEC_MBLK_BITS);   \
+  }                                                                            \
+                                                                               \
+  static inline u0 _name##_set_range(_name *const _msk,                        \
+                                     const usize _start_idx,                   \
+                                     const usize _end_idx,                     \
+                                     const bool _value) {                      \
+    DE_BVEC_FIXED_CHECK(_start_idx <= _end_idx && _end_idx < (_bits));         \
+    const usize first = _start_idx / DE_BVEC_MBLK_BITS;                        \
+    const usize last = _end_idx / DE_BVEC_MBLK_BITS;                           \
+    const mblk_t fill = -(mblk_t)_value;                                       \
+    mblk_t lo = ~(mblk_t)0 << (_start_idx % DE_BVEC_MBLK_BITS);                \
+    const mblk_t hi =                                                          \
+        ~(mblk_t)0 >> (DE_BVEC_MBLK_BITS - 1 - _end_idx % DE_BVEC_MBLK_BITS);  \
+    if (first == last)                                                         \
+      lo &= hi;                                                                \
+    else {                                                                     \
+      for (usize i = first + 1; i < last; ++i)                                 \
+        _msk->blocks[i] = fill;                                                \
+      _msk->blocks[last] = (_msk->blocks[last] & ~hi) | (fill & hi);           \
+    }                                                                          \
+    _msk->blocks[first] = (_msk->blocks[first] & ~lo) | (fill & lo);           \
+  }                                                                            \
+                                                                               \
+  /* ---- Whole-set operations ---- */                                         \
+  static inline u0 _name##_clear(_name *const _msk) {                          \
+    DE_BVEC_FIXED_UNROLL                                                       \
+    for (usize i = 0; i < DE_BVEC_FIXED_BLOCKS(_bits); ++i)                    \
+      _msk->blocks[i] = 0;                                                     \
+  }                                                                            \
+                                                                               \
+  static inline u0 _name##_fill(_name *const _msk) {                           \
+    DE_BVEC_FIXED_UNROLL                                                       \
+    for (usize i = 0; i < DE_BVEC_FIXED_BLOCKS(_bits); ++i)                    \
+      _msk->blocks[i] = ~(mblk_t)0;                                            \
+    _msk->blocks[DE_BVEC_FIXED_BLOCKS(_bits) - 1] = DE_BVEC_FIXED_TAIL(_bits); \
+  }                                                                            \
+                                                                               \
+  static inline u0 _name##_not(_name *const _msk) {                            \
+    DE_BVEC_FIXED_UNROLL                                                       \
+    for (usize i = 0; i < DE_BVEC_FIXED_BLOCKS(_bits); ++i)                    \
+      _msk->blocks[i] = ~_msk->blocks[i];                                      \
+    _msk->blocks[DE_BVEC_FIXED_BLOCKS(_bits) - 1] &=                           \
+        DE_BVEC_FIXED_TAIL(_bits);                                             \
+  }                                                                            \
+                                                                               \
+  static inline u0 _name##_and_msk(_name *const _dst,                          \
+                                   const _name *const _src) {                  \
+    DE_BVEC_FIXED_UNROLL                                                       \
+    for (usize i = 0; i < DE_BVEC_FIXED_BLOCKS(_bits); ++i)                    \
+      _dst->blocks[i] &= _src->blocks[i];                                      \
+  }                                                                            \
+                                                                               \
+  static inline u0 _name##_or_msk(_name *const _dst,                           \
+                                  const _name *const _src) {                   \
+    DE_BVEC_FIXED_UNROLL                                                       \
+    for (usize i = 0; i < DE_BVEC_FIXED_BLOCKS(_bits); ++i)                    \
+      _dst->blocks[i] |= _src->blocks[i];                                      \
+  }                                                                            \
+                                                                               \
+  static inline u0 _name##_xor_msk(_name *const _dst,                          \
+                                   const _name *const _src) {                  \
+    DE_BVEC_FIXED_UNROLL                                                       \
+    for (usize i = 0; i < DE_BVEC_FIXED_BLOCKS(_bits); ++i)                    \
+      _dst->blocks[i] ^= _src->blocks[i];                                      \
+  }                                                                            \
+                                                                               \
+  static inline u0 _name##_andnot_msk(_name *const _dst,                       \
+                                      const _name *const _src) {               \
+    DE_BVEC_FIXED_UNROLL                                                       \
+    for (usize i = 0; i < DE_BVEC_FIXED_BLOCKS(_bits); ++i)                    \
+      _dst->blocks[i] &= ~_src->blocks[i];                                     \
+  }                                                                            \
+                                                                               \
+  /* ---- Queries ---- */                                                      \
+  static inline bool _name##_any(const _name *const _msk) {                    \
+    mblk_t acc = 0;                                                            \
+    DE_BVEC_FIXED_UNROLL                                                       \
+    for (usize i = 0; i < DE_BVEC_FIXED_BLOCKS(_bits); ++i)                    \
+      acc |= _msk->blocks[i];                                                  \
+    return acc != 0;                                                           \
+  }                                                                            \
+                                                                               \
+  static inline bool _name##_none(const _name *const _msk) {                   \
+    return !_name##_any(_msk);                                                 \
+  }                                                                            \
+                                                                               \
+  static inline bool _name##_all(const _name *const _msk) {                    \
+    mblk_t acc = ~(mblk_t)0;                                                   \
+    DE_BVEC_FIXED_UNROLL                                                       \
+    for (usize i = 0; i + 1 < DE_BVEC_FIXED_BLOCKS(_bits); ++i)                \
+      acc &= _msk->blocks[i];                                                  \
+    return acc == ~(mblk_t)0 &&                                                \
+           _msk->blocks[DE_BVEC_FIXED_BLOCKS(_bits) - 1] ==                    \
+               DE_BVEC_FIXED_TAIL(_bits);                                      \
+  }                                                                            \
+                                                                               \
+  static inline bool _name##_equal(const _name *const _a,                      \
+                                   const _name *const _b) {                    \
+    mblk_t acc = 0;                                                            \
+    DE_BVEC_FIXED_UNROLL                                                       \
+    for (usize i = 0; i < DE_BVEC_FIXED_BLOCKS(_bits); ++i)                    \
+      acc |= _a->blocks[i] ^ _b->blocks[i];                                    \
+    return acc == 0;                                                           \
+  }                                                                            \
+                                                                               \
+  static inline usize _name##_count(const _name *const _msk) {                 \
+    usize out = 0;                                                             \
+    DE_BVEC_FIXED_UNROLL                                                       \
+    for (usize i = 0; i < DE_BVEC_FIXED_BLOCKS(_bits); ++i)                    \
+      out += (usize)__builtin_popcountll(_msk->blocks[i]);                     \
+    return out;                                                                \
+  }                                                                            \
+                                                                               \
+  static inline usize _name##_and_count(const _name *const _a,                 \
+                                        const _name *const _b) {               \
+    usize out = 0;                                                             \
+    DE_BVEC_FIXED_UNROLL                                                       \
+    for (usize i = 0; i < DE_BVEC_FIXED_BLOCKS(_bits); ++i)                    \
+      out += (usize)__builtin_popcountll(_a->blocks[i] & _b->blocks[i]);       \
+    return out;                                                                \
+  }                                                                            \
+                                                                               \
+  static inline usize _name##_find_next(const _name *const _msk,               \
+                                        const usize _idx) {                    \
+    if (_idx >= (_bits))                                                       \
+      return DE_BVEC_NPOS;                                                     \
+    usize b = _idx / DE_BVEC_MBLK_BITS;                                        \
+    mblk_t word =                                                              \
+        _msk->blocks[b] & (~(mblk_t)0 << (_idx % DE_BVEC_MBLK_BITS));          \
+    while (!word) {                                                            \
+      if (++b >= DE_BVEC_FIXED_BLOCKS(_bits))                                  \
+        return DE_BVEC_NPOS;                                                   \
+      word = _msk->blocks[b];                                                  \
+    }                                                                          \
+    return b * DE_BVEC_MBLK_BITS + (usize)__builtin_ctzll(word);               \
+  }                                                                            \
+                                                                               \
+  static inline usize _name##_find_first(const _name *const _msk) {            \
+    return _name##_find_next(_msk, 0);                                         \
+  }                                                                            \
+                                                                               \
+  /* ---- Conversion ---- */                                                   \
+  static inline u0 _name##_to_bvec(const _name *const _msk,                    \
+                                   de_bvec *const _dst) {                      \
+    de_bvec_resize(_dst, (_bits));                                             \
+    mblk_t *const dst = DE_BVEC_data(_dst);                                    \
+    for (usize i = 0; i < DE_BVEC_FIXED_BLOCKS(_bits); ++i)                    \
+      dst[i] = _msk->blocks[i];                                                \
+    de_bvec_count_invalidate(_dst);                                            \
+  }                                                                            \
+                                                                               \
+  static inline u0 _name##_from_bvec(_name *const _dst,                        \
+                                     const de_bvec *const _src) {              \
+    const mblk_t *const src = DE_BVEC_data(_src);                              \
+    const usize bits =                                                         \
+        _src->bits_amount < (_bits) ? _src->bits_amount : (_bits);             \
+    const usize full = bits / DE_BVEC_MBLK_BITS;                               \
+    _name##_clear(_dst);                                                       \
+    for (usize i = 0; i < full; ++i)                                           \
+      _dst->blocks[i] = src[i];                                                \
+    if (bits % DE_BVEC_MBLK_BITS)                                              \
+      _dst->blocks[full] =                                                     \
+          src[full] & (((mblk_t)1 << (bits % DE_BVEC_MBLK_BITS)) - 1);         \
+  }
+
+#endif /* DE_CONTAINER_BITMASK_FIXED_HEADER */
@@ -0,0 +1,962 @@
+#ifndef DE_CONTAINER_BITMASK_HYBRID_HEADER
+#define DE_CONTAINER_BITMASK_HYBRID_HEADER
+
+/*
+  Adaptive bitvector for masks with few 1 bits in a large range.
+  While sparse it stores the sorted positions of the 1 bits (u32, or u64
+  once the range does not fit), so nothing is allocated for the 0 bits
+  and count / any are O(1). When the positions would take more bytes than
+  the blocks it promotes itself to a plain de_bvec, and it demotes back
+  once the 1 bits take a DE_BVEC_HYBRID_HYSTERESIS-th of that again.
+  Demotion is checked by the bulk operations, which scan the blocks
+  anyway, by optimize, and with DE_CONTAINER_BITMASK_CACHED_COUNT also by
+  set / set_range clearing bits of a dense mask.
+  sparse & sparse intersects by galloping through the larger side,
+  sparse & dense probes the dense side for every position.
+  To get function definitions include
+  `#define DE_CONTAINER_BITMASK_IMPLEMENTATION`
+  before including this file.
+*/
+
+#include <common.h>
+#include <de_bitmask.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+/* a dense mask demotes when positions need <= 1/4 of its block bytes */
+#ifndef DE_BVEC_HYBRID_HYSTERESIS
+#define DE_BVEC_HYBRID_HYSTERESIS ((usize)4)
+#endif
+
+// clang-format off
+
+/* ---- Struct ---- */
+typedef enum {
+  DE_BVEC_HYBRID_SPARSE = 0,  /* sorted positions in pos */
+  DE_BVEC_HYBRID_DENSE,       /* blocks in dense */
+} de_bvec_hybrid_kind;
+
+typedef struct {
+  de_bvec dense;         /* DENSE only */
+  union {
+    u32* narrow;         /* positions while bits_amount <= 2^32 */
+    u64* wide;           /* positions above that */
+    u8*  bytes;
+  } pos;
+  usize size;            /* positions in use (SPARSE) */
+  usize capacity;        /* allocated positions (SPARSE) */
+  usize bits_amount;     /* logical number of bits */
+  u8    kind;            /* de_bvec_hybrid_kind */
+  u8    wide;            /* positions are u64 */
+} de_bvec_hybrid;
+
+/* ---- Lifecycle ---- */
+
+/*
+create an empty sparse bitvector with _amount_bits bits.
+no memory is allocated until bits are set.
+*/
+DE_CONTAINER_BITMASK_API de_bvec_hybrid
+de_bvec_hybrid_create(
+  const usize _amount_bits
+);
+
+/*
+resets all values and clears the struct
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_hybrid_delete(
+  de_bvec_hybrid* const _msk
+);
+
+/*
+deep copies _src into _dst
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_hybrid_copy(
+  de_bvec_hybrid* const       _dst,
+  const de_bvec_hybrid* const _src
+);
+
+/*
+converts a dense bitvector, the result picks the cheaper form
+*/
+DE_CONTAINER_BITMASK_API de_bvec_hybrid
+de_bvec_hybrid_from_bvec(
+  const de_bvec* const _msk
+);
+
+/*
+expands into a dense bitvector of the same size
+*/
+DE_CONTAINER_BITMASK_API de_bvec
+de_bvec_hybrid_to_bvec(
+  const de_bvec_hybrid* const _msk
+);
+
+/*
+re-picks the form from the current amount of 1 bits.
+O(n) for a dense mask without the cached count
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_hybrid_optimize(
+  de_bvec_hybrid* const _msk
+);
+
+/* ---- Single-bit access ---- */
+
+/*
+return the state of the bit at the given index.
+O(log n) while sparse
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_hybrid_get(
+  const de_bvec_hybrid* const _msk,
+  const usize                 _idx
+);
+
+/*
+sets the state of the bit at the given index.
+may promote the mask to dense
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_hybrid_set(
+  de_bvec_hybrid* const _msk,
+  const usize           _idx,
+  const bool            _value
+);
+
+/*
+flips the state of the bit at the given index
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_hybrid_flip(
+  de_bvec_hybrid* const _msk,
+  const usize           _idx
+);
+
+/*
+sets the state of the bits in the range provided.
+setting a range too long for the sparse form promotes the mask first
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_hybrid_set_range(
+  de_bvec_hybrid* const _msk,
+  const usize           _start_idx,
+  const usize           _end_idx,
+  const bool            _value
+);
+
+/* ---- Bulk operations ---- */
+
+/*
+clears all bits to 0, the mask becomes an empty sparse one
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_hybrid_clear(
+  de_bvec_hybrid* const _msk
+);
+
+/*
+all bits from _dst are &= with the bits from _src.
+bits past the end of _src count as 0
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_hybrid_and_msk(
+  de_bvec_hybrid* const       _dst,
+  const de_bvec_hybrid* const _src
+);
+
+/*
+all bits from _dst are |= with the bits from _src.
+bits of _src past the end of _dst are ignored
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_hybrid_or_msk(
+  de_bvec_hybrid* const       _dst,
+  const de_bvec_hybrid* const _src
+);
+
+/*
+all bits from _dst are ^= with the bits from _src.
+bits of _src past the end of _dst are ignored
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_hybrid_xor_msk(
+  de_bvec_hybrid* const       _dst,
+  const de_bvec_hybrid* const _src
+);
+
+/*
+returns the amount of bits that are 1 in both, nothing is written
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_hybrid_and_count(
+  const de_bvec_hybrid* const _a,
+  const de_bvec_hybrid* const _b
+);
+
+/* ---- Info / Introspection ---- */
+
+/*
+retuns the amount of available bits
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_hybrid_info_size(
+  const de_bvec_hybrid* const _msk
+);
+
+/*
+returns the heap bytes used by the positions or the blocks
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_hybrid_info_bytes(
+  const de_bvec_hybrid* const _msk
+);
+
+/*
+retuns if the struct is valid.
+a failed allocation frees the storage and leaves an empty, invalid mask
+that ignores further edits until de_bvec_hybrid_delete
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_hybrid_info_valid(
+  const de_bvec_hybrid* const _msk
+);
+
+/*
+returns true while the mask stores positions
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_hybrid_info_sparse(
+  const de_bvec_hybrid* const _msk
+);
+
+/*
+returns true if any bit is 1
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_hybrid_any(
+  const de_bvec_hybrid* const _msk
+);
+
+/*
+returns amount of positive bits (1) in _msk
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_hybrid_count(
+  const de_bvec_hybrid* const _msk
+);
+
+/*
+returns the index of the first 1 bit at or after _idx, or DE_BVEC_NPOS
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_hybrid_find_next(
+  const de_bvec_hybrid* const _msk,
+  const usize                 _idx
+);
+
+/*
+returns the index of the first 1 bit, or DE_BVEC_NPOS
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_hybrid_find_first(
+  const de_bvec_hybrid* const _msk
+);
+
+// clang-format on
+#pragma GCC diagnostic pop
+#endif /* DE_CONTAINER_BITMASK_HYBRID_HEADER */
+
+/* ---- Implementation Guard ---- */
+#if defined(DE_CONTAINER_BITMASK_IMPLEMENTATION)
+#ifndef DE_CONTAINER_BITMASK_HYBRID_IMPLEMENTATION_INTERNAL
+#define DE_CONTAINER_BITMASK_HYBRID_IMPLEMENTATION_INTERNAL
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DE_BVEC_HYBRID_ELEM(_msk)                                              \
+  ((usize)((_msk)->wide ? sizeof(u64) : sizeof(u32)))
+#define DE_BVEC_HYBRID_DENSE_BYTES(_msk)                                       \
+  (DE_BVEC_GET_BLOCKS_AMOUNT((_msk)->bits_amount) * sizeof(mblk_t))
+/* _ones positions cost more than the blocks */
+#define DE_BVEC_HYBRID_OVER(_msk, _ones)                                       \
+  ((_ones) * DE_BVEC_HYBRID_ELEM(_msk) > DE_BVEC_HYBRID_DENSE_BYTES(_msk))
+/* _ones positions leave the sparse form room to grow again */
+#define DE_BVEC_HYBRID_UNDER(_msk, _ones)                                      \
+  ((_ones) * DE_BVEC_HYBRID_ELEM(_msk) * DE_BVEC_HYBRID_HYSTERESIS <=          \
+   DE_BVEC_HYBRID_DENSE_BYTES(_msk))
+
+/* ---- Position helpers ---- */
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_hybrid_at(const de_bvec_hybrid *const _msk, const usize _i) {
+  return _msk->wide ? (usize)_msk->pos.wide[_i] : (usize)_msk->pos.narrow[_i];
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_hybrid_put(de_bvec_hybrid *const _msk,
+                                                    const usize _i,
+                                                    const usize _v) {
+  if (_msk->wide)
+    _msk->pos.wide[_i] = (u64)_v;
+  else
+    _msk->pos.narrow[_i] = (u32)_v;
+}
+
+/* makes room for _need positions, on failure _msk is left untouched */
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_hybrid_grow(de_bvec_hybrid *const _msk, const usize _need) {
+  if (_need <= _msk->capacity)
+    return true;
+  usize cap = _msk->capacity ? _msk->capacity * 2 : 8;
+  while (cap < _need)
+    cap *= 2;
+  u8 *const bytes =
+      (u8 *)realloc(_msk->pos.bytes, cap * DE_BVEC_HYBRID_ELEM(_msk));
+  if (!bytes)
+    return false;
+  _msk->pos.bytes = bytes;
+  _msk->capacity = cap;
+  return true;
+}
+
+/* first index in [_lo, _hi) whose position is >= _v */
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_hybrid_lower_bound(const de_bvec_hybrid *const _msk, usize _lo,
+                           usize _hi, const usize _v) {
+  while (_lo < _hi) {
+    const usize mid = _lo + (_hi - _lo) / 2;
+    if (DE_BVEC_hybrid_at(_msk, mid) < _v)
+      _lo = mid + 1;
+    else
+      _hi = mid;
+  }
+  return _lo;
+}
+
+/*
+first index >= _from whose position is >= _v. doubles the step from
+_from so a walk over a much larger array costs O(log gap) per lookup
+*/
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_hybrid_gallop(const de_bvec_hybrid *const _msk, const usize _from,
+                      const usize _v) {
+  usize lo = _from, hi = _from, step = 1;
+  while (hi < _msk->size && DE_BVEC_hybrid_at(_msk, hi) < _v) {
+    lo = hi + 1;
+    hi += step;
+    step *= 2;
+  }
+  return DE_BVEC_hybrid_lower_bound(_msk, lo, hi < _msk->size ? hi : _msk->size,
+                                    _v);
+}
+
+/* ---- Form changes ---- */
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_hybrid_free_pos(de_bvec_hybrid *const _msk) {
+  free(_msk->pos.bytes);
+  _msk->pos.bytes = NULL;
+  _msk->size = 0;
+  _msk->capacity = 0;
+}
+
+/*
+frees the storage and leaves the invalid state de_bvec_hybrid_info_valid
+reports: sparse without positions but a non zero capacity
+*/
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_hybrid_fail(de_bvec_hybrid *const _msk) {
+  if (_msk->kind == DE_BVEC_HYBRID_DENSE)
+    de_bvec_delete(&_msk->dense);
+  else
+    DE_BVEC_hybrid_free_pos(_msk);
+  _msk->kind = DE_BVEC_HYBRID_SPARSE;
+  _msk->pos.bytes = NULL;
+  _msk->size = 0;
+  _msk->capacity = 1;
+}
+
+/*
+false after turning _dst invalid if either side is invalid, an op with an
+invalid operand has no meaningful result
+*/
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_hybrid_both_valid(de_bvec_hybrid *const _dst,
+                          const de_bvec_hybrid *const _src) {
+  if (!de_bvec_hybrid_info_valid(_dst))
+    return false;
+  if (!de_bvec_hybrid_info_valid(_src)) {
+    DE_BVEC_hybrid_fail(_dst);
+    return false;
+  }
+  return true;
+}
+
+/* takes _dense as the new storage of _msk */
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_hybrid_adopt(de_bvec_hybrid *const _msk, de_bvec *const _dense) {
+  if (_msk->kind == DE_BVEC_HYBRID_DENSE)
+    de_bvec_delete(&_msk->dense);
+  else
+    DE_BVEC_hybrid_free_pos(_msk);
+  _msk->dense = *_dense;
+  _msk->kind = DE_BVEC_HYBRID_DENSE;
+}
+
+/* returns false and leaves _msk invalid if the blocks could not be made */
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_hybrid_to_dense(de_bvec_hybrid *const _msk) {
+  if (_msk->kind == DE_BVEC_HYBRID_DENSE)
+    return true;
+  de_bvec dense = de_bvec_create(_msk->bits_amount);
+  if (!de_bvec_info_valid(&dense)) {
+    de_bvec_delete(&dense);
+    DE_BVEC_hybrid_fail(_msk);
+    return false;
+  }
+  mblk_t *const blocks = DE_BVEC_DATA(&dense);
+  for (usize i = 0; i < _msk->size; ++i) {
+    const usize p = DE_BVEC_hybrid_at(_msk, i);
+    blocks[DE_BVEC_GET_BLOCKS_INDEX(p)] |= DE_BVEC_ONE
+                                           << (p % DE_BVEC_MBLK_BITS);
+  }
+  DE_BVEC_COUNT_SET(&dense, _msk->size);
+  DE_BVEC_hybrid_adopt(_msk, &dense);
+  return true;
+}
+
+/*
+_ones is the amount of 1 bits in the dense mask. if the positions cannot
+be allocated the mask stays dense, which holds the same bits
+*/
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_hybrid_to_sparse(de_bvec_hybrid *const _msk, const usize _ones) {
+  if (_msk->kind == DE_BVEC_HYBRID_SPARSE)
+    return;
+  const usize cap = _ones ? _ones : 1;
+  u8 *const pos = (u8 *)malloc(cap * DE_BVEC_HYBRID_ELEM(_msk));
+  if (!pos)
+    return;
+  de_bvec dense = _msk->dense;
+  _msk->kind = DE_BVEC_HYBRID_SPARSE;
+  _msk->pos.bytes = pos;
+  _msk->size = 0;
+  _msk->capacity = cap;
+  const mblk_t *const blocks = DE_BVEC_DATA(&dense);
+  for (usize b = 0; b < dense.block_count; ++b) {
+    for (mblk_t word = blocks[b]; word; word &= word - 1)
+      DE_BVEC_hybrid_put(_msk, _msk->size++,
+                         b * DE_BVEC_MBLK_BITS + (usize)__builtin_ctzll(word));
+  }
+  de_bvec_delete(&dense);
+}
+
+/* demotes a dense mask if its cached count says it is sparse enough */
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_hybrid_try_demote(de_bvec_hybrid *const _msk) {
+  if (_msk->kind == DE_BVEC_HYBRID_DENSE &&
+      DE_BVEC_COUNT_KNOWN(&_msk->dense) &&
+      DE_BVEC_HYBRID_UNDER(_msk, DE_BVEC_COUNT_GET(&_msk->dense)))
+    DE_BVEC_hybrid_to_sparse(_msk, DE_BVEC_COUNT_GET(&_msk->dense));
+}
+
+/* replaces the positions of _msk with _size positions from _pos */
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_hybrid_take(de_bvec_hybrid *const _msk, u8 *const _pos,
+                    const usize _size, const usize _capacity) {
+  DE_BVEC_hybrid_free_pos(_msk);
+  _msk->pos.bytes = _pos;
+  _msk->size = _size;
+  _msk->capacity = _capacity;
+  if (DE_BVEC_HYBRID_OVER(_msk, _size))
+    DE_BVEC_hybrid_to_dense(_msk);
+}
+
+/* dense copy of _src cut or extended to _bits, check de_bvec_info_valid */
+DE_CONTAINER_BITMASK_INTERNAL de_bvec
+DE_BVEC_hybrid_dense_of(const de_bvec_hybrid *const _src, const usize _bits) {
+  de_bvec out = de_bvec_create(0);
+  de_bvec_copy(&out, &_src->dense);
+  de_bvec_resize(&out, _bits);
+  return out;
+}
+
+/* ---- Lifecycle ---- */
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_hybrid
+de_bvec_hybrid_create(const usize _amount_bits) {
+  return (de_bvec_hybrid){
+      .pos.bytes = NULL,
+      .bits_amount = _amount_bits,
+      .kind = DE_BVEC_HYBRID_SPARSE,
+      .wide = (u64)_amount_bits > (u64)UINT32_MAX + 1};
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_hybrid_delete(de_bvec_hybrid *const _msk) {
+  if (!_msk)
+    return;
+  if (_msk->kind == DE_BVEC_HYBRID_DENSE)
+    de_bvec_delete(&_msk->dense);
+  else
+    DE_BVEC_hybrid_free_pos(_msk);
+  *_msk = (de_bvec_hybrid){0};
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_hybrid_copy(de_bvec_hybrid *const _dst,
+                    const de_bvec_hybrid *const _src) {
+  if (_dst == _src)
+    return;
+  de_bvec_hybrid_delete(_dst);
+  *_dst = de_bvec_hybrid_create(_src->bits_amount);
+  if (!de_bvec_hybrid_info_valid(_src)) {
+    DE_BVEC_hybrid_fail(_dst);
+    return;
+  }
+  if (_src->kind == DE_BVEC_HYBRID_DENSE) {
+    _dst->dense = DE_BVEC_hybrid_dense_of(_src, _src->bits_amount);
+    _dst->kind = DE_BVEC_HYBRID_DENSE;
+    if (!de_bvec_info_valid(&_dst->dense))
+      DE_BVEC_hybrid_fail(_dst);
+    return;
+  }
+  if (!DE_BVEC_hybrid_grow(_dst, _src->size)) {
+    DE_BVEC_hybrid_fail(_dst);
+    return;
+  }
+  if (_src->size)
+    memcpy(_dst->pos.bytes, _src->pos.bytes,
+           _src->size * DE_BVEC_HYBRID_ELEM(_src));
+  _dst->size = _src->size;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_hybrid
+de_bvec_hybrid_from_bvec(const de_bvec *const _msk) {
+  de_bvec_hybrid out = de_bvec_hybrid_create(_msk->bits_amount);
+  const usize ones = de_bvec_count(_msk);
+  out.dense = de_bvec_create(0);
+  de_bvec_copy(&out.dense, _msk);
+  DE_BVEC_COUNT_SET(&out.dense, ones);
+  out.kind = DE_BVEC_HYBRID_DENSE;
+  if (!de_bvec_info_valid(&out.dense)) {
+    DE_BVEC_hybrid_fail(&out);
+    return out;
+  }
+  if (!DE_BVEC_HYBRID_OVER(&out, ones))
+    DE_BVEC_hybrid_to_sparse(&out, ones);
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec
+de_bvec_hybrid_to_bvec(const de_bvec_hybrid *const _msk) {
+  if (_msk->kind == DE_BVEC_HYBRID_DENSE)
+    return DE_BVEC_hybrid_dense_of(_msk, _msk->bits_amount);
+  de_bvec out = de_bvec_create(_msk->bits_amount);
+  if (!de_bvec_info_valid(&out))
+    return out;
+  for (usize i = 0; i < _msk->size; ++i)
+    de_bvec_set(&out, DE_BVEC_hybrid_at(_msk, i), true);
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_hybrid_optimize(de_bvec_hybrid *const _msk) {
+  if (!de_bvec_hybrid_info_valid(_msk))
+    return;
+  if (_msk->kind == DE_BVEC_HYBRID_SPARSE) {
+    if (DE_BVEC_HYBRID_OVER(_msk, _msk->size))
+      DE_BVEC_hybrid_to_dense(_msk);
+    return;
+  }
+  const usize ones = de_bvec_count_refresh(&_msk->dense);
+  if (DE_BVEC_HYBRID_UNDER(_msk, ones))
+    DE_BVEC_hybrid_to_sparse(_msk, ones);
+}
+
+/* ---- Single-bit access ---- */
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_hybrid_get(const de_bvec_hybrid *const _msk, const usize _idx) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_idx < _msk->bits_amount);
+#endif
+  if (_msk->kind == DE_BVEC_HYBRID_DENSE)
+    return de_bvec_get(&_msk->dense, _idx);
+  const usize i = DE_BVEC_hybrid_lower_bound(_msk, 0, _msk->size, _idx);
+  return i < _msk->size && DE_BVEC_hybrid_at(_msk, i) == _idx;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_hybrid_set(de_bvec_hybrid *const _msk,
+                                                    const usize _idx,
+                                                    const bool _value) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_idx < _msk->bits_amount);
+#endif
+  if (!de_bvec_hybrid_info_valid(_msk))
+    return;
+  if (_msk->kind == DE_BVEC_HYBRID_DENSE) {
+    de_bvec_set(&_msk->dense, _idx, _value);
+    if (!_value)
+      DE_BVEC_hybrid_try_demote(_msk);
+    return;
+  }
+  const usize elem = DE_BVEC_HYBRID_ELEM(_msk);
+  const usize i = DE_BVEC_hybrid_lower_bound(_msk, 0, _msk->size, _idx);
+  const bool has = i < _msk->size && DE_BVEC_hybrid_at(_msk, i) == _idx;
+  if (has == _value)
+    return;
+  if (!_value) {
+    memmove(_msk->pos.bytes + i * elem, _msk->pos.bytes + (i + 1) * elem,
+            (_msk->size - i - 1) * elem);
+    --_msk->size;
+    return;
+  }
+  if (DE_BVEC_HYBRID_OVER(_msk, _msk->size + 1)) {
+    if (DE_BVEC_hybrid_to_dense(_msk))
+      de_bvec_set(&_msk->dense, _idx, true);
+    return;
+  }
+  if (!DE_BVEC_hybrid_grow(_msk, _msk->size + 1)) {
+    DE_BVEC_hybrid_fail(_msk);
+    return;
+  }
+  memmove(_msk->pos.bytes + (i + 1) * elem, _msk->pos.bytes + i * elem,
+          (_msk->size - i) * elem);
+  DE_BVEC_hybrid_put(_msk, i, _idx);
+  ++_msk->size;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_hybrid_flip(de_bvec_hybrid *const _msk, const usize _idx) {
+  if (!de_bvec_hybrid_info_valid(_msk))
+    return;
+  if (_msk->kind == DE_BVEC_HYBRID_DENSE) {
+    de_bvec_flip(&_msk->dense, _idx);
+    DE_BVEC_hybrid_try_demote(_msk);
+    return;
+  }
+  de_bvec_hybrid_set(_msk, _idx, !de_bvec_hybrid_get(_msk, _idx));
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_hybrid_set_range(de_bvec_hybrid *const _msk, const usize _start_idx,
+                         const usize _end_idx, const bool _value) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_start_idx < _msk->bits_amount);
+  assert(_end_idx < _msk->bits_amount);
+  assert(_start_idx <= _end_idx);
+#endif
+  if (!de_bvec_hybrid_info_valid(_msk))
+    return;
+  if (_msk->kind == DE_BVEC_HYBRID_DENSE) {
+    de_bvec_set_range(&_msk->dense, _start_idx, _end_idx, _value);
+    if (!_value)
+      DE_BVEC_hybrid_try_demote(_msk);
+    return;
+  }
+  const usize elem = DE_BVEC_HYBRID_ELEM(_msk);
+  const usize lo = DE_BVEC_hybrid_lower_bound(_msk, 0, _msk->size, _start_idx);
+  const usize hi =
+      DE_BVEC_hybrid_lower_bound(_msk, lo, _msk->size, _end_idx + 1);
+  const usize len = _value ? _end_idx - _start_idx + 1 : 0;
+  const usize size = _msk->size - (hi - lo) + len;
+  if (DE_BVEC_HYBRID_OVER(_msk, size)) {
+    if (DE_BVEC_hybrid_to_dense(_msk))
+      de_bvec_set_range(&_msk->dense, _start_idx, _end_idx, _value);
+    return;
+  }
+  if (!DE_BVEC_hybrid_grow(_msk, size)) {
+    DE_BVEC_hybrid_fail(_msk);
+    return;
+  }
+  /* the positions after the range move to their new place first */
+  if (hi < _msk->size)
+    memmove(_msk->pos.bytes + (lo + len) * elem, _msk->pos.bytes + hi * elem,
+            (_msk->size - hi) * elem);
+  for (usize k = 0; k < len; ++k)
+    DE_BVEC_hybrid_put(_msk, lo + k, _start_idx + k);
+  _msk->size = size;
+}
+
+/* ---- Bulk operations ---- */
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_hybrid_clear(de_bvec_hybrid *const _msk) {
+  if (_msk->kind == DE_BVEC_HYBRID_DENSE) {
+    de_bvec_delete(&_msk->dense);
+    _msk->kind = DE_BVEC_HYBRID_SPARSE;
+  }
+  /* keeps the capacity, the positions are likely to come back */
+  _msk->size = 0;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_hybrid_and_msk(de_bvec_hybrid *const _dst,
+                       const de_bvec_hybrid *const _src) {
+  if (!DE_BVEC_hybrid_both_valid(_dst, _src))
+    return;
+  const bool dst_sparse = _dst->kind == DE_BVEC_HYBRID_SPARSE;
+  const bool src_sparse = _src->kind == DE_BVEC_HYBRID_SPARSE;
+  if (!dst_sparse && !src_sparse) {
+    de_bvec_and_msk(&_dst->dense, &_src->dense);
+    de_bvec_hybrid_optimize(_dst);
+    return;
+  }
+  usize k = 0;
+  if (dst_sparse && src_sparse) {
+    /* walk the smaller side, gallop through the larger one. output never
+       overtakes the input of _dst, so it is written in place */
+    if (_dst->size <= _src->size) {
+      for (usize i = 0, j = 0; i < _dst->size; ++i) {
+        const usize v = DE_BVEC_hybrid_at(_dst, i);
+        j = DE_BVEC_hybrid_gallop(_src, j, v);
+        if (j == _src->size)
+          break;
+        if (DE_BVEC_hybrid_at(_src, j) == v)
+          DE_BVEC_hybrid_put(_dst, k++, v);
+      }
+    } else {
+      for (usize i = 0, j = 0; j < _src->size; ++j) {
+        const usize v = DE_BVEC_hybrid_at(_src, j);
+        i = DE_BVEC_hybrid_gallop(_dst, i, v);
+        if (i == _dst->size)
+          break;
+        if (DE_BVEC_hybrid_at(_dst, i) == v)
+          DE_BVEC_hybrid_put(_dst, k++, v);
+      }
+    }
+    _dst->size = k;
+  } else if (dst_sparse) {
+    /* probe the dense side for every position */
+    const usize bits = _src->bits_amount;
+    for (usize i = 0; i < _dst->size; ++i) {
+      const usize v = DE_BVEC_hybrid_at(_dst, i);
+      if (v >= bits)
+        break;
+      if (de_bvec_get(&_src->dense, v))
+        DE_BVEC_hybrid_put(_dst, k++, v);
+    }
+    _dst->size = k;
+  } else {
+    /* the result is a subset of the positions of _src */
+    const usize bits = _dst->bits_amount;
+    const usize end = DE_BVEC_hybrid_lower_bound(_src, 0, _src->size, bits);
+    const usize cap = end ? end : 1;
+    u8 *const pos = (u8 *)malloc(cap * DE_BVEC_HYBRID_ELEM(_dst));
+    if (!pos) {
+      DE_BVEC_hybrid_fail(_dst);
+      return;
+    }
+    de_bvec dense = _dst->dense;
+    _dst->kind = DE_BVEC_HYBRID_SPARSE;
+    _dst->pos.bytes = pos;
+    _dst->size = 0;
+    _dst->capacity = cap;
+    for (usize j = 0; j < end; ++j) {
+      const usize v = DE_BVEC_hybrid_at(_src, j);
+      if (de_bvec_get(&dense, v))
+        DE_BVEC_hybrid_put(_dst, k++, v);
+    }
+    _dst->size = k;
+    de_bvec_delete(&dense);
+    de_bvec_hybrid_optimize(_dst);
+  }
+}
+
+/* merges the positions of _dst and _src (below the end of _dst) */
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_hybrid_merge(de_bvec_hybrid *const _dst,
+                     const de_bvec_hybrid *const _src, const bool _xor) {
+  const usize end =
+      DE_BVEC_hybrid_lower_bound(_src, 0, _src->size, _dst->bits_amount);
+  const usize cap = _dst->size + end;
+  de_bvec_hybrid out = de_bvec_hybrid_create(_dst->bits_amount);
+  if (!DE_BVEC_hybrid_grow(&out, cap)) {
+    DE_BVEC_hybrid_fail(_dst);
+    return;
+  }
+  usize i = 0, j = 0, k = 0;
+  while (i < _dst->size && j < end) {
+    const usize a = DE_BVEC_hybrid_at(_dst, i);
+    const usize b = DE_BVEC_hybrid_at(_src, j);
+    if (a == b) {
+      if (!_xor)
+        DE_BVEC_hybrid_put(&out, k++, a);
+      ++i;
+      ++j;
+    } else if (a < b) {
+      DE_BVEC_hybrid_put(&out, k++, a);
+      ++i;
+    } else {
+      DE_BVEC_hybrid_put(&out, k++, b);
+      ++j;
+    }
+  }
+  for (; i < _dst->size; ++i)
+    DE_BVEC_hybrid_put(&out, k++, DE_BVEC_hybrid_at(_dst, i));
+  for (; j < end; ++j)
+    DE_BVEC_hybrid_put(&out, k++, DE_BVEC_hybrid_at(_src, j));
+  DE_BVEC_hybrid_take(_dst, out.pos.bytes, k, out.capacity);
+}
+
+/* or / xor of a sparse _dst with a dense _src, the result starts dense */
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_hybrid_onto_dense(de_bvec_hybrid *const _dst,
+                          const de_bvec_hybrid *const _src, const bool _xor) {
+  de_bvec dense = DE_BVEC_hybrid_dense_of(_src, _dst->bits_amount);
+  if (!de_bvec_info_valid(&dense)) {
+    de_bvec_delete(&dense);
+    DE_BVEC_hybrid_fail(_dst);
+    return;
+  }
+  for (usize i = 0; i < _dst->size; ++i) {
+    const usize v = DE_BVEC_hybrid_at(_dst, i);
+    if (_xor)
+      de_bvec_flip(&dense, v);
+    else
+      de_bvec_set(&dense, v, true);
+  }
+  DE_BVEC_hybrid_adopt(_dst, &dense);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_hybrid_or_msk(de_bvec_hybrid *const _dst,
+                      const de_bvec_hybrid *const _src) {
+  if (!DE_BVEC_hybrid_both_valid(_dst, _src))
+    return;
+  const bool dst_sparse = _dst->kind == DE_BVEC_HYBRID_SPARSE;
+  if (_src->kind == DE_BVEC_HYBRID_SPARSE) {
+    if (dst_sparse) {
+      DE_BVEC_hybrid_merge(_dst, _src, false);
+      return;
+    }
+    for (usize j = 0; j < _src->size; ++j) {
+      const usize v = DE_BVEC_hybrid_at(_src, j);
+      if (v >= _dst->bits_amount)
+        break;
+      de_bvec_set(&_dst->dense, v, true);
+    }
+  } else if (dst_sparse) {
+    /* _src may be dense with few bits, or have them past the end of _dst */
+    DE_BVEC_hybrid_onto_dense(_dst, _src, false);
+    de_bvec_hybrid_optimize(_dst);
+  } else {
+    de_bvec_or_msk(&_dst->dense, &_src->dense);
+  }
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_hybrid_xor_msk(de_bvec_hybrid *const _dst,
+                       const de_bvec_hybrid *const _src) {
+  if (!DE_BVEC_hybrid_both_valid(_dst, _src))
+    return;
+  const bool dst_sparse = _dst->kind == DE_BVEC_HYBRID_SPARSE;
+  if (_src->kind == DE_BVEC_HYBRID_SPARSE) {
+    if (dst_sparse) {
+      DE_BVEC_hybrid_merge(_dst, _src, true);
+      return;
+    }
+    for (usize j = 0; j < _src->size; ++j) {
+      const usize v = DE_BVEC_hybrid_at(_src, j);
+      if (v >= _dst->bits_amount)
+        break;
+      de_bvec_flip(&_dst->dense, v);
+    }
+    DE_BVEC_hybrid_try_demote(_dst);
+    return;
+  }
+  if (dst_sparse)
+    DE_BVEC_hybrid_onto_dense(_dst, _src, true);
+  else
+    de_bvec_xor_msk(&_dst->dense, &_src->dense);
+  de_bvec_hybrid_optimize(_dst);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_hybrid_and_count(const de_bvec_hybrid *const _a,
+                         const de_bvec_hybrid *const _b) {
+  const bool a_sparse = _a->kind == DE_BVEC_HYBRID_SPARSE;
+  const bool b_sparse = _b->kind == DE_BVEC_HYBRID_SPARSE;
+  if (!a_sparse && !b_sparse)
+    return de_bvec_and_count(&_a->dense, &_b->dense);
+  usize out = 0;
+  if (a_sparse && b_sparse) {
+    const de_bvec_hybrid *const small = _a->size <= _b->size ? _a : _b;
+    const de_bvec_hybrid *const large = small == _a ? _b : _a;
+    for (usize i = 0, j = 0; i < small->size; ++i) {
+      const usize v = DE_BVEC_hybrid_at(small, i);
+      j = DE_BVEC_hybrid_gallop(large, j, v);
+      if (j == large->size)
+        break;
+      out += DE_BVEC_hybrid_at(large, j) == v;
+    }
+    return out;
+  }
+  const de_bvec_hybrid *const sparse = a_sparse ? _a : _b;
+  const de_bvec *const dense = a_sparse ? &_b->dense : &_a->dense;
+  for (usize i = 0; i < sparse->size; ++i) {
+    const usize v = DE_BVEC_hybrid_at(sparse, i);
+    if (v >= dense->bits_amount)
+      break;
+    out += de_bvec_get(dense, v);
+  }
+  return out;
+}
+
+/* ---- Info / Introspection ---- */
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_hybrid_info_size(const de_bvec_hybrid *const _msk) {
+  return _msk->bits_amount;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_hybrid_info_valid(const de_bvec_hybrid *const _msk) {
+  if (!_msk)
+    return false;
+  if (_msk->kind == DE_BVEC_HYBRID_DENSE)
+    return de_bvec_info_valid(&_msk->dense);
+  return _msk->pos.bytes != NULL || !_msk->capacity;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_hybrid_info_bytes(const de_bvec_hybrid *const _msk) {
+  if (_msk->kind == DE_BVEC_HYBRID_SPARSE)
+    return _msk->capacity * DE_BVEC_HYBRID_ELEM(_msk);
+  return _msk->dense.block_capacity * sizeof(mblk_t);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_hybrid_info_sparse(const de_bvec_hybrid *const _msk) {
+  return _msk->kind == DE_BVEC_HYBRID_SPARSE;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_hybrid_any(const de_bvec_hybrid *const _msk) {
+  if (_msk->kind == DE_BVEC_HYBRID_DENSE)
+    return de_bvec_any(&_msk->dense);
+  return _msk->size != 0;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_hybrid_count(const de_bvec_hybrid *const _msk) {
+  if (_msk->kind == DE_BVEC_HYBRID_DENSE)
+    return de_bvec_count(&_msk->dense);
+  return _msk->size;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_hybrid_find_next(const de_bvec_hybrid *const _msk, const usize _idx) {
+  if (_msk->kind == DE_BVEC_HYBRID_DENSE)
+    return de_bvec_find_next(&_msk->dense, _idx);
+  const usize i = DE_BVEC_hybrid_lower_bound(_msk, 0, _msk->size, _idx);
+  return i < _msk->size ? DE_BVEC_hybrid_at(_msk, i) : DE_BVEC_NPOS;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_hybrid_find_first(const de_bvec_hybrid *const _msk) {
+  return de_bvec_hybrid_find_next(_msk, 0);
+}
+
+#endif
+#endif
@@ -0,0 +1,431 @@
+#ifndef DE_CONTAINER_BITMASK_MMAP_HEADER
+#define DE_CONTAINER_BITMASK_MMAP_HEADER
+
+/*
+  de_bvec stored in a memory mapped file.
+  The file is a 64 byte header (magic, size in bits) followed by the raw
+  blocks, so opening a mask maps it instead of reading it: pages are only
+  loaded when touched and the page cache is shared between processes
+  mapping the same file.
+  map.msk is a regular de_bvec, the whole de_bvec API works on &map.msk.
+  Its storage comes from the mapping through an attached allocator,
+  growing the mask grows the file. Masks of at most DE_BVEC_INLINE_BITS
+  live inline and are written back on flush.
+  - DE_BVEC_MMAP_READ: read only, writing or growing the mask faults.
+  - DE_BVEC_MMAP_WRITE: changes reach the file, durable after flush.
+  - DE_BVEC_MMAP_PRIVATE: copy on write, changes never reach the file,
+    the mask can not grow past the file size.
+  de_bvec_mmap_* take the map by pointer, it must not be moved while open.
+  Moving (or swapping) another mask onto map.msk replaces its allocator
+  and detaches it from the file: flush and close return false and leave
+  the file as it was, close deletes the detached mask.
+  To get function definitions include
+  `#define DE_CONTAINER_BITMASK_IMPLEMENTATION`
+  before including this file.
+*/
+
+#include <common.h>
+#include <de_bitmask.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+// clang-format off
+
+/* ---- Struct ---- */
+typedef enum {
+  DE_BVEC_MMAP_READ = 0,
+  DE_BVEC_MMAP_WRITE,
+  DE_BVEC_MMAP_PRIVATE,
+} de_bvec_mmap_mode;
+
+typedef struct {
+  de_bvec_allocator base;  /* attached to msk, hands out the mapped blocks */
+  de_bvec  msk;            /* the mask, use it through the de_bvec API */
+  u8*      view;           /* header followed by the blocks */
+  usize    view_bytes;
+  uptr     file;           /* fd, HANDLE on Windows */
+  u8       mode;           /* de_bvec_mmap_mode */
+  bool     lent;           /* the mapped blocks are msk's storage */
+} de_bvec_mmap;
+
+/* ---- Lifecycle ---- */
+
+/*
+creates (or truncates) the file at _path holding _amount_bits zeroed bits
+and maps it writable. returns false if the file can not be created
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_mmap_create(
+  de_bvec_mmap* const _map,
+  const char* const   _path,
+  const usize         _amount_bits
+);
+
+/*
+maps an existing mask file. returns false if it can not be opened or is
+not a mask file
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_mmap_open(
+  de_bvec_mmap* const     _map,
+  const char* const       _path,
+  const de_bvec_mmap_mode _mode
+);
+
+/*
+writes the size and inline blocks to the file and schedules the dirty
+pages for writeback, _sync waits until they are on disk.
+returns false for read only and private maps, if map.msk was detached
+from the file or if the sync failed
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_mmap_flush(
+  de_bvec_mmap* const _map,
+  const bool          _sync
+);
+
+/*
+flushes writable maps synchronously, unmaps and cuts the file to the mask
+size. &map.msk must not be used afterwards. returns false if the flush
+failed, a detached map.msk is deleted and the file is left as it was
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_mmap_close(
+  de_bvec_mmap* const _map
+);
+
+// clang-format on
+#pragma GCC diagnostic pop
+#endif /* DE_CONTAINER_BITMASK_MMAP_HEADER */
+
+/* ---- Implementation Guard ---- */
+#if defined(DE_CONTAINER_BITMASK_IMPLEMENTATION)
+#ifndef DE_CONTAINER_BITMASK_MMAP_IMPLEMENTATION_INTERNAL
+#define DE_CONTAINER_BITMASK_MMAP_IMPLEMENTATION_INTERNAL
+
+#include <string.h>
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* "DEBVMMAP" */
+#define DE_BVEC_MMAP_MAGIC ((u64)0x50414d4d56424544ull)
+
+typedef struct {
+  u64 magic;
+  u64 bits_amount;
+  u64 reserved[6];
+} DE_BVEC_mmap_header;
+
+_Static_assert(sizeof(DE_BVEC_mmap_header) == 64,
+               "blocks must start on a cache line");
+
+#define DE_BVEC_MMAP_HEADER(_map) ((DE_BVEC_mmap_header *)(_map)->view)
+#define DE_BVEC_MMAP_BLOCKS(_map)                                              \
+  ((mblk_t *)((_map)->view + sizeof(DE_BVEC_mmap_header)))
+/* file bytes holding _blocks, room for the inline blocks is always kept */
+#define DE_BVEC_MMAP_BYTES(_blocks)                                            \
+  (sizeof(DE_BVEC_mmap_header) +                                              \
+   ((_blocks) > DE_BVEC_INLINE_BLOCKS ? (_blocks) : DE_BVEC_INLINE_BLOCKS) *   \
+       sizeof(mblk_t))
+#define DE_BVEC_MMAP_CAPACITY(_map)                                            \
+  (((_map)->view_bytes - sizeof(DE_BVEC_mmap_header)) / sizeof(mblk_t))
+
+/*
+true if _bytes hold the header and the blocks of _bits. divides instead of
+multiplying, _bits comes from the file and may be anything
+*/
+DE_CONTAINER_BITMASK_INTERNAL bool DE_BVEC_mmap_fits(const u64 _bits,
+                                                     const u64 _bytes) {
+  if (_bytes < sizeof(DE_BVEC_mmap_header) ||
+      _bits > (u64)(usize)-1 - DE_BVEC_MBLK_BITS)
+    return false;
+  const usize blocks = DE_BVEC_GET_BLOCKS_AMOUNT((usize)_bits);
+  return (blocks > DE_BVEC_INLINE_BLOCKS ? blocks : DE_BVEC_INLINE_BLOCKS) <=
+         (_bytes - sizeof(DE_BVEC_mmap_header)) / sizeof(mblk_t);
+}
+
+/* ---- Platform ---- */
+/* maps _bytes of the file, NULL on failure */
+DE_CONTAINER_BITMASK_INTERNAL u8 *DE_BVEC_mmap_view(de_bvec_mmap *const _map,
+                                                    const usize _bytes) {
+#if defined(_WIN32)
+  const DWORD protect =
+      _map->mode == DE_BVEC_MMAP_READ    ? PAGE_READONLY
+      : _map->mode == DE_BVEC_MMAP_WRITE ? PAGE_READWRITE
+                                         : PAGE_WRITECOPY;
+  const DWORD access = _map->mode == DE_BVEC_MMAP_READ    ? FILE_MAP_READ
+                       : _map->mode == DE_BVEC_MMAP_WRITE ? FILE_MAP_WRITE
+                                                          : FILE_MAP_COPY;
+  HANDLE mapping = CreateFileMappingA((HANDLE)_map->file, NULL, protect,
+                                      (DWORD)((u64)_bytes >> 32),
+                                      (DWORD)_bytes, NULL);
+  if (!mapping)
+    return NULL;
+  u8 *const out = (u8 *)MapViewOfFile(mapping, access, 0, 0, _bytes);
+  /* the view keeps the mapping object alive */
+  CloseHandle(mapping);
+  return out;
+#else
+  const int prot = _map->mode == DE_BVEC_MMAP_READ
+                       ? PROT_READ
+                       : PROT_READ | PROT_WRITE;
+  const int flags =
+      _map->mode == DE_BVEC_MMAP_PRIVATE ? MAP_PRIVATE : MAP_SHARED;
+  u8 *const out = (u8 *)mmap(NULL, _bytes, prot, flags, (int)_map->file, 0);
+  return out == (u8 *)MAP_FAILED ? NULL : out;
+#endif
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_mmap_unview(de_bvec_mmap *const _map) {
+  if (!_map->view)
+    return;
+#if defined(_WIN32)
+  UnmapViewOfFile(_map->view);
+#else
+  munmap(_map->view, _map->view_bytes);
+#endif
+  _map->view = NULL;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_mmap_truncate(de_bvec_mmap *const _map, const usize _bytes) {
+#if defined(_WIN32)
+  LARGE_INTEGER size;
+  size.QuadPart = (LONGLONG)_bytes;
+  return SetFilePointerEx((HANDLE)_map->file, size, NULL, FILE_BEGIN) &&
+         SetEndOfFile((HANDLE)_map->file);
+#else
+  return ftruncate((int)_map->file, (off_t)_bytes) == 0;
+#endif
+}
+
+/* grows the file and the view to hold _blocks blocks */
+DE_CONTAINER_BITMASK_INTERNAL bool DE_BVEC_mmap_grow(de_bvec_mmap *const _map,
+                                                     const usize _blocks) {
+  const usize bytes = DE_BVEC_MMAP_BYTES(_blocks);
+  if (bytes <= _map->view_bytes)
+    return true;
+  if (_map->mode != DE_BVEC_MMAP_WRITE)
+    return false;
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+  if (!DE_BVEC_mmap_truncate(_map, bytes))
+    return false;
+  u0 *const out = mremap(_map->view, _map->view_bytes, bytes, MREMAP_MAYMOVE);
+  if (out == MAP_FAILED)
+    return false;
+  _map->view = (u8 *)out;
+#else
+  /* Windows can not resize a file with a live view */
+  DE_BVEC_mmap_unview(_map);
+  const bool resized = DE_BVEC_mmap_truncate(_map, bytes);
+  _map->view = DE_BVEC_mmap_view(_map, resized ? bytes : _map->view_bytes);
+  if (!resized || !_map->view)
+    return false;
+#endif
+  _map->view_bytes = bytes;
+  return true;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_mmap_close_file(de_bvec_mmap *const _map) {
+#if defined(_WIN32)
+  CloseHandle((HANDLE)_map->file);
+#else
+  close((int)_map->file);
+#endif
+}
+
+/* opens _path, sets _map->file and returns the file size or -1 */
+DE_CONTAINER_BITMASK_INTERNAL i64 DE_BVEC_mmap_open_file(
+    de_bvec_mmap *const _map, const char *const _path, const bool _create) {
+#if defined(_WIN32)
+  const DWORD access = _map->mode == DE_BVEC_MMAP_WRITE
+                           ? GENERIC_READ | GENERIC_WRITE
+                           : GENERIC_READ;
+  HANDLE file = CreateFileA(_path, access, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                            NULL, _create ? CREATE_ALWAYS : OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return -1;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return -1;
+  }
+  _map->file = (uptr)file;
+  return (i64)size.QuadPart;
+#else
+  const int flags = _map->mode == DE_BVEC_MMAP_WRITE ? O_RDWR : O_RDONLY;
+  const int fd = open(_path, _create ? flags | O_CREAT | O_TRUNC : flags, 0644);
+  if (fd < 0)
+    return -1;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return -1;
+  }
+  _map->file = (uptr)fd;
+  return (i64)st.st_size;
+#endif
+}
+
+/* ---- Allocator ---- */
+/*
+  The mapping backs a single mask. Growth reaches it as realloc, moving
+  between inline and mapped storage as alloc / dealloc. dealloc keeps the
+  file, the blocks are still written back by flush.
+*/
+DE_CONTAINER_BITMASK_INTERNAL mblk_t *
+DE_BVEC_mmap_alloc(de_bvec_allocator *const _self, const usize _blocks) {
+  de_bvec_mmap *const map = (de_bvec_mmap *)_self;
+  if (map->lent || !DE_BVEC_mmap_grow(map, _blocks))
+    return NULL;
+  map->lent = true;
+  DE_BVEC_memset(DE_BVEC_MMAP_BLOCKS(map), 0, _blocks);
+  return DE_BVEC_MMAP_BLOCKS(map);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_mmap_dealloc(
+    de_bvec_allocator *const _self, mblk_t *const _data, const usize _blocks) {
+  (u0)_data;
+  (u0)_blocks;
+  ((de_bvec_mmap *)_self)->lent = false;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL mblk_t *
+DE_BVEC_mmap_realloc(de_bvec_allocator *const _self, mblk_t *const _data,
+                     const usize _old_blocks, const usize _new_blocks) {
+  de_bvec_mmap *const map = (de_bvec_mmap *)_self;
+  (u0)_data;
+  (u0)_old_blocks;
+  if (!DE_BVEC_mmap_grow(map, _new_blocks))
+    return NULL;
+  return DE_BVEC_MMAP_BLOCKS(map);
+}
+
+/* ---- Lifecycle ---- */
+/* points _map->msk at the mapped blocks, or inline for small masks */
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_mmap_attach(de_bvec_mmap *const _map,
+                                                     const usize _bits) {
+  _map->base = (de_bvec_allocator){.alloc = DE_BVEC_mmap_alloc,
+                                   .dealloc = DE_BVEC_mmap_dealloc,
+                                   .realloc = DE_BVEC_mmap_realloc};
+  _map->msk = de_bvec_create_with(0, &_map->base);
+  _map->msk.bits_amount = _bits;
+  _map->msk.block_count = DE_BVEC_GET_BLOCKS_AMOUNT(_bits);
+  _map->msk.last_block_bits_count = DE_BVEC_BITS_MOD_MBLK(_bits);
+  DE_BVEC_COUNT_INVALIDATE(&_map->msk);
+  if (_bits <= DE_BVEC_INLINE_BITS) {
+    DE_BVEC_memcpy(_map->msk.data.small, DE_BVEC_MMAP_BLOCKS(_map),
+                   _map->msk.block_count);
+    _map->lent = false;
+  } else {
+    _map->msk.data.blocks = DE_BVEC_MMAP_BLOCKS(_map);
+    _map->msk.block_capacity = DE_BVEC_MMAP_CAPACITY(_map);
+    _map->lent = true;
+  }
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_mmap_create(de_bvec_mmap *const _map, const char *const _path,
+                    const usize _amount_bits) {
+  _map->mode = DE_BVEC_MMAP_WRITE;
+  _map->view = NULL;
+  if (!DE_BVEC_mmap_fits(_amount_bits, (usize)-1) ||
+      DE_BVEC_mmap_open_file(_map, _path, true) < 0)
+    return false;
+  /* a freshly extended file reads as zeros, nothing has to be written */
+  const usize bytes =
+      DE_BVEC_MMAP_BYTES(DE_BVEC_GET_BLOCKS_AMOUNT(_amount_bits));
+  if (DE_BVEC_mmap_truncate(_map, bytes))
+    _map->view = DE_BVEC_mmap_view(_map, bytes);
+  if (!_map->view) {
+    DE_BVEC_mmap_close_file(_map);
+    return false;
+  }
+  _map->view_bytes = bytes;
+  DE_BVEC_MMAP_HEADER(_map)->magic = DE_BVEC_MMAP_MAGIC;
+  DE_BVEC_MMAP_HEADER(_map)->bits_amount = _amount_bits;
+  DE_BVEC_mmap_attach(_map, _amount_bits);
+  return true;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_mmap_open(de_bvec_mmap *const _map, const char *const _path,
+                  const de_bvec_mmap_mode _mode) {
+  _map->mode = (u8)_mode;
+  _map->view = NULL;
+  const i64 size = DE_BVEC_mmap_open_file(_map, _path, false);
+  if (size < 0)
+    return false;
+  if ((u64)size >= sizeof(DE_BVEC_mmap_header))
+    _map->view = DE_BVEC_mmap_view(_map, (usize)size);
+  _map->view_bytes = (usize)size;
+  if (!_map->view || DE_BVEC_MMAP_HEADER(_map)->magic != DE_BVEC_MMAP_MAGIC ||
+      !DE_BVEC_mmap_fits(DE_BVEC_MMAP_HEADER(_map)->bits_amount, (u64)size)) {
+    DE_BVEC_mmap_unview(_map);
+    DE_BVEC_mmap_close_file(_map);
+    return false;
+  }
+  DE_BVEC_mmap_attach(_map, (usize)DE_BVEC_MMAP_HEADER(_map)->bits_amount);
+  return true;
+}
+
+/* a mask moved onto map.msk brought its own allocator and storage */
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_mmap_detached(const de_bvec_mmap *const _map) {
+  return _map->msk.alloc != &_map->base;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_mmap_flush(de_bvec_mmap *const _map,
+                                                      const bool _sync) {
+  if (_map->mode != DE_BVEC_MMAP_WRITE || !_map->view ||
+      DE_BVEC_mmap_detached(_map))
+    return false;
+  if (!_map->lent)
+    DE_BVEC_memcpy(DE_BVEC_MMAP_BLOCKS(_map), _map->msk.data.small,
+                   DE_BVEC_INLINE_BLOCKS);
+  DE_BVEC_MMAP_HEADER(_map)->bits_amount = _map->msk.bits_amount;
+#if defined(_WIN32)
+  if (!FlushViewOfFile(_map->view, _map->view_bytes))
+    return false;
+  return !_sync || FlushFileBuffers((HANDLE)_map->file);
+#else
+  return msync(_map->view, _map->view_bytes, _sync ? MS_SYNC : MS_ASYNC) == 0;
+#endif
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_mmap_close(de_bvec_mmap *const _map) {
+  if (!_map->view)
+    return false;
+  const bool detached = DE_BVEC_mmap_detached(_map);
+  const bool flushed =
+      !detached &&
+      (_map->mode != DE_BVEC_MMAP_WRITE || de_bvec_mmap_flush(_map, true));
+  DE_BVEC_mmap_unview(_map);
+  /* growth is geometric, the file only keeps the used blocks */
+  if (_map->mode == DE_BVEC_MMAP_WRITE && !detached)
+    DE_BVEC_mmap_truncate(_map, DE_BVEC_MMAP_BYTES(_map->msk.block_count));
+  DE_BVEC_mmap_close_file(_map);
+  /* its storage is not part of the mapping */
+  if (detached)
+    de_bvec_delete(&_map->msk);
+  _map->msk = de_bvec_create_with(0, NULL);
+  _map->lent = false;
+  return flushed;
+}
+
+#endif
+#endif
@@ -0,0 +1,520 @@
+#ifndef DE_CONTAINER_BITMASK_PAR_HEADER
+#define DE_CONTAINER_BITMASK_PAR_HEADER
+
+/*
+  Parallel bulk operations for large de_bvec instances.
+  A process wide pool of worker threads is started with de_bvec_par_init,
+  the calling thread works alongside the pool. Blocks are handed out in
+  chunks of DE_BVEC_PAR_CHUNK_BLOCKS from a shared counter, so faster
+  cores simply take more chunks. count sums per thread and merges once,
+  any/all stop every thread as soon as the answer is known.
+  Masks below the threshold (de_bvec_par_set_threshold) or calls made
+  before de_bvec_par_init run the serial functions.
+  Jobs are serialized, concurrent callers wait for each other.
+  To get function definitions include
+  `#define DE_CONTAINER_BITMASK_IMPLEMENTATION`
+  before including this file.
+*/
+
+#include <common.h>
+#include <de_bitmask.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+/* masks with fewer bits stay on the calling thread */
+#ifndef DE_BVEC_PAR_THRESHOLD
+#define DE_BVEC_PAR_THRESHOLD ((usize)1 << 24)
+#endif
+
+/* blocks taken by a thread at a time, 64 KiB */
+#ifndef DE_BVEC_PAR_CHUNK_BLOCKS
+#define DE_BVEC_PAR_CHUNK_BLOCKS ((usize)8192)
+#endif
+
+// clang-format off
+
+/* ---- Pool ---- */
+
+/*
+starts the pool with _threads threads in total, the caller included.
+0 uses one thread per online core. returns false if the pool is
+already running or no worker could be started
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_par_init(
+  const usize _threads
+);
+
+/*
+stops and joins the workers, later calls run serially
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_par_shutdown(u0);
+
+/*
+returns the amount of threads taking part in a job, 1 without a pool
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_par_threads(u0);
+
+/*
+masks with less than _bits bits are processed serially
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_par_set_threshold(
+  const usize _bits
+);
+
+/* ---- Bulk operations ---- */
+
+/*
+parallel de_bvec_clear
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_par_clear(
+  de_bvec* const _msk
+);
+
+/*
+parallel de_bvec_fill
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_par_fill(
+  de_bvec* const _msk
+);
+
+/*
+parallel de_bvec_and_msk
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_par_and_msk(
+  de_bvec* const       _dst,
+  const de_bvec* const _src
+);
+
+/*
+parallel de_bvec_or_msk
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_par_or_msk(
+  de_bvec* const       _dst,
+  const de_bvec* const _src
+);
+
+/*
+parallel de_bvec_xor_msk
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_par_xor_msk(
+  de_bvec* const       _dst,
+  const de_bvec* const _src
+);
+
+/*
+parallel de_bvec_not
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_par_not(
+  de_bvec* const _dst
+);
+
+/* ---- Queries ---- */
+
+/*
+parallel de_bvec_count
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_par_count(
+  const de_bvec* const _msk
+);
+
+/*
+parallel de_bvec_count_refresh
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_par_count_refresh(
+  de_bvec* const _msk
+);
+
+/*
+parallel de_bvec_any, stops at the first set block found by any thread
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_par_any(
+  const de_bvec* const _msk
+);
+
+/*
+parallel de_bvec_all, stops at the first clear bit found by any thread
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_par_all(
+  const de_bvec* const _msk
+);
+
+// clang-format on
+#pragma GCC diagnostic pop
+#endif /* DE_CONTAINER_BITMASK_PAR_HEADER */
+
+/* ---- Implementation Guard ---- */
+#if defined(DE_CONTAINER_BITMASK_IMPLEMENTATION)
+#ifndef DE_CONTAINER_BITMASK_PAR_IMPLEMENTATION_INTERNAL
+#define DE_CONTAINER_BITMASK_PAR_IMPLEMENTATION_INTERNAL
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+typedef enum {
+  DE_BVEC_PAR_SET = 0,
+  DE_BVEC_PAR_AND,
+  DE_BVEC_PAR_OR,
+  DE_BVEC_PAR_XOR,
+  DE_BVEC_PAR_NOT,
+  DE_BVEC_PAR_COUNT,
+  DE_BVEC_PAR_ANY,  /* cancels on a nonzero block */
+  DE_BVEC_PAR_ALL,  /* cancels on a block that is not all ones */
+} DE_BVEC_par_op;
+
+typedef struct {
+  mblk_t *dst;
+  const mblk_t *src;
+  usize blocks;
+  mblk_t value;  /* DE_BVEC_PAR_SET */
+  u8 op;         /* DE_BVEC_par_op */
+  _Atomic usize next;
+  _Atomic usize result;
+  atomic_bool cancel;
+} DE_BVEC_par_job;
+
+typedef struct {
+  pthread_t *workers;
+  usize worker_count;
+  usize threshold;
+  pthread_mutex_t submit; /* one job at a time */
+  pthread_mutex_t lock;   /* guards the fields below */
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  DE_BVEC_par_job *job;
+  u64 generation;
+  usize pending;
+  bool stop;
+} DE_BVEC_par_pool;
+
+static DE_BVEC_par_pool DE_BVEC_par = {
+    .workers = NULL,
+    .worker_count = 0,
+    .threshold = DE_BVEC_PAR_THRESHOLD,
+    .submit = PTHREAD_MUTEX_INITIALIZER,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+    .job = NULL,
+    .generation = 0,
+    .pending = 0,
+    .stop = false};
+
+/* runs the op on blocks [_first, _first + _n), returns the partial count */
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_par_chunk(DE_BVEC_par_job *const _job, const usize _first,
+                  const usize _n) {
+  mblk_t *const dst = _job->dst ? _job->dst + _first : NULL;
+  const mblk_t *const src = _job->src ? _job->src + _first : NULL;
+  switch (_job->op) {
+  case DE_BVEC_PAR_SET:
+    DE_BVEC_memset(dst, _job->value, _n);
+    return 0;
+  case DE_BVEC_PAR_AND:
+    DE_BVEC_kernels.and_blocks(dst, src, _n);
+    return 0;
+  case DE_BVEC_PAR_OR:
+    DE_BVEC_kernels.or_blocks(dst, src, _n);
+    return 0;
+  case DE_BVEC_PAR_XOR:
+    DE_BVEC_kernels.xor_blocks(dst, src, _n);
+    return 0;
+  case DE_BVEC_PAR_NOT:
+    DE_BVEC_kernels.not_blocks(dst, _n);
+    return 0;
+  case DE_BVEC_PAR_COUNT:
+    return DE_BVEC_kernels.count_blocks(src, _n);
+  case DE_BVEC_PAR_ANY: {
+    mblk_t acc = 0;
+    for (usize i = 0; i < _n; ++i)
+      acc |= src[i];
+    return acc != 0;
+  }
+  case DE_BVEC_PAR_ALL: {
+    mblk_t acc = DE_BVEC_MBLK_FILLED;
+    for (usize i = 0; i < _n; ++i)
+      acc &= src[i];
+    return ~acc != 0;
+  }
+  default:
+    return 0;
+  }
+}
+
+/* takes chunks until the job is drained or cancelled */
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_par_work(DE_BVEC_par_job *const _job) {
+  const bool cancels =
+      _job->op == DE_BVEC_PAR_ANY || _job->op == DE_BVEC_PAR_ALL;
+  usize sum = 0;
+  while (!atomic_load_explicit(&_job->cancel, memory_order_relaxed)) {
+    const usize first = atomic_fetch_add_explicit(
+        &_job->next, DE_BVEC_PAR_CHUNK_BLOCKS, memory_order_relaxed);
+    if (first >= _job->blocks)
+      break;
+    const usize n = _job->blocks - first < DE_BVEC_PAR_CHUNK_BLOCKS
+                        ? _job->blocks - first
+                        : DE_BVEC_PAR_CHUNK_BLOCKS;
+    const usize part = DE_BVEC_par_chunk(_job, first, n);
+    if (cancels && part)
+      atomic_store_explicit(&_job->cancel, true, memory_order_relaxed);
+    sum += part;
+  }
+  if (sum)
+    atomic_fetch_add_explicit(&_job->result, sum, memory_order_relaxed);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 *DE_BVEC_par_worker(u0 *const _arg) {
+  DE_BVEC_par_pool *const pool = (DE_BVEC_par_pool *)_arg;
+  u64 seen = 0;
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (!pool->stop && pool->generation == seen)
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    if (pool->stop)
+      break;
+    seen = pool->generation;
+    DE_BVEC_par_job *const job = pool->job;
+    pthread_mutex_unlock(&pool->lock);
+    DE_BVEC_par_work(job);
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->pending == 0)
+      pthread_cond_signal(&pool->done);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+/* runs _job on the pool and the calling thread, returns its result */
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_par_run(DE_BVEC_par_job *const _job) {
+  DE_BVEC_par_pool *const pool = &DE_BVEC_par;
+  atomic_init(&_job->next, 0);
+  atomic_init(&_job->result, 0);
+  atomic_init(&_job->cancel, false);
+
+  pthread_mutex_lock(&pool->submit);
+  pthread_mutex_lock(&pool->lock);
+  pool->job = _job;
+  pool->pending = pool->worker_count;
+  ++pool->generation;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+
+  DE_BVEC_par_work(_job);
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->pending)
+    pthread_cond_wait(&pool->done, &pool->lock);
+  pool->job = NULL;
+  pthread_mutex_unlock(&pool->lock);
+  pthread_mutex_unlock(&pool->submit);
+  return atomic_load_explicit(&_job->result, memory_order_relaxed);
+}
+
+/* whether a mask of _bits bits is worth waking the pool for */
+DE_CONTAINER_BITMASK_INTERNAL bool DE_BVEC_par_enabled(const usize _bits) {
+  return DE_BVEC_par.worker_count != 0 && _bits >= DE_BVEC_par.threshold;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_par_apply(const DE_BVEC_par_op _op, mblk_t *const _dst,
+                  const mblk_t *const _src, const usize _blocks,
+                  const mblk_t _value) {
+  DE_BVEC_par_job job = {
+      .dst = _dst, .src = _src, .blocks = _blocks, .value = _value,
+      .op = (u8)_op};
+  return DE_BVEC_par_run(&job);
+}
+
+/* ---- Pool ---- */
+DE_CONTAINER_BITMASK_INTERNAL usize DE_BVEC_par_cores(u0) {
+#if defined(_WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (usize)info.dwNumberOfProcessors;
+#else
+  const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  return cores > 0 ? (usize)cores : 1;
+#endif
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_par_init(const usize _threads) {
+  DE_BVEC_par_pool *const pool = &DE_BVEC_par;
+  const usize threads = _threads ? _threads : DE_BVEC_par_cores();
+  if (pool->workers || threads < 2)
+    return false;
+  pool->workers = (pthread_t *)malloc((threads - 1) * sizeof(pthread_t));
+  if (!pool->workers)
+    return false;
+  pool->stop = false;
+  pool->generation = 0;
+  usize started = 0;
+  while (started < threads - 1 &&
+         pthread_create(&pool->workers[started], NULL, DE_BVEC_par_worker,
+                        pool) == 0)
+    ++started;
+  pool->worker_count = started;
+  if (!started) {
+    free(pool->workers);
+    pool->workers = NULL;
+    return false;
+  }
+  return true;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_par_shutdown(u0) {
+  DE_BVEC_par_pool *const pool = &DE_BVEC_par;
+  if (!pool->workers)
+    return;
+  pthread_mutex_lock(&pool->submit);
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = true;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+  for (usize i = 0; i < pool->worker_count; ++i)
+    pthread_join(pool->workers[i], NULL);
+  free(pool->workers);
+  pool->workers = NULL;
+  pool->worker_count = 0;
+  pthread_mutex_unlock(&pool->submit);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize de_bvec_par_threads(u0) {
+  return DE_BVEC_par.worker_count + 1;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_par_set_threshold(const usize _bits) {
+  DE_BVEC_par.threshold = _bits;
+}
+
+/* ---- Bulk operations ---- */
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_par_clear(de_bvec *const _msk) {
+  if (!DE_BVEC_par_enabled(_msk->bits_amount)) {
+    de_bvec_clear(_msk);
+    return;
+  }
+  DE_BVEC_par_apply(DE_BVEC_PAR_SET, DE_BVEC_DATA(_msk), NULL,
+                    _msk->block_count, 0);
+  DE_BVEC_COUNT_SET(_msk, 0);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_par_fill(de_bvec *const _msk) {
+  if (!DE_BVEC_par_enabled(_msk->bits_amount)) {
+    de_bvec_fill(_msk);
+    return;
+  }
+  DE_BVEC_par_apply(DE_BVEC_PAR_SET, DE_BVEC_DATA(_msk), NULL,
+                    _msk->block_count, DE_BVEC_MBLK_FILLED);
+  DE_BVEC_trim(_msk);
+  DE_BVEC_COUNT_SET(_msk, _msk->bits_amount);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_par_and_msk(de_bvec *const _dst, const de_bvec *const _src) {
+  if (!DE_BVEC_par_enabled(_dst->bits_amount)) {
+    de_bvec_and_msk(_dst, _src);
+    return;
+  }
+  mblk_t *const dst = DE_BVEC_DATA(_dst);
+  const usize bl_amount = DE_BVEC_MIN_BLOCKS(_dst, _src);
+  DE_BVEC_par_apply(DE_BVEC_PAR_AND, dst, DE_BVEC_DATA(_src), bl_amount, 0);
+  DE_BVEC_par_apply(DE_BVEC_PAR_SET, dst + bl_amount, NULL,
+                    _dst->block_count - bl_amount, 0);
+  DE_BVEC_COUNT_INVALIDATE(_dst);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_par_or_msk(de_bvec *const _dst,
+                                                    const de_bvec *const _src) {
+  if (!DE_BVEC_par_enabled(_dst->bits_amount)) {
+    de_bvec_or_msk(_dst, _src);
+    return;
+  }
+  DE_BVEC_par_apply(DE_BVEC_PAR_OR, DE_BVEC_DATA(_dst), DE_BVEC_DATA(_src),
+                    DE_BVEC_MIN_BLOCKS(_dst, _src), 0);
+  DE_BVEC_trim(_dst);
+  DE_BVEC_COUNT_INVALIDATE(_dst);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_par_xor_msk(de_bvec *const _dst, const de_bvec *const _src) {
+  if (!DE_BVEC_par_enabled(_dst->bits_amount)) {
+    de_bvec_xor_msk(_dst, _src);
+    return;
+  }
+  DE_BVEC_par_apply(DE_BVEC_PAR_XOR, DE_BVEC_DATA(_dst), DE_BVEC_DATA(_src),
+                    DE_BVEC_MIN_BLOCKS(_dst, _src), 0);
+  DE_BVEC_trim(_dst);
+  DE_BVEC_COUNT_INVALIDATE(_dst);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_par_not(de_bvec *const _dst) {
+  if (!DE_BVEC_par_enabled(_dst->bits_amount)) {
+    de_bvec_not(_dst);
+    return;
+  }
+  DE_BVEC_par_apply(DE_BVEC_PAR_NOT, DE_BVEC_DATA(_dst), NULL,
+                    _dst->block_count, 0);
+  DE_BVEC_trim(_dst);
+  if (DE_BVEC_COUNT_KNOWN(_dst))
+    DE_BVEC_COUNT_SET(_dst, _dst->bits_amount - DE_BVEC_COUNT_GET(_dst));
+}
+
+/* ---- Queries ---- */
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_par_count(const de_bvec *const _msk) {
+  if (!DE_BVEC_par_enabled(_msk->bits_amount) || DE_BVEC_COUNT_KNOWN(_msk))
+    return de_bvec_count(_msk);
+  return DE_BVEC_par_apply(DE_BVEC_PAR_COUNT, NULL, DE_BVEC_DATA(_msk),
+                           _msk->block_count, 0);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_par_count_refresh(de_bvec *const _msk) {
+  const usize out = de_bvec_par_count(_msk);
+  DE_BVEC_COUNT_SET(_msk, out);
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_par_any(const de_bvec *const _msk) {
+  if (!DE_BVEC_par_enabled(_msk->bits_amount))
+    return de_bvec_any(_msk);
+  return DE_BVEC_par_apply(DE_BVEC_PAR_ANY, NULL, DE_BVEC_DATA(_msk),
+                           _msk->block_count, 0) != 0;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_par_all(const de_bvec *const _msk) {
+  if (!DE_BVEC_par_enabled(_msk->bits_amount) || !_msk->block_count)
+    return de_bvec_all(_msk);
+  /* the partial last block is checked here, the pool sees full blocks */
+  const usize full = _msk->block_count - 1;
+  const mblk_t *const blocks = DE_BVEC_DATA(_msk);
+  if ((~blocks[full] << (DE_BVEC_MBLK_BITS - _msk->last_block_bits_count)) !=
+      0)
+    return false;
+  return DE_BVEC_par_apply(DE_BVEC_PAR_ALL, NULL, blocks, full, 0) == 0;
+}
+
+#endif
+#endif
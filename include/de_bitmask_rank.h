@@ -0,0 +1,346 @@
+#ifndef DE_CONTAINER_BITMASK_RANK_HEADER
+#define DE_CONTAINER_BITMASK_RANK_HEADER
+
+/*
+  Succinct rank/select index over a de_bvec (rank9 layout).
+  To get function definitions include
+  `#define DE_CONTAINER_BITMASK_IMPLEMENTATION`
+  before including this file.
+*/
+
+#include <common.h>
+#include <de_bitmask.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+/* every n-th 1 bit remembers its superblock to narrow select's search */
+#ifndef DE_BVEC_RANK_SELECT_SAMPLE
+#define DE_BVEC_RANK_SELECT_SAMPLE 8192
+#endif
+
+// clang-format off
+
+/* ---- Struct ---- */
+/*
+  One superblock covers 8 blocks (512 bits) and stores two words:
+  the absolute amount of 1 bits before it, and seven 9-bit counts
+  relative to the superblock start for blocks 1..7.
+  A trailing sentinel superblock holds the total.
+*/
+typedef struct {
+  const de_bvec* msk;    /* indexed mask, must stay at the same address */
+  u64*   counts;         /* 2 words per superblock */
+  usize  super_count;    /* superblocks incl. the sentinel */
+  usize* select_hints;   /* superblock of every SAMPLE-th 1 bit */
+  usize  hint_count;
+  usize  ones;           /* total amount of 1 bits */
+  usize  bits_amount;    /* size of msk when the index was built */
+} de_bvec_rank;
+
+/* ---- Lifecycle ---- */
+
+/*
+builds a rank/select index over _msk.
+the index keeps a pointer to _msk, so it must outlive the index
+and must not be moved.
+*/
+DE_CONTAINER_BITMASK_API de_bvec_rank
+de_bvec_rank_create(
+  const de_bvec* const _msk
+);
+
+/*
+frees the index
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_rank_delete(
+  de_bvec_rank* const _rank
+);
+
+/*
+recomputes the whole index, needed after the bulk operations
+(and/or/xor/not/fill/clear) or a resize of the mask
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_rank_rebuild(
+  de_bvec_rank* const _rank
+);
+
+/*
+updates the index after bits in [_start_idx, _end_idx] changed
+(set/flip/set_range/...). only the touched superblocks are recounted,
+later superblocks are shifted by the delta.
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_rank_update(
+  de_bvec_rank* const _rank,
+  const usize   _start_idx,
+  const usize   _end_idx
+);
+
+/*
+returns if the index is valid (allocation worked)
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_rank_info_valid(
+  const de_bvec_rank* const _rank
+);
+
+/* ---- Queries ---- */
+
+/*
+returns the amount of 1 bits in [0, _idx). _idx may equal the mask size
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_rank1(
+  const de_bvec_rank* const _rank,
+  const usize   _idx
+);
+
+/*
+returns the amount of 0 bits in [0, _idx). _idx may equal the mask size
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_rank0(
+  const de_bvec_rank* const _rank,
+  const usize   _idx
+);
+
+/*
+returns the index of the _k-th 1 bit (0 based), or DE_BVEC_NPOS
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_select1(
+  const de_bvec_rank* const _rank,
+  const usize   _k
+);
+
+// clang-format on
+#pragma GCC diagnostic pop
+#endif /* DE_CONTAINER_BITMASK_RANK_HEADER */
+
+/* ---- Implementation Guard ---- */
+#if defined(DE_CONTAINER_BITMASK_IMPLEMENTATION)
+#ifndef DE_CONTAINER_BITMASK_RANK_IMPLEMENTATION_INTERNAL
+#define DE_CONTAINER_BITMASK_RANK_IMPLEMENTATION_INTERNAL
+
+#include <stdlib.h>
+
+#define DE_BVEC_RANK_SUPER_BLOCKS 8
+#define DE_BVEC_RANK_REL_BITS 9
+#define DE_BVEC_RANK_REL_MASK ((u64)0x1ff)
+
+/* relative count of block _j (0..7) inside its superblock */
+#define DE_BVEC_RANK_REL(_packed, _j)                                          \
+  ((_j) ? (usize)(((_packed) >> (((_j) - 1) * DE_BVEC_RANK_REL_BITS)) &        \
+                  DE_BVEC_RANK_REL_MASK)                                       \
+        : (usize)0)
+
+/* block _b of the mask with the bits past the end masked off */
+DE_CONTAINER_BITMASK_INTERNAL mblk_t
+DE_BVEC_rank_block(const de_bvec *const _msk, const usize _b) {
+  const mblk_t word = DE_BVEC_DATA(_msk)[_b];
+  if (_b + 1 == DE_BVEC_BLOCKS_USED(_msk) && _msk->last_block_bits_count &&
+      _msk->last_block_bits_count < DE_BVEC_MBLK_BITS)
+    return word & ~(DE_BVEC_MBLK_FILLED << _msk->last_block_bits_count);
+  return word;
+}
+
+/* position of the _r-th 1 bit inside _word */
+DE_CONTAINER_BITMASK_INTERNAL usize DE_BVEC_select_in_word(mblk_t _word,
+                                                           usize _r) {
+#ifdef __BMI2__
+  return (usize)__builtin_ctzll(_pdep_u64(DE_BVEC_ONE << _r, _word));
+#else
+  for (; _r; --_r)
+    _word &= _word - 1;
+  return (usize)__builtin_ctzll(_word);
+#endif
+}
+
+/* fills the counts of superblock _sb from _base, returns its 1 bits */
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_rank_fill_super(de_bvec_rank *const _rank, const usize _sb,
+                        const usize _base) {
+  const usize bcount = DE_BVEC_BLOCKS_USED(_rank->msk);
+  u64 packed = 0;
+  usize acc = 0;
+  for (usize j = 0; j < DE_BVEC_RANK_SUPER_BLOCKS; ++j) {
+    const usize b = _sb * DE_BVEC_RANK_SUPER_BLOCKS + j;
+    if (j)
+      packed |= (u64)acc << ((j - 1) * DE_BVEC_RANK_REL_BITS);
+    if (b < bcount)
+      acc += __builtin_popcountll(DE_BVEC_rank_block(_rank->msk, b));
+  }
+  _rank->counts[2 * _sb] = _base;
+  _rank->counts[2 * _sb + 1] = packed;
+  return acc;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_rank_fill_hints(de_bvec_rank *const _rank) {
+  usize sb = 0;
+  for (usize j = 0; j < _rank->hint_count; ++j) {
+    const usize k = j * DE_BVEC_RANK_SELECT_SAMPLE;
+    while (sb + 1 < _rank->super_count && _rank->counts[2 * (sb + 1)] <= k)
+      ++sb;
+    _rank->select_hints[j] = sb;
+  }
+}
+
+/* ---- Lifecycle ---- */
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_rank_rebuild(de_bvec_rank *const _rank) {
+  const de_bvec *const msk = _rank->msk;
+  const usize blocks = msk->bits_amount ? DE_BVEC_BLOCKS_USED(msk) : 0;
+  const usize supers =
+      (blocks + DE_BVEC_RANK_SUPER_BLOCKS - 1) / DE_BVEC_RANK_SUPER_BLOCKS + 1;
+  if (supers != _rank->super_count) {
+    free(_rank->counts);
+    _rank->counts = (u64 *)malloc(2 * supers * sizeof(u64));
+    _rank->super_count = _rank->counts ? supers : 0;
+  }
+  _rank->bits_amount = msk->bits_amount;
+  if (!_rank->counts)
+    return;
+
+  usize running = 0;
+  for (usize sb = 0; sb + 1 < supers; ++sb)
+    running += DE_BVEC_rank_fill_super(_rank, sb, running);
+  _rank->counts[2 * (supers - 1)] = running;
+  _rank->counts[2 * (supers - 1) + 1] = 0;
+  _rank->ones = running;
+
+  const usize hints = running / DE_BVEC_RANK_SELECT_SAMPLE + 1;
+  if (hints != _rank->hint_count) {
+    free(_rank->select_hints);
+    _rank->select_hints = (usize *)malloc(hints * sizeof(usize));
+    _rank->hint_count = _rank->select_hints ? hints : 0;
+  }
+  if (_rank->select_hints)
+    DE_BVEC_rank_fill_hints(_rank);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_rank
+de_bvec_rank_create(const de_bvec *const _msk) {
+  de_bvec_rank out = {.msk = _msk,
+                      .counts = NULL,
+                      .super_count = 0,
+                      .select_hints = NULL,
+                      .hint_count = 0,
+                      .ones = 0,
+                      .bits_amount = 0};
+  de_bvec_rank_rebuild(&out);
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_rank_delete(de_bvec_rank *const _rank) {
+  if (!_rank)
+    return;
+  free(_rank->counts);
+  free(_rank->select_hints);
+  *_rank = (de_bvec_rank){0};
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_rank_update(de_bvec_rank *const _rank,
+                                                     const usize _start_idx,
+                                                     const usize _end_idx) {
+  if (_rank->bits_amount != _rank->msk->bits_amount ||
+      !de_bvec_rank_info_valid(_rank)) {
+    de_bvec_rank_rebuild(_rank);
+    return;
+  }
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_start_idx <= _end_idx);
+  assert(_end_idx < _rank->bits_amount);
+#endif
+  const usize first =
+      DE_BVEC_GET_BLOCKS_INDEX(_start_idx) / DE_BVEC_RANK_SUPER_BLOCKS;
+  const usize last =
+      DE_BVEC_GET_BLOCKS_INDEX(_end_idx) / DE_BVEC_RANK_SUPER_BLOCKS;
+
+  usize running = _rank->counts[2 * first];
+  for (usize sb = first; sb <= last; ++sb)
+    running += DE_BVEC_rank_fill_super(_rank, sb, running);
+
+  /* shift everything behind the touched superblocks, incl. the sentinel */
+  const usize old = _rank->counts[2 * (last + 1)];
+  for (usize sb = last + 1; sb < _rank->super_count; ++sb)
+    _rank->counts[2 * sb] = _rank->counts[2 * sb] - old + running;
+  _rank->ones = _rank->counts[2 * (_rank->super_count - 1)];
+
+  const usize hints = _rank->ones / DE_BVEC_RANK_SELECT_SAMPLE + 1;
+  if (hints != _rank->hint_count) {
+    free(_rank->select_hints);
+    _rank->select_hints = (usize *)malloc(hints * sizeof(usize));
+    _rank->hint_count = _rank->select_hints ? hints : 0;
+  }
+  if (_rank->select_hints)
+    DE_BVEC_rank_fill_hints(_rank);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_rank_info_valid(const de_bvec_rank *const _rank) {
+  return _rank && _rank->msk && _rank->counts && _rank->select_hints;
+}
+
+/* ---- Queries ---- */
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_rank1(const de_bvec_rank *const _rank, const usize _idx) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_idx <= _rank->bits_amount);
+#endif
+  if (_idx >= _rank->bits_amount)
+    return _rank->ones;
+  const usize b = DE_BVEC_GET_BLOCKS_INDEX(_idx);
+  const usize sb = b / DE_BVEC_RANK_SUPER_BLOCKS;
+  const usize bit = _idx % DE_BVEC_MBLK_BITS;
+  return (usize)_rank->counts[2 * sb] +
+         DE_BVEC_RANK_REL(_rank->counts[2 * sb + 1],
+                          b % DE_BVEC_RANK_SUPER_BLOCKS) +
+         (usize)__builtin_popcountll(DE_BVEC_DATA(_rank->msk)[b] &
+                                     ((DE_BVEC_ONE << bit) - 1));
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_rank0(const de_bvec_rank *const _rank, const usize _idx) {
+  const usize idx = _idx < _rank->bits_amount ? _idx : _rank->bits_amount;
+  return idx - de_bvec_rank1(_rank, idx);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_select1(const de_bvec_rank *const _rank, const usize _k) {
+  if (_k >= _rank->ones)
+    return DE_BVEC_NPOS;
+
+  /* largest superblock in [lo, hi) whose absolute count is <= _k */
+  const usize h = _k / DE_BVEC_RANK_SELECT_SAMPLE;
+  usize lo = _rank->select_hints[h];
+  usize hi = h + 1 < _rank->hint_count ? _rank->select_hints[h + 1] + 1
+                                       : _rank->super_count - 1;
+  while (hi - lo > 1) {
+    const usize mid = lo + (hi - lo) / 2;
+    if (_rank->counts[2 * mid] <= _k)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  const usize r = _k - (usize)_rank->counts[2 * lo];
+  const u64 packed = _rank->counts[2 * lo + 1];
+  usize j = 1;
+  while (j < DE_BVEC_RANK_SUPER_BLOCKS && DE_BVEC_RANK_REL(packed, j) <= r)
+    ++j;
+  --j;
+
+  const usize b = lo * DE_BVEC_RANK_SUPER_BLOCKS + j;
+  return b * DE_BVEC_MBLK_BITS +
+         DE_BVEC_select_in_word(DE_BVEC_DATA(_rank->msk)[b],
+                                r - DE_BVEC_RANK_REL(packed, j));
+}
+
+#endif
+#endif
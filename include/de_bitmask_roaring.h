@@ -0,0 +1,1217 @@
+#ifndef DE_CONTAINER_BITMASK_ROARING_HEADER
+#define DE_CONTAINER_BITMASK_ROARING_HEADER
+
+/*
+  Roaring-style compressed bitvector.
+  The bit range is split into 64K-bit chunks, each chunk is stored as a
+  sorted u16 array, a dense bitmap or a list of runs, whichever is smaller.
+  To get function definitions include
+  `#define DE_CONTAINER_BITMASK_IMPLEMENTATION`
+  before including this file.
+*/
+
+#include <common.h>
+#include <de_bitmask.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+// clang-format off
+
+/* ---- Struct ---- */
+typedef enum {
+  DE_BVEC_ROARING_ARRAY = 0,  /* sorted u16 values, at most 4096 */
+  DE_BVEC_ROARING_BITMAP,     /* 1024 mblk_t, always 64K bits */
+  DE_BVEC_ROARING_RUN,        /* (start, length - 1) u16 pairs */
+} de_bvec_roaring_kind;
+
+typedef struct {
+  union {
+    u16*    values;  /* ARRAY */
+    mblk_t* bitmap;  /* BITMAP */
+    u16*    runs;    /* RUN */
+  } data;
+  u32 size;          /* values (ARRAY) or runs (RUN) in use */
+  u32 capacity;      /* allocated u16 elements for ARRAY / RUN */
+  u32 cardinality;   /* amount of 1 bits in the chunk */
+  u8  kind;          /* de_bvec_roaring_kind */
+} de_bvec_roaring_container;
+
+typedef struct {
+  u32*   keys;                          /* chunk index (bit >> 16), sorted */
+  de_bvec_roaring_container* containers;
+  usize  size;                          /* non-empty chunks */
+  usize  capacity;
+  usize  bits_amount;                   /* logical number of bits */
+} de_bvec_roaring;
+
+/* ---- Lifecycle ---- */
+
+/*
+create an empty compressed bitvector with _amount_bits bits.
+no chunk memory is allocated until bits are set.
+*/
+DE_CONTAINER_BITMASK_API de_bvec_roaring
+de_bvec_roaring_create(
+  const usize _amount_bits
+);
+
+/*
+resets all values and clears the struct
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_roaring_delete(
+  de_bvec_roaring* const _msk
+);
+
+/*
+deep copies _src into _dst
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_roaring_copy(
+  de_bvec_roaring* const       _dst,
+  const de_bvec_roaring* const _src
+);
+
+/*
+compresses a dense bitvector, each chunk gets its smallest container
+*/
+DE_CONTAINER_BITMASK_API de_bvec_roaring
+de_bvec_roaring_from_bvec(
+  const de_bvec* const _msk
+);
+
+/*
+expands into a dense bitvector of the same size
+*/
+DE_CONTAINER_BITMASK_API de_bvec
+de_bvec_roaring_to_bvec(
+  const de_bvec_roaring* const _msk
+);
+
+/*
+re-picks the smallest container for every chunk,
+turning long stretches of 1 bits into run containers
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_roaring_run_optimize(
+  de_bvec_roaring* const _msk
+);
+
+/* ---- Single-bit access ---- */
+
+/*
+return the state of the bit at the given index
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_roaring_get(
+  const de_bvec_roaring* const _msk,
+  const usize         _idx
+);
+
+/*
+sets the state of the bit at the given index
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_roaring_set(
+  de_bvec_roaring* const _msk,
+  const usize         _idx,
+  const bool          _value
+);
+
+/*
+sets the state of the bits in the range provided.
+fully covered chunks become a single run (or are dropped)
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_roaring_set_range(
+  de_bvec_roaring* const _msk,
+  const usize   _start_idx,
+  const usize   _end_idx,
+  const bool    _value
+);
+
+/* ---- Bulk operations ---- */
+
+/*
+clears all bits to 0, frees all chunks
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_roaring_clear(
+  de_bvec_roaring* const _msk
+);
+
+/*
+all bits from _dst are &= with the bits from _src
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_roaring_and_msk(
+  de_bvec_roaring* const       _dst,
+  const de_bvec_roaring* const _src
+);
+
+/*
+all bits from _dst are |= with the bits from _src
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_roaring_or_msk(
+  de_bvec_roaring* const       _dst,
+  const de_bvec_roaring* const _src
+);
+
+/*
+all bits from _dst are ^= with the bits from _src
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_roaring_xor_msk(
+  de_bvec_roaring* const       _dst,
+  const de_bvec_roaring* const _src
+);
+
+/* ---- Info / Introspection ---- */
+
+/*
+retuns the amount of available bits
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_roaring_info_size(
+  const de_bvec_roaring* const _msk
+);
+
+/*
+retuns if the struct is valid.
+a failed allocation frees all chunks and leaves an empty, invalid mask
+that ignores further edits until de_bvec_roaring_delete
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_roaring_info_valid(
+  const de_bvec_roaring* const _msk
+);
+
+/*
+returns the heap bytes used by the chunks and the chunk index
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_roaring_info_bytes(
+  const de_bvec_roaring* const _msk
+);
+
+/*
+returns true if any bit is 1
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_roaring_any(
+  const de_bvec_roaring* const _msk
+);
+
+/*
+returns amount of positive bits (1) in _msk
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_roaring_count(
+  const de_bvec_roaring* const _msk
+);
+
+// clang-format on
+#pragma GCC diagnostic pop
+#endif /* DE_CONTAINER_BITMASK_ROARING_HEADER */
+
+/* ---- Implementation Guard ---- */
+#if defined(DE_CONTAINER_BITMASK_IMPLEMENTATION)
+#ifndef DE_CONTAINER_BITMASK_ROARING_IMPLEMENTATION_INTERNAL
+#define DE_CONTAINER_BITMASK_ROARING_IMPLEMENTATION_INTERNAL
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DE_BVEC_ROAR_CHUNK_BITS ((usize)1 << 16)
+#define DE_BVEC_ROAR_CHUNK_BLOCKS (DE_BVEC_ROAR_CHUNK_BITS / DE_BVEC_MBLK_BITS)
+#define DE_BVEC_ROAR_ARRAY_MAX 4096
+#define DE_BVEC_ROAR_BITMAP_BYTES (DE_BVEC_ROAR_CHUNK_BLOCKS * sizeof(mblk_t))
+#define DE_BVEC_ROAR_KEY(idx) ((u32)((idx) >> 16))
+#define DE_BVEC_ROAR_LOW(idx) ((u32)((idx) & 0xffff))
+
+typedef enum {
+  DE_BVEC_ROAR_AND,
+  DE_BVEC_ROAR_OR,
+  DE_BVEC_ROAR_XOR,
+} DE_BVEC_roar_op;
+
+typedef de_bvec_roaring_container DE_BVEC_roar_cont;
+
+/* ---- Container helpers ---- */
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_roar_cont_free(DE_BVEC_roar_cont *_c) {
+  if (_c->kind == DE_BVEC_ROARING_BITMAP)
+    free(_c->data.bitmap);
+  else
+    free(_c->data.values);
+  *_c = (DE_BVEC_roar_cont){0};
+}
+
+/*
+makes room for _need u16 elements in an ARRAY / RUN container.
+on failure the container is left untouched and false is returned
+*/
+DE_CONTAINER_BITMASK_INTERNAL bool DE_BVEC_roar_cont_grow(DE_BVEC_roar_cont *_c,
+                                                          const u32 _need) {
+  if (_need <= _c->capacity)
+    return true;
+  u32 cap = _c->capacity ? _c->capacity * 2 : 8;
+  while (cap < _need)
+    cap *= 2;
+  u16 *const values = (u16 *)realloc(_c->data.values, cap * sizeof(u16));
+  if (!values)
+    return false;
+  _c->data.values = values;
+  _c->capacity = cap;
+  return true;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u32 DE_BVEC_roar_lower_bound(const u16 *_vals,
+                                                           const u32 _size,
+                                                           const u32 _v) {
+  u32 lo = 0, hi = _size;
+  while (lo < hi) {
+    const u32 mid = lo + (hi - lo) / 2;
+    if (_vals[mid] < _v)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* index of the last run starting at or before _v, or DE_BVEC_NPOS */
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_roar_run_find(const DE_BVEC_roar_cont *_c, const u32 _v) {
+  usize lo = 0, hi = _c->size;
+  while (lo < hi) {
+    const usize mid = lo + (hi - lo) / 2;
+    if (_c->data.runs[2 * mid] <= _v)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo ? lo - 1 : DE_BVEC_NPOS;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_roar_run_is_full(const DE_BVEC_roar_cont *_c) {
+  return _c->kind == DE_BVEC_ROARING_RUN &&
+         _c->cardinality == DE_BVEC_ROAR_CHUNK_BITS;
+}
+
+/* sets (or clears) [_first, _last] inside a chunk bitmap */
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_roar_bitmap_range(mblk_t *_bm,
+                                                           const u32 _first,
+                                                           const u32 _last,
+                                                           const bool _value) {
+  const u32 wf = _first / DE_BVEC_MBLK_BITS, wl = _last / DE_BVEC_MBLK_BITS;
+  for (u32 w = wf; w <= wl; ++w) {
+    mblk_t m = DE_BVEC_MBLK_FILLED;
+    if (w == wf)
+      m &= DE_BVEC_MBLK_FILLED << (_first % DE_BVEC_MBLK_BITS);
+    if (w == wl)
+      m &= DE_BVEC_MBLK_FILLED >>
+           (DE_BVEC_MBLK_BITS - 1 - _last % DE_BVEC_MBLK_BITS);
+    if (_value)
+      _bm[w] |= m;
+    else
+      _bm[w] &= ~m;
+  }
+}
+
+/* writes the chunk as a dense bitmap into _bm */
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_roar_fill_bitmap(const DE_BVEC_roar_cont *_c, mblk_t *_bm) {
+  if (_c->kind == DE_BVEC_ROARING_BITMAP) {
+    memcpy(_bm, _c->data.bitmap, DE_BVEC_ROAR_BITMAP_BYTES);
+    return;
+  }
+  memset(_bm, 0, DE_BVEC_ROAR_BITMAP_BYTES);
+  if (_c->kind == DE_BVEC_ROARING_ARRAY) {
+    for (u32 i = 0; i < _c->size; ++i)
+      _bm[_c->data.values[i] / DE_BVEC_MBLK_BITS] |=
+          DE_BVEC_ONE << (_c->data.values[i] % DE_BVEC_MBLK_BITS);
+  } else {
+    for (u32 i = 0; i < _c->size; ++i)
+      DE_BVEC_roar_bitmap_range(_bm, _c->data.runs[2 * i],
+                                (u32)_c->data.runs[2 * i] +
+                                    _c->data.runs[2 * i + 1],
+                                true);
+  }
+}
+
+/*
+the container conversions return false and keep the old container when
+the allocation fails, every kind holds any set of values correctly
+*/
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_roar_to_bitmap(DE_BVEC_roar_cont *_c) {
+  if (_c->kind == DE_BVEC_ROARING_BITMAP)
+    return true;
+  mblk_t *bm = (mblk_t *)malloc(DE_BVEC_ROAR_BITMAP_BYTES);
+  if (!bm)
+    return false;
+  DE_BVEC_roar_fill_bitmap(_c, bm);
+  const u32 card = _c->cardinality;
+  DE_BVEC_roar_cont_free(_c);
+  _c->data.bitmap = bm;
+  _c->cardinality = card;
+  _c->kind = DE_BVEC_ROARING_BITMAP;
+  return true;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_roar_to_array(DE_BVEC_roar_cont *_c) {
+  if (_c->kind == DE_BVEC_ROARING_ARRAY)
+    return true;
+  const u32 card = _c->cardinality;
+  u16 *vals = (u16 *)malloc((card ? card : 1) * sizeof(u16));
+  if (!vals)
+    return false;
+  u32 n = 0;
+  if (_c->kind == DE_BVEC_ROARING_BITMAP) {
+    for (u32 w = 0; w < DE_BVEC_ROAR_CHUNK_BLOCKS; ++w) {
+      for (mblk_t word = _c->data.bitmap[w]; word; word &= word - 1)
+        vals[n++] = (u16)(w * DE_BVEC_MBLK_BITS + __builtin_ctzll(word));
+    }
+  } else {
+    for (u32 i = 0; i < _c->size; ++i) {
+      const u32 start = _c->data.runs[2 * i];
+      for (u32 v = start; v <= start + _c->data.runs[2 * i + 1]; ++v)
+        vals[n++] = (u16)v;
+    }
+  }
+  DE_BVEC_roar_cont_free(_c);
+  _c->data.values = vals;
+  _c->size = _c->capacity = _c->cardinality = card;
+  _c->kind = DE_BVEC_ROARING_ARRAY;
+  return true;
+}
+
+/* amount of runs of 1 bits in the container */
+DE_CONTAINER_BITMASK_INTERNAL u32
+DE_BVEC_roar_count_runs(const DE_BVEC_roar_cont *_c) {
+  if (_c->kind == DE_BVEC_ROARING_RUN)
+    return _c->size;
+  u32 runs = 0;
+  if (_c->kind == DE_BVEC_ROARING_ARRAY) {
+    for (u32 i = 0; i < _c->size; ++i)
+      runs += !i || _c->data.values[i] != _c->data.values[i - 1] + 1;
+    return runs;
+  }
+  mblk_t carry = 0;
+  for (u32 w = 0; w < DE_BVEC_ROAR_CHUNK_BLOCKS; ++w) {
+    const mblk_t word = _c->data.bitmap[w];
+    runs += __builtin_popcountll(word & ~((word << 1) | carry));
+    carry = word >> (DE_BVEC_MBLK_BITS - 1);
+  }
+  return runs;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool DE_BVEC_roar_to_run(DE_BVEC_roar_cont *_c) {
+  if (_c->kind == DE_BVEC_ROARING_RUN)
+    return true;
+  const u32 nruns = DE_BVEC_roar_count_runs(_c);
+  u16 *runs = (u16 *)malloc((nruns ? nruns : 1) * 2 * sizeof(u16));
+  if (!runs)
+    return false;
+  u32 k = 0;
+  if (_c->kind == DE_BVEC_ROARING_ARRAY) {
+    for (u32 i = 0; i < _c->size; ++i) {
+      const u16 v = _c->data.values[i];
+      if (k && (u32)runs[2 * (k - 1)] + runs[2 * (k - 1) + 1] + 1 == v) {
+        ++runs[2 * (k - 1) + 1];
+      } else {
+        runs[2 * k] = v;
+        runs[2 * k + 1] = 0;
+        ++k;
+      }
+    }
+  } else {
+    const mblk_t *bm = _c->data.bitmap;
+    /* run starts: 1 bits whose lower neighbour is 0 */
+    for (u32 w = 0; w < DE_BVEC_ROAR_CHUNK_BLOCKS; ++w) {
+      const mblk_t prev = w ? bm[w - 1] >> (DE_BVEC_MBLK_BITS - 1) : 0;
+      for (mblk_t s = bm[w] & ~((bm[w] << 1) | prev); s; s &= s - 1)
+        runs[2 * k++] = (u16)(w * DE_BVEC_MBLK_BITS + __builtin_ctzll(s));
+    }
+    /* run ends: 1 bits whose upper neighbour is 0 */
+    k = 0;
+    for (u32 w = 0; w < DE_BVEC_ROAR_CHUNK_BLOCKS; ++w) {
+      const mblk_t next = w + 1 < DE_BVEC_ROAR_CHUNK_BLOCKS ? bm[w + 1] & 1 : 0;
+      const mblk_t ends =
+          bm[w] & ~((bm[w] >> 1) | (next << (DE_BVEC_MBLK_BITS - 1)));
+      for (mblk_t e = ends; e; e &= e - 1, ++k)
+        runs[2 * k + 1] = (u16)(w * DE_BVEC_MBLK_BITS + __builtin_ctzll(e) -
+                                runs[2 * k]);
+    }
+  }
+  const u32 card = _c->cardinality;
+  DE_BVEC_roar_cont_free(_c);
+  _c->data.runs = runs;
+  _c->size = nruns;
+  _c->capacity = (nruns ? nruns : 1) * 2;
+  _c->cardinality = card;
+  _c->kind = DE_BVEC_ROARING_RUN;
+  return true;
+}
+
+/* picks the smallest of array / bitmap / run, best effort on failure */
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_roar_optimize(DE_BVEC_roar_cont *_c) {
+  const usize run_bytes = (usize)DE_BVEC_roar_count_runs(_c) * 2 * sizeof(u16);
+  const usize other_bytes = _c->cardinality <= DE_BVEC_ROAR_ARRAY_MAX
+                                ? _c->cardinality * sizeof(u16)
+                                : DE_BVEC_ROAR_BITMAP_BYTES;
+  if (run_bytes < other_bytes)
+    DE_BVEC_roar_to_run(_c);
+  else if (_c->cardinality <= DE_BVEC_ROAR_ARRAY_MAX)
+    DE_BVEC_roar_to_array(_c);
+  else
+    DE_BVEC_roar_to_bitmap(_c);
+}
+
+/* keeps the cheap invariants after a modification (no run counting) */
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_roar_shrink(DE_BVEC_roar_cont *_c) {
+  switch (_c->kind) {
+  case DE_BVEC_ROARING_ARRAY:
+    if (_c->cardinality > DE_BVEC_ROAR_ARRAY_MAX)
+      DE_BVEC_roar_to_bitmap(_c);
+    break;
+  case DE_BVEC_ROARING_BITMAP:
+    if (_c->cardinality <= DE_BVEC_ROAR_ARRAY_MAX)
+      DE_BVEC_roar_to_array(_c);
+    break;
+  default: {
+    const usize other_bytes = _c->cardinality <= DE_BVEC_ROAR_ARRAY_MAX
+                                  ? _c->cardinality * sizeof(u16)
+                                  : DE_BVEC_ROAR_BITMAP_BYTES;
+    if ((usize)_c->size * 2 * sizeof(u16) > other_bytes) {
+      if (_c->cardinality <= DE_BVEC_ROAR_ARRAY_MAX)
+        DE_BVEC_roar_to_array(_c);
+      else
+        DE_BVEC_roar_to_bitmap(_c);
+    }
+  } break;
+  }
+}
+
+/* on failure _dst is left as an empty container */
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_roar_cont_copy(DE_BVEC_roar_cont *_dst, const DE_BVEC_roar_cont *_src) {
+  *_dst = *_src;
+  if (_src->kind == DE_BVEC_ROARING_BITMAP) {
+    _dst->data.bitmap = (mblk_t *)malloc(DE_BVEC_ROAR_BITMAP_BYTES);
+    if (_dst->data.bitmap)
+      memcpy(_dst->data.bitmap, _src->data.bitmap, DE_BVEC_ROAR_BITMAP_BYTES);
+  } else {
+    const u32 elems =
+        _src->kind == DE_BVEC_ROARING_RUN ? 2 * _src->size : _src->size;
+    _dst->capacity = elems ? elems : 1;
+    _dst->data.values = (u16 *)malloc(_dst->capacity * sizeof(u16));
+    if (_dst->data.values)
+      memcpy(_dst->data.values, _src->data.values, elems * sizeof(u16));
+  }
+  if (!_dst->data.values) {
+    *_dst = (DE_BVEC_roar_cont){0};
+    return false;
+  }
+  return true;
+}
+
+/* on failure _c is left untouched */
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_roar_make_full(DE_BVEC_roar_cont *_c) {
+  u16 *const runs = (u16 *)malloc(2 * sizeof(u16));
+  if (!runs)
+    return false;
+  DE_BVEC_roar_cont_free(_c);
+  _c->data.runs = runs;
+  _c->data.runs[0] = 0;
+  _c->data.runs[1] = (u16)(DE_BVEC_ROAR_CHUNK_BITS - 1);
+  _c->size = 1;
+  _c->capacity = 2;
+  _c->cardinality = DE_BVEC_ROAR_CHUNK_BITS;
+  _c->kind = DE_BVEC_ROARING_RUN;
+  return true;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_roar_cont_get(const DE_BVEC_roar_cont *_c, const u32 _v) {
+  switch (_c->kind) {
+  case DE_BVEC_ROARING_ARRAY: {
+    const u32 i = DE_BVEC_roar_lower_bound(_c->data.values, _c->size, _v);
+    return i < _c->size && _c->data.values[i] == _v;
+  }
+  case DE_BVEC_ROARING_BITMAP:
+    return DE_BVEC_ONE & (_c->data.bitmap[_v / DE_BVEC_MBLK_BITS] >>
+                          (_v % DE_BVEC_MBLK_BITS));
+  default: {
+    const usize i = DE_BVEC_roar_run_find(_c, _v);
+    return i != DE_BVEC_NPOS &&
+           _v - _c->data.runs[2 * i] <= _c->data.runs[2 * i + 1];
+  }
+  }
+}
+
+/* inserts run _i as [_start, _start + _len] */
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_roar_run_insert(DE_BVEC_roar_cont *_c, const usize _i,
+                        const u32 _start, const u32 _len) {
+  if (!DE_BVEC_roar_cont_grow(_c, 2 * (_c->size + 1)))
+    return false;
+  memmove(_c->data.runs + 2 * (_i + 1), _c->data.runs + 2 * _i,
+          2 * (_c->size - _i) * sizeof(u16));
+  _c->data.runs[2 * _i] = (u16)_start;
+  _c->data.runs[2 * _i + 1] = (u16)_len;
+  ++_c->size;
+  return true;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_roar_run_erase(DE_BVEC_roar_cont *_c,
+                                                        const usize _i) {
+  memmove(_c->data.runs + 2 * _i, _c->data.runs + 2 * (_i + 1),
+          2 * (_c->size - _i - 1) * sizeof(u16));
+  --_c->size;
+}
+
+/* single bit edit of a run container, merging / splitting runs */
+DE_CONTAINER_BITMASK_INTERNAL bool DE_BVEC_roar_run_set(DE_BVEC_roar_cont *_c,
+                                                        const u32 _v,
+                                                        const bool _value) {
+  u16 *runs;
+  const usize i = DE_BVEC_roar_run_find(_c, _v);
+  const bool inside = i != DE_BVEC_NPOS &&
+                      _v - _c->data.runs[2 * i] <= _c->data.runs[2 * i + 1];
+  if (inside == _value)
+    return true;
+
+  if (_value) {
+    const usize next = i == DE_BVEC_NPOS ? 0 : i + 1;
+    runs = _c->data.runs;
+    const bool join_prev =
+        i != DE_BVEC_NPOS && (u32)runs[2 * i] + runs[2 * i + 1] + 1 == _v;
+    const bool join_next = next < _c->size && runs[2 * next] == _v + 1;
+    if (join_prev && join_next) {
+      runs[2 * i + 1] =
+          (u16)((u32)runs[2 * next] + runs[2 * next + 1] - runs[2 * i]);
+      DE_BVEC_roar_run_erase(_c, next);
+    } else if (join_prev) {
+      ++runs[2 * i + 1];
+    } else if (join_next) {
+      --runs[2 * next];
+      ++runs[2 * next + 1];
+    } else if (!DE_BVEC_roar_run_insert(_c, next, _v, 0)) {
+      return false;
+    }
+    ++_c->cardinality;
+  } else {
+    runs = _c->data.runs;
+    const u32 start = runs[2 * i];
+    const u32 end = start + runs[2 * i + 1];
+    if (start == end) {
+      DE_BVEC_roar_run_erase(_c, i);
+    } else if (_v == start) {
+      ++runs[2 * i];
+      --runs[2 * i + 1];
+    } else if (_v == end) {
+      --runs[2 * i + 1];
+    } else {
+      /* insert the upper half first, a failed grow leaves run i intact */
+      if (!DE_BVEC_roar_run_insert(_c, i + 1, _v + 1, end - _v - 1))
+        return false;
+      _c->data.runs[2 * i + 1] = (u16)(_v - 1 - start);
+    }
+    --_c->cardinality;
+  }
+  return true;
+}
+
+/* returns false if the container could not grow, it is left unchanged */
+DE_CONTAINER_BITMASK_INTERNAL bool DE_BVEC_roar_cont_set(DE_BVEC_roar_cont *_c,
+                                                         const u32 _v,
+                                                         const bool _value) {
+  switch (_c->kind) {
+  case DE_BVEC_ROARING_ARRAY: {
+    const u32 i = DE_BVEC_roar_lower_bound(_c->data.values, _c->size, _v);
+    const bool present = i < _c->size && _c->data.values[i] == _v;
+    if (present == _value)
+      return true;
+    if (_value) {
+      if (!DE_BVEC_roar_cont_grow(_c, _c->size + 1))
+        return false;
+      memmove(_c->data.values + i + 1, _c->data.values + i,
+              (_c->size - i) * sizeof(u16));
+      _c->data.values[i] = (u16)_v;
+      ++_c->size;
+    } else {
+      memmove(_c->data.values + i, _c->data.values + i + 1,
+              (_c->size - i - 1) * sizeof(u16));
+      --_c->size;
+    }
+    _c->cardinality = _c->size;
+  } break;
+  case DE_BVEC_ROARING_BITMAP: {
+    mblk_t *const word = &_c->data.bitmap[_v / DE_BVEC_MBLK_BITS];
+    const mblk_t bit = DE_BVEC_ONE << (_v % DE_BVEC_MBLK_BITS);
+    if (!(*word & bit) == !_value)
+      return true;
+    *word ^= bit;
+    _c->cardinality += _value ? 1 : (u32)-1;
+  } break;
+  default:
+    if (!DE_BVEC_roar_run_set(_c, _v, _value))
+      return false;
+    break;
+  }
+  DE_BVEC_roar_shrink(_c);
+  return true;
+}
+
+/* merges two sorted arrays into _dst, which is kept on failure */
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_roar_array_op(DE_BVEC_roar_cont *_dst, const DE_BVEC_roar_cont *_src,
+                      const DE_BVEC_roar_op _op) {
+  const u16 *a = _dst->data.values, *b = _src->data.values;
+  const u32 na = _dst->size, nb = _src->size;
+  u16 *out = (u16 *)malloc((na + nb ? na + nb : 1) * sizeof(u16));
+  if (!out)
+    return false;
+  u32 i = 0, j = 0, n = 0;
+  while (i < na && j < nb) {
+    if (a[i] < b[j]) {
+      if (_op != DE_BVEC_ROAR_AND)
+        out[n++] = a[i];
+      ++i;
+    } else if (b[j] < a[i]) {
+      if (_op != DE_BVEC_ROAR_AND)
+        out[n++] = b[j];
+      ++j;
+    } else {
+      if (_op != DE_BVEC_ROAR_XOR)
+        out[n++] = a[i];
+      ++i, ++j;
+    }
+  }
+  if (_op != DE_BVEC_ROAR_AND) {
+    while (i < na)
+      out[n++] = a[i++];
+    while (j < nb)
+      out[n++] = b[j++];
+  }
+  free(_dst->data.values);
+  _dst->data.values = out;
+  _dst->size = _dst->cardinality = n;
+  _dst->capacity = na + nb ? na + nb : 1;
+  return true;
+}
+
+/*
+_dst op= _src for one chunk, _dst may become empty.
+returns false on a failed allocation, _dst then still owns valid memory
+*/
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_roar_cont_op(DE_BVEC_roar_cont *_dst, const DE_BVEC_roar_cont *_src,
+                     const DE_BVEC_roar_op _op) {
+  /* full chunks make and/or trivial */
+  if (DE_BVEC_roar_run_is_full(_src) && _op != DE_BVEC_ROAR_XOR)
+    return _op != DE_BVEC_ROAR_OR || DE_BVEC_roar_make_full(_dst);
+  if (DE_BVEC_roar_run_is_full(_dst) && _op != DE_BVEC_ROAR_XOR) {
+    if (_op == DE_BVEC_ROAR_AND) {
+      DE_BVEC_roar_cont_free(_dst);
+      return DE_BVEC_roar_cont_copy(_dst, _src);
+    }
+    return true;
+  }
+
+  const bool had_runs = _dst->kind == DE_BVEC_ROARING_RUN ||
+                        _src->kind == DE_BVEC_ROARING_RUN;
+  if (_dst->kind == DE_BVEC_ROARING_ARRAY &&
+      _src->kind == DE_BVEC_ROARING_ARRAY) {
+    if (!DE_BVEC_roar_array_op(_dst, _src, _op))
+      return false;
+  } else if (_dst->kind == DE_BVEC_ROARING_ARRAY && _op == DE_BVEC_ROAR_AND) {
+    /* the result is a subset of the array, probe instead of expanding */
+    u32 n = 0;
+    for (u32 i = 0; i < _dst->size; ++i) {
+      if (DE_BVEC_roar_cont_get(_src, _dst->data.values[i]))
+        _dst->data.values[n++] = _dst->data.values[i];
+    }
+    _dst->size = _dst->cardinality = n;
+  } else {
+    mblk_t tmp[DE_BVEC_ROAR_CHUNK_BLOCKS];
+    if (!DE_BVEC_roar_to_bitmap(_dst))
+      return false;
+    DE_BVEC_roar_fill_bitmap(_src, tmp);
+    switch (_op) {
+    case DE_BVEC_ROAR_AND:
+      DE_BVEC_kernels.and_blocks(_dst->data.bitmap, tmp,
+                                 DE_BVEC_ROAR_CHUNK_BLOCKS);
+      break;
+    case DE_BVEC_ROAR_OR:
+      DE_BVEC_kernels.or_blocks(_dst->data.bitmap, tmp,
+                                DE_BVEC_ROAR_CHUNK_BLOCKS);
+      break;
+    default:
+      DE_BVEC_kernels.xor_blocks(_dst->data.bitmap, tmp,
+                                 DE_BVEC_ROAR_CHUNK_BLOCKS);
+      break;
+    }
+    _dst->cardinality = (u32)DE_BVEC_kernels.count_blocks(
+        _dst->data.bitmap, DE_BVEC_ROAR_CHUNK_BLOCKS);
+  }
+  /* run inputs usually give run-friendly results, keep them compressed */
+  if (had_runs && _dst->cardinality)
+    DE_BVEC_roar_optimize(_dst);
+  else
+    DE_BVEC_roar_shrink(_dst);
+  return true;
+}
+
+/* clears the values at or above _limit, _c may become empty */
+DE_CONTAINER_BITMASK_INTERNAL bool DE_BVEC_roar_cont_clip(DE_BVEC_roar_cont *_c,
+                                                          const u32 _limit) {
+  if (!_c->cardinality || _limit >= DE_BVEC_ROAR_CHUNK_BITS)
+    return true;
+  if (_c->kind == DE_BVEC_ROARING_ARRAY) {
+    _c->size = _c->cardinality =
+        DE_BVEC_roar_lower_bound(_c->data.values, _c->size, _limit);
+    return true;
+  }
+  if (_c->kind == DE_BVEC_ROARING_RUN &&
+      (u32)_c->data.runs[2 * (_c->size - 1)] +
+              _c->data.runs[2 * (_c->size - 1) + 1] <
+          _limit)
+    return true;
+  if (!DE_BVEC_roar_to_bitmap(_c))
+    return false;
+  DE_BVEC_roar_bitmap_range(_c->data.bitmap, _limit,
+                            (u32)(DE_BVEC_ROAR_CHUNK_BITS - 1), false);
+  _c->cardinality = (u32)DE_BVEC_kernels.count_blocks(
+      _c->data.bitmap, DE_BVEC_ROAR_CHUNK_BLOCKS);
+  if (_c->cardinality)
+    DE_BVEC_roar_optimize(_c);
+  return true;
+}
+
+/* ---- Chunk index helpers ---- */
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_roar_find(const de_bvec_roaring *const _msk, const u32 _key) {
+  usize lo = 0, hi = _msk->size;
+  while (lo < hi) {
+    const usize mid = lo + (hi - lo) / 2;
+    if (_msk->keys[mid] < _key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/*
+frees all chunks and leaves the invalid state de_bvec_roaring_info_valid
+reports: no chunk index but a non zero capacity, like a core de_bvec with
+NULL blocks
+*/
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_roar_fail(de_bvec_roaring *const _msk) {
+  for (usize i = 0; i < _msk->size; ++i)
+    DE_BVEC_roar_cont_free(&_msk->containers[i]);
+  free(_msk->keys);
+  free(_msk->containers);
+  _msk->keys = NULL;
+  _msk->containers = NULL;
+  _msk->size = 0;
+  _msk->capacity = _msk->capacity ? _msk->capacity : 1;
+}
+
+/*
+inserts an empty array container for _key at _pos.
+returns NULL if the chunk index could not grow, _msk is unchanged then
+*/
+DE_CONTAINER_BITMASK_INTERNAL DE_BVEC_roar_cont *
+DE_BVEC_roar_insert_at(de_bvec_roaring *const _msk, const usize _pos,
+                       const u32 _key) {
+  if (!de_bvec_roaring_info_valid(_msk))
+    return NULL;
+  if (_msk->size == _msk->capacity) {
+    const usize cap = _msk->capacity ? _msk->capacity * 2 : 4;
+    u32 *const keys = (u32 *)realloc(_msk->keys, cap * sizeof(u32));
+    if (!keys)
+      return NULL;
+    /* a larger keys array is harmless if the second realloc fails */
+    _msk->keys = keys;
+    DE_BVEC_roar_cont *const conts = (DE_BVEC_roar_cont *)realloc(
+        _msk->containers, cap * sizeof(DE_BVEC_roar_cont));
+    if (!conts)
+      return NULL;
+    _msk->containers = conts;
+    _msk->capacity = cap;
+  }
+  memmove(_msk->keys + _pos + 1, _msk->keys + _pos,
+          (_msk->size - _pos) * sizeof(u32));
+  memmove(_msk->containers + _pos + 1, _msk->containers + _pos,
+          (_msk->size - _pos) * sizeof(DE_BVEC_roar_cont));
+  _msk->keys[_pos] = _key;
+  _msk->containers[_pos] = (DE_BVEC_roar_cont){0};
+  _msk->containers[_pos].kind = DE_BVEC_ROARING_ARRAY;
+  ++_msk->size;
+  return &_msk->containers[_pos];
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_roar_remove_at(de_bvec_roaring *const _msk, const usize _pos) {
+  DE_BVEC_roar_cont_free(&_msk->containers[_pos]);
+  memmove(_msk->keys + _pos, _msk->keys + _pos + 1,
+          (_msk->size - _pos - 1) * sizeof(u32));
+  memmove(_msk->containers + _pos, _msk->containers + _pos + 1,
+          (_msk->size - _pos - 1) * sizeof(DE_BVEC_roar_cont));
+  --_msk->size;
+}
+
+/* ---- Lifecycle ---- */
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_roaring
+de_bvec_roaring_create(const usize _amount_bits) {
+  return (de_bvec_roaring){.keys = NULL,
+                           .containers = NULL,
+                           .size = 0,
+                           .capacity = 0,
+                           .bits_amount = _amount_bits};
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_roaring_clear(de_bvec_roaring *const _msk) {
+  for (usize i = 0; i < _msk->size; ++i)
+    DE_BVEC_roar_cont_free(&_msk->containers[i]);
+  _msk->size = 0;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_roaring_delete(de_bvec_roaring *const _msk) {
+  if (!_msk)
+    return;
+  de_bvec_roaring_clear(_msk);
+  free(_msk->keys);
+  free(_msk->containers);
+  *_msk = de_bvec_roaring_create(0);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_roaring_copy(de_bvec_roaring *const _dst,
+                     const de_bvec_roaring *const _src) {
+  if (_dst == _src)
+    return;
+  de_bvec_roaring_delete(_dst);
+  _dst->bits_amount = _src->bits_amount;
+  if (!de_bvec_roaring_info_valid(_src)) {
+    DE_BVEC_roar_fail(_dst);
+    return;
+  }
+  if (!_src->size)
+    return;
+  _dst->keys = (u32 *)malloc(_src->size * sizeof(u32));
+  _dst->containers =
+      (DE_BVEC_roar_cont *)malloc(_src->size * sizeof(DE_BVEC_roar_cont));
+  _dst->capacity = _src->size;
+  if (!_dst->keys || !_dst->containers) {
+    DE_BVEC_roar_fail(_dst);
+    return;
+  }
+  memcpy(_dst->keys, _src->keys, _src->size * sizeof(u32));
+  for (; _dst->size < _src->size; ++_dst->size) {
+    if (!DE_BVEC_roar_cont_copy(&_dst->containers[_dst->size],
+                                &_src->containers[_dst->size])) {
+      DE_BVEC_roar_fail(_dst);
+      return;
+    }
+  }
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_roaring
+de_bvec_roaring_from_bvec(const de_bvec *const _msk) {
+  de_bvec_roaring out = de_bvec_roaring_create(_msk->bits_amount);
+  if (!_msk->bits_amount)
+    return out;
+  const mblk_t *const blocks = DE_BVEC_DATA(_msk);
+  const usize bcount = DE_BVEC_BLOCKS_USED(_msk);
+  for (usize base = 0; base < bcount; base += DE_BVEC_ROAR_CHUNK_BLOCKS) {
+    const usize n = bcount - base < DE_BVEC_ROAR_CHUNK_BLOCKS
+                        ? bcount - base
+                        : DE_BVEC_ROAR_CHUNK_BLOCKS;
+    if (!DE_BVEC_kernels.count_blocks(blocks + base, n))
+      continue;
+    DE_BVEC_roar_cont *c = DE_BVEC_roar_insert_at(
+        &out, out.size, (u32)(base / DE_BVEC_ROAR_CHUNK_BLOCKS));
+    mblk_t *const bm =
+        c ? (mblk_t *)calloc(DE_BVEC_ROAR_CHUNK_BLOCKS, sizeof(mblk_t)) : NULL;
+    if (!bm) {
+      DE_BVEC_roar_fail(&out);
+      return out;
+    }
+    c->kind = DE_BVEC_ROARING_BITMAP;
+    c->data.bitmap = bm;
+    memcpy(c->data.bitmap, blocks + base, n * sizeof(mblk_t));
+    /* drop bits past the logical end */
+    if (base + n == bcount && _msk->last_block_bits_count < DE_BVEC_MBLK_BITS)
+      c->data.bitmap[n - 1] &=
+          ~(DE_BVEC_MBLK_FILLED << _msk->last_block_bits_count);
+    c->cardinality = (u32)DE_BVEC_kernels.count_blocks(
+        c->data.bitmap, DE_BVEC_ROAR_CHUNK_BLOCKS);
+    if (!c->cardinality)
+      DE_BVEC_roar_remove_at(&out, out.size - 1);
+    else
+      DE_BVEC_roar_optimize(c);
+  }
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec
+de_bvec_roaring_to_bvec(const de_bvec_roaring *const _msk) {
+  de_bvec out = de_bvec_create(_msk->bits_amount);
+  if (!_msk->bits_amount)
+    return out;
+  mblk_t *const blocks = DE_BVEC_DATA(&out);
+  const usize bcount = DE_BVEC_BLOCKS_USED(&out);
+  mblk_t tmp[DE_BVEC_ROAR_CHUNK_BLOCKS];
+  for (usize i = 0; i < _msk->size; ++i) {
+    const usize base = (usize)_msk->keys[i] * DE_BVEC_ROAR_CHUNK_BLOCKS;
+    if (base >= bcount)
+      break;
+    const usize n = bcount - base < DE_BVEC_ROAR_CHUNK_BLOCKS
+                        ? bcount - base
+                        : DE_BVEC_ROAR_CHUNK_BLOCKS;
+    DE_BVEC_roar_fill_bitmap(&_msk->containers[i], tmp);
+    memcpy(blocks + base, tmp, n * sizeof(mblk_t));
+  }
+  DE_BVEC_COUNT_INVALIDATE(&out);
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_roaring_run_optimize(de_bvec_roaring *const _msk) {
+  for (usize i = 0; i < _msk->size; ++i)
+    DE_BVEC_roar_optimize(&_msk->containers[i]);
+}
+
+/* ---- Single-bit access ---- */
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_roaring_get(const de_bvec_roaring *const _msk, const usize _idx) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_idx < _msk->bits_amount);
+#endif
+  const u32 key = DE_BVEC_ROAR_KEY(_idx);
+  const usize pos = DE_BVEC_roar_find(_msk, key);
+  return pos < _msk->size && _msk->keys[pos] == key &&
+         DE_BVEC_roar_cont_get(&_msk->containers[pos], DE_BVEC_ROAR_LOW(_idx));
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_roaring_set(
+    de_bvec_roaring *const _msk, const usize _idx, const bool _value) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_idx < _msk->bits_amount);
+#endif
+  const u32 key = DE_BVEC_ROAR_KEY(_idx);
+  const usize pos = DE_BVEC_roar_find(_msk, key);
+  const bool found = pos < _msk->size && _msk->keys[pos] == key;
+  if (!found && !_value)
+    return;
+  DE_BVEC_roar_cont *c =
+      found ? &_msk->containers[pos] : DE_BVEC_roar_insert_at(_msk, pos, key);
+  if (!c || !DE_BVEC_roar_cont_set(c, DE_BVEC_ROAR_LOW(_idx), _value)) {
+    DE_BVEC_roar_fail(_msk);
+    return;
+  }
+  if (!c->cardinality)
+    DE_BVEC_roar_remove_at(_msk, pos);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_roaring_set_range(de_bvec_roaring *const _msk, const usize _start_idx,
+                          const usize _end_idx, const bool _value) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_start_idx < _msk->bits_amount);
+  assert(_end_idx < _msk->bits_amount);
+  assert(_start_idx <= _end_idx);
+#endif
+  const u32 key_first = DE_BVEC_ROAR_KEY(_start_idx);
+  const u32 key_last = DE_BVEC_ROAR_KEY(_end_idx);
+  for (u32 key = key_first; key <= key_last; ++key) {
+    const u32 first =
+        key == key_first ? DE_BVEC_ROAR_LOW(_start_idx) : 0;
+    const u32 last = key == key_last
+                         ? DE_BVEC_ROAR_LOW(_end_idx)
+                         : (u32)(DE_BVEC_ROAR_CHUNK_BITS - 1);
+    const bool whole = first == 0 && last == DE_BVEC_ROAR_CHUNK_BITS - 1;
+    const usize pos = DE_BVEC_roar_find(_msk, key);
+    const bool found = pos < _msk->size && _msk->keys[pos] == key;
+    if (!found && !_value)
+      continue;
+    if (whole && !_value) {
+      DE_BVEC_roar_remove_at(_msk, pos);
+      continue;
+    }
+
+    DE_BVEC_roar_cont *c =
+        found ? &_msk->containers[pos] : DE_BVEC_roar_insert_at(_msk, pos, key);
+    const bool ok =
+        c && (whole ? DE_BVEC_roar_make_full(c) : DE_BVEC_roar_to_bitmap(c));
+    if (!ok) {
+      DE_BVEC_roar_fail(_msk);
+      return;
+    }
+    if (whole)
+      continue;
+    DE_BVEC_roar_bitmap_range(c->data.bitmap, first, last, _value);
+    c->cardinality = (u32)DE_BVEC_kernels.count_blocks(
+        c->data.bitmap, DE_BVEC_ROAR_CHUNK_BLOCKS);
+    if (!c->cardinality)
+      DE_BVEC_roar_remove_at(_msk, pos);
+    else
+      DE_BVEC_roar_optimize(c);
+  }
+}
+
+/* ---- Bulk operations ---- */
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_roar_msk_op(de_bvec_roaring *const _dst,
+                    const de_bvec_roaring *const _src,
+                    const DE_BVEC_roar_op _op) {
+  if (!de_bvec_roaring_info_valid(_dst))
+    return;
+  if (!de_bvec_roaring_info_valid(_src)) {
+    DE_BVEC_roar_fail(_dst);
+    return;
+  }
+  if (_dst == _src) {
+    if (_op == DE_BVEC_ROAR_XOR)
+      de_bvec_roaring_clear(_dst);
+    return;
+  }
+  /* _src bits past _dst->bits_amount are dropped, as in de_bvec_or_msk */
+  const usize chunks = _dst->bits_amount
+                           ? (usize)DE_BVEC_ROAR_KEY(_dst->bits_amount - 1) + 1
+                           : 0;
+  const u32 tail =
+      _dst->bits_amount ? DE_BVEC_ROAR_LOW(_dst->bits_amount - 1) + 1 : 0;
+  const usize cap = _dst->size + _src->size;
+  if (!cap)
+    return;
+  u32 *keys = (u32 *)malloc(cap * sizeof(u32));
+  DE_BVEC_roar_cont *conts =
+      (DE_BVEC_roar_cont *)malloc(cap * sizeof(DE_BVEC_roar_cont));
+  usize i = 0, j = 0, n = 0;
+  bool ok = keys && conts;
+  while (ok && (i < _dst->size || j < _src->size)) {
+    const bool has_i = i < _dst->size, has_j = j < _src->size;
+    if (has_i && (!has_j || _dst->keys[i] < _src->keys[j])) {
+      if (_op == DE_BVEC_ROAR_AND) {
+        DE_BVEC_roar_cont_free(&_dst->containers[i]);
+      } else {
+        keys[n] = _dst->keys[i];
+        conts[n++] = _dst->containers[i];
+      }
+      ++i;
+    } else if (!has_i || _src->keys[j] < _dst->keys[i]) {
+      if (_op != DE_BVEC_ROAR_AND && _src->keys[j] < chunks) {
+        keys[n] = _src->keys[j];
+        if (!(ok = DE_BVEC_roar_cont_copy(&conts[n], &_src->containers[j])))
+          break;
+        ++n;
+      }
+      ++j;
+    } else {
+      if (!(ok = DE_BVEC_roar_cont_op(&_dst->containers[i],
+                                      &_src->containers[j], _op)))
+        break;
+      if (_dst->containers[i].cardinality) {
+        keys[n] = _dst->keys[i];
+        conts[n++] = _dst->containers[i];
+      } else {
+        DE_BVEC_roar_cont_free(&_dst->containers[i]);
+      }
+      ++i, ++j;
+    }
+  }
+  /* only the last chunk of _dst can hold _src bits past the end */
+  if (ok && n && _op != DE_BVEC_ROAR_AND && keys[n - 1] == chunks - 1) {
+    ok = DE_BVEC_roar_cont_clip(&conts[n - 1], tail);
+    if (ok && !conts[n - 1].cardinality)
+      DE_BVEC_roar_cont_free(&conts[--n]);
+  }
+  if (!ok) {
+    /* conts owns the merged chunks, _dst still owns the ones from i on */
+    while (n)
+      DE_BVEC_roar_cont_free(&conts[--n]);
+    for (; i < _dst->size; ++i)
+      DE_BVEC_roar_cont_free(&_dst->containers[i]);
+    free(keys);
+    free(conts);
+    _dst->size = 0;
+    DE_BVEC_roar_fail(_dst);
+    return;
+  }
+  free(_dst->keys);
+  free(_dst->containers);
+  _dst->keys = keys;
+  _dst->containers = conts;
+  _dst->size = n;
+  _dst->capacity = cap;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_roaring_and_msk(de_bvec_roaring *const _dst,
+                        const de_bvec_roaring *const _src) {
+  DE_BVEC_roar_msk_op(_dst, _src, DE_BVEC_ROAR_AND);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_roaring_or_msk(de_bvec_roaring *const _dst,
+                       const de_bvec_roaring *const _src) {
+  DE_BVEC_roar_msk_op(_dst, _src, DE_BVEC_ROAR_OR);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_roaring_xor_msk(de_bvec_roaring *const _dst,
+                        const de_bvec_roaring *const _src) {
+  DE_BVEC_roar_msk_op(_dst, _src, DE_BVEC_ROAR_XOR);
+}
+
+/* ---- Info / Introspection ---- */
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_roaring_info_size(const de_bvec_roaring *const _msk) {
+  return _msk->bits_amount;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_roaring_info_valid(const de_bvec_roaring *const _msk) {
+  return _msk && (_msk->keys != NULL || !_msk->capacity);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_roaring_info_bytes(const de_bvec_roaring *const _msk) {
+  usize out = _msk->capacity * (sizeof(u32) + sizeof(DE_BVEC_roar_cont));
+  for (usize i = 0; i < _msk->size; ++i) {
+    const DE_BVEC_roar_cont *c = &_msk->containers[i];
+    out += c->kind == DE_BVEC_ROARING_BITMAP ? DE_BVEC_ROAR_BITMAP_BYTES
+                                             : c->capacity * sizeof(u16);
+  }
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_roaring_any(const de_bvec_roaring *const _msk) {
+  return _msk->size != 0;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_roaring_count(const de_bvec_roaring *const _msk) {
+  usize out = 0;
+  for (usize i = 0; i < _msk->size; ++i)
+    out += _msk->containers[i].cardinality;
+  return out;
+}
+
+#endif
+#endif
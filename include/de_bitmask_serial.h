@@ -0,0 +1,458 @@
+#ifndef DE_CONTAINER_BITMASK_SERIAL_HEADER
+#define DE_CONTAINER_BITMASK_SERIAL_HEADER
+
+/*
+  Binary format for de_bvec, independent of the host byte order.
+  A 64 byte header, all fields little endian:
+    0   u32 magic "DBVS"
+    4   u16 version (DE_BVEC_SERIAL_VERSION)
+    6   u16 flags (de_bvec_serial_flags)
+    8   u64 size in bits
+    16  u64 payload bytes
+    24  u32 CRC32C of bytes 0..23 and the payload, 0 without checksum
+    28  zero up to 64
+  followed by the payload: the little endian blocks, or with
+  DE_BVEC_SERIAL_COMPRESS the EWAH stream of de_bitmask_ewah.h.
+  Uncompressed data starts 64 bytes into the buffer, on little endian
+  hosts de_bvec_serial_view_create uses it in place.
+  To get function definitions include
+  `#define DE_CONTAINER_BITMASK_IMPLEMENTATION`
+  before including this file.
+*/
+
+#include <common.h>
+#include <de_bitmask.h>
+#include <de_bitmask_ewah.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+#define DE_BVEC_SERIAL_VERSION 1
+#define DE_BVEC_SERIAL_HEADER_BYTES ((usize)64)
+
+/* larger sizes are refused on load, a compressed payload of a few bytes
+   could otherwise ask for any allocation */
+#ifndef DE_BVEC_SERIAL_MAX_BITS
+#define DE_BVEC_SERIAL_MAX_BITS ((u64)1 << 35)
+#endif
+
+// clang-format off
+
+/* ---- Struct ---- */
+typedef enum {
+  DE_BVEC_SERIAL_CHECKSUM = 1 << 0,  /* CRC32C over header and payload */
+  DE_BVEC_SERIAL_COMPRESS = 1 << 1,  /* EWAH payload, if it is smaller */
+} de_bvec_serial_flags;
+
+/*
+  A mask whose blocks are borrowed from a loaded buffer. msk is used
+  through the de_bvec API, writes go straight into the buffer (and make a
+  stored checksum stale). Masks of at most DE_BVEC_INLINE_BITS are copied
+  inline instead, writes to them stay in msk. growing it moves it to the
+  heap, de_bvec_delete(&view.msk) never frees the buffer.
+  The allocator is kept in the struct, it must not be moved.
+*/
+typedef struct {
+  de_bvec_allocator base;
+  de_bvec       msk;
+  mblk_t*       borrowed;
+} de_bvec_serial_view;
+
+/* ---- Save ---- */
+
+/*
+returns the buffer size de_bvec_serial_save needs at most for _msk
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_serial_bound(
+  const de_bvec* const _msk
+);
+
+/*
+writes _msk into _buffer with the given de_bvec_serial_flags.
+compression is dropped when it would not make the payload smaller or
+the stream cannot be allocated.
+returns the bytes written, 0 if _capacity is too small
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_serial_save(
+  const de_bvec* const _msk,
+  u0* const            _buffer,
+  const usize          _capacity,
+  const u32            _flags
+);
+
+/* ---- Load ---- */
+
+/*
+replaces _dst by the mask stored in _buffer.
+returns false, leaving _dst untouched, if the data is truncated, of an
+unknown version, fails its checksum or is larger than
+DE_BVEC_SERIAL_MAX_BITS. a compressed payload must expand to exactly the
+stored size, which is checked before anything is allocated
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_serial_load(
+  de_bvec* const    _dst,
+  const u0* const   _buffer,
+  const usize       _bytes
+);
+
+/*
+points _view->msk at the blocks inside _buffer without copying them, the
+mask writes into _buffer. masks of at most DE_BVEC_INLINE_BITS are copied
+inline, see de_bvec_serial_view.
+needs an uncompressed payload, a little endian host and an 8 byte aligned
+_buffer, otherwise returns false; fall back to de_bvec_serial_load then.
+a payload with bits set past the stored size is rejected as well, the view
+cannot clear them without writing to _buffer.
+_verify checks the checksum, which reads the whole payload once
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_serial_view_create(
+  de_bvec_serial_view* const _view,
+  u0* const                  _buffer,
+  const usize                _bytes,
+  const bool                 _verify
+);
+
+// clang-format on
+#pragma GCC diagnostic pop
+#endif /* DE_CONTAINER_BITMASK_SERIAL_HEADER */
+
+/* ---- Implementation Guard ---- */
+#if defined(DE_CONTAINER_BITMASK_IMPLEMENTATION)
+#ifndef DE_CONTAINER_BITMASK_SERIAL_IMPLEMENTATION_INTERNAL
+#define DE_CONTAINER_BITMASK_SERIAL_IMPLEMENTATION_INTERNAL
+
+#include <string.h>
+
+/* "DBVS" */
+#define DE_BVEC_SERIAL_MAGIC ((u32)0x53564244)
+
+/* blocks can be copied or borrowed as they are */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define DE_BVEC_SERIAL_HOST_LE
+#endif
+
+/* ---- Little endian fields ---- */
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_serial_put(u8 *const _dst,
+                                                    const u64 _value,
+                                                    const usize _bytes) {
+  for (usize i = 0; i < _bytes; ++i)
+    _dst[i] = (u8)(_value >> (8 * i));
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u64 DE_BVEC_serial_get(const u8 *const _src,
+                                                     const usize _bytes) {
+  u64 out = 0;
+  for (usize i = 0; i < _bytes; ++i)
+    out |= (u64)_src[i] << (8 * i);
+  return out;
+}
+
+/* ---- CRC32C ---- */
+/*
+  Castagnoli polynomial, hardware crc32 instructions where SSE4.2 exists,
+  a byte table otherwise. Picked once at startup like DE_BVEC_kernels.
+*/
+typedef u32 (*DE_BVEC_crc_fn)(u32, const u8 *const, const usize);
+
+static u32 DE_BVEC_crc_table[256];
+
+DE_CONTAINER_BITMASK_INTERNAL u32 DE_BVEC_crc32c_table(u32 _crc,
+                                                       const u8 *const _data,
+                                                       const usize _bytes) {
+  for (usize i = 0; i < _bytes; ++i)
+    _crc = DE_BVEC_crc_table[(_crc ^ _data[i]) & 0xff] ^ (_crc >> 8);
+  return _crc;
+}
+
+#ifdef DE_BVEC_X86_DISPATCH
+DE_BVEC_TARGET("sse4.2")
+DE_CONTAINER_BITMASK_INTERNAL u32 DE_BVEC_crc32c_sse42(u32 _crc,
+                                                       const u8 *const _data,
+                                                       const usize _bytes) {
+  usize i = 0;
+#if defined(__x86_64__)
+  u64 crc = _crc;
+  for (; i + 8 <= _bytes; i += 8) {
+    u64 word;
+    memcpy(&word, _data + i, 8);
+    crc = __builtin_ia32_crc32di(crc, word);
+  }
+  _crc = (u32)crc;
+#endif
+  for (; i < _bytes; ++i)
+    _crc = __builtin_ia32_crc32qi(_crc, _data[i]);
+  return _crc;
+}
+#endif
+
+static DE_BVEC_crc_fn DE_BVEC_crc32c = DE_BVEC_crc32c_table;
+
+__attribute__((constructor)) static u0 DE_BVEC_crc_init(u0) {
+  for (u32 i = 0; i < 256; ++i) {
+    u32 crc = i;
+    for (u32 k = 0; k < 8; ++k)
+      crc = (crc >> 1) ^ (0x82f63b78u & (0u - (crc & 1)));
+    DE_BVEC_crc_table[i] = crc;
+  }
+#ifdef DE_BVEC_X86_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.2"))
+    DE_BVEC_crc32c = DE_BVEC_crc32c_sse42;
+#endif
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u32 DE_BVEC_serial_crc(const u8 *const _buffer,
+                                                     const usize _payload) {
+  u32 crc = DE_BVEC_crc32c(~(u32)0, _buffer, 24);
+  crc = DE_BVEC_crc32c(crc, _buffer + DE_BVEC_SERIAL_HEADER_BYTES, _payload);
+  /* 0 means no checksum */
+  return ~crc ? ~crc : 1;
+}
+
+/* ---- Header ---- */
+typedef struct {
+  usize bits_amount;
+  usize payload;
+  u32 flags;
+} DE_BVEC_serial_header;
+
+/* parses and checks the header, the checksum is only checked on _verify */
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_serial_parse(const u8 *const _buffer, const usize _bytes,
+                     const bool _verify, DE_BVEC_serial_header *const _out) {
+  if (!_buffer || _bytes < DE_BVEC_SERIAL_HEADER_BYTES ||
+      DE_BVEC_serial_get(_buffer, 4) != DE_BVEC_SERIAL_MAGIC ||
+      DE_BVEC_serial_get(_buffer + 4, 2) != DE_BVEC_SERIAL_VERSION)
+    return false;
+  const u64 bits = DE_BVEC_serial_get(_buffer + 8, 8);
+  const u64 payload = DE_BVEC_serial_get(_buffer + 16, 8);
+  const u32 flags = (u32)DE_BVEC_serial_get(_buffer + 6, 2);
+  if (payload > _bytes - DE_BVEC_SERIAL_HEADER_BYTES ||
+      payload % sizeof(mblk_t) || bits > DE_BVEC_SERIAL_MAX_BITS ||
+      bits > (u64)(usize)-1 - DE_BVEC_MBLK_BITS)
+    return false;
+  if (!(flags & DE_BVEC_SERIAL_COMPRESS) &&
+      payload != DE_BVEC_GET_BLOCKS_AMOUNT(bits) * sizeof(mblk_t))
+    return false;
+  if (_verify && (flags & DE_BVEC_SERIAL_CHECKSUM) &&
+      DE_BVEC_serial_get(_buffer + 24, 4) !=
+          DE_BVEC_serial_crc(_buffer, (usize)payload))
+    return false;
+  _out->bits_amount = (usize)bits;
+  _out->payload = (usize)payload;
+  _out->flags = flags;
+  return true;
+}
+
+/* ---- Save ---- */
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_serial_bound(const de_bvec *const _msk) {
+  /* compressed payloads are only kept when smaller than the blocks */
+  return DE_BVEC_SERIAL_HEADER_BYTES + _msk->block_count * sizeof(mblk_t);
+}
+
+/* writes _words words of _src as little endian */
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_serial_put_words(
+    u8 *const _dst, const mblk_t *const _src, const usize _words) {
+#ifdef DE_BVEC_SERIAL_HOST_LE
+  memcpy(_dst, _src, _words * sizeof(mblk_t));
+#else
+  for (usize i = 0; i < _words; ++i)
+    DE_BVEC_serial_put(_dst + i * sizeof(mblk_t), _src[i], sizeof(mblk_t));
+#endif
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize de_bvec_serial_save(
+    const de_bvec *const _msk, u0 *const _buffer, const usize _capacity,
+    const u32 _flags) {
+  u8 *const out = (u8 *)_buffer;
+  const usize raw = _msk->block_count * sizeof(mblk_t);
+  u32 flags = _flags & (DE_BVEC_SERIAL_CHECKSUM | DE_BVEC_SERIAL_COMPRESS);
+  usize payload = raw;
+  de_bvec_ewah packed = {0};
+  if (flags & DE_BVEC_SERIAL_COMPRESS) {
+    packed = de_bvec_ewah_from_bvec(_msk);
+    if (de_bvec_ewah_info_valid(&packed) && packed.size * sizeof(mblk_t) < raw)
+      payload = packed.size * sizeof(mblk_t);
+    else
+      flags &= ~(u32)DE_BVEC_SERIAL_COMPRESS;
+  }
+  const usize total = DE_BVEC_SERIAL_HEADER_BYTES + payload;
+  if (total > _capacity || !out) {
+    de_bvec_ewah_delete(&packed);
+    return 0;
+  }
+
+  memset(out, 0, DE_BVEC_SERIAL_HEADER_BYTES);
+  DE_BVEC_serial_put(out, DE_BVEC_SERIAL_MAGIC, 4);
+  DE_BVEC_serial_put(out + 4, DE_BVEC_SERIAL_VERSION, 2);
+  DE_BVEC_serial_put(out + 6, flags, 2);
+  DE_BVEC_serial_put(out + 8, _msk->bits_amount, 8);
+  DE_BVEC_serial_put(out + 16, payload, 8);
+  if (flags & DE_BVEC_SERIAL_COMPRESS)
+    DE_BVEC_serial_put_words(out + DE_BVEC_SERIAL_HEADER_BYTES,
+                             packed.buffer, packed.size);
+  else
+    DE_BVEC_serial_put_words(out + DE_BVEC_SERIAL_HEADER_BYTES,
+                             DE_BVEC_DATA(_msk), _msk->block_count);
+  de_bvec_ewah_delete(&packed);
+  if (flags & DE_BVEC_SERIAL_CHECKSUM)
+    DE_BVEC_serial_put(out + 24, DE_BVEC_serial_crc(out, payload), 4);
+  return total;
+}
+
+/* ---- Load ---- */
+/* the blocks the EWAH stream expands to, without writing them */
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_serial_measure(const u8 *const _src, const usize _words,
+                       const usize _total) {
+  usize at = 0;
+  usize pos = 0;
+  while (pos < _words) {
+    const u64 marker = DE_BVEC_serial_get(_src + pos * sizeof(mblk_t), 8);
+    const u64 run = DE_BVEC_EWAH_M_RUN(marker);
+    const u64 lit = DE_BVEC_EWAH_M_LIT(marker);
+    ++pos;
+    if (run > _total - at || lit > _total - at - run || lit > _words - pos)
+      return false;
+    at += (usize)(run + lit);
+    pos += (usize)lit;
+  }
+  return at == _total;
+}
+
+/*
+  Expands the EWAH stream into _dst, which already has the right size and
+  is zeroed. Every count is checked against both ends, a corrupt stream is
+  rejected instead of read or written out of bounds.
+*/
+DE_CONTAINER_BITMASK_INTERNAL bool
+DE_BVEC_serial_inflate(de_bvec *const _dst, const u8 *const _src,
+                       const usize _words) {
+  mblk_t *const blocks = DE_BVEC_DATA(_dst);
+  const usize total = _dst->block_count;
+  usize at = 0;
+  usize pos = 0;
+  while (pos < _words) {
+    const u64 marker = DE_BVEC_serial_get(_src + pos * sizeof(mblk_t), 8);
+    const u64 run = DE_BVEC_EWAH_M_RUN(marker);
+    const u64 lit = DE_BVEC_EWAH_M_LIT(marker);
+    ++pos;
+    if (run > total - at || lit > total - at - run || lit > _words - pos)
+      return false;
+    if (DE_BVEC_EWAH_M_BIT(marker))
+      DE_BVEC_memset(blocks + at, DE_BVEC_MBLK_FILLED, (usize)run);
+    at += (usize)run;
+    for (u64 i = 0; i < lit; ++i)
+      blocks[at++] = DE_BVEC_serial_get(_src + pos++ * sizeof(mblk_t), 8);
+  }
+  return at == total;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_serial_load(de_bvec *const _dst,
+                                                       const u0 *const _buffer,
+                                                       const usize _bytes) {
+  const u8 *const in = (const u8 *)_buffer;
+  DE_BVEC_serial_header header;
+  if (!DE_BVEC_serial_parse(in, _bytes, true, &header))
+    return false;
+  const u8 *const payload = in + DE_BVEC_SERIAL_HEADER_BYTES;
+  if ((header.flags & DE_BVEC_SERIAL_COMPRESS) &&
+      !DE_BVEC_serial_measure(payload, header.payload / sizeof(mblk_t),
+                              DE_BVEC_GET_BLOCKS_AMOUNT(header.bits_amount)))
+    return false;
+  de_bvec out = de_bvec_create_with(header.bits_amount, _dst->alloc);
+  if (!de_bvec_info_valid(&out))
+    return false;
+  if (header.flags & DE_BVEC_SERIAL_COMPRESS) {
+    if (!DE_BVEC_serial_inflate(&out, payload,
+                                header.payload / sizeof(mblk_t))) {
+      de_bvec_delete(&out);
+      return false;
+    }
+  } else {
+#ifdef DE_BVEC_SERIAL_HOST_LE
+    memcpy(DE_BVEC_DATA(&out), payload, header.payload);
+#else
+    for (usize i = 0; i < out.block_count; ++i)
+      DE_BVEC_DATA(&out)[i] =
+          DE_BVEC_serial_get(payload + i * sizeof(mblk_t), 8);
+#endif
+  }
+  /* writers keep the tail clear, a foreign buffer might not */
+  DE_BVEC_trim(&out);
+  DE_BVEC_COUNT_INVALIDATE(&out);
+  de_bvec_move(_dst, &out);
+  return true;
+}
+
+/* ---- View ---- */
+DE_CONTAINER_BITMASK_INTERNAL mblk_t *
+DE_BVEC_serial_view_alloc(de_bvec_allocator *const _self, const usize _blocks) {
+  (u0)_self;
+  return DE_BVEC_heap_alloc(_blocks, true);
+}
+
+/* everything but the borrowed buffer came from the heap */
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_serial_view_dealloc(de_bvec_allocator *const _self,
+                            mblk_t *const _data, const usize _blocks) {
+  de_bvec_serial_view *const view = (de_bvec_serial_view *)_self;
+  if (_data == view->borrowed)
+    view->borrowed = NULL;
+  else
+    DE_BVEC_heap_free(_data, _blocks);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_serial_view_create(de_bvec_serial_view *const _view,
+                           u0 *const _buffer, const usize _bytes,
+                           const bool _verify) {
+#ifdef DE_BVEC_SERIAL_HOST_LE
+  u8 *const in = (u8 *)_buffer;
+  DE_BVEC_serial_header header;
+  if ((uptr)in % sizeof(mblk_t) ||
+      !DE_BVEC_serial_parse(in, _bytes, _verify, &header) ||
+      (header.flags & DE_BVEC_SERIAL_COMPRESS))
+    return false;
+  mblk_t *const blocks = (mblk_t *)(in + DE_BVEC_SERIAL_HEADER_BYTES);
+  const usize block_count = DE_BVEC_GET_BLOCKS_AMOUNT(header.bits_amount);
+  /* every other de_bvec relies on a clear tail */
+  if (block_count &&
+      blocks[block_count - 1] &
+          ~DE_BVEC_LOW_MASK(DE_BVEC_BITS_MOD_MBLK(header.bits_amount)))
+    return false;
+  _view->base = (de_bvec_allocator){.alloc = DE_BVEC_serial_view_alloc,
+                                    .dealloc = DE_BVEC_serial_view_dealloc,
+                                    .realloc = NULL};
+  _view->borrowed = NULL;
+  _view->msk = de_bvec_create_with(0, &_view->base);
+  _view->msk.bits_amount = header.bits_amount;
+  _view->msk.block_count = block_count;
+  _view->msk.last_block_bits_count = DE_BVEC_BITS_MOD_MBLK(header.bits_amount);
+  DE_BVEC_COUNT_INVALIDATE(&_view->msk);
+  if (header.bits_amount <= DE_BVEC_INLINE_BITS) {
+    /* too small to borrow, the inline copy is just as cheap */
+    DE_BVEC_memcpy(_view->msk.data.small, blocks, _view->msk.block_count);
+  } else {
+    _view->borrowed = blocks;
+    _view->msk.data.blocks = blocks;
+    _view->msk.block_capacity = _view->msk.block_count;
+  }
+  return true;
+#else
+  (u0)_view;
+  (u0)_buffer;
+  (u0)_bytes;
+  (u0)_verify;
+  return false;
+#endif
+}
+
+#endif
+#endif
@@ -0,0 +1,522 @@
+#ifndef DE_CONTAINER_BITMASK_SUMMARY_HEADER
+#define DE_CONTAINER_BITMASK_SUMMARY_HEADER
+
+/*
+  Hierarchical summary over a de_bvec for large, mostly empty masks.
+  Level 0 has one bit per block of the mask that is not 0, every level
+  above one bit per word of the level below that is not 0, up to a single
+  word. any / none read that word, find_next skips empty regions by
+  climbing up and back down, O(log64 n) instead of a scan of the blocks.
+  The summary costs 1/64 of the mask plus a little.
+  Changes made through the de_bvec_summary_* mutators keep it current,
+  after changing the mask directly call update (or rebuild after a resize).
+  To get function definitions include
+  `#define DE_CONTAINER_BITMASK_IMPLEMENTATION`
+  before including this file.
+*/
+
+#include <common.h>
+#include <de_bitmask.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+/* 64^10 blocks is more than any mask can hold */
+#define DE_BVEC_SUMMARY_MAX_LEVELS 10
+
+// clang-format off
+
+/* ---- Struct ---- */
+typedef struct {
+  de_bvec* msk;          /* summarized mask, must stay at the same address */
+  mblk_t*  words;        /* all levels, level 0 first */
+  mblk_t*  level[DE_BVEC_SUMMARY_MAX_LEVELS];
+  usize    length[DE_BVEC_SUMMARY_MAX_LEVELS]; /* words per level */
+  usize    depth;        /* levels in use, the last one is one word */
+  usize    block_count;  /* blocks of msk when the summary was built */
+} de_bvec_summary;
+
+/* ---- Lifecycle ---- */
+
+/*
+builds the summary of _msk.
+the summary keeps a pointer to _msk, so it must outlive the summary
+and must not be moved.
+*/
+DE_CONTAINER_BITMASK_API de_bvec_summary
+de_bvec_summary_create(
+  de_bvec* const _msk
+);
+
+/*
+frees the summary, the mask is untouched
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_summary_delete(
+  de_bvec_summary* const _sum
+);
+
+/*
+recomputes the whole summary, needed after a resize of the mask
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_summary_rebuild(
+  de_bvec_summary* const _sum
+);
+
+/*
+updates the summary after bits in [_start_idx, _end_idx] of the mask
+were changed directly
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_summary_update(
+  de_bvec_summary* const _sum,
+  const usize            _start_idx,
+  const usize            _end_idx
+);
+
+/*
+returns if the summary is valid (allocation worked)
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_summary_info_valid(
+  const de_bvec_summary* const _sum
+);
+
+/* ---- Mutators ---- */
+
+/*
+sets the state of the bit at the given index
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_summary_set(
+  de_bvec_summary* const _sum,
+  const usize            _idx,
+  const bool             _value
+);
+
+/*
+flips the bit at the given index
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_summary_flip(
+  de_bvec_summary* const _sum,
+  const usize            _idx
+);
+
+/*
+sets the state of the bits in the range provided
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_summary_set_range(
+  de_bvec_summary* const _sum,
+  const usize            _start_idx,
+  const usize            _end_idx,
+  const bool             _value
+);
+
+/*
+sets all bits to 0
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_summary_clear(
+  de_bvec_summary* const _sum
+);
+
+/*
+sets all bits to 1
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_summary_fill(
+  de_bvec_summary* const _sum
+);
+
+/*
+inverts all bits
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_summary_not(
+  de_bvec_summary* const _sum
+);
+
+/*
+de_bvec_and_msk / or_msk / xor_msk on the summarized mask. the summary
+words are computed while the blocks are still in cache
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_summary_and_msk(
+  de_bvec_summary* const _sum,
+  const de_bvec* const   _src
+);
+
+DE_CONTAINER_BITMASK_API u0
+de_bvec_summary_or_msk(
+  de_bvec_summary* const _sum,
+  const de_bvec* const   _src
+);
+
+DE_CONTAINER_BITMASK_API u0
+de_bvec_summary_xor_msk(
+  de_bvec_summary* const _sum,
+  const de_bvec* const   _src
+);
+
+/* ---- Queries ---- */
+
+/*
+returns true if any bit is 1, O(1)
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_summary_any(
+  const de_bvec_summary* const _sum
+);
+
+/*
+returns true if no bit is 1, O(1)
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_summary_none(
+  const de_bvec_summary* const _sum
+);
+
+/*
+returns the index of the first 1 bit, or DE_BVEC_NPOS
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_summary_find_first(
+  const de_bvec_summary* const _sum
+);
+
+/*
+returns the index of the first 1 bit at or after _idx, or DE_BVEC_NPOS
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_summary_find_next(
+  const de_bvec_summary* const _sum,
+  const usize                  _idx
+);
+
+/*
+iterates the 1 bits of the summarized mask in order, skipping empty
+regions. _idx must be a declared usize
+*/
+#define DE_BVEC_SUMMARY_FOREACH(_sum, _idx)                                    \
+  for ((_idx) = de_bvec_summary_find_first(_sum); (_idx) != DE_BVEC_NPOS;      \
+       (_idx) = de_bvec_summary_find_next(_sum, (_idx) + 1))
+
+// clang-format on
+#pragma GCC diagnostic pop
+#endif /* DE_CONTAINER_BITMASK_SUMMARY_HEADER */
+
+/* ---- Implementation Guard ---- */
+#if defined(DE_CONTAINER_BITMASK_IMPLEMENTATION)
+#ifndef DE_CONTAINER_BITMASK_SUMMARY_IMPLEMENTATION_INTERNAL
+#define DE_CONTAINER_BITMASK_SUMMARY_IMPLEMENTATION_INTERNAL
+
+#include <stdlib.h>
+
+#define DE_BVEC_SUMMARY_WORDS(_n)                                              \
+  (((_n) + DE_BVEC_MBLK_BITS - 1) / DE_BVEC_MBLK_BITS)
+
+/* one bit per entry of _below[0, _n) that is not 0 */
+DE_CONTAINER_BITMASK_INTERNAL mblk_t
+DE_BVEC_summary_word(const mblk_t *const _below, const usize _n) {
+  mblk_t out = 0;
+  for (usize j = 0; j < _n; ++j)
+    out |= (mblk_t)(_below[j] != 0) << j;
+  return out;
+}
+
+/*
+recomputes the levels from _level up, for entries [_lo, _hi] of the level
+below _level (the blocks of the mask for level 0)
+*/
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_summary_refresh(
+    de_bvec_summary *const _sum, const usize _level, usize _lo, usize _hi) {
+  const mblk_t *below =
+      _level ? _sum->level[_level - 1] : DE_BVEC_DATA(_sum->msk);
+  usize below_len = _level ? _sum->length[_level - 1] : _sum->block_count;
+  for (usize k = _level; k < _sum->depth; ++k) {
+    for (usize w = _lo / DE_BVEC_MBLK_BITS; w <= _hi / DE_BVEC_MBLK_BITS;
+         ++w) {
+      const usize first = w * DE_BVEC_MBLK_BITS;
+      const usize n = below_len - first < DE_BVEC_MBLK_BITS
+                          ? below_len - first
+                          : DE_BVEC_MBLK_BITS;
+      _sum->level[k][w] = DE_BVEC_summary_word(below + first, n);
+    }
+    below = _sum->level[k];
+    below_len = _sum->length[k];
+    _lo /= DE_BVEC_MBLK_BITS;
+    _hi /= DE_BVEC_MBLK_BITS;
+  }
+}
+
+/* block _b changed, fixes its bit and walks up while a word changes zeroness */
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_summary_mark(de_bvec_summary *const _sum, usize _b) {
+  bool set = DE_BVEC_DATA(_sum->msk)[_b] != 0;
+  for (usize k = 0; k < _sum->depth; ++k) {
+    mblk_t *const word = _sum->level[k] + _b / DE_BVEC_MBLK_BITS;
+    const mblk_t bit = DE_BVEC_ONE << (_b % DE_BVEC_MBLK_BITS);
+    const bool was = *word != 0;
+    *word = set ? *word | bit : *word & ~bit;
+    set = *word != 0;
+    if (set == was)
+      return;
+    _b /= DE_BVEC_MBLK_BITS;
+  }
+}
+
+/* ---- Lifecycle ---- */
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_summary_rebuild(de_bvec_summary *const _sum) {
+  const usize blocks = DE_BVEC_BLOCKS_USED(_sum->msk);
+  if (blocks != _sum->block_count || !_sum->words) {
+    free(_sum->words);
+    _sum->words = NULL;
+    _sum->depth = 0;
+    _sum->block_count = blocks;
+    if (!blocks)
+      return;
+    usize total = 0;
+    usize n = blocks;
+    do {
+      n = DE_BVEC_SUMMARY_WORDS(n);
+      _sum->length[_sum->depth++] = n;
+      total += n;
+    } while (n > 1);
+    _sum->words = (mblk_t *)malloc(total * sizeof(mblk_t));
+    if (!_sum->words) {
+      _sum->depth = 0;
+      return;
+    }
+    mblk_t *at = _sum->words;
+    for (usize k = 0; k < _sum->depth; ++k) {
+      _sum->level[k] = at;
+      at += _sum->length[k];
+    }
+  }
+  if (_sum->depth)
+    DE_BVEC_summary_refresh(_sum, 0, 0, blocks - 1);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_summary
+de_bvec_summary_create(de_bvec *const _msk) {
+  de_bvec_summary out = {.msk = _msk, .words = NULL, .depth = 0,
+                         .block_count = 0};
+  de_bvec_summary_rebuild(&out);
+  return out;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_summary_delete(de_bvec_summary *const _sum) {
+  if (!_sum)
+    return;
+  free(_sum->words);
+  _sum->words = NULL;
+  _sum->depth = 0;
+  _sum->block_count = 0;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_summary_update(de_bvec_summary *const _sum, const usize _start_idx,
+                       const usize _end_idx) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_start_idx <= _end_idx);
+  assert(_end_idx < _sum->msk->bits_amount);
+  assert(_sum->block_count == DE_BVEC_BLOCKS_USED(_sum->msk));
+#endif
+  DE_BVEC_summary_refresh(_sum, 0, DE_BVEC_GET_BLOCKS_INDEX(_start_idx),
+                          DE_BVEC_GET_BLOCKS_INDEX(_end_idx));
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_summary_info_valid(const de_bvec_summary *const _sum) {
+  return _sum && (_sum->words || !_sum->block_count);
+}
+
+/* ---- Mutators ---- */
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_summary_set(
+    de_bvec_summary *const _sum, const usize _idx, const bool _value) {
+  de_bvec_set(_sum->msk, _idx, _value);
+  DE_BVEC_summary_mark(_sum, DE_BVEC_GET_BLOCKS_INDEX(_idx));
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_summary_flip(de_bvec_summary *const _sum, const usize _idx) {
+  de_bvec_flip(_sum->msk, _idx);
+  DE_BVEC_summary_mark(_sum, DE_BVEC_GET_BLOCKS_INDEX(_idx));
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_summary_set_range(
+    de_bvec_summary *const _sum, const usize _start_idx, const usize _end_idx,
+    const bool _value) {
+  de_bvec_set_range(_sum->msk, _start_idx, _end_idx, _value);
+  de_bvec_summary_update(_sum, _start_idx, _end_idx);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_summary_clear(de_bvec_summary *const _sum) {
+  de_bvec_clear(_sum->msk);
+  if (_sum->words)
+    DE_BVEC_memset(_sum->words, 0,
+                   (usize)(_sum->level[_sum->depth - 1] + 1 - _sum->words));
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_summary_fill(de_bvec_summary *const _sum) {
+  de_bvec_fill(_sum->msk);
+  if (!_sum->depth)
+    return;
+  /* every block is non zero now, level 0 is known without reading them */
+  const usize tail = _sum->block_count % DE_BVEC_MBLK_BITS;
+  DE_BVEC_memset(_sum->level[0], DE_BVEC_MBLK_FILLED, _sum->length[0]);
+  if (tail)
+    _sum->level[0][_sum->length[0] - 1] = DE_BVEC_LOW_MASK(tail);
+  DE_BVEC_summary_refresh(_sum, 1, 0, _sum->length[0] - 1);
+}
+
+/*
+  The bulk ops run over chunks of 64 blocks: apply the kernel, then build
+  the level 0 word of the chunk while its blocks are still in L1, instead of
+  a second pass over the whole mask.
+*/
+typedef enum {
+  DE_BVEC_SUMMARY_AND,
+  DE_BVEC_SUMMARY_OR,
+  DE_BVEC_SUMMARY_XOR,
+  DE_BVEC_SUMMARY_NOT,
+} DE_BVEC_summary_op;
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+DE_BVEC_summary_bulk(de_bvec_summary *const _sum, const de_bvec *const _src,
+                     const DE_BVEC_summary_op _op) {
+  de_bvec *const msk = _sum->msk;
+  mblk_t *const dst = DE_BVEC_DATA(msk);
+  const mblk_t *const src = _src ? DE_BVEC_DATA(_src) : NULL;
+  const usize count = msk->block_count;
+  const usize n = _src && _src->block_count < count ? _src->block_count : count;
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_sum->block_count == count);
+#endif
+  /* or / xor leave the blocks past _src alone, and / not touch them all */
+  const usize end =
+      _op == DE_BVEC_SUMMARY_OR || _op == DE_BVEC_SUMMARY_XOR ? n : count;
+  if (!end)
+    return;
+  DE_BVEC_COUNT_INVALIDATE(msk);
+  for (usize first = 0; first < end; first += DE_BVEC_MBLK_BITS) {
+    const usize len =
+        count - first < DE_BVEC_MBLK_BITS ? count - first : DE_BVEC_MBLK_BITS;
+    const usize op_len = n > first ? (n - first < len ? n - first : len) : 0;
+    switch (_op) {
+    case DE_BVEC_SUMMARY_AND:
+      DE_BVEC_kernels.and_blocks(dst + first, src + first, op_len);
+      DE_BVEC_memset(dst + first + op_len, 0, len - op_len);
+      break;
+    case DE_BVEC_SUMMARY_OR:
+      DE_BVEC_kernels.or_blocks(dst + first, src + first, op_len);
+      break;
+    case DE_BVEC_SUMMARY_XOR:
+      DE_BVEC_kernels.xor_blocks(dst + first, src + first, op_len);
+      break;
+    case DE_BVEC_SUMMARY_NOT:
+      DE_BVEC_kernels.not_blocks(dst + first, len);
+      break;
+    }
+    /* bits past the end may have come in from a longer _src or the not */
+    if (first + len == count)
+      DE_BVEC_trim(msk);
+    if (_sum->depth)
+      _sum->level[0][first / DE_BVEC_MBLK_BITS] =
+          DE_BVEC_summary_word(dst + first, len);
+  }
+  if (_sum->depth)
+    DE_BVEC_summary_refresh(_sum, 1, 0, (end - 1) / DE_BVEC_MBLK_BITS);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_summary_not(de_bvec_summary *const _sum) {
+  DE_BVEC_summary_bulk(_sum, NULL, DE_BVEC_SUMMARY_NOT);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_summary_and_msk(de_bvec_summary *const _sum,
+                        const de_bvec *const _src) {
+  DE_BVEC_summary_bulk(_sum, _src, DE_BVEC_SUMMARY_AND);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_summary_or_msk(de_bvec_summary *const _sum,
+                       const de_bvec *const _src) {
+  DE_BVEC_summary_bulk(_sum, _src, DE_BVEC_SUMMARY_OR);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0
+de_bvec_summary_xor_msk(de_bvec_summary *const _sum,
+                        const de_bvec *const _src) {
+  DE_BVEC_summary_bulk(_sum, _src, DE_BVEC_SUMMARY_XOR);
+}
+
+/* ---- Queries ---- */
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_summary_any(const de_bvec_summary *const _sum) {
+  return _sum->depth && _sum->level[_sum->depth - 1][0] != 0;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool
+de_bvec_summary_none(const de_bvec_summary *const _sum) {
+  return !de_bvec_summary_any(_sum);
+}
+
+/*
+first block at or after _b that is not 0, or DE_BVEC_NPOS: climb while the
+rest of the current word is empty, then descend along the lowest set bits
+*/
+DE_CONTAINER_BITMASK_INTERNAL usize
+DE_BVEC_summary_next_block(const de_bvec_summary *const _sum, usize _b) {
+  usize k = 0;
+  for (;;) {
+    const usize w = _b / DE_BVEC_MBLK_BITS;
+    if (w >= _sum->length[k])
+      return DE_BVEC_NPOS;
+    const mblk_t word =
+        _sum->level[k][w] & (DE_BVEC_MBLK_FILLED << (_b % DE_BVEC_MBLK_BITS));
+    if (word) {
+      _b = w * DE_BVEC_MBLK_BITS + (usize)__builtin_ctzll(word);
+      break;
+    }
+    if (++k == _sum->depth)
+      return DE_BVEC_NPOS;
+    _b = w + 1;
+  }
+  while (k--)
+    _b = _b * DE_BVEC_MBLK_BITS + (usize)__builtin_ctzll(_sum->level[k][_b]);
+  return _b;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize de_bvec_summary_find_next(
+    const de_bvec_summary *const _sum, const usize _idx) {
+  if (_idx >= _sum->msk->bits_amount || !_sum->depth)
+    return DE_BVEC_NPOS;
+  const mblk_t *const blocks = DE_BVEC_DATA(_sum->msk);
+  usize b = DE_BVEC_GET_BLOCKS_INDEX(_idx);
+  mblk_t word = blocks[b] & (DE_BVEC_MBLK_FILLED << (_idx % DE_BVEC_MBLK_BITS));
+  if (!word) {
+    b = DE_BVEC_summary_next_block(_sum, b + 1);
+    if (b == DE_BVEC_NPOS)
+      return DE_BVEC_NPOS;
+    word = blocks[b];
+  }
+  return b * DE_BVEC_MBLK_BITS + (usize)__builtin_ctzll(word);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_summary_find_first(const de_bvec_summary *const _sum) {
+  return de_bvec_summary_find_next(_sum, 0);
+}
+
+#endif
+#endif
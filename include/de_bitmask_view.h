@@ -0,0 +1,521 @@
+#ifndef DE_CONTAINER_BITMASK_VIEW_HEADER
+#define DE_CONTAINER_BITMASK_VIEW_HEADER
+
+/*
+  Non-owning window of bits over a de_bvec or any external mblk_t buffer.
+  A view is a block pointer, a bit offset (0..63) into the first block and
+  a length; nothing is allocated and nothing is freed. Bits outside the
+  window are never modified, so views over disjoint ranges of one mask
+  can be written concurrently as long as they do not share a block.
+  Offsets do not have to line up: binary ops realign the source with a
+  funnel shift per block. When both offsets agree the SIMD kernels of
+  de_bitmask.h run on the whole blocks in between.
+  To get function definitions include
+  `#define DE_CONTAINER_BITMASK_IMPLEMENTATION`
+  before including this file.
+*/
+
+#include <common.h>
+#include <de_bitmask.h>
+#include <stdbool.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+
+// clang-format off
+
+/* ---- Struct ---- */
+typedef struct {
+  mblk_t* data;         /* block holding bit 0 of the view */
+  usize   offset;       /* bit of data[0] that is bit 0 of the view, < 64 */
+  usize   bits_amount;  /* logical number of bits */
+} de_bvec_view;
+
+/* ---- Lifecycle ---- */
+
+/*
+view of the _amount_bits bits of _msk starting at _start_idx. the view is
+invalidated by anything that reallocates _msk. writes through the view
+bypass _msk, call de_bvec_count_invalidate on it afterwards
+*/
+DE_CONTAINER_BITMASK_API de_bvec_view
+de_bvec_view_from_bvec(
+  de_bvec* const _msk,
+  const usize    _start_idx,
+  const usize    _amount_bits
+);
+
+/*
+view of _amount_bits bits of an external buffer, starting at bit
+_bit_offset of _data[0]
+*/
+DE_CONTAINER_BITMASK_API de_bvec_view
+de_bvec_view_from_buffer(
+  mblk_t* const _data,
+  const usize   _bit_offset,
+  const usize   _amount_bits
+);
+
+/*
+view of _amount_bits bits of _view starting at _start_idx
+*/
+DE_CONTAINER_BITMASK_API de_bvec_view
+de_bvec_view_slice(
+  const de_bvec_view _view,
+  const usize        _start_idx,
+  const usize        _amount_bits
+);
+
+/* ---- Single-bit access ---- */
+
+/*
+return the state of the bit at the given index
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_view_get(
+  const de_bvec_view _view,
+  const usize        _idx
+);
+
+/*
+sets the state of the bit at the given index
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_view_set(
+  const de_bvec_view _view,
+  const usize        _idx,
+  const bool         _value
+);
+
+/* ---- Bulk operations ---- */
+
+/*
+clears all bits of the view to 0
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_view_clear(
+  const de_bvec_view _view
+);
+
+/*
+sets all bits of the view to 1
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_view_fill(
+  const de_bvec_view _view
+);
+
+/*
+inverts all bits of the view
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_view_not(
+  const de_bvec_view _dst
+);
+
+/*
+  The binary ops cover the first min(_dst, _src) bits, the rest of _dst is
+  left as is. _dst and _src may be slices of the same buffer as long as
+  they do not overlap.
+*/
+
+/*
+copies the bits of _src into _dst
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_view_copy(
+  const de_bvec_view _dst,
+  const de_bvec_view _src
+);
+
+/*
+all bits from _dst are &= with the bits from _src
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_view_and_msk(
+  const de_bvec_view _dst,
+  const de_bvec_view _src
+);
+
+/*
+all bits from _dst are |= with the bits from _src
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_view_or_msk(
+  const de_bvec_view _dst,
+  const de_bvec_view _src
+);
+
+/*
+all bits from _dst are ^= with the bits from _src
+*/
+DE_CONTAINER_BITMASK_API u0
+de_bvec_view_xor_msk(
+  const de_bvec_view _dst,
+  const de_bvec_view _src
+);
+
+/* ---- Queries ---- */
+
+/*
+returns true if any bit of the view is 1
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_view_any(
+  const de_bvec_view _view
+);
+
+/*
+returns true if every bit of the view is 1, true for an empty view
+*/
+DE_CONTAINER_BITMASK_API bool
+de_bvec_view_all(
+  const de_bvec_view _view
+);
+
+/*
+returns the amount of 1 bits in the view
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_view_count(
+  const de_bvec_view _view
+);
+
+/*
+returns the index of the first 1 bit in the view, or its size if none
+*/
+DE_CONTAINER_BITMASK_API usize
+de_bvec_view_find_first(
+  const de_bvec_view _view
+);
+
+// clang-format on
+#pragma GCC diagnostic pop
+#endif /* DE_CONTAINER_BITMASK_VIEW_HEADER */
+
+/* ---- Implementation Guard ---- */
+#if defined(DE_CONTAINER_BITMASK_IMPLEMENTATION)
+#ifndef DE_CONTAINER_BITMASK_VIEW_IMPLEMENTATION_INTERNAL
+#define DE_CONTAINER_BITMASK_VIEW_IMPLEMENTATION_INTERNAL
+
+#include <assert.h>
+
+/* blocks touched by the view */
+#define DE_BVEC_VIEW_BLOCKS(_view)                                             \
+  DE_BVEC_GET_BLOCKS_AMOUNT((_view).offset + (_view).bits_amount)
+
+/* bits of block _b of the view, only the first and last are partial */
+DE_CONTAINER_BITMASK_INTERNAL mblk_t DE_BVEC_view_mask(const de_bvec_view _view,
+                                                       const usize _b,
+                                                       const usize _blocks) {
+  mblk_t mask = DE_BVEC_MBLK_FILLED;
+  if (_b == 0)
+    mask &= DE_BVEC_MBLK_FILLED << _view.offset;
+  if (_b == _blocks - 1)
+    mask &= DE_BVEC_LOW_MASK(
+        DE_BVEC_BITS_MOD_MBLK(_view.offset + _view.bits_amount));
+  return mask;
+}
+
+/*
+  64 bits of _view starting _pos bits after bit 0 of _view.data[0], _pos
+  may be negative. Blocks outside the view read as 0, so this never
+  touches memory the view does not cover.
+*/
+DE_CONTAINER_BITMASK_INTERNAL mblk_t
+DE_BVEC_view_fetch(const de_bvec_view _view, const ptrdiff _pos) {
+  const ptrdiff blocks = (ptrdiff)DE_BVEC_VIEW_BLOCKS(_view);
+  const ptrdiff lo = _pos >> 6;
+  const usize shift = (usize)_pos & (DE_BVEC_MBLK_BITS - 1);
+  const mblk_t a = lo >= 0 && lo < blocks ? _view.data[lo] : 0;
+  if (!shift)
+    return a;
+  const mblk_t b = lo + 1 >= 0 && lo + 1 < blocks ? _view.data[lo + 1] : 0;
+  return (a >> shift) | (b << (DE_BVEC_MBLK_BITS - shift));
+}
+
+/* ---- Lifecycle ---- */
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_view
+de_bvec_view_from_buffer(mblk_t *const _data, const usize _bit_offset,
+                         const usize _amount_bits) {
+  return (de_bvec_view){
+      .data = _data + DE_BVEC_GET_BLOCKS_INDEX(_bit_offset),
+      .offset = _bit_offset % DE_BVEC_MBLK_BITS,
+      .bits_amount = _amount_bits};
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_view
+de_bvec_view_from_bvec(de_bvec *const _msk, const usize _start_idx,
+                       const usize _amount_bits) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_start_idx + _amount_bits <= _msk->bits_amount);
+#endif
+  return de_bvec_view_from_buffer(DE_BVEC_DATA(_msk), _start_idx,
+                                  _amount_bits);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL de_bvec_view
+de_bvec_view_slice(const de_bvec_view _view, const usize _start_idx,
+                   const usize _amount_bits) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_start_idx + _amount_bits <= _view.bits_amount);
+#endif
+  return de_bvec_view_from_buffer(_view.data, _view.offset + _start_idx,
+                                  _amount_bits);
+}
+
+/* ---- Single-bit access ---- */
+DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_view_get(const de_bvec_view _view,
+                                                    const usize _idx) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_idx < _view.bits_amount);
+#endif
+  const usize bit = _view.offset + _idx;
+  return DE_BVEC_ONE & (_view.data[DE_BVEC_GET_BLOCKS_INDEX(bit)] >>
+                        (bit % DE_BVEC_MBLK_BITS));
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_view_set(const de_bvec_view _view,
+                                                  const usize _idx,
+                                                  const bool _value) {
+#ifndef DE_CONTAINER_NO_SAFETY_CHECKS
+  assert(_idx < _view.bits_amount);
+#endif
+  const usize bit = _view.offset + _idx;
+  mblk_t *const block = _view.data + DE_BVEC_GET_BLOCKS_INDEX(bit);
+  const mblk_t mask = DE_BVEC_ONE << (bit % DE_BVEC_MBLK_BITS);
+  *block = (*block & ~mask) | (mask & -(mblk_t)_value);
+}
+
+/* ---- Bulk operations ---- */
+typedef enum {
+  DE_BVEC_VIEW_COPY = 0,
+  DE_BVEC_VIEW_AND,
+  DE_BVEC_VIEW_OR,
+  DE_BVEC_VIEW_XOR,
+} DE_BVEC_view_op;
+
+/* _dst = op(_dst, _src) on the bits in _mask only */
+DE_CONTAINER_BITMASK_INTERNAL mblk_t DE_BVEC_view_merge(const u8 _op,
+                                                        const mblk_t _dst,
+                                                        const mblk_t _src,
+                                                        const mblk_t _mask) {
+  switch (_op) {
+  case DE_BVEC_VIEW_AND:
+    return _dst & (_src | ~_mask);
+  case DE_BVEC_VIEW_OR:
+    return _dst | (_src & _mask);
+  case DE_BVEC_VIEW_XOR:
+    return _dst ^ (_src & _mask);
+  default:
+    return (_dst & ~_mask) | (_src & _mask);
+  }
+}
+
+/* whole blocks with the same alignment, handed to the SIMD kernels */
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_view_blocks(const u8 _op,
+                                                     mblk_t *const _dst,
+                                                     const mblk_t *const _src,
+                                                     const usize _n) {
+  switch (_op) {
+  case DE_BVEC_VIEW_AND:
+    DE_BVEC_kernels.and_blocks(_dst, _src, _n);
+    break;
+  case DE_BVEC_VIEW_OR:
+    DE_BVEC_kernels.or_blocks(_dst, _src, _n);
+    break;
+  case DE_BVEC_VIEW_XOR:
+    DE_BVEC_kernels.xor_blocks(_dst, _src, _n);
+    break;
+  default:
+    DE_BVEC_memmov(_dst, _src, _n);
+    break;
+  }
+}
+
+/* whole blocks, _src shifted right by 0 < _shift < 64 across two blocks */
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_view_funnel(const u8 _op,
+                                                     mblk_t *const _dst,
+                                                     const mblk_t *const _src,
+                                                     const usize _shift,
+                                                     const usize _n) {
+  const usize back = DE_BVEC_MBLK_BITS - _shift;
+  switch (_op) {
+  case DE_BVEC_VIEW_AND:
+    for (usize i = 0; i < _n; ++i)
+      _dst[i] &= (_src[i] >> _shift) | (_src[i + 1] << back);
+    break;
+  case DE_BVEC_VIEW_OR:
+    for (usize i = 0; i < _n; ++i)
+      _dst[i] |= (_src[i] >> _shift) | (_src[i + 1] << back);
+    break;
+  case DE_BVEC_VIEW_XOR:
+    for (usize i = 0; i < _n; ++i)
+      _dst[i] ^= (_src[i] >> _shift) | (_src[i + 1] << back);
+    break;
+  default:
+    for (usize i = 0; i < _n; ++i)
+      _dst[i] = (_src[i] >> _shift) | (_src[i + 1] << back);
+    break;
+  }
+}
+
+/*
+  Walks the blocks of _dst. Source bit k sits `delta` bits after the
+  destination bit k (relative to each data pointer), so destination block
+  b reads the 64 source bits starting at 64 * b + delta. The first and
+  last blocks go through the bounds checked fetch and are merged under a
+  mask, all blocks in between are complete on both sides.
+*/
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_view_binary(const u8 _op,
+                                                     const de_bvec_view _dst,
+                                                     de_bvec_view _src) {
+  const usize bits =
+      _dst.bits_amount < _src.bits_amount ? _dst.bits_amount : _src.bits_amount;
+  if (!bits)
+    return;
+  const de_bvec_view dst = {
+      .data = _dst.data, .offset = _dst.offset, .bits_amount = bits};
+  _src.bits_amount = bits;
+  const usize blocks = DE_BVEC_VIEW_BLOCKS(dst);
+  const ptrdiff delta = (ptrdiff)_src.offset - (ptrdiff)dst.offset;
+
+  dst.data[0] = DE_BVEC_view_merge(_op, dst.data[0],
+                                   DE_BVEC_view_fetch(_src, delta),
+                                   DE_BVEC_view_mask(dst, 0, blocks));
+  if (blocks == 1)
+    return;
+  if (blocks > 2) {
+    /* delta > -64, so the source of block 1 starts at or after block 0 */
+    const usize from = (usize)(DE_BVEC_MBLK_BITS + delta);
+    const mblk_t *const src = _src.data + from / DE_BVEC_MBLK_BITS;
+    const usize shift = from % DE_BVEC_MBLK_BITS;
+    if (shift)
+      DE_BVEC_view_funnel(_op, dst.data + 1, src, shift, blocks - 2);
+    else
+      DE_BVEC_view_blocks(_op, dst.data + 1, src, blocks - 2);
+  }
+  const usize last = blocks - 1;
+  dst.data[last] = DE_BVEC_view_merge(
+      _op, dst.data[last],
+      DE_BVEC_view_fetch(_src, (ptrdiff)(last * DE_BVEC_MBLK_BITS) + delta),
+      DE_BVEC_view_mask(dst, last, blocks));
+}
+
+/* fills the view with _value, full blocks in between are set directly */
+DE_CONTAINER_BITMASK_INTERNAL u0 DE_BVEC_view_set_all(const de_bvec_view _view,
+                                                      const mblk_t _value) {
+  if (!_view.bits_amount)
+    return;
+  const usize blocks = DE_BVEC_VIEW_BLOCKS(_view);
+  const mblk_t first = DE_BVEC_view_mask(_view, 0, blocks);
+  _view.data[0] = (_view.data[0] & ~first) | (_value & first);
+  if (blocks == 1)
+    return;
+  DE_BVEC_memset(_view.data + 1, _value, blocks - 2);
+  const mblk_t last = DE_BVEC_view_mask(_view, blocks - 1, blocks);
+  _view.data[blocks - 1] = (_view.data[blocks - 1] & ~last) | (_value & last);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_view_clear(const de_bvec_view _view) {
+  DE_BVEC_view_set_all(_view, 0);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_view_fill(const de_bvec_view _view) {
+  DE_BVEC_view_set_all(_view, DE_BVEC_MBLK_FILLED);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_view_not(const de_bvec_view _dst) {
+  if (!_dst.bits_amount)
+    return;
+  const usize blocks = DE_BVEC_VIEW_BLOCKS(_dst);
+  _dst.data[0] ^= DE_BVEC_view_mask(_dst, 0, blocks);
+  if (blocks == 1)
+    return;
+  DE_BVEC_kernels.not_blocks(_dst.data + 1, blocks - 2);
+  _dst.data[blocks - 1] ^= DE_BVEC_view_mask(_dst, blocks - 1, blocks);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_view_copy(const de_bvec_view _dst,
+                                                   const de_bvec_view _src) {
+  DE_BVEC_view_binary(DE_BVEC_VIEW_COPY, _dst, _src);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_view_and_msk(const de_bvec_view _dst,
+                                                      const de_bvec_view _src) {
+  DE_BVEC_view_binary(DE_BVEC_VIEW_AND, _dst, _src);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_view_or_msk(const de_bvec_view _dst,
+                                                     const de_bvec_view _src) {
+  DE_BVEC_view_binary(DE_BVEC_VIEW_OR, _dst, _src);
+}
+
+DE_CONTAINER_BITMASK_INTERNAL u0 de_bvec_view_xor_msk(const de_bvec_view _dst,
+                                                      const de_bvec_view _src) {
+  DE_BVEC_view_binary(DE_BVEC_VIEW_XOR, _dst, _src);
+}
+
+/* ---- Queries ---- */
+DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_view_any(const de_bvec_view _view) {
+  if (!_view.bits_amount)
+    return false;
+  const usize blocks = DE_BVEC_VIEW_BLOCKS(_view);
+  if (_view.data[0] & DE_BVEC_view_mask(_view, 0, blocks))
+    return true;
+  if (blocks == 1)
+    return false;
+  for (usize i = 1; i < blocks - 1; ++i) {
+    if (_view.data[i])
+      return true;
+  }
+  return (_view.data[blocks - 1] &
+          DE_BVEC_view_mask(_view, blocks - 1, blocks)) != 0;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL bool de_bvec_view_all(const de_bvec_view _view) {
+  if (!_view.bits_amount)
+    return true;
+  const usize blocks = DE_BVEC_VIEW_BLOCKS(_view);
+  const mblk_t first = DE_BVEC_view_mask(_view, 0, blocks);
+  if ((_view.data[0] & first) != first)
+    return false;
+  if (blocks == 1)
+    return true;
+  for (usize i = 1; i < blocks - 1; ++i) {
+    if (~_view.data[i])
+      return false;
+  }
+  const mblk_t last = DE_BVEC_view_mask(_view, blocks - 1, blocks);
+  return (_view.data[blocks - 1] & last) == last;
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_view_count(const de_bvec_view _view) {
+  if (!_view.bits_amount)
+    return 0;
+  const usize blocks = DE_BVEC_VIEW_BLOCKS(_view);
+  usize out = (usize)__builtin_popcountll(
+      _view.data[0] & DE_BVEC_view_mask(_view, 0, blocks));
+  if (blocks == 1)
+    return out;
+  out += DE_BVEC_kernels.count_blocks(_view.data + 1, blocks - 2);
+  return out + (usize)__builtin_popcountll(
+                   _view.data[blocks - 1] &
+                   DE_BVEC_view_mask(_view, blocks - 1, blocks));
+}
+
+DE_CONTAINER_BITMASK_INTERNAL usize
+de_bvec_view_find_first(const de_bvec_view _view) {
+  const usize blocks = DE_BVEC_VIEW_BLOCKS(_view);
+  for (usize i = 0; i < blocks; ++i) {
+    const mblk_t word = _view.data[i] & DE_BVEC_view_mask(_view, i, blocks);
+    if (word)
+      return i * DE_BVEC_MBLK_BITS + (usize)__builtin_ctzll(word) -
+             _view.offset;
+  }
+  return _view.bits_amount;
+}
+
+#endif
+#endif
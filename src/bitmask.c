@@ -1,2 +1,18 @@
+/* mmap flags, madvise and mremap for the huge page storage path */
+#define _GNU_SOURCE
 #define DE_CONTAINER_BITMASK_IMPLEMENTATION
-#include <de_bitmask.h>
\ No newline at end of file
+#include <de_bitmask.h>
+#include <de_bitmask_rank.h>
+#include <de_bitmask_roaring.h>
+#include <de_bitmask_ewah.h>
+#include <de_bitmask_alloc.h>
+#include <de_bitmask_expr.h>
+#include <de_bitmask_par.h>
+#include <de_bitmask_atomic.h>
+#include <de_bitmask_mmap.h>
+#include <de_bitmask_serial.h>
+#include <de_bitmask_view.h>
+#include <de_bitmask_fixed.h>
+#include <de_bitmask_summary.h>
+#include <de_bitmask_hybrid.h>
+#include <de_bitmask_bloom.h>
@@ -1,17 +1,90 @@
+#define _GNU_SOURCE
 #include <stdbool.h>
 #include <stdio.h>
 #include <de_bitmask.h>
 #include <benchmark.h>
 #include <stdlib.h>
+#include <string.h>
 
-int main(void) {
-  de_bvec a = de_bvec_create(64);
-  de_bvec_flip_range(&a, 10, 54);
-  de_bvec_print(&a);
+static u0 usage(const char *const _prog) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --csv | --json        output format (default: table)\n"
+          "  --out <file>          write results to file\n"
+          "  --min-bits <n>        smallest mask size (default 64)\n"
+          "  --max-bits <n>        largest mask size (default 2^30)\n"
+          "  --step <n>            size multiplier (default 4)\n"
+          "  --trials <n>          timed trials per case (default 21)\n"
+          "  --warmup-ms <n>       warmup per case (default 20)\n"
+          "  --trial-ms <n>        target time of one trial (default 2)\n"
+          "  --filter <name>       only cases containing name\n"
+          "  --simd <level>        scalar | sse2 | avx2 | avx512\n",
+          _prog);
+}
 
-  run_all_benchmarks(((usize)1) << 6);
-  run_all_benchmarks(((usize)1) << 7);
-  run_all_benchmarks(((usize)1) << 9);
-  // run_all_benchmarks(((usize)1) << 10);
-  // run_all_benchmarks(((usize)1) << 14);
-}
\ No newline at end of file
+int main(int argc, char **argv) {
+  bench_config cfg = bench_config_default();
+  const char *out_path = NULL;
+
+  for (int i = 1; i < argc; ++i) {
+    const char *const arg = argv[i];
+    const char *const val = i + 1 < argc ? argv[i + 1] : NULL;
+    if (!strcmp(arg, "--csv"))
+      cfg.format = BENCH_FMT_CSV;
+    else if (!strcmp(arg, "--json"))
+      cfg.format = BENCH_FMT_JSON;
+    else if (!strcmp(arg, "--help") || !strcmp(arg, "-h")) {
+      usage(argv[0]);
+      return 0;
+    } else if (!val) {
+      usage(argv[0]);
+      return 1;
+    } else {
+      ++i;
+      if (!strcmp(arg, "--out"))
+        out_path = val;
+      else if (!strcmp(arg, "--min-bits"))
+        cfg.min_bits = (usize)strtoull(val, NULL, 0);
+      else if (!strcmp(arg, "--max-bits"))
+        cfg.max_bits = (usize)strtoull(val, NULL, 0);
+      else if (!strcmp(arg, "--step"))
+        cfg.step = (usize)strtoull(val, NULL, 0);
+      else if (!strcmp(arg, "--trials"))
+        cfg.trials = (usize)strtoull(val, NULL, 0);
+      else if (!strcmp(arg, "--warmup-ms"))
+        cfg.warmup_ns = (u64)strtoull(val, NULL, 0) * 1000000u;
+      else if (!strcmp(arg, "--trial-ms"))
+        cfg.trial_ns = (u64)strtoull(val, NULL, 0) * 1000000u;
+      else if (!strcmp(arg, "--filter"))
+        cfg.filter = val;
+      else if (!strcmp(arg, "--simd")) {
+        const char *const names[] = {"scalar", "sse2", "avx2", "avx512"};
+        usize level = 0;
+        while (level < 4 && strcmp(val, names[level]))
+          ++level;
+        if (level == 4) {
+          usage(argv[0]);
+          return 1;
+        }
+        de_bvec_simd_select((de_bvec_simd)level);
+      } else {
+        usage(argv[0]);
+        return 1;
+      }
+    }
+  }
+  if (!cfg.trials)
+    cfg.trials = 1;
+
+  if (out_path) {
+    cfg.out = fopen(out_path, "w");
+    if (!cfg.out) {
+      perror(out_path);
+      return 1;
+    }
+  }
+  const bool ok = bench_run(&cfg);
+  if (out_path)
+    fclose(cfg.out);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+#ifndef DE_BITMASK_TEST_H_
+#define DE_BITMASK_TEST_H_
+
+/*
+  Shared helpers for the programs under test/.
+  The tests are differential: an engine and a plain dense de_bvec get the
+  same edits from the same seeded generator and have to agree bit for bit
+  afterwards. The dense mask itself is checked against a bool array.
+  A failed check prints where it happened and the program keeps going, so
+  one run lists every mismatch; the exit code is non zero if any failed.
+*/
+
+#include <common.h>
+#include <de_bitmask.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static usize test_failures = 0;
+
+#define TEST_CHECK(_cond)                                                      \
+  do {                                                                         \
+    if (!(_cond)) {                                                            \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,       \
+              #_cond);                                                         \
+      ++test_failures;                                                         \
+    }                                                                          \
+  } while (0)
+
+#define TEST_EQ(_a, _b)                                                        \
+  do {                                                                         \
+    const u64 test_a_ = (u64)(_a), test_b_ = (u64)(_b);                        \
+    if (test_a_ != test_b_) {                                                  \
+      fprintf(stderr, "%s:%d: %s == %s failed: %llu != %llu\n", __FILE__,     \
+              __LINE__, #_a, #_b, (unsigned long long)test_a_,                 \
+              (unsigned long long)test_b_);                                    \
+      ++test_failures;                                                         \
+    }                                                                          \
+  } while (0)
+
+/* compares two masks bit for bit, _what names the case in the report */
+#define TEST_SAME(_a, _b, _what)                                               \
+  test_same_at((_a), (_b), (_what), __FILE__, __LINE__)
+
+/*
+sizes around the inline storage, block, cache line and 2^16 chunk edges,
+where the engines switch code paths
+*/
+static const usize test_sizes[] = {1,    63,    64,    65,    511,
+                                   512,  513,   4095,  4096,  65535,
+                                   65536, 65537, 200003};
+#define TEST_SIZES_AMOUNT (sizeof(test_sizes) / sizeof(test_sizes[0]))
+
+/* xorshift64*, fixed seed so a failure reproduces */
+static u64 test_rng = 0x9E3779B97F4A7C15ull;
+
+static inline u64 test_rand(u0) {
+  test_rng ^= test_rng >> 12;
+  test_rng ^= test_rng << 25;
+  test_rng ^= test_rng >> 27;
+  return test_rng * 0x2545F4914F6CDD1Dull;
+}
+
+static inline usize test_rand_below(const usize _bound) {
+  return _bound ? (usize)(test_rand() % _bound) : 0;
+}
+
+/*
+sets roughly _per_mille of the bits of _msk plus a few runs, so the
+compressed engines see sparse, dense and run shaped data in one mask
+*/
+static inline u0 test_fill(de_bvec *const _msk, const u32 _per_mille) {
+  const usize bits = _msk->bits_amount;
+  if (!bits)
+    return;
+  for (usize i = 0; i < bits; ++i)
+    if (test_rand_below(1000) < _per_mille)
+      de_bvec_set(_msk, i, true);
+  for (usize r = 0; r < 4; ++r) {
+    const usize start = test_rand_below(bits);
+    const usize len = test_rand_below(bits - start < 5000 ? bits - start
+                                                          : 5000);
+    de_bvec_set_range(_msk, start, start + len, r & 1);
+  }
+}
+
+static inline bool test_same_at(const de_bvec *const _a,
+                                const de_bvec *const _b,
+                                const char *const _what,
+                                const char *const _file, const int _line) {
+  if (_a->bits_amount != _b->bits_amount) {
+    fprintf(stderr, "%s:%d: %s: size %zu != %zu\n", _file, _line, _what,
+            _a->bits_amount, _b->bits_amount);
+    ++test_failures;
+    return false;
+  }
+  for (usize i = 0; i < _a->bits_amount; ++i) {
+    if (de_bvec_get(_a, i) != de_bvec_get(_b, i)) {
+      fprintf(stderr, "%s:%d: %s: first mismatch at bit %zu of %zu\n", _file,
+              _line, _what, i, _a->bits_amount);
+      ++test_failures;
+      return false;
+    }
+  }
+  return true;
+}
+
+/* dense copy of _src cut or extended to _bits, the reference for clipping */
+static inline de_bvec test_resized(const de_bvec *const _src,
+                                   const usize _bits) {
+  de_bvec out = de_bvec_create(_bits);
+  const usize n = _src->bits_amount < _bits ? _src->bits_amount : _bits;
+  for (usize i = 0; i < n; ++i)
+    if (de_bvec_get(_src, i))
+      de_bvec_set(&out, i, true);
+  return out;
+}
+
+static inline int test_report(const char *const _name) {
+  if (test_failures) {
+    fprintf(stderr, "%s: %zu check(s) failed\n", _name, test_failures);
+    return EXIT_FAILURE;
+  }
+  printf("%s: ok\n", _name);
+  return EXIT_SUCCESS;
+}
+
+#endif // DE_BITMASK_TEST_H_
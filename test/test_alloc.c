@@ -0,0 +1,174 @@
+/*
+  The arena and pool allocators: vectors built on them must hold the same
+  bits as heap vectors, and the memory reuse the header promises has to
+  happen: the arena grows and hands back its most recent vector in place,
+  puts oversized vectors in their own chunk and starts over in the kept
+  chunk after a reset; the pool hands a freed block to the next vector
+  of the same class.
+*/
+#include "test.h"
+
+#include <de_bitmask_alloc.h>
+
+#define CHUNK_BYTES 4096
+
+/* a vector from _alloc holding the same bits as _want */
+static de_bvec filled_like(de_bvec_allocator *const _alloc,
+                           const de_bvec *const _want) {
+  de_bvec out = de_bvec_create_with(_want->bits_amount, _alloc);
+  TEST_CHECK(de_bvec_info_valid(&out));
+  de_bvec_or_msk(&out, _want);
+  return out;
+}
+
+static u0 test_arena_top(u0) {
+  de_bvec_arena arena = de_bvec_arena_create(CHUNK_BYTES);
+  de_bvec want = de_bvec_create(1000);
+  test_fill(&want, 500);
+
+  /* the top vector grows and shrinks without moving */
+  de_bvec a = filled_like(&arena.base, &want);
+  const mblk_t *const at = a.data.blocks;
+  de_bvec_resize(&a, 1100);
+  de_bvec_set(&a, 1099, true);
+  TEST_CHECK(a.data.blocks == at);
+  de_bvec grown = test_resized(&want, 1100);
+  de_bvec_set(&grown, 1099, true);
+  TEST_SAME(&a, &grown, "arena grow in place");
+  const usize used = arena.used;
+  de_bvec_resize(&a, 1000);
+  de_bvec_shrink_to_fit(&a);
+  TEST_CHECK(a.data.blocks == at);
+  TEST_CHECK(arena.used < used);
+  TEST_SAME(&a, &want, "arena shrink in place");
+
+  /* once another vector sits above it, growing copies */
+  de_bvec b = filled_like(&arena.base, &want);
+  de_bvec_resize(&a, 1100);
+  de_bvec_set(&a, 1099, true);
+  TEST_CHECK(a.data.blocks != at);
+  TEST_SAME(&a, &grown, "arena grow by copy");
+  TEST_SAME(&b, &want, "arena neighbour");
+
+  /* deleting the top vector hands its bytes to the next one */
+  const usize before = arena.used;
+  de_bvec c = filled_like(&arena.base, &want);
+  const mblk_t *const top = c.data.blocks;
+  de_bvec_delete(&c);
+  TEST_EQ(arena.used, before);
+  c = de_bvec_create_with(1000, &arena.base);
+  TEST_CHECK(c.data.blocks == top);
+  TEST_EQ(de_bvec_count_refresh(&c), 0);
+
+  de_bvec_delete(&c);
+  de_bvec_delete(&b);
+  de_bvec_delete(&a);
+  de_bvec_delete(&grown);
+  de_bvec_delete(&want);
+  de_bvec_arena_delete(&arena);
+}
+
+static u0 test_arena_chunks(u0) {
+  de_bvec_arena arena = de_bvec_arena_create(CHUNK_BYTES);
+  de_bvec small = de_bvec_create(1000), big = de_bvec_create(100000);
+  test_fill(&small, 500);
+  test_fill(&big, 500);
+
+  /* the first vector opens a regular chunk */
+  de_bvec first = filled_like(&arena.base, &small);
+  u8 *const chunk = arena.chunk;
+  const mblk_t *const start = first.data.blocks;
+  const usize used = arena.used;
+  const usize head = (usize)((const u8 *)start - chunk);
+
+  /* an oversized vector gets its own chunk, the current one stays open */
+  de_bvec huge = filled_like(&arena.base, &big);
+  TEST_CHECK(arena.chunk == chunk);
+  TEST_EQ(arena.used, used);
+  de_bvec next = filled_like(&arena.base, &small);
+  TEST_CHECK((const u8 *)next.data.blocks == (const u8 *)start + used);
+  TEST_SAME(&huge, &big, "arena oversized");
+  TEST_SAME(&first, &small, "arena first");
+  TEST_SAME(&next, &small, "arena next");
+
+  /* filling the chunk opens another one */
+  de_bvec rest[40];
+  for (usize i = 0; i < 40; ++i)
+    rest[i] = filled_like(&arena.base, &small);
+  TEST_CHECK(arena.chunk != chunk);
+  for (usize i = 0; i < 40; ++i)
+    TEST_SAME(&rest[i], &small, "arena chunk full");
+
+  /* a reset keeps one regular chunk and starts at its beginning, the old
+     vectors are dropped without de_bvec_delete */
+  de_bvec_arena_reset(&arena);
+  TEST_EQ(arena.used, 0);
+  TEST_CHECK(arena.chunk != NULL);
+  de_bvec again = filled_like(&arena.base, &big);
+  de_bvec after = filled_like(&arena.base, &small);
+  TEST_SAME(&again, &big, "arena oversized after reset");
+  TEST_SAME(&after, &small, "arena after reset");
+  TEST_EQ(arena.used, used);
+  TEST_CHECK((u8 *)after.data.blocks == arena.chunk + head);
+
+  de_bvec_delete(&after);
+  de_bvec_delete(&again);
+  de_bvec_arena_delete(&arena);
+  TEST_CHECK(arena.chunk == NULL);
+  de_bvec_delete(&big);
+  de_bvec_delete(&small);
+}
+
+static u0 test_pool(u0) {
+  de_bvec_pool pool = de_bvec_pool_create();
+  de_bvec want = de_bvec_create(1000);
+  test_fill(&want, 500);
+
+  /* a freed block goes to the next vector of its class, cleared */
+  de_bvec a = filled_like(&pool.base, &want);
+  const mblk_t *const at = a.data.blocks;
+  de_bvec_delete(&a);
+  a = de_bvec_create_with(900, &pool.base);
+  TEST_CHECK(a.data.blocks == at);
+  TEST_EQ(de_bvec_count_refresh(&a), 0);
+  de_bvec_or_msk(&a, &want);
+  de_bvec part = test_resized(&want, 900);
+  TEST_SAME(&a, &part, "pool reuse");
+
+  /* other classes get other blocks */
+  de_bvec b = de_bvec_create_with(5000, &pool.base);
+  TEST_CHECK(b.data.blocks != at);
+
+  /* shrinking inside the class keeps the block, leaving it moves */
+  de_bvec_resize(&b, 4500);
+  const mblk_t *const b_at = b.data.blocks;
+  de_bvec_shrink_to_fit(&b);
+  TEST_CHECK(b.data.blocks == b_at);
+  de_bvec_resize(&b, 20000);
+  de_bvec_set(&b, 19999, true);
+  TEST_CHECK(b.data.blocks != b_at);
+  TEST_EQ(de_bvec_count_refresh(&b), 1);
+
+  /* vectors past the largest class live on the heap */
+  de_bvec huge = de_bvec_create_with(
+      ((usize)1 << DE_BVEC_POOL_CLASSES) * DE_BVEC_MBLK_BITS + 1,
+      &pool.base);
+  TEST_CHECK(de_bvec_info_valid(&huge));
+  de_bvec_delete(&huge);
+  TEST_CHECK(pool.free_lists[DE_BVEC_POOL_CLASSES - 1] == NULL);
+
+  de_bvec_delete(&b);
+  de_bvec_delete(&a);
+  de_bvec_delete(&part);
+  de_bvec_delete(&want);
+  de_bvec_pool_delete(&pool);
+  for (usize c = 0; c < DE_BVEC_POOL_CLASSES; ++c)
+    TEST_CHECK(pool.free_lists[c] == NULL);
+}
+
+int main(u0) {
+  test_arena_top();
+  test_arena_chunks();
+  test_pool();
+  return test_report("alloc");
+}
@@ -0,0 +1,220 @@
+/*
+  de_bvec_atomic against de_bvec. Single threaded every call has to
+  return what the dense mask holds before it. With threads racing over
+  the same bits, test_and_set / test_and_clear must let exactly one
+  thread win each bit, flips must not get lost, and threads writing
+  different bits of the same blocks must not undo each other.
+*/
+#define _POSIX_C_SOURCE 200809L
+#include "test.h"
+
+#include <de_bitmask_atomic.h>
+
+#include <pthread.h>
+
+#define THREADS 4
+#define BITS 100003
+
+typedef struct {
+  de_bvec_atomic *shared;
+  de_bvec won;  /* bits this thread claimed, or its stripe of edits */
+  usize hits;   /* calls that returned true */
+  usize wrong;  /* calls that returned something else than the stripe */
+  usize thread;
+  u64 seed;
+} worker;
+
+static pthread_barrier_t start;
+
+/* every thread claims every bit, ends in opposite directions */
+static u0 *race_test_and_set(u0 *const _arg) {
+  worker *const w = (worker *)_arg;
+  pthread_barrier_wait(&start);
+  for (usize k = 0; k < BITS; ++k) {
+    const usize i = w->thread % 2 ? BITS - 1 - k : k;
+    if (!de_bvec_atomic_test_and_set(w->shared, i))
+      de_bvec_set(&w->won, i, true);
+  }
+  return NULL;
+}
+
+static u0 *race_test_and_clear(u0 *const _arg) {
+  worker *const w = (worker *)_arg;
+  pthread_barrier_wait(&start);
+  for (usize k = 0; k < BITS; ++k) {
+    const usize i = w->thread % 2 ? BITS - 1 - k : k;
+    if (de_bvec_atomic_test_and_clear(w->shared, i))
+      de_bvec_set(&w->won, i, true);
+  }
+  return NULL;
+}
+
+/* every thread flips every bit once */
+static u0 *race_flip(u0 *const _arg) {
+  worker *const w = (worker *)_arg;
+  pthread_barrier_wait(&start);
+  for (usize k = 0; k < BITS; ++k)
+    w->hits += de_bvec_atomic_flip(w->shared, (k * 7 + w->thread) % BITS);
+  return NULL;
+}
+
+/* random edits on the bits i with i % THREADS == thread, the blocks are
+   shared with every other thread */
+static u0 *race_stripes(u0 *const _arg) {
+  worker *const w = (worker *)_arg;
+  pthread_barrier_wait(&start);
+  for (usize k = 0; k < BITS * 2; ++k) {
+    w->seed ^= w->seed << 13;
+    w->seed ^= w->seed >> 7;
+    w->seed ^= w->seed << 17;
+    const usize i =
+        (usize)(w->seed % (BITS / THREADS)) * THREADS + w->thread;
+    const bool was = de_bvec_get(&w->won, i);
+    const u64 op = w->seed >> 60 & 3;
+    bool got = was;
+    switch (op) {
+    case 0:
+      de_bvec_atomic_set(w->shared, i, !was);
+      break;
+    case 1:
+      got = de_bvec_atomic_flip(w->shared, i);
+      break;
+    case 2:
+      got = de_bvec_atomic_test_and_set(w->shared, i);
+      break;
+    default:
+      got = de_bvec_atomic_test_and_clear(w->shared, i);
+      break;
+    }
+    w->wrong += got != was;
+    de_bvec_set(&w->won, i, op == 0 || op == 1 ? !was : op == 2);
+  }
+  return NULL;
+}
+
+/* runs _fn on THREADS threads, _won of every worker starts empty */
+static u0 run(u0 *(*const _fn)(u0 *), de_bvec_atomic *const _shared,
+              worker *const _workers) {
+  pthread_t threads[THREADS];
+  pthread_barrier_init(&start, NULL, THREADS);
+  for (usize t = 0; t < THREADS; ++t) {
+    _workers[t] = (worker){.shared = _shared,
+                           .won = de_bvec_create(BITS),
+                           .hits = 0,
+                           .wrong = 0,
+                           .thread = t,
+                           .seed = test_rand() | 1};
+    if (pthread_create(&threads[t], NULL, _fn, &_workers[t])) {
+      fprintf(stderr, "atomic: no thread could be started\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (usize t = 0; t < THREADS; ++t)
+    pthread_join(threads[t], NULL);
+  pthread_barrier_destroy(&start);
+}
+
+/* each bit went to exactly one thread: the wins are disjoint and cover
+   the whole mask */
+static u0 check_one_winner(worker *const _workers, const char *const _what) {
+  de_bvec all = de_bvec_create(BITS);
+  usize sum = 0;
+  for (usize t = 0; t < THREADS; ++t) {
+    sum += de_bvec_count_refresh(&_workers[t].won);
+    de_bvec_or_msk(&all, &_workers[t].won);
+    de_bvec_delete(&_workers[t].won);
+  }
+  if (sum != BITS || de_bvec_count_refresh(&all) != BITS) {
+    fprintf(stderr, "atomic: %s: %zu wins over %zu bits\n", _what,
+            (size_t)sum, (size_t)de_bvec_count_refresh(&all));
+    ++test_failures;
+  }
+  de_bvec_delete(&all);
+}
+
+static u0 test_races(u0) {
+  de_bvec_atomic shared = de_bvec_atomic_create(BITS);
+  worker workers[THREADS];
+  de_bvec snap = de_bvec_create(0);
+
+  run(race_test_and_set, &shared, workers);
+  check_one_winner(workers, "test_and_set");
+  TEST_EQ(de_bvec_atomic_count(&shared), BITS);
+
+  /* 4 flips of a 1 bit see 1, 0, 1, 0 in some order */
+  run(race_flip, &shared, workers);
+  usize hits = 0;
+  for (usize t = 0; t < THREADS; ++t) {
+    hits += workers[t].hits;
+    de_bvec_delete(&workers[t].won);
+  }
+  TEST_EQ(hits, (usize)BITS * THREADS / 2);
+  TEST_EQ(de_bvec_atomic_count(&shared), BITS);
+
+  run(race_test_and_clear, &shared, workers);
+  check_one_winner(workers, "test_and_clear");
+  TEST_EQ(de_bvec_atomic_count(&shared), 0);
+  TEST_CHECK(!de_bvec_atomic_any(&shared));
+
+  /* every return matched the thread's own stripe, no update got lost */
+  run(race_stripes, &shared, workers);
+  de_bvec want = de_bvec_create(BITS);
+  usize wrong = 0;
+  for (usize t = 0; t < THREADS; ++t) {
+    wrong += workers[t].wrong;
+    de_bvec_or_msk(&want, &workers[t].won);
+    de_bvec_delete(&workers[t].won);
+  }
+  TEST_EQ(wrong, 0);
+  de_bvec_atomic_snapshot(&shared, &snap);
+  TEST_SAME(&snap, &want, "stripes");
+  TEST_EQ(de_bvec_atomic_count(&shared), de_bvec_count_refresh(&want));
+
+  de_bvec_delete(&want);
+  de_bvec_delete(&snap);
+  de_bvec_atomic_delete(&shared);
+}
+
+/* one thread, every call against the dense mask */
+static u0 test_single(const usize _bits) {
+  de_bvec_atomic msk = de_bvec_atomic_create(_bits);
+  de_bvec want = de_bvec_create(_bits);
+  de_bvec snap = de_bvec_create(3);
+  for (usize k = 0; k < 4096; ++k) {
+    const usize i = test_rand_below(_bits);
+    const bool was = de_bvec_get(&want, i);
+    const usize op = test_rand_below(6);
+    if (op == 0) {
+      de_bvec_atomic_set(&msk, i, true);
+      de_bvec_set(&want, i, true);
+    } else if (op == 1) {
+      de_bvec_atomic_clear(&msk, i);
+      de_bvec_set(&want, i, false);
+    } else if (op == 2) {
+      TEST_EQ(de_bvec_atomic_flip(&msk, i), was);
+      de_bvec_set(&want, i, !was);
+    } else if (op == 3) {
+      TEST_EQ(de_bvec_atomic_test_and_set(&msk, i), was);
+      de_bvec_set(&want, i, true);
+    } else if (op == 4) {
+      TEST_EQ(de_bvec_atomic_test_and_clear(&msk, i), was);
+      de_bvec_set(&want, i, false);
+    } else {
+      TEST_EQ(de_bvec_atomic_get(&msk, i), was);
+    }
+  }
+  de_bvec_atomic_snapshot(&msk, &snap);
+  TEST_SAME(&snap, &want, "single thread");
+  TEST_EQ(de_bvec_atomic_count(&msk), de_bvec_count_refresh(&want));
+  TEST_EQ(de_bvec_atomic_any(&msk), de_bvec_any(&want));
+  de_bvec_delete(&snap);
+  de_bvec_delete(&want);
+  de_bvec_atomic_delete(&msk);
+}
+
+int main(u0) {
+  for (usize s = 0; s < TEST_SIZES_AMOUNT; ++s)
+    test_single(test_sizes[s]);
+  test_races();
+  return test_report("atomic");
+}
@@ -0,0 +1,97 @@
+/*
+  de_bvec_bloom has no exact reference, so the filter is checked against
+  itself: the blocks built at every SIMD level supported by the cpu must
+  equal the scalar ones bit for bit, batched calls must equal single key
+  calls, merge must equal inserting both key sets. Inserted keys always
+  hit and the false positive rate stays near what the size promises.
+*/
+#include "test.h"
+
+#include <de_bitmask_bloom.h>
+
+#define KEYS 20000
+
+static u64 keys[KEYS];
+static u64 others[KEYS];
+
+static de_bvec_bloom build(const usize _from, const usize _to,
+                           const bool _batched) {
+  de_bvec_bloom flt = de_bvec_bloom_create(KEYS, 10);
+  TEST_CHECK(de_bvec_bloom_info_valid(&flt));
+  if (_batched) {
+    de_bvec_bloom_insert_many(&flt, keys + _from, _to - _from);
+  } else {
+    for (usize i = _from; i < _to; ++i)
+      de_bvec_bloom_insert(&flt, keys[i]);
+  }
+  return flt;
+}
+
+static u0 check_lookups(const de_bvec_bloom *const _flt) {
+  static bool out[KEYS];
+  usize missed = 0;
+  for (usize i = 0; i < KEYS; ++i)
+    missed += !de_bvec_bloom_contains(_flt, keys[i]);
+  TEST_EQ(missed, 0);
+  TEST_EQ(de_bvec_bloom_contains_many(_flt, keys, KEYS, out), KEYS);
+
+  const usize hits = de_bvec_bloom_contains_many(_flt, others, KEYS, out);
+  usize single = 0, differ = 0;
+  for (usize i = 0; i < KEYS; ++i) {
+    const bool hit = de_bvec_bloom_contains(_flt, others[i]);
+    single += hit;
+    differ += hit != out[i];
+  }
+  TEST_EQ(hits, single);
+  TEST_EQ(differ, 0);
+  /* about 1% at 10 bits per key */
+  TEST_CHECK(hits < KEYS * 3 / 100);
+  TEST_EQ(de_bvec_bloom_contains_many(_flt, others, KEYS, NULL), hits);
+}
+
+int main(u0) {
+  /* sequential ids and random keys, the two halves of the key space */
+  for (usize i = 0; i < KEYS; ++i) {
+    keys[i] = i % 2 ? (u64)i : test_rand();
+    others[i] = i % 2 ? (u64)(KEYS + i) : test_rand();
+  }
+
+  const de_bvec_simd best = de_bvec_simd_detect();
+  de_bvec_simd_select(DE_BVEC_SIMD_SCALAR);
+  de_bvec_bloom want = build(0, KEYS, false);
+  check_lookups(&want);
+
+  for (int level = DE_BVEC_SIMD_SCALAR; level <= (int)best; ++level) {
+    de_bvec_simd_select((de_bvec_simd)level);
+    de_bvec_bloom single = build(0, KEYS, false);
+    de_bvec_bloom batched = build(0, KEYS, true);
+    TEST_SAME(&single.msk, &want.msk, "insert");
+    TEST_SAME(&batched.msk, &want.msk, "insert_many");
+    check_lookups(&batched);
+
+    de_bvec_bloom half = build(0, KEYS / 3, false);
+    de_bvec_bloom rest = build(KEYS / 3, KEYS, true);
+    de_bvec_bloom_merge(&half, &rest);
+    TEST_SAME(&half.msk, &want.msk, "merge");
+
+    de_bvec_bloom_clear(&half);
+    TEST_EQ(de_bvec_count_refresh(&half.msk), 0);
+    TEST_EQ(de_bvec_bloom_contains_many(&half, keys, KEYS, NULL), 0);
+
+    de_bvec_bloom_delete(&half);
+    de_bvec_bloom_delete(&rest);
+    de_bvec_bloom_delete(&batched);
+    de_bvec_bloom_delete(&single);
+  }
+  de_bvec_simd_select(best);
+  de_bvec_bloom_delete(&want);
+
+  /* tiny filters still get one block */
+  de_bvec_bloom tiny = de_bvec_bloom_create(0, 10);
+  TEST_CHECK(de_bvec_bloom_info_valid(&tiny));
+  TEST_CHECK(de_bvec_bloom_info_bytes(&tiny) >= DE_BVEC_BLOOM_BLOCK_BITS / 8);
+  de_bvec_bloom_insert(&tiny, 42);
+  TEST_CHECK(de_bvec_bloom_contains(&tiny, 42));
+  de_bvec_bloom_delete(&tiny);
+  return test_report("bloom");
+}
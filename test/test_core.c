@@ -0,0 +1,283 @@
+/*
+  de_bvec against a bool array. set_range / flip_range used to build the
+  edge masks wrong for ranges that start or end on a block boundary and
+  for ranges inside a single block, so those shapes are listed explicitly
+  before the random ones. The finds and DE_BVEC_FOREACH_SET walk every 1
+  and 0 bit of the result. Everything runs once per SIMD level the cpu
+  supports.
+*/
+#include "test.h"
+
+#include <string.h>
+
+static bool *ref = NULL;
+
+static u0 check_against_ref(de_bvec *const _msk, const char *const _what,
+                            const int _line) {
+  usize ones = 0;
+  for (usize i = 0; i < _msk->bits_amount; ++i) {
+    ones += ref[i];
+    if (de_bvec_get(_msk, i) != ref[i]) {
+      fprintf(stderr, "test_core.c:%d: %s: first mismatch at bit %zu\n",
+              _line, _what, i);
+      ++test_failures;
+      return;
+    }
+  }
+  /* a cached count must still be right, and be right once stored */
+  TEST_EQ(de_bvec_count(_msk), ones);
+  TEST_EQ(de_bvec_count_refresh(_msk), ones);
+  TEST_EQ(de_bvec_count(_msk), ones);
+}
+
+static u0 apply_range(de_bvec *const _msk, const usize _start,
+                      const usize _end, const int _op) {
+  for (usize i = _start; i <= _end; ++i)
+    ref[i] = _op == 2 ? !ref[i] : _op;
+  if (_op == 2)
+    de_bvec_flip_range(_msk, _start, _end);
+  else
+    de_bvec_set_range(_msk, _start, _end, _op);
+}
+
+static u0 test_ranges(const usize _bits) {
+  de_bvec msk = de_bvec_create(_bits);
+  memset(ref, 0, _bits);
+  const usize blk = DE_BVEC_MBLK_BITS;
+  const usize last = _bits - 1;
+  /* {start, end} pairs, clamped to the mask below */
+  const usize shapes[][2] = {
+      {0, 0},           {0, last},         {0, blk - 1},
+      {blk, 2 * blk - 1}, {blk, 3 * blk - 1}, {3, 60},
+      {blk + 1, blk + 1}, {5, blk},         {blk - 1, blk},
+      {blk - 1, 4 * blk}, {2 * blk, 2 * blk}, {last, last},
+  };
+  for (int op = 0; op < 3; ++op) {
+    for (usize s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s) {
+      const usize start = shapes[s][0] < last ? shapes[s][0] : last;
+      const usize end = shapes[s][1] < last ? shapes[s][1] : last;
+      apply_range(&msk, start, end, (op + s) % 3);
+      check_against_ref(&msk, "fixed range", __LINE__);
+    }
+  }
+  for (usize r = 0; r < 200; ++r) {
+    const usize start = test_rand_below(_bits);
+    usize end = start + test_rand_below(r & 1 ? blk : 4 * blk);
+    end = end < last ? end : last;
+    apply_range(&msk, start, end, (int)test_rand_below(3));
+  }
+  check_against_ref(&msk, "random ranges", __LINE__);
+
+  const usize start = test_rand_below(_bits);
+  const usize end = start + test_rand_below(_bits - start);
+  usize ones = 0;
+  for (usize i = start; i <= end; ++i)
+    ones += ref[i];
+  TEST_EQ(de_bvec_count_range(&msk, start, end), ones);
+
+  usize idx = de_bvec_find_first(&msk);
+  for (usize i = 0; i < _bits; ++i) {
+    if (!ref[i])
+      continue;
+    TEST_EQ(idx, i);
+    idx = de_bvec_find_next(&msk, i + 1);
+  }
+  TEST_EQ(idx, DE_BVEC_NPOS);
+
+  idx = de_bvec_find_first_zero(&msk);
+  for (usize i = 0; i < _bits; ++i) {
+    if (ref[i])
+      continue;
+    TEST_EQ(idx, i);
+    idx = de_bvec_find_next_zero(&msk, i + 1);
+  }
+  TEST_EQ(idx, DE_BVEC_NPOS);
+
+  /* the iterator yields the 1 bits in order and nothing else */
+  usize at = 0, wrong = 0, seen = 0;
+  DE_BVEC_FOREACH_SET(&msk, idx) {
+    while (at < idx && at < _bits)
+      wrong += ref[at++];
+    wrong += idx >= _bits || !ref[at++];
+    ++seen;
+  }
+  while (at < _bits)
+    wrong += ref[at++];
+  TEST_EQ(wrong, 0);
+  TEST_EQ(seen, de_bvec_count_refresh(&msk));
+
+  /* a full mask has no zero, until its last bit is cleared */
+  de_bvec_fill(&msk);
+  TEST_EQ(de_bvec_find_first_zero(&msk), DE_BVEC_NPOS);
+  de_bvec_set(&msk, last, false);
+  TEST_EQ(de_bvec_find_first_zero(&msk), last);
+  TEST_EQ(de_bvec_find_next_zero(&msk, last), last);
+  de_bvec_delete(&msk);
+}
+
+/* the bulk ops clip to _dst, and clears _dst past the end of _src */
+static u0 test_ops(const usize _bits) {
+  const usize other = _bits / 2 + 3;
+  de_bvec a = de_bvec_create(_bits), b = de_bvec_create(other);
+  test_fill(&a, 300);
+  test_fill(&b, 500);
+  de_bvec wide = test_resized(&b, _bits);
+
+  de_bvec got = de_bvec_create(0);
+  for (int op = 0; op < 3; ++op) {
+    de_bvec_copy(&got, &a);
+    if (op == 0)
+      de_bvec_and_msk(&got, &b);
+    else if (op == 1)
+      de_bvec_or_msk(&got, &b);
+    else
+      de_bvec_xor_msk(&got, &b);
+    for (usize i = 0; i < _bits; ++i) {
+      const bool x = de_bvec_get(&a, i), y = de_bvec_get(&wide, i);
+      ref[i] = op == 0 ? x && y : op == 1 ? x || y : x != y;
+    }
+    check_against_ref(&got, op == 0 ? "and" : op == 1 ? "or" : "xor",
+                      __LINE__);
+  }
+  de_bvec_copy(&got, &a);
+  de_bvec_not(&got);
+  for (usize i = 0; i < _bits; ++i)
+    ref[i] = !de_bvec_get(&a, i);
+  check_against_ref(&got, "not", __LINE__);
+
+  de_bvec_delete(&got);
+  de_bvec_delete(&wide);
+  de_bvec_delete(&a);
+  de_bvec_delete(&b);
+}
+
+/* the batched calls, in order, like the single bit calls they replace */
+static u0 test_batch(const usize _bits) {
+  enum { AMOUNT = 700 };
+  static usize idx[AMOUNT];
+  static bool out[AMOUNT];
+  de_bvec msk = de_bvec_create(_bits);
+  test_fill(&msk, 400);
+  for (usize i = 0; i < _bits; ++i)
+    ref[i] = de_bvec_get(&msk, i);
+
+  for (usize r = 0; r < 4; ++r) {
+    /* random indices, some repeated right away and some later on */
+    for (usize i = 0; i < AMOUNT; ++i)
+      idx[i] = i && i % 7 == 0   ? idx[i - 1]
+               : i && i % 11 == 0 ? idx[test_rand_below(i)]
+                                  : test_rand_below(_bits);
+
+    de_bvec_get_many(&msk, idx, AMOUNT, out);
+    usize wrong = 0;
+    for (usize i = 0; i < AMOUNT; ++i)
+      wrong += out[i] != ref[idx[i]];
+    TEST_EQ(wrong, 0);
+
+    const bool value = r % 2;
+    de_bvec_set_many(&msk, idx, AMOUNT, value);
+    for (usize i = 0; i < AMOUNT; ++i)
+      ref[idx[i]] = value;
+    check_against_ref(&msk, "set_many", __LINE__);
+
+    /* a repeated index is flipped back */
+    de_bvec_flip_many(&msk, idx, AMOUNT);
+    for (usize i = 0; i < AMOUNT; ++i)
+      ref[idx[i]] = !ref[idx[i]];
+    check_against_ref(&msk, "flip_many", __LINE__);
+
+    /* a repeated index sees its own first call and is not fresh again */
+    de_bvec_flip_many(&msk, idx, AMOUNT / 2);
+    for (usize i = 0; i < AMOUNT / 2; ++i)
+      ref[idx[i]] = !ref[idx[i]];
+    usize fresh = 0;
+    wrong = 0;
+    const usize got =
+        de_bvec_test_and_set_many(&msk, idx, AMOUNT, r < 2 ? out : NULL);
+    for (usize i = 0; i < AMOUNT; ++i) {
+      wrong += r < 2 && out[i] != ref[idx[i]];
+      fresh += !ref[idx[i]];
+      ref[idx[i]] = true;
+    }
+    TEST_EQ(wrong, 0);
+    TEST_EQ(got, fresh);
+    check_against_ref(&msk, "test_and_set_many", __LINE__);
+  }
+
+  /* an empty list changes nothing */
+  de_bvec_set_many(&msk, idx, 0, false);
+  de_bvec_flip_many(&msk, idx, 0);
+  TEST_EQ(de_bvec_test_and_set_many(&msk, idx, 0, out), 0);
+  de_bvec_get_many(&msk, idx, 0, out);
+  check_against_ref(&msk, "empty batch", __LINE__);
+  de_bvec_delete(&msk);
+}
+
+/* fused counts and the early exit predicates, sizes are zero padded */
+static u0 check_counts(const de_bvec *const _a, const de_bvec *const _b) {
+  const usize bits =
+      _a->bits_amount > _b->bits_amount ? _a->bits_amount : _b->bits_amount;
+  usize and_n = 0, or_n = 0, xor_n = 0, andnot_n = 0;
+  for (usize i = 0; i < bits; ++i) {
+    const bool x = i < _a->bits_amount && de_bvec_get(_a, i);
+    const bool y = i < _b->bits_amount && de_bvec_get(_b, i);
+    and_n += x && y;
+    or_n += x || y;
+    xor_n += x != y;
+    andnot_n += x && !y;
+  }
+  TEST_EQ(de_bvec_and_count(_a, _b), and_n);
+  TEST_EQ(de_bvec_or_count(_a, _b), or_n);
+  TEST_EQ(de_bvec_xor_count(_a, _b), xor_n);
+  TEST_EQ(de_bvec_andnot_count(_a, _b), andnot_n);
+  TEST_EQ(de_bvec_intersects(_a, _b), and_n != 0);
+  TEST_EQ(de_bvec_is_subset(_a, _b), andnot_n == 0);
+}
+
+static u0 test_counts(const usize _bits) {
+  const usize others[] = {_bits, _bits / 2 + 3, _bits + 70};
+  de_bvec a = de_bvec_create(_bits);
+  test_fill(&a, 300);
+  for (usize o = 0; o < 3; ++o) {
+    de_bvec b = de_bvec_create(others[o]);
+    test_fill(&b, 500);
+    check_counts(&a, &b);
+    check_counts(&b, &a);
+
+    /* a superset of a, then a disjoint mask, both one bit off */
+    de_bvec sup = test_resized(&a, others[o]);
+    de_bvec_or_msk(&sup, &b);
+    check_counts(&a, &sup);
+    const usize last = others[o] < _bits ? others[o] - 1 : _bits - 1;
+    de_bvec_set(&sup, last, !de_bvec_get(&a, last));
+    check_counts(&a, &sup);
+    de_bvec_copy(&sup, &a);
+    de_bvec_not(&sup);
+    check_counts(&a, &sup);
+    de_bvec_set(&sup, last, true);
+    check_counts(&a, &sup);
+    de_bvec_delete(&sup);
+    de_bvec_delete(&b);
+  }
+  de_bvec_delete(&a);
+}
+
+int main(u0) {
+  ref = (bool *)malloc(test_sizes[TEST_SIZES_AMOUNT - 1]);
+  if (!ref)
+    return EXIT_FAILURE;
+  /* the kernels are picked at runtime, run everything on each of them */
+  const de_bvec_simd best = de_bvec_simd_detect();
+  for (int level = DE_BVEC_SIMD_SCALAR; level <= (int)best; ++level) {
+    de_bvec_simd_select((de_bvec_simd)level);
+    for (usize s = 0; s < TEST_SIZES_AMOUNT; ++s) {
+      test_ranges(test_sizes[s]);
+      test_ops(test_sizes[s]);
+      test_counts(test_sizes[s]);
+      test_batch(test_sizes[s]);
+    }
+  }
+  de_bvec_simd_select(best);
+  free(ref);
+  return test_report("core");
+}
@@ -0,0 +1,79 @@
+/*
+  de_bvec_ewah against de_bvec. A result has the size of _dst, a shorter
+  _src reads as 0 past its end and the bits of a longer one past the end
+  of _dst, even inside its last word, are dropped.
+*/
+#include "test.h"
+
+#include <de_bitmask_ewah.h>
+
+static u0 check(const de_bvec_ewah *const _got, const de_bvec *const _want,
+                const char *const _what) {
+  TEST_CHECK(de_bvec_ewah_info_valid(_got));
+  TEST_EQ(de_bvec_ewah_info_size(_got), _want->bits_amount);
+  de_bvec dense = de_bvec_ewah_to_bvec(_got);
+  TEST_SAME(&dense, _want, _what);
+  TEST_EQ(de_bvec_ewah_count(_got), de_bvec_count_refresh(&dense));
+  TEST_EQ(de_bvec_ewah_any(_got), de_bvec_any(_want));
+  for (usize r = 0; r < 64 && _want->bits_amount; ++r) {
+    const usize i = test_rand_below(_want->bits_amount);
+    TEST_EQ(de_bvec_ewah_get(_got, i), de_bvec_get(_want, i));
+  }
+  de_bvec_delete(&dense);
+}
+
+static u0 test_ops(const usize _a_bits, const usize _b_bits,
+                   const u32 _density) {
+  de_bvec a = de_bvec_create(_a_bits), b = de_bvec_create(_b_bits);
+  test_fill(&a, _density);
+  test_fill(&b, 1000 - _density);
+  de_bvec fit_b = test_resized(&b, _a_bits);
+  de_bvec_ewah ea = de_bvec_ewah_from_bvec(&a);
+  de_bvec_ewah eb = de_bvec_ewah_from_bvec(&b);
+  check(&ea, &a, "from_bvec");
+  check(&eb, &b, "from_bvec");
+
+  de_bvec want = de_bvec_create(0);
+  de_bvec_ewah got = de_bvec_ewah_create(0);
+  for (int op = 0; op < 3; ++op) {
+    de_bvec_copy(&want, &a);
+    de_bvec_ewah_copy(&got, &ea);
+    if (op == 0) {
+      de_bvec_and_msk(&want, &fit_b);
+      de_bvec_ewah_and_msk(&got, &eb);
+    } else if (op == 1) {
+      de_bvec_or_msk(&want, &fit_b);
+      de_bvec_ewah_or_msk(&got, &eb);
+    } else {
+      de_bvec_xor_msk(&want, &fit_b);
+      de_bvec_ewah_xor_msk(&got, &eb);
+    }
+    check(&got, &want, op == 0 ? "and" : op == 1 ? "or" : "xor");
+    de_bvec_not(&want);
+    de_bvec_ewah_not(&got);
+    check(&got, &want, "not");
+  }
+
+  de_bvec_ewah_delete(&got);
+  de_bvec_ewah_delete(&ea);
+  de_bvec_ewah_delete(&eb);
+  de_bvec_delete(&want);
+  de_bvec_delete(&fit_b);
+  de_bvec_delete(&a);
+  de_bvec_delete(&b);
+}
+
+int main(u0) {
+  for (usize s = 0; s < TEST_SIZES_AMOUNT; ++s) {
+    const usize bits = test_sizes[s];
+    /* sparse, run heavy and literal heavy streams */
+    test_ops(bits, bits, 2);
+    test_ops(bits, bits, 500);
+    test_ops(bits, bits / 2 + 1, 30);
+    test_ops(bits / 2 + 1, bits, 970);
+    /* the last word of _dst is partly covered by _src */
+    test_ops(bits, bits + 5, 500);
+    test_ops(bits + 5, bits, 998);
+  }
+  return test_report("ewah");
+}
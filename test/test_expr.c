@@ -0,0 +1,163 @@
+/*
+  de_bvec_expr against the same expression evaluated one op at a time
+  with de_bvec. Random trees over leaves of different sizes cover the zero
+  padding, several tiles per operand and nodes shared by two parents.
+  Results written over an operand cover every way the output can alias
+  the inputs.
+*/
+#include "test.h"
+
+#include <de_bitmask_expr.h>
+
+#define LEAVES 4
+
+static de_bvec leaves[LEAVES];
+static de_bvec padded[LEAVES];
+static usize most = 0;
+
+typedef struct {
+  de_bvec_expr_id id;
+  de_bvec dense; /* value at the size of the largest leaf */
+  usize reach;   /* largest leaf below this node */
+} node;
+
+static node build(de_bvec_expr *const _expr, const usize _depth) {
+  node out;
+  const usize op = _depth ? test_rand_below(6) : 5;
+  if (op == 5) {
+    const usize l = test_rand_below(LEAVES);
+    out.id = de_bvec_expr_leaf(_expr, &leaves[l]);
+    out.dense = de_bvec_create(0);
+    de_bvec_copy(&out.dense, &padded[l]);
+    out.reach = leaves[l].bits_amount;
+    return out;
+  }
+  node lhs = build(_expr, _depth - 1);
+  if (op == 4) {
+    out.id = de_bvec_expr_not(_expr, lhs.id);
+    de_bvec_not(&lhs.dense);
+    lhs.id = out.id;
+    return lhs;
+  }
+  /* sometimes reuse lhs as rhs, the DAG then shares the node */
+  node rhs;
+  if (test_rand_below(5) == 0) {
+    rhs = lhs;
+    rhs.dense = de_bvec_create(0);
+    de_bvec_copy(&rhs.dense, &lhs.dense);
+  } else {
+    rhs = build(_expr, _depth - 1);
+  }
+  switch (op) {
+  case 0:
+    out.id = de_bvec_expr_and(_expr, lhs.id, rhs.id);
+    de_bvec_and_msk(&lhs.dense, &rhs.dense);
+    break;
+  case 1:
+    out.id = de_bvec_expr_or(_expr, lhs.id, rhs.id);
+    de_bvec_or_msk(&lhs.dense, &rhs.dense);
+    break;
+  case 2:
+    out.id = de_bvec_expr_xor(_expr, lhs.id, rhs.id);
+    de_bvec_xor_msk(&lhs.dense, &rhs.dense);
+    break;
+  default:
+    out.id = de_bvec_expr_andnot(_expr, lhs.id, rhs.id);
+    de_bvec_not(&rhs.dense);
+    de_bvec_and_msk(&lhs.dense, &rhs.dense);
+    break;
+  }
+  out.dense = lhs.dense;
+  out.reach = lhs.reach > rhs.reach ? lhs.reach : rhs.reach;
+  de_bvec_delete(&rhs.dense);
+  return out;
+}
+
+static u0 test_expr(const usize _bits) {
+  most = 0;
+  for (usize l = 0; l < LEAVES; ++l) {
+    const usize bits = l ? test_rand_below(_bits) + 1 : _bits;
+    leaves[l] = de_bvec_create(bits);
+    test_fill(&leaves[l], (u32)test_rand_below(1000));
+    most = bits > most ? bits : most;
+  }
+  for (usize l = 0; l < LEAVES; ++l)
+    padded[l] = test_resized(&leaves[l], most);
+
+  de_bvec_expr expr = de_bvec_expr_create();
+  de_bvec got = de_bvec_create(0);
+  for (usize r = 0; r < 8; ++r) {
+    de_bvec_expr_clear(&expr);
+    node root = build(&expr, 1 + r % 4);
+    de_bvec want = test_resized(&root.dense, root.reach);
+    TEST_CHECK(de_bvec_expr_eval(&expr, root.id, &got));
+    TEST_SAME(&got, &want, "eval");
+    TEST_EQ(de_bvec_expr_count(&expr, root.id),
+            de_bvec_count_refresh(&want));
+    de_bvec_delete(&want);
+    de_bvec_delete(&root.dense);
+  }
+
+  /* the result may overwrite either operand, or both at once */
+  de_bvec_expr_id x = DE_BVEC_EXPR_INVALID;
+  for (usize k = 0; k < 12; ++k) {
+    const usize op = k / 2;
+    de_bvec *const into = &leaves[k % 2];
+    const usize reach =
+        op == 4 || leaves[1].bits_amount < leaves[0].bits_amount
+            ? leaves[0].bits_amount
+            : leaves[1].bits_amount;
+    de_bvec want = test_resized(&leaves[0], reach);
+    de_bvec rhs = test_resized(&leaves[op == 5 ? 0 : 1], reach);
+    de_bvec_expr_clear(&expr);
+    const de_bvec_expr_id l = de_bvec_expr_leaf(&expr, &leaves[0]);
+    const de_bvec_expr_id r =
+        de_bvec_expr_leaf(&expr, &leaves[op == 5 ? 0 : 1]);
+    if (op == 0) {
+      x = de_bvec_expr_and(&expr, l, r);
+      de_bvec_and_msk(&want, &rhs);
+    } else if (op == 1) {
+      x = de_bvec_expr_or(&expr, l, r);
+      de_bvec_or_msk(&want, &rhs);
+    } else if (op == 2) {
+      x = de_bvec_expr_xor(&expr, l, r);
+      de_bvec_xor_msk(&want, &rhs);
+    } else if (op == 4) {
+      x = de_bvec_expr_not(&expr, l);
+      de_bvec_not(&want);
+    } else {
+      x = de_bvec_expr_andnot(&expr, l, r);
+      de_bvec_not(&rhs);
+      de_bvec_and_msk(&want, &rhs);
+    }
+    TEST_CHECK(de_bvec_expr_eval(&expr, x, op == 5 ? &leaves[0] : into));
+    TEST_SAME(op == 5 ? &leaves[0] : into, &want, "eval into an operand");
+    de_bvec_delete(&rhs);
+    de_bvec_delete(&want);
+  }
+
+  /* an invalid root is rejected and leaves _dst alone */
+  TEST_CHECK(!de_bvec_expr_eval(&expr, DE_BVEC_EXPR_INVALID, &got));
+  TEST_EQ(de_bvec_expr_count(&expr, DE_BVEC_EXPR_INVALID), DE_BVEC_NPOS);
+  TEST_EQ(de_bvec_expr_and(&expr, x, DE_BVEC_EXPR_INVALID),
+          DE_BVEC_EXPR_INVALID);
+
+  de_bvec_delete(&got);
+  de_bvec_expr_delete(&expr);
+  for (usize l = 0; l < LEAVES; ++l) {
+    de_bvec_delete(&leaves[l]);
+    de_bvec_delete(&padded[l]);
+  }
+}
+
+int main(u0) {
+  /* the ops run through the kernels, once per SIMD level */
+  const de_bvec_simd best = de_bvec_simd_detect();
+  for (int level = DE_BVEC_SIMD_SCALAR; level <= (int)best; ++level) {
+    de_bvec_simd_select((de_bvec_simd)level);
+    for (usize s = 0; s < TEST_SIZES_AMOUNT; ++s)
+      test_expr(test_sizes[s]);
+  }
+  de_bvec_simd_select(best);
+  return test_report("expr");
+}
@@ -0,0 +1,123 @@
+/*
+  DE_BVEC_DEFINE_FIXED sets against de_bvec of the same size. 1 and 130
+  bits leave most of the last block unused, 64 and 512 fill it exactly;
+  every step compares the whole set through to_bvec, which also shows
+  when a whole-set operation lets a bit past the end through.
+*/
+#include "test.h"
+
+#include <de_bitmask_fixed.h>
+
+DE_BVEC_DEFINE_FIXED(fixed1, 1)
+DE_BVEC_DEFINE_FIXED(fixed64, 64)
+DE_BVEC_DEFINE_FIXED(fixed130, 130)
+DE_BVEC_DEFINE_FIXED(fixed512, 512)
+
+#define TEST_FIXED(_name, _bits)                                               \
+  static u0 check_##_name(const _name *const _got,                             \
+                          const de_bvec *const _want,                          \
+                          const char *const _what) {                           \
+    de_bvec dense = de_bvec_create(0);                                         \
+    _name##_to_bvec(_got, &dense);                                             \
+    TEST_SAME(&dense, _want, _what);                                           \
+    TEST_EQ(_name##_count(_got), de_bvec_count_refresh(&dense));               \
+    TEST_EQ(_name##_any(_got), de_bvec_any(_want));                            \
+    TEST_EQ(_name##_none(_got), !de_bvec_any(_want));                          \
+    TEST_EQ(_name##_all(_got), de_bvec_all(_want));                            \
+    usize idx = _name##_find_first(_got);                                      \
+    TEST_EQ(idx, de_bvec_find_first(_want));                                   \
+    for (usize r = 0; r < 8 && idx != DE_BVEC_NPOS; ++r) {                     \
+      const usize next = _name##_find_next(_got, idx + 1);                     \
+      TEST_EQ(next, de_bvec_find_next(_want, idx + 1));                        \
+      idx = next;                                                              \
+    }                                                                          \
+    /* the blocks past the end of the set must stay 0 */                       \
+    _name back = _name##_create();                                             \
+    _name##_from_bvec(&back, &dense);                                          \
+    TEST_CHECK(_name##_equal(&back, _got));                                    \
+    de_bvec_delete(&dense);                                                    \
+  }                                                                            \
+                                                                               \
+  static u0 test_##_name(u0) {                                                 \
+    _name a = _name##_create(), b = _name##_create();                          \
+    de_bvec want_a = de_bvec_create(_bits), want_b = de_bvec_create(_bits);    \
+    check_##_name(&a, &want_a, #_name " create");                              \
+    for (usize r = 0; r < 64; ++r) {                                           \
+      /* single bits and ranges, including ones of the whole set */            \
+      const usize i = test_rand_below(_bits);                                  \
+      const bool value = test_rand_below(2);                                   \
+      _name##_set(&a, i, value);                                               \
+      de_bvec_set(&want_a, i, value);                                          \
+      TEST_EQ(_name##_get(&a, i), value);                                      \
+      const usize j = test_rand_below(_bits);                                  \
+      _name##_flip(&b, j);                                                     \
+      de_bvec_set(&want_b, j, !de_bvec_get(&want_b, j));                       \
+      const usize start = r % 5 ? test_rand_below(_bits) : 0;                  \
+      const usize end =                                                        \
+          r % 7 ? start + test_rand_below(_bits - start) : (usize)(_bits) - 1; \
+      _name##_set_range(r % 2 ? &a : &b, start, end, value);                   \
+      de_bvec_set_range(r % 2 ? &want_a : &want_b, start, end, value);         \
+    }                                                                          \
+    check_##_name(&a, &want_a, #_name " set / set_range");                     \
+    check_##_name(&b, &want_b, #_name " flip / set_range");                    \
+    TEST_EQ(_name##_and_count(&a, &b), de_bvec_and_count(&want_a, &want_b));   \
+    TEST_EQ(_name##_equal(&a, &b), de_bvec_xor_count(&want_a, &want_b) == 0);  \
+                                                                               \
+    for (int op = 0; op < 4; ++op) {                                           \
+      _name got = a;                                                           \
+      de_bvec want = de_bvec_create(0);                                        \
+      de_bvec_copy(&want, &want_a);                                            \
+      if (op == 0) {                                                           \
+        _name##_and_msk(&got, &b);                                             \
+        de_bvec_and_msk(&want, &want_b);                                       \
+      } else if (op == 1) {                                                    \
+        _name##_or_msk(&got, &b);                                              \
+        de_bvec_or_msk(&want, &want_b);                                        \
+      } else if (op == 2) {                                                    \
+        _name##_xor_msk(&got, &b);                                             \
+        de_bvec_xor_msk(&want, &want_b);                                       \
+      } else {                                                                 \
+        _name##_andnot_msk(&got, &b);                                          \
+        TEST_EQ(_name##_count(&got),                                           \
+                de_bvec_andnot_count(&want_a, &want_b));                       \
+        de_bvec_not(&want);                                                    \
+        de_bvec_or_msk(&want, &want_b);                                        \
+        de_bvec_not(&want);                                                    \
+      }                                                                        \
+      check_##_name(&got, &want,                                               \
+                    op == 0   ? #_name " and"                                  \
+                    : op == 1 ? #_name " or"                                   \
+                    : op == 2 ? #_name " xor"                                  \
+                              : #_name " andnot");                             \
+      _name##_not(&got);                                                       \
+      de_bvec_not(&want);                                                      \
+      check_##_name(&got, &want, #_name " not");                               \
+      de_bvec_delete(&want);                                                   \
+    }                                                                          \
+                                                                               \
+    _name##_fill(&a);                                                          \
+    de_bvec_fill(&want_a);                                                     \
+    check_##_name(&a, &want_a, #_name " fill");                                \
+    TEST_CHECK(_name##_all(&a));                                               \
+    _name##_set(&a, (_bits) - 1, false);                                       \
+    de_bvec_set(&want_a, (_bits) - 1, false);                                  \
+    check_##_name(&a, &want_a, #_name " fill, last bit cleared");              \
+    _name##_clear(&a);                                                         \
+    de_bvec_clear(&want_a);                                                    \
+    check_##_name(&a, &want_a, #_name " clear");                               \
+    de_bvec_delete(&want_a);                                                   \
+    de_bvec_delete(&want_b);                                                   \
+  }
+
+TEST_FIXED(fixed1, 1)
+TEST_FIXED(fixed64, 64)
+TEST_FIXED(fixed130, 130)
+TEST_FIXED(fixed512, 512)
+
+int main(u0) {
+  test_fixed1();
+  test_fixed64();
+  test_fixed130();
+  test_fixed512();
+  return test_report("fixed");
+}
@@ -0,0 +1,151 @@
+/*
+  de_bvec_hybrid against de_bvec. Densities are picked so each operation
+  runs with both operands sparse, both dense and one of each, and the
+  edits cross the promote / demote thresholds.
+*/
+#include "test.h"
+
+#include <de_bitmask_hybrid.h>
+
+static u0 check(const de_bvec_hybrid *const _got, const de_bvec *const _want,
+                const char *const _what) {
+  TEST_CHECK(de_bvec_hybrid_info_valid(_got));
+  TEST_EQ(de_bvec_hybrid_info_size(_got), _want->bits_amount);
+  de_bvec dense = de_bvec_hybrid_to_bvec(_got);
+  TEST_SAME(&dense, _want, _what);
+  de_bvec_delete(&dense);
+  TEST_EQ(de_bvec_hybrid_count(_got),
+          de_bvec_count_refresh((de_bvec *)_want));
+  TEST_EQ(de_bvec_hybrid_any(_got), de_bvec_any(_want));
+  usize idx = de_bvec_hybrid_find_first(_got);
+  usize want_idx = de_bvec_find_first(_want);
+  for (usize r = 0; r < 64 && want_idx != DE_BVEC_NPOS; ++r) {
+    TEST_EQ(idx, want_idx);
+    idx = de_bvec_hybrid_find_next(_got, want_idx + 1);
+    want_idx = de_bvec_find_next(_want, want_idx + 1);
+  }
+  TEST_EQ(idx, want_idx);
+}
+
+static u0 test_edits(const usize _bits) {
+  de_bvec want = de_bvec_create(_bits);
+  de_bvec_hybrid got = de_bvec_hybrid_create(_bits);
+  /* grows past the promote threshold one bit at a time */
+  for (usize r = 0; r < _bits / 8 + 8; ++r) {
+    const usize i = test_rand_below(_bits);
+    de_bvec_set(&want, i, true);
+    de_bvec_hybrid_set(&got, i, true);
+  }
+  check(&got, &want, "set");
+  for (usize r = 0; r < 500; ++r) {
+    const usize i = test_rand_below(_bits);
+    de_bvec_flip(&want, i);
+    de_bvec_hybrid_flip(&got, i);
+  }
+  check(&got, &want, "flip");
+  for (usize r = 0; r < 16; ++r) {
+    const usize start = test_rand_below(_bits);
+    const usize end = start + test_rand_below(_bits - start);
+    de_bvec_set_range(&want, start, end, r & 1);
+    de_bvec_hybrid_set_range(&got, start, end, r & 1);
+  }
+  check(&got, &want, "set_range");
+  /* back down to a handful of bits, optimize has to demote */
+  de_bvec_clear(&want);
+  de_bvec_hybrid_set_range(&got, 0, _bits - 1, false);
+  for (usize r = 0; r < 3; ++r) {
+    const usize i = test_rand_below(_bits);
+    de_bvec_set(&want, i, true);
+    de_bvec_hybrid_set(&got, i, true);
+  }
+  de_bvec_hybrid_optimize(&got);
+  check(&got, &want, "optimize");
+  TEST_CHECK(_bits < 4096 || de_bvec_hybrid_info_sparse(&got));
+  de_bvec_hybrid_clear(&got);
+  de_bvec_clear(&want);
+  check(&got, &want, "clear");
+  de_bvec_hybrid_delete(&got);
+  de_bvec_delete(&want);
+}
+
+static u0 test_ops(const usize _dst_bits, const usize _src_bits,
+                   const u32 _dst_density, const u32 _src_density) {
+  de_bvec a = de_bvec_create(_dst_bits), b = de_bvec_create(_src_bits);
+  for (usize i = 0; i < _dst_bits; ++i)
+    if (test_rand_below(1000) < _dst_density)
+      de_bvec_set(&a, i, true);
+  for (usize i = 0; i < _src_bits; ++i)
+    if (test_rand_below(1000) < _src_density)
+      de_bvec_set(&b, i, true);
+  de_bvec wide = test_resized(&b, _dst_bits);
+  de_bvec_hybrid ha = de_bvec_hybrid_from_bvec(&a);
+  de_bvec_hybrid hb = de_bvec_hybrid_from_bvec(&b);
+  check(&ha, &a, "from_bvec");
+  check(&hb, &b, "from_bvec");
+
+  de_bvec both = de_bvec_create(0);
+  de_bvec_copy(&both, &a);
+  de_bvec_and_msk(&both, &wide);
+  TEST_EQ(de_bvec_hybrid_and_count(&ha, &hb), de_bvec_count_refresh(&both));
+  de_bvec_delete(&both);
+
+  de_bvec want = de_bvec_create(0);
+  de_bvec_hybrid got = de_bvec_hybrid_create(0);
+  for (int op = 0; op < 3; ++op) {
+    de_bvec_copy(&want, &a);
+    de_bvec_hybrid_copy(&got, &ha);
+    if (op == 0) {
+      de_bvec_and_msk(&want, &wide);
+      de_bvec_hybrid_and_msk(&got, &hb);
+    } else if (op == 1) {
+      de_bvec_or_msk(&want, &wide);
+      de_bvec_hybrid_or_msk(&got, &hb);
+    } else {
+      de_bvec_xor_msk(&want, &wide);
+      de_bvec_hybrid_xor_msk(&got, &hb);
+    }
+    check(&got, &want, op == 0 ? "and" : op == 1 ? "or" : "xor");
+  }
+
+  de_bvec_hybrid_delete(&got);
+  de_bvec_hybrid_delete(&ha);
+  de_bvec_hybrid_delete(&hb);
+  de_bvec_delete(&want);
+  de_bvec_delete(&wide);
+  de_bvec_delete(&a);
+  de_bvec_delete(&b);
+}
+
+/* sparse | a dense mask holding few bits stays sparse */
+static u0 test_or_demotes(u0) {
+  const usize bits = (usize)1 << 20;
+  de_bvec full = de_bvec_create(bits);
+  de_bvec_set_range(&full, 0, bits - 1, true);
+  de_bvec_hybrid src = de_bvec_hybrid_from_bvec(&full);
+  de_bvec_hybrid_set_range(&src, 0, bits - 1, false);
+  de_bvec_hybrid_set(&src, 5, true);
+  de_bvec_hybrid dst = de_bvec_hybrid_create(bits);
+  de_bvec_hybrid_set(&dst, 9, true);
+  de_bvec_hybrid_or_msk(&dst, &src);
+  TEST_CHECK(de_bvec_hybrid_info_sparse(&dst));
+  TEST_EQ(de_bvec_hybrid_count(&dst), 2);
+  de_bvec_hybrid_delete(&dst);
+  de_bvec_hybrid_delete(&src);
+  de_bvec_delete(&full);
+}
+
+int main(u0) {
+  static const u32 densities[][2] = {
+      {1, 2}, {1, 600}, {600, 1}, {500, 500}};
+  for (usize s = 0; s < TEST_SIZES_AMOUNT; ++s) {
+    const usize bits = test_sizes[s];
+    test_edits(bits);
+    for (usize d = 0; d < sizeof(densities) / sizeof(densities[0]); ++d) {
+      test_ops(bits, bits, densities[d][0], densities[d][1]);
+      test_ops(bits, bits / 2 + 1, densities[d][0], densities[d][1]);
+      test_ops(bits / 2 + 1, bits, densities[d][0], densities[d][1]);
+    }
+  }
+  test_or_demotes();
+  return test_report("hybrid");
+}
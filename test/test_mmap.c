@@ -0,0 +1,126 @@
+/*
+  de_bvec_mmap against de_bvec: a mask written through a writable map
+  has to read back the same after reopening, growing has to reach the
+  file, private maps must not. A mask moved onto map.msk detaches it, the
+  file must stay as it was. Crafted files with a wrong magic, a short
+  body or a size whose block count overflows must be refused.
+  The files are created in the working directory.
+*/
+#include "test.h"
+
+#include <de_bitmask_mmap.h>
+
+#define TEST_PATH "test_mmap.bin"
+
+static u0 check_file(const de_bvec *const _want, const char *const _what) {
+  de_bvec_mmap map;
+  TEST_CHECK(de_bvec_mmap_open(&map, TEST_PATH, DE_BVEC_MMAP_READ));
+  if (test_failures)
+    return;
+  TEST_SAME(&map.msk, _want, _what);
+  de_bvec_mmap_close(&map);
+}
+
+static u0 test_round_trip(const usize _bits) {
+  de_bvec want = de_bvec_create(_bits);
+  test_fill(&want, 300);
+
+  de_bvec_mmap map;
+  TEST_CHECK(de_bvec_mmap_create(&map, TEST_PATH, _bits));
+  if (test_failures)
+    return;
+  de_bvec_or_msk(&map.msk, &want);
+  TEST_CHECK(de_bvec_mmap_flush(&map, false));
+  TEST_CHECK(de_bvec_mmap_close(&map));
+  check_file(&want, "create");
+
+  /* growing through the allocator extends the file */
+  TEST_CHECK(de_bvec_mmap_open(&map, TEST_PATH, DE_BVEC_MMAP_WRITE));
+  de_bvec_resize(&map.msk, _bits * 2 + 5);
+  de_bvec_set(&map.msk, _bits * 2 + 4, true);
+  de_bvec_flip_range(&map.msk, 0, _bits - 1);
+  TEST_CHECK(de_bvec_mmap_close(&map));
+  de_bvec_resize(&want, _bits * 2 + 5);
+  de_bvec_set(&want, _bits * 2 + 4, true);
+  de_bvec_flip_range(&want, 0, _bits - 1);
+  check_file(&want, "grow");
+
+  /* private changes stay in memory */
+  TEST_CHECK(de_bvec_mmap_open(&map, TEST_PATH, DE_BVEC_MMAP_PRIVATE));
+  de_bvec_not(&map.msk);
+  TEST_CHECK(!de_bvec_mmap_flush(&map, false));
+  de_bvec_mmap_close(&map);
+  check_file(&want, "private");
+
+  /* a moved in mask has its own storage, nothing reaches the file */
+  TEST_CHECK(de_bvec_mmap_open(&map, TEST_PATH, DE_BVEC_MMAP_WRITE));
+  de_bvec other = de_bvec_create(_bits + 70);
+  test_fill(&other, 500);
+  de_bvec_move(&map.msk, &other);
+  TEST_CHECK(!de_bvec_mmap_flush(&map, true));
+  TEST_CHECK(!de_bvec_mmap_close(&map));
+  check_file(&want, "detached");
+
+  de_bvec_delete(&want);
+  remove(TEST_PATH);
+}
+
+/* writes a header and _blocks blocks of alternating bits */
+static bool write_file(const u64 _magic, const u64 _bits, const usize _blocks,
+                       const usize _header_bytes) {
+  FILE *const file = fopen(TEST_PATH, "wb");
+  if (!file)
+    return false;
+  u64 header[8] = {_magic, _bits};
+  bool ok = fwrite(header, 1, _header_bytes, file) == _header_bytes;
+  for (usize i = 0; i < _blocks && ok; ++i) {
+    const u64 block = 0x5555555555555555ull;
+    ok = fwrite(&block, sizeof(block), 1, file) == 1;
+  }
+  return fclose(file) == 0 && ok;
+}
+
+static u0 test_crafted(u0) {
+  const u64 magic = 0x50414d4d56424544ull; /* "DEBVMMAP" */
+  de_bvec_mmap map;
+
+  /* a well formed file written by hand, the last block is cut to 100 bits */
+  TEST_CHECK(write_file(magic, 100, 2, 64));
+  TEST_CHECK(de_bvec_mmap_open(&map, TEST_PATH, DE_BVEC_MMAP_READ));
+  if (!test_failures) {
+    TEST_EQ(map.msk.bits_amount, 100);
+    TEST_CHECK(de_bvec_get(&map.msk, 0) && !de_bvec_get(&map.msk, 1));
+    de_bvec_mmap_close(&map);
+  }
+
+  struct {
+    u64 magic, bits;
+    usize blocks, header_bytes;
+  } const bad[] = {
+      {magic ^ 1, 100, 2, 64},           /* wrong magic */
+      {magic, 100, 2, 40},               /* header cut short */
+      {magic, 64 * 40 + 1, 40, 64},      /* one block missing */
+      {magic, (u64)1 << 40, 4, 64},      /* far past the file */
+      {magic, ~(u64)0, 4, 64},           /* block count overflows */
+      {magic, ~(u64)0 - 70, 4, 64},      /* so does the byte count */
+      {magic, (u64)(usize)-1 / 8 + 1, 4, 64},
+  };
+  for (usize i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+    TEST_CHECK(write_file(bad[i].magic, bad[i].bits, bad[i].blocks,
+                          bad[i].header_bytes));
+    const bool opened = de_bvec_mmap_open(&map, TEST_PATH, DE_BVEC_MMAP_READ);
+    if (opened) {
+      fprintf(stderr, "%s: crafted file %zu was accepted\n", __FILE__, i);
+      ++test_failures;
+      de_bvec_mmap_close(&map);
+    }
+  }
+  remove(TEST_PATH);
+}
+
+int main(u0) {
+  for (usize s = 0; s < TEST_SIZES_AMOUNT; ++s)
+    test_round_trip(test_sizes[s]);
+  test_crafted();
+  return test_report("mmap");
+}
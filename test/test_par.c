@@ -0,0 +1,89 @@
+/*
+  de_bvec_par_* against the serial de_bvec functions. The threshold is
+  dropped so even the smallest masks go through the pool, and the largest
+  sizes split into several chunks per thread.
+*/
+#include "test.h"
+
+#include <de_bitmask_par.h>
+
+static u0 test_ops(const usize _dst_bits, const usize _src_bits) {
+  de_bvec a = de_bvec_create(_dst_bits), b = de_bvec_create(_src_bits);
+  test_fill(&a, 400);
+  test_fill(&b, 600);
+  de_bvec want = de_bvec_create(0), got = de_bvec_create(0);
+  for (int op = 0; op < 4; ++op) {
+    de_bvec_copy(&want, &a);
+    de_bvec_copy(&got, &a);
+    if (op == 0) {
+      de_bvec_and_msk(&want, &b);
+      de_bvec_par_and_msk(&got, &b);
+    } else if (op == 1) {
+      de_bvec_or_msk(&want, &b);
+      de_bvec_par_or_msk(&got, &b);
+    } else if (op == 2) {
+      de_bvec_xor_msk(&want, &b);
+      de_bvec_par_xor_msk(&got, &b);
+    } else {
+      de_bvec_not(&want);
+      de_bvec_par_not(&got);
+    }
+    TEST_SAME(&got, &want,
+              op == 0 ? "and" : op == 1 ? "or" : op == 2 ? "xor" : "not");
+    TEST_EQ(de_bvec_par_count_refresh(&got), de_bvec_count_refresh(&want));
+    TEST_EQ(de_bvec_par_count(&got), de_bvec_count(&want));
+    TEST_EQ(de_bvec_par_any(&got), de_bvec_any(&want));
+    TEST_EQ(de_bvec_par_all(&got), de_bvec_all(&want));
+  }
+  de_bvec_delete(&got);
+  de_bvec_delete(&want);
+  de_bvec_delete(&a);
+  de_bvec_delete(&b);
+}
+
+/* any / all stop early, the deciding bit sits in the last block */
+static u0 test_early_exit(const usize _bits) {
+  de_bvec msk = de_bvec_create(_bits);
+  de_bvec_par_fill(&msk);
+  TEST_EQ(de_bvec_par_count_refresh(&msk), _bits);
+  TEST_CHECK(de_bvec_par_all(&msk));
+  de_bvec_set(&msk, _bits - 1, false);
+  TEST_CHECK(!de_bvec_par_all(&msk));
+  TEST_EQ(de_bvec_par_any(&msk), _bits > 1);
+  de_bvec_par_clear(&msk);
+  TEST_EQ(de_bvec_par_count_refresh(&msk), 0);
+  TEST_CHECK(!de_bvec_par_any(&msk));
+  de_bvec_set(&msk, _bits - 1, true);
+  TEST_CHECK(de_bvec_par_any(&msk));
+  TEST_EQ(de_bvec_par_all(&msk), _bits == 1);
+  de_bvec_delete(&msk);
+}
+
+static u0 test_all_sizes(u0) {
+  const usize chunk_bits = DE_BVEC_PAR_CHUNK_BLOCKS * DE_BVEC_MBLK_BITS;
+  for (usize s = 0; s < TEST_SIZES_AMOUNT + 2; ++s) {
+    const usize bits = s < TEST_SIZES_AMOUNT ? test_sizes[s]
+                       : s == TEST_SIZES_AMOUNT ? chunk_bits
+                                                : chunk_bits * 5 + 77;
+    test_ops(bits, bits);
+    test_ops(bits, bits / 2 + 1);
+    test_ops(bits / 2 + 1, bits);
+    test_early_exit(bits);
+  }
+}
+
+int main(u0) {
+  /* before init every call runs serially */
+  test_ops(70000, 70000);
+  if (!de_bvec_par_init(4)) {
+    fprintf(stderr, "par: no worker thread could be started\n");
+    return EXIT_FAILURE;
+  }
+  de_bvec_par_set_threshold(0);
+  TEST_EQ(de_bvec_par_threads(), 4);
+  test_all_sizes();
+  de_bvec_par_shutdown();
+  TEST_EQ(de_bvec_par_threads(), 1);
+  test_ops(70000, 35001);
+  return test_report("par");
+}
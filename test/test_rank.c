@@ -0,0 +1,72 @@
+/*
+  de_bvec_rank against prefix counts taken bit by bit with de_bvec_get.
+  rank is checked at every index, select for every 1 bit, before and
+  after partial updates and a rebuild.
+*/
+#include "test.h"
+
+#include <de_bitmask_rank.h>
+
+static usize *prefix = NULL;
+
+static u0 check(const de_bvec_rank *const _rank, const de_bvec *const _msk,
+                const char *const _what) {
+  TEST_CHECK(de_bvec_rank_info_valid(_rank));
+  const usize bits = _msk->bits_amount;
+  prefix[0] = 0;
+  for (usize i = 0; i < bits; ++i)
+    prefix[i + 1] = prefix[i] + de_bvec_get(_msk, i);
+  usize bad = 0;
+  for (usize i = 0; i <= bits && !bad; ++i) {
+    bad += de_bvec_rank1(_rank, i) != prefix[i];
+    bad += de_bvec_rank0(_rank, i) != i - prefix[i];
+  }
+  for (usize i = 0; i < bits && !bad; ++i)
+    if (prefix[i + 1] != prefix[i])
+      bad += de_bvec_select1(_rank, prefix[i]) != i;
+  if (bad) {
+    fprintf(stderr, "%s: %s: rank / select mismatch at %zu bits\n",
+            __FILE__, _what, bits);
+    ++test_failures;
+  }
+  TEST_EQ(de_bvec_select1(_rank, prefix[bits]), DE_BVEC_NPOS);
+}
+
+static u0 test_rank(const usize _bits, const u32 _density) {
+  de_bvec msk = de_bvec_create(_bits);
+  test_fill(&msk, _density);
+  de_bvec_rank rank = de_bvec_rank_create(&msk);
+  check(&rank, &msk, "create");
+
+  for (usize r = 0; r < 8; ++r) {
+    const usize start = test_rand_below(_bits);
+    usize end = start + test_rand_below(r & 1 ? 64 : 2000);
+    end = end < _bits ? end : _bits - 1;
+    if (r % 3 == 0)
+      de_bvec_flip_range(&msk, start, end);
+    else
+      de_bvec_set_range(&msk, start, end, r & 1);
+    de_bvec_rank_update(&rank, start, end);
+  }
+  check(&rank, &msk, "update");
+
+  de_bvec_not(&msk);
+  de_bvec_rank_rebuild(&rank);
+  check(&rank, &msk, "rebuild");
+
+  de_bvec_rank_delete(&rank);
+  de_bvec_delete(&msk);
+}
+
+int main(u0) {
+  const usize most = test_sizes[TEST_SIZES_AMOUNT - 1];
+  prefix = (usize *)malloc((most + 1) * sizeof(usize));
+  if (!prefix)
+    return EXIT_FAILURE;
+  for (usize s = 0; s < TEST_SIZES_AMOUNT; ++s) {
+    test_rank(test_sizes[s], 5);
+    test_rank(test_sizes[s], 500);
+  }
+  free(prefix);
+  return test_report("rank");
+}
@@ -0,0 +1,100 @@
+/*
+  de_bvec_roaring against de_bvec. Operands of different sizes are run in
+  both directions: the result keeps the size of _dst, bits of a longer
+  _src past its end are dropped.
+*/
+#include "test.h"
+
+#include <de_bitmask_roaring.h>
+
+static u0 check(const de_bvec_roaring *const _got, const de_bvec *const _want,
+                const char *const _what) {
+  TEST_CHECK(de_bvec_roaring_info_valid(_got));
+  de_bvec dense = de_bvec_roaring_to_bvec(_got);
+  TEST_SAME(&dense, _want, _what);
+  TEST_EQ(de_bvec_roaring_count(_got), de_bvec_count_refresh(&dense));
+  TEST_EQ(de_bvec_roaring_any(_got), de_bvec_any(_want));
+  for (usize r = 0; r < 64 && _want->bits_amount; ++r) {
+    const usize i = test_rand_below(_want->bits_amount);
+    TEST_EQ(de_bvec_roaring_get(_got, i), de_bvec_get(_want, i));
+  }
+  de_bvec_delete(&dense);
+}
+
+static u0 test_edits(const usize _bits) {
+  de_bvec want = de_bvec_create(_bits);
+  de_bvec_roaring got = de_bvec_roaring_create(_bits);
+  for (usize r = 0; r < 2000; ++r) {
+    const usize i = test_rand_below(_bits);
+    const bool v = test_rand_below(4) != 0;
+    de_bvec_set(&want, i, v);
+    de_bvec_roaring_set(&got, i, v);
+  }
+  check(&got, &want, "set");
+  for (usize r = 0; r < 16; ++r) {
+    const usize start = test_rand_below(_bits);
+    const usize end = start + test_rand_below(_bits - start);
+    de_bvec_set_range(&want, start, end, r & 1);
+    de_bvec_roaring_set_range(&got, start, end, r & 1);
+  }
+  check(&got, &want, "set_range");
+  de_bvec_roaring_run_optimize(&got);
+  check(&got, &want, "run_optimize");
+  de_bvec_roaring_clear(&got);
+  de_bvec_clear(&want);
+  check(&got, &want, "clear");
+  de_bvec_roaring_delete(&got);
+  de_bvec_delete(&want);
+}
+
+static u0 test_ops(const usize _dst_bits, const usize _src_bits) {
+  de_bvec a = de_bvec_create(_dst_bits), b = de_bvec_create(_src_bits);
+  test_fill(&a, 20);
+  test_fill(&b, 600);
+  de_bvec wide = test_resized(&b, _dst_bits);
+  de_bvec_roaring ra = de_bvec_roaring_from_bvec(&a);
+  de_bvec_roaring rb = de_bvec_roaring_from_bvec(&b);
+  check(&ra, &a, "from_bvec");
+  check(&rb, &b, "from_bvec");
+
+  de_bvec want = de_bvec_create(0);
+  de_bvec_roaring got = de_bvec_roaring_create(0);
+  for (int op = 0; op < 3; ++op) {
+    de_bvec_copy(&want, &a);
+    de_bvec_roaring_copy(&got, &ra);
+    if (op == 0) {
+      de_bvec_and_msk(&want, &wide);
+      de_bvec_roaring_and_msk(&got, &rb);
+    } else if (op == 1) {
+      de_bvec_or_msk(&want, &wide);
+      de_bvec_roaring_or_msk(&got, &rb);
+    } else {
+      de_bvec_xor_msk(&want, &wide);
+      de_bvec_roaring_xor_msk(&got, &rb);
+    }
+    TEST_EQ(de_bvec_roaring_info_size(&got), _dst_bits);
+    check(&got, &want, op == 0 ? "and" : op == 1 ? "or" : "xor");
+  }
+
+  de_bvec_roaring_delete(&got);
+  de_bvec_roaring_delete(&ra);
+  de_bvec_roaring_delete(&rb);
+  de_bvec_delete(&want);
+  de_bvec_delete(&wide);
+  de_bvec_delete(&a);
+  de_bvec_delete(&b);
+}
+
+int main(u0) {
+  for (usize s = 0; s < TEST_SIZES_AMOUNT; ++s) {
+    const usize bits = test_sizes[s];
+    test_edits(bits);
+    test_ops(bits, bits);
+    test_ops(bits, bits / 2 + 1);
+    test_ops(bits / 2 + 1, bits);
+  }
+  /* keys past the last chunk of the smaller side */
+  test_ops(65536 * 3 + 100, 65536 + 7);
+  test_ops(65536 + 7, 65536 * 3 + 100);
+  return test_report("roaring");
+}
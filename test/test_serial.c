@@ -0,0 +1,170 @@
+/*
+  de_bvec_serial round trips for every flag combination, rejection of
+  truncated and corrupted buffers, and the zero-copy view: it has to read
+  like the saved mask, write into the buffer unless it is an inline copy,
+  and refuse a payload with bits set past the stored size. Crafted
+  compressed headers must be refused before anything is allocated.
+*/
+#include "test.h"
+
+#include <de_bitmask_serial.h>
+
+#include <string.h>
+
+static u64 read_u64(const u8 *const _src) {
+  u64 out = 0;
+  for (usize i = 0; i < 8; ++i)
+    out |= (u64)_src[i] << (8 * i);
+  return out;
+}
+
+static usize allocs;
+
+static mblk_t *counting_alloc(de_bvec_allocator *const _self,
+                              const usize _blocks) {
+  (u0)_self;
+  ++allocs;
+  return (mblk_t *)calloc(_blocks, sizeof(mblk_t));
+}
+
+static u0 counting_dealloc(de_bvec_allocator *const _self,
+                           mblk_t *const _data, const usize _blocks) {
+  (u0)_self;
+  (u0)_blocks;
+  free(_data);
+}
+
+/* a compressed buffer holding the single EWAH marker _marker */
+static u0 write_packed(u8 *const _buffer, const u64 _bits, const u64 _marker) {
+  const u64 fields[] = {0x53564244 | (u64)1 << 32 |
+                            (u64)DE_BVEC_SERIAL_COMPRESS << 48,
+                        _bits, 8, 0, 0, 0, 0, 0, _marker};
+  for (usize f = 0; f < 9; ++f)
+    for (usize i = 0; i < 8; ++i)
+      _buffer[f * 8 + i] = (u8)(fields[f] >> (8 * i));
+}
+
+static u0 test_crafted(u0) {
+  de_bvec_allocator counting = {.alloc = counting_alloc,
+                                .dealloc = counting_dealloc,
+                                .realloc = NULL};
+  de_bvec got = de_bvec_create_with(3, &counting);
+  u8 buffer[DE_BVEC_SERIAL_HEADER_BYTES + 8];
+
+  /* a run of 10 filled blocks */
+  write_packed(buffer, 640, 1 | 10 << 1);
+  TEST_CHECK(de_bvec_serial_load(&got, buffer, sizeof(buffer)));
+  TEST_EQ(got.bits_amount, 640);
+  TEST_EQ(de_bvec_count_refresh(&got), 640);
+  TEST_EQ(allocs, 1);
+
+  /* sizes the stream does not cover, or past the limit */
+  static const u64 bad[][2] = {
+      {(u64)1 << 34, 1 | 10 << 1},
+      {641, 1 | 10 << 1},
+      {640, 1 | 11 << 1},
+      {DE_BVEC_SERIAL_MAX_BITS + 64,
+       1 | (DE_BVEC_SERIAL_MAX_BITS / 64 + 1) << 1},
+      {~(u64)0, 1 | (u64)0xffffffff << 1},
+  };
+  allocs = 0;
+  for (usize i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+    write_packed(buffer, bad[i][0], bad[i][1]);
+    TEST_CHECK(!de_bvec_serial_load(&got, buffer, sizeof(buffer)));
+  }
+  TEST_EQ(allocs, 0);
+  TEST_EQ(got.bits_amount, 640);
+  de_bvec_delete(&got);
+}
+
+static u0 test_round_trip(const de_bvec *const _msk, const u32 _flags) {
+  const usize bound = de_bvec_serial_bound(_msk);
+  u8 *const buffer = (u8 *)malloc(bound);
+  if (!buffer) {
+    ++test_failures;
+    return;
+  }
+  const usize bytes = de_bvec_serial_save(_msk, buffer, bound, _flags);
+  TEST_CHECK(bytes >= DE_BVEC_SERIAL_HEADER_BYTES && bytes <= bound);
+  TEST_EQ(de_bvec_serial_save(_msk, buffer, bytes - 1, _flags), 0);
+  de_bvec_serial_save(_msk, buffer, bound, _flags);
+
+  de_bvec got = de_bvec_create(3);
+  TEST_CHECK(de_bvec_serial_load(&got, buffer, bytes));
+  TEST_SAME(&got, _msk, "load");
+  TEST_EQ(de_bvec_count_refresh(&got), de_bvec_count_refresh((de_bvec *)_msk));
+
+  /* failed loads leave _dst as it was */
+  TEST_CHECK(!de_bvec_serial_load(&got, buffer, bytes - 1));
+  TEST_CHECK(!de_bvec_serial_load(&got, buffer, DE_BVEC_SERIAL_HEADER_BYTES -
+                                                    1));
+  if (_flags & DE_BVEC_SERIAL_CHECKSUM) {
+    buffer[bytes - 1] ^= 0x10;
+    TEST_CHECK(!de_bvec_serial_load(&got, buffer, bytes));
+    buffer[bytes - 1] ^= 0x10;
+  }
+  TEST_SAME(&got, _msk, "failed load");
+  de_bvec_delete(&got);
+  free(buffer);
+}
+
+static u0 test_view(const de_bvec *const _msk, const u32 _flags) {
+  const usize bound = de_bvec_serial_bound(_msk);
+  u8 *const buffer = (u8 *)malloc(bound);
+  if (!buffer) {
+    ++test_failures;
+    return;
+  }
+  const usize bytes = de_bvec_serial_save(_msk, buffer, bound, _flags);
+  de_bvec_serial_view view;
+  TEST_CHECK(de_bvec_serial_view_create(&view, buffer, bytes, true));
+  TEST_SAME(&view.msk, _msk, "view");
+
+  /* writes land in the buffer, small masks are inline copies */
+  const usize idx = test_rand_below(_msk->bits_amount);
+  const bool old = de_bvec_get(_msk, idx);
+  de_bvec_set(&view.msk, idx, !old);
+  de_bvec copy = de_bvec_create(0);
+  de_bvec_copy(&copy, _msk);
+  de_bvec_set(&copy, idx, !old);
+  de_bvec loaded = de_bvec_create(0);
+  if (!(_flags & DE_BVEC_SERIAL_CHECKSUM) &&
+      _msk->bits_amount > DE_BVEC_INLINE_BITS) {
+    TEST_CHECK(de_bvec_serial_load(&loaded, buffer, bytes));
+    TEST_SAME(&loaded, &copy, "write through the view");
+  }
+  de_bvec_delete(&view.msk);
+  de_bvec_delete(&loaded);
+  de_bvec_delete(&copy);
+
+  /* a stored bit past the size cannot be cleared, the view refuses it */
+  if (_msk->bits_amount % DE_BVEC_MBLK_BITS && !_flags) {
+    de_bvec_serial_save(_msk, buffer, bound, 0);
+    const usize payload = (usize)read_u64(buffer + 16);
+    buffer[DE_BVEC_SERIAL_HEADER_BYTES + payload - 1] |= 0x80;
+    TEST_CHECK(!de_bvec_serial_view_create(&view, buffer, bytes, false));
+  }
+  free(buffer);
+}
+
+int main(u0) {
+  static const u32 flags[] = {0, DE_BVEC_SERIAL_CHECKSUM,
+                              DE_BVEC_SERIAL_COMPRESS,
+                              DE_BVEC_SERIAL_CHECKSUM |
+                                  DE_BVEC_SERIAL_COMPRESS};
+  for (usize s = 0; s < TEST_SIZES_AMOUNT; ++s) {
+    for (usize d = 0; d < 3; ++d) {
+      de_bvec msk = de_bvec_create(test_sizes[s]);
+      test_fill(&msk, d == 0 ? 1 : d == 1 ? 500 : 999);
+      for (usize f = 0; f < sizeof(flags) / sizeof(flags[0]); ++f)
+        test_round_trip(&msk, flags[f]);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      test_view(&msk, 0);
+      test_view(&msk, DE_BVEC_SERIAL_CHECKSUM);
+#endif
+      de_bvec_delete(&msk);
+    }
+  }
+  test_crafted();
+  return test_report("serial");
+}
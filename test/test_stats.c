@@ -0,0 +1,118 @@
+/*
+  The opt-in usage counters, built with DE_CONTAINER_BITMASK_STATS. Calls,
+  bytes, create counts and the size histogram have to match what the test
+  did since the last reset, a reset has to start over from 0, and the
+  largest sizes must land in the last histogram bucket instead of past it.
+*/
+#include "test.h"
+
+#include <string.h>
+
+#ifndef DE_CONTAINER_BITMASK_STATS
+#error "test_stats needs DE_CONTAINER_BITMASK_STATS"
+#endif
+
+static mblk_t *refuse_alloc(de_bvec_allocator *const _self,
+                            const usize _blocks) {
+  (u0)_self;
+  (u0)_blocks;
+  return NULL;
+}
+
+static u0 refuse_dealloc(de_bvec_allocator *const _self, mblk_t *const _data,
+                         const usize _blocks) {
+  (u0)_self;
+  (u0)_data;
+  (u0)_blocks;
+}
+
+static u0 test_counters(u0) {
+  de_bvec_stats stats;
+  de_bvec_stats_reset();
+  de_bvec_stats_snapshot(&stats);
+  for (usize op = 0; op < DE_BVEC_STATS_OP_COUNT; ++op)
+    TEST_EQ(stats.calls[op], 0);
+
+  de_bvec small = de_bvec_create(100);
+  de_bvec big = de_bvec_create(1000);
+  de_bvec_set(&big, 999, true);
+  TEST_CHECK(de_bvec_any(&big));
+  TEST_CHECK(!de_bvec_none(&big));
+  TEST_CHECK(de_bvec_none(&small));
+  de_bvec_stats_snapshot(&stats);
+
+  /* create goes through create_with, both count */
+  TEST_EQ(stats.calls[DE_BVEC_STATS_OP_create], 2);
+  TEST_EQ(stats.calls[DE_BVEC_STATS_OP_create_with], 2);
+  TEST_EQ(stats.calls[DE_BVEC_STATS_OP_set], 1);
+  /* none is counted once, not as an any as well */
+  TEST_EQ(stats.calls[DE_BVEC_STATS_OP_any], 1);
+  TEST_EQ(stats.calls[DE_BVEC_STATS_OP_none], 2);
+  TEST_EQ(stats.inline_creates, 1);
+  TEST_EQ(stats.heap_creates, 1);
+  TEST_EQ(stats.allocs, 1);
+  /* 100 and 1000 bits have a bit length of 7 and 10 */
+  TEST_EQ(stats.create_bits[7], 1);
+  TEST_EQ(stats.create_bits[10], 1);
+
+  /* a full pass over both masks, unless the count was known */
+#ifdef DE_CONTAINER_BITMASK_CACHED_COUNT
+  TEST_EQ(stats.bytes[DE_BVEC_STATS_OP_none], 0);
+#else
+  TEST_EQ(stats.bytes[DE_BVEC_STATS_OP_none],
+          (big.block_count + small.block_count) * sizeof(mblk_t));
+#endif
+  TEST_CHECK(!strcmp(de_bvec_stats_op_name(DE_BVEC_STATS_OP_none), "none"));
+  TEST_CHECK(!strcmp(de_bvec_stats_op_name(DE_BVEC_STATS_OP_COUNT), "?"));
+
+  de_bvec_delete(&big);
+  de_bvec_delete(&small);
+  de_bvec_stats_snapshot(&stats);
+  TEST_EQ(stats.calls[DE_BVEC_STATS_OP_delete], 2);
+  TEST_EQ(stats.frees, 1);
+
+  de_bvec_stats_reset();
+  de_bvec_stats_snapshot(&stats);
+  TEST_EQ(stats.calls[DE_BVEC_STATS_OP_create], 0);
+  TEST_EQ(stats.calls[DE_BVEC_STATS_OP_none], 0);
+  TEST_EQ(stats.heap_creates, 0);
+  TEST_EQ(stats.create_bits[10], 0);
+}
+
+/* sizes of 2^63 bits and up share the last bucket */
+static u0 test_huge_create(u0) {
+  de_bvec_allocator refuse = {.alloc = refuse_alloc,
+                              .dealloc = refuse_dealloc,
+                              .realloc = NULL};
+  de_bvec_stats stats;
+  de_bvec_stats_reset();
+  de_bvec a = de_bvec_create_with((usize)1 << 62, &refuse);
+  de_bvec b = de_bvec_create_with((usize)1 << 63, &refuse);
+  de_bvec c = de_bvec_create_with(~(usize)0 - DE_BVEC_MBLK_BITS, &refuse);
+  TEST_CHECK(!de_bvec_info_valid(&a));
+  de_bvec_stats_snapshot(&stats);
+  TEST_EQ(stats.create_bits[DE_BVEC_STATS_BUCKETS - 1], 3);
+  TEST_EQ(stats.heap_creates, 3);
+  de_bvec_delete(&c);
+  de_bvec_delete(&b);
+  de_bvec_delete(&a);
+
+  /* the dump names what was counted */
+  FILE *const file = tmpfile();
+  if (!file)
+    return;
+  de_bvec_stats_dump(&stats, file);
+  char text[4096] = {0};
+  rewind(file);
+  const usize read = fread(text, 1, sizeof(text) - 1, file);
+  fclose(file);
+  TEST_CHECK(read > 0);
+  TEST_CHECK(strstr(text, "create_with") != NULL);
+  TEST_CHECK(strstr(text, ">=2^62:3") != NULL);
+}
+
+int main(u0) {
+  test_counters();
+  test_huge_create();
+  return test_report("stats");
+}
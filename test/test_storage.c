@@ -0,0 +1,176 @@
+/*
+  Storage management of de_bvec: push_back, append_bits, reserve, resize,
+  shrink_to_fit and move against masks built with de_bvec_set. An
+  allocator that runs out after a set amount of calls checks that a
+  failed grow leaves an invalid mask that later appends do not touch.
+*/
+#include "test.h"
+
+#include <string.h>
+
+typedef struct {
+  de_bvec_allocator base;
+  usize budget; /* calls that still succeed */
+  usize live;   /* blocks handed out and not returned */
+} budget_alloc;
+
+static mblk_t *budget_alloc_fn(de_bvec_allocator *const _self,
+                               const usize _blocks) {
+  budget_alloc *const self = (budget_alloc *)_self;
+  if (!self->budget)
+    return NULL;
+  --self->budget;
+  mblk_t *const out = (mblk_t *)calloc(_blocks ? _blocks : 1, sizeof(mblk_t));
+  self->live += out ? _blocks : 0;
+  return out;
+}
+
+static u0 budget_dealloc_fn(de_bvec_allocator *const _self,
+                            mblk_t *const _data, const usize _blocks) {
+  ((budget_alloc *)_self)->live -= _blocks;
+  free(_data);
+}
+
+static mblk_t *budget_realloc_fn(de_bvec_allocator *const _self,
+                                 mblk_t *const _data, const usize _old_blocks,
+                                 const usize _new_blocks) {
+  budget_alloc *const self = (budget_alloc *)_self;
+  if (!self->budget)
+    return NULL;
+  --self->budget;
+  mblk_t *const out = (mblk_t *)realloc(
+      _data, (_new_blocks ? _new_blocks : 1) * sizeof(mblk_t));
+  if (out)
+    self->live += _new_blocks - _old_blocks;
+  return out;
+}
+
+static budget_alloc budget_create(const usize _budget, const bool _realloc) {
+  return (budget_alloc){
+      .base = {.alloc = budget_alloc_fn,
+               .dealloc = budget_dealloc_fn,
+               .realloc = _realloc ? budget_realloc_fn : NULL},
+      .budget = _budget,
+      .live = 0};
+}
+
+static u0 test_append(const usize _bits) {
+  de_bvec want = de_bvec_create(_bits);
+  test_fill(&want, 500);
+
+  de_bvec got = de_bvec_create(0);
+  for (usize i = 0; i < _bits; ++i)
+    de_bvec_push_back(&got, de_bvec_get(&want, i));
+  TEST_SAME(&got, &want, "push_back");
+  TEST_CHECK(de_bvec_info_capacity(&got) >= _bits);
+  TEST_EQ(de_bvec_count_refresh(&got), de_bvec_count_refresh(&want));
+
+  /* chunks of 0..64 bits at every offset in the block */
+  de_bvec_delete(&got);
+  got = de_bvec_create(0);
+  for (usize i = 0; i < _bits;) {
+    usize amount = test_rand_below(DE_BVEC_MBLK_BITS + 1);
+    amount = amount < _bits - i ? amount : _bits - i;
+    mblk_t chunk = test_rand(); /* bits above amount must be ignored */
+    for (usize b = 0; b < amount; ++b)
+      chunk = (chunk & ~((mblk_t)1 << b)) |
+              ((mblk_t)de_bvec_get(&want, i + b) << b);
+    if (i % 3 == 0 && amount) {
+      de_bvec_push_back(&got, chunk & 1);
+      chunk >>= 1;
+      --amount;
+      ++i;
+    }
+    de_bvec_append_bits(&got, chunk, amount);
+    i += amount;
+  }
+  TEST_SAME(&got, &want, "append_bits");
+  TEST_EQ(de_bvec_count_refresh(&got), de_bvec_count_refresh(&want));
+
+  de_bvec_delete(&got);
+  de_bvec_delete(&want);
+}
+
+static u0 test_sizes_and_move(const usize _bits) {
+  de_bvec want = de_bvec_create(_bits);
+  test_fill(&want, 500);
+  de_bvec got = de_bvec_create(0);
+  de_bvec_copy(&got, &want);
+
+  /* reserve never shrinks, growing adds 0 bits */
+  de_bvec_reserve(&got, _bits / 2);
+  TEST_SAME(&got, &want, "reserve smaller");
+  de_bvec_reserve(&got, _bits * 2 + 3);
+  de_bvec big = test_resized(&want, _bits * 2 + 3);
+  TEST_SAME(&got, &big, "reserve larger");
+  de_bvec_delete(&big);
+
+  /* bits dropped by a shrink read as 0 after growing back */
+  const usize cut = _bits / 3;
+  de_bvec_resize(&got, cut);
+  de_bvec part = test_resized(&want, cut);
+  TEST_SAME(&got, &part, "resize smaller");
+  TEST_EQ(de_bvec_count_refresh(&got), de_bvec_count_refresh(&part));
+  de_bvec_resize(&got, _bits);
+  de_bvec back = test_resized(&part, _bits);
+  TEST_SAME(&got, &back, "resize back");
+
+  de_bvec_shrink_to_fit(&got);
+  TEST_CHECK(de_bvec_info_valid(&got));
+  TEST_CHECK(de_bvec_info_capacity(&got) >= _bits);
+  TEST_CHECK(de_bvec_info_capacity(&got) <
+             _bits + DE_BVEC_MBLK_BITS + DE_BVEC_INLINE_BITS);
+  TEST_SAME(&got, &back, "shrink_to_fit");
+
+  /* move takes the storage, the source ends up empty and reusable */
+  de_bvec dst = de_bvec_create(300);
+  de_bvec_set(&dst, 299, true);
+  de_bvec_move(&dst, &got);
+  TEST_SAME(&dst, &back, "move");
+  TEST_EQ(got.bits_amount, 0);
+  TEST_CHECK(de_bvec_info_valid(&got));
+  de_bvec_push_back(&got, true);
+  TEST_EQ(de_bvec_count_refresh(&got), 1);
+
+  de_bvec_delete(&dst);
+  de_bvec_delete(&got);
+  de_bvec_delete(&back);
+  de_bvec_delete(&part);
+  de_bvec_delete(&want);
+}
+
+/* every grow may be the one that fails */
+static u0 test_failed_grow(const bool _realloc) {
+  for (usize budget = 0; budget < 12; ++budget) {
+    budget_alloc alloc = budget_create(budget, _realloc);
+    de_bvec msk = de_bvec_create_with(0, &alloc.base);
+    usize pushed = 0;
+    for (; pushed < 20000 && de_bvec_info_valid(&msk); ++pushed) {
+      if (pushed % 2)
+        de_bvec_push_back(&msk, true);
+      else
+        de_bvec_append_bits(&msk, ~(mblk_t)0, 7);
+    }
+    if (!de_bvec_info_valid(&msk)) {
+      /* capacity is still reported, the appends must not write */
+      const usize bits = msk.bits_amount;
+      de_bvec_push_back(&msk, true);
+      de_bvec_append_bits(&msk, 1, 64);
+      TEST_EQ(msk.bits_amount, bits);
+      TEST_CHECK(!de_bvec_info_valid(&msk));
+      TEST_CHECK(!de_bvec_any(&msk));
+    }
+    de_bvec_delete(&msk);
+    TEST_EQ(alloc.live, 0);
+  }
+}
+
+int main(u0) {
+  for (usize s = 0; s < TEST_SIZES_AMOUNT; ++s) {
+    test_append(test_sizes[s]);
+    test_sizes_and_move(test_sizes[s]);
+  }
+  test_failed_grow(false);
+  test_failed_grow(true);
+  return test_report("storage");
+}
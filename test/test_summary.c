@@ -0,0 +1,116 @@
+/*
+  de_bvec_summary against de_bvec. The summarized mask and a plain copy
+  get the same edits; the summary's any / none / find have to match the
+  scans of the copy after every step. Masks are kept sparse so find walks
+  across empty regions of every level.
+*/
+#include "test.h"
+
+#include <de_bitmask_summary.h>
+
+static u0 check(const de_bvec_summary *const _sum, const de_bvec *const _want,
+                const char *const _what) {
+  TEST_CHECK(de_bvec_summary_info_valid(_sum));
+  TEST_SAME(_sum->msk, _want, _what);
+  TEST_EQ(de_bvec_summary_any(_sum), de_bvec_any(_want));
+  TEST_EQ(de_bvec_summary_none(_sum), de_bvec_none(_want));
+  usize idx = de_bvec_summary_find_first(_sum);
+  usize want_idx = de_bvec_find_first(_want);
+  for (usize r = 0; r < 4096 && want_idx != DE_BVEC_NPOS; ++r) {
+    TEST_EQ(idx, want_idx);
+    if (idx != want_idx)
+      return;
+    idx = de_bvec_summary_find_next(_sum, want_idx + 1);
+    want_idx = de_bvec_find_next(_want, want_idx + 1);
+  }
+  /* from an arbitrary spot, usually inside an empty region */
+  const usize from = test_rand_below(_want->bits_amount + 1);
+  TEST_EQ(de_bvec_summary_find_next(_sum, from),
+          de_bvec_find_next(_want, from));
+}
+
+static u0 test_summary(const usize _bits) {
+  de_bvec msk = de_bvec_create(_bits), want = de_bvec_create(_bits);
+  de_bvec_summary sum = de_bvec_summary_create(&msk);
+  check(&sum, &want, "empty");
+
+  for (usize r = 0; r < 40; ++r) {
+    const usize i = test_rand_below(_bits);
+    de_bvec_set(&want, i, true);
+    de_bvec_summary_set(&sum, i, true);
+  }
+  check(&sum, &want, "set");
+  for (usize r = 0; r < 40; ++r) {
+    const usize i = test_rand_below(_bits);
+    de_bvec_flip(&want, i);
+    de_bvec_summary_flip(&sum, i);
+  }
+  check(&sum, &want, "flip");
+  for (usize r = 0; r < 8; ++r) {
+    const usize start = test_rand_below(_bits);
+    usize end = start + test_rand_below(300);
+    end = end < _bits ? end : _bits - 1;
+    de_bvec_set_range(&want, start, end, r & 1);
+    de_bvec_summary_set_range(&sum, start, end, r & 1);
+  }
+  check(&sum, &want, "set_range");
+
+  /* edits made on the mask itself, then reported through update */
+  const usize start = test_rand_below(_bits);
+  const usize end = start + test_rand_below(_bits - start);
+  de_bvec_set_range(&msk, start, end, false);
+  de_bvec_set_range(&want, start, end, false);
+  de_bvec_set(&msk, end, true);
+  de_bvec_set(&want, end, true);
+  de_bvec_summary_update(&sum, start, end);
+  check(&sum, &want, "update");
+
+  de_bvec other = de_bvec_create(_bits);
+  for (usize r = 0; r < 20; ++r)
+    de_bvec_set(&other, test_rand_below(_bits), true);
+  de_bvec_or_msk(&want, &other);
+  de_bvec_summary_or_msk(&sum, &other);
+  check(&sum, &want, "or");
+  de_bvec_xor_msk(&want, &other);
+  de_bvec_summary_xor_msk(&sum, &other);
+  check(&sum, &want, "xor");
+  de_bvec_or_msk(&want, &other);
+  de_bvec_summary_or_msk(&sum, &other);
+  de_bvec_and_msk(&want, &other);
+  de_bvec_summary_and_msk(&sum, &other);
+  check(&sum, &want, "and");
+  de_bvec_delete(&other);
+
+  de_bvec_not(&want);
+  de_bvec_summary_not(&sum);
+  check(&sum, &want, "not");
+  de_bvec_not(&want);
+  de_bvec_summary_not(&sum);
+  check(&sum, &want, "not twice");
+
+  de_bvec_resize(&msk, _bits * 2 + 1);
+  de_bvec_resize(&want, _bits * 2 + 1);
+  de_bvec_set(&msk, _bits * 2, true);
+  de_bvec_set(&want, _bits * 2, true);
+  de_bvec_summary_rebuild(&sum);
+  check(&sum, &want, "rebuild");
+
+  de_bvec_summary_fill(&sum);
+  de_bvec_set_range(&want, 0, want.bits_amount - 1, true);
+  check(&sum, &want, "fill");
+  de_bvec_summary_clear(&sum);
+  de_bvec_clear(&want);
+  check(&sum, &want, "clear");
+
+  de_bvec_summary_delete(&sum);
+  de_bvec_delete(&msk);
+  de_bvec_delete(&want);
+}
+
+int main(u0) {
+  for (usize s = 0; s < TEST_SIZES_AMOUNT; ++s)
+    test_summary(test_sizes[s]);
+  /* three levels */
+  test_summary((usize)64 * 64 * 64 * 3 + 5);
+  return test_report("summary");
+}
@@ -0,0 +1,125 @@
+/*
+  de_bvec_view against the same edits done bit by bit on a de_bvec.
+  Windows start at random offsets, so the binary ops run with aligned and
+  misaligned operands; every check compares the whole mask, bits outside
+  the window must not change.
+*/
+#include "test.h"
+
+#include <de_bitmask_view.h>
+
+static u0 test_unary(de_bvec *const _msk, de_bvec *const _want,
+                     const usize _start, const usize _len) {
+  const de_bvec_view view = de_bvec_view_from_bvec(_msk, _start, _len);
+  const usize op = test_rand_below(3);
+  for (usize i = _start; i < _start + _len; ++i)
+    de_bvec_set(_want, i, op == 0 ? false : op == 1 ? true
+                                                    : !de_bvec_get(_want, i));
+  if (op == 0)
+    de_bvec_view_clear(view);
+  else if (op == 1)
+    de_bvec_view_fill(view);
+  else
+    de_bvec_view_not(view);
+  de_bvec_count_invalidate(_msk);
+  TEST_SAME(_msk, _want, op == 0 ? "clear" : op == 1 ? "fill" : "not");
+}
+
+static u0 test_queries(de_bvec *const _msk, const usize _start,
+                       const usize _len) {
+  const de_bvec_view view = de_bvec_view_from_bvec(_msk, _start, _len);
+  usize ones = 0, first = _len;
+  for (usize i = 0; i < _len; ++i) {
+    const bool bit = de_bvec_get(_msk, _start + i);
+    ones += bit;
+    first = bit && first == _len ? i : first;
+    if (i % 97 == 0)
+      TEST_EQ(de_bvec_view_get(view, i), bit);
+  }
+  TEST_EQ(de_bvec_view_count(view), ones);
+  TEST_EQ(de_bvec_view_any(view), ones != 0);
+  TEST_EQ(de_bvec_view_all(view), ones == _len);
+  TEST_EQ(de_bvec_view_find_first(view), first);
+}
+
+static u0 test_binary(de_bvec *const _msk, de_bvec *const _want,
+                      const de_bvec *const _src, const usize _dst_start,
+                      const usize _src_start, const usize _len) {
+  const de_bvec_view dst = de_bvec_view_from_bvec(_msk, _dst_start, _len);
+  const de_bvec_view src =
+      de_bvec_view_from_bvec((de_bvec *)_src, _src_start, _len);
+  const usize op = test_rand_below(4);
+  for (usize i = 0; i < _len; ++i) {
+    const bool x = de_bvec_get(_want, _dst_start + i);
+    const bool y = de_bvec_get(_src, _src_start + i);
+    de_bvec_set(_want, _dst_start + i,
+                op == 0 ? y : op == 1 ? x && y : op == 2 ? x || y : x != y);
+  }
+  if (op == 0)
+    de_bvec_view_copy(dst, src);
+  else if (op == 1)
+    de_bvec_view_and_msk(dst, src);
+  else if (op == 2)
+    de_bvec_view_or_msk(dst, src);
+  else
+    de_bvec_view_xor_msk(dst, src);
+  de_bvec_count_invalidate(_msk);
+  TEST_SAME(_msk, _want,
+            op == 0 ? "copy" : op == 1 ? "and" : op == 2 ? "or" : "xor");
+}
+
+static u0 test_view(const usize _bits) {
+  de_bvec msk = de_bvec_create(_bits), want = de_bvec_create(_bits);
+  de_bvec src = de_bvec_create(_bits);
+  test_fill(&msk, 400);
+  de_bvec_copy(&want, &msk);
+  test_fill(&src, 600);
+
+  for (usize r = 0; r < 48; ++r) {
+    const usize len = test_rand_below(r & 1 ? 200 : _bits) + 1;
+    const usize max_len = len < _bits ? len : _bits;
+    const usize dst_start = test_rand_below(_bits - max_len + 1);
+    /* every third pair shares the offset in the block */
+    usize src_start = test_rand_below(_bits - max_len + 1);
+    if (r % 3 == 0 && src_start % 64 != dst_start % 64 &&
+        src_start - src_start % 64 + dst_start % 64 + max_len <= _bits)
+      src_start = src_start - src_start % 64 + dst_start % 64;
+    test_unary(&msk, &want, dst_start, max_len);
+    test_queries(&msk, dst_start, max_len);
+    test_binary(&msk, &want, &src, dst_start, src_start, max_len);
+  }
+
+  /* a slice of a slice addresses the same bits */
+  if (_bits > 10) {
+    const de_bvec_view all = de_bvec_view_from_bvec(&msk, 3, _bits - 3);
+    const de_bvec_view part = de_bvec_view_slice(all, 5, _bits - 10);
+    for (usize r = 0; r < 64; ++r) {
+      const usize i = test_rand_below(_bits - 10);
+      TEST_EQ(de_bvec_view_get(part, i), de_bvec_get(&msk, 8 + i));
+    }
+  }
+  de_bvec_delete(&src);
+  de_bvec_delete(&want);
+  de_bvec_delete(&msk);
+}
+
+/* a buffer view leaves the bits around it alone */
+static u0 test_buffer(u0) {
+  mblk_t buffer[6] = {0};
+  const de_bvec_view view = de_bvec_view_from_buffer(buffer + 1, 37, 200);
+  de_bvec_view_fill(view);
+  TEST_EQ(buffer[0], 0);
+  TEST_EQ(buffer[1], ~(mblk_t)0 << 37);
+  TEST_EQ(buffer[2], ~(mblk_t)0);
+  TEST_EQ(buffer[3], ~(mblk_t)0);
+  TEST_EQ(buffer[4], ((mblk_t)1 << 45) - 1);
+  TEST_EQ(buffer[5], 0);
+  TEST_EQ(de_bvec_view_count(view), 200);
+}
+
+int main(u0) {
+  for (usize s = 0; s < TEST_SIZES_AMOUNT; ++s)
+    test_view(test_sizes[s]);
+  test_buffer();
+  return test_report("view");
+}